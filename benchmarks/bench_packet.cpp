@@ -0,0 +1,121 @@
+/* benchmarks/bench_packet.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "benchmark.hpp"
+
+#include "packet.hpp"
+
+#include <cstddef>
+#include <string>
+
+// Roughly the shape of a walk reply: a few numbers and a name
+static std::string sample_packet(std::size_t length)
+{
+	PacketBuilder builder(PACKET_WALK, PACKET_REPLY, length);
+	builder.AddShort(1234);
+	builder.AddChar(3);
+	builder.AddThree(70000);
+	builder.AddBreakString("benchmark");
+
+	while (builder.Length() < length)
+		builder.AddChar(int(builder.Length() % 200));
+
+	return builder.Get();
+}
+
+static void bench_packet_encode(benchmark::State &state)
+{
+	PacketProcessor processor;
+	processor.SetEMulti(6, 10);
+	std::string packet = sample_packet(std::size_t(state.range()));
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(processor.Encode(packet));
+
+	state.SetBytesProcessed(state.Iterations() * packet.length());
+}
+EOSERV_BENCHMARK_ARGS(bench_packet_encode, 8, 64, 1024);
+
+static void bench_packet_decode(benchmark::State &state)
+{
+	PacketProcessor encoder;
+	encoder.SetEMulti(10, 6);
+	std::string encoded = encoder.Encode(sample_packet(std::size_t(state.range()))).substr(2);
+
+	PacketProcessor processor;
+	processor.SetEMulti(6, 10);
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(processor.Decode(encoded));
+
+	state.SetBytesProcessed(state.Iterations() * encoded.length());
+}
+EOSERV_BENCHMARK_ARGS(bench_packet_decode, 8, 64, 1024);
+
+static void bench_packet_dickwinder(benchmark::State &state)
+{
+	std::string packet = sample_packet(std::size_t(state.range()));
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(PacketProcessor::DickWinder(packet, 6));
+
+	state.SetBytesProcessed(state.Iterations() * packet.length());
+}
+EOSERV_BENCHMARK_ARGS(bench_packet_dickwinder, 8, 64, 1024);
+
+static void bench_packet_builder(benchmark::State &state)
+{
+	long fields = state.range();
+
+	while (state.KeepRunning())
+	{
+		PacketBuilder builder(PACKET_PLAYERS, PACKET_AGREE);
+
+		for (long i = 0; i < fields; ++i)
+		{
+			builder.AddBreakString("benchmark");
+			builder.AddShort(int(i));
+			builder.AddChar(1);
+			builder.AddInt(int(i * 1000));
+		}
+
+		benchmark::DoNotOptimize(builder.Get());
+	}
+
+	state.SetItemsProcessed(state.Iterations() * std::size_t(fields));
+}
+EOSERV_BENCHMARK_ARGS(bench_packet_builder, 1, 16, 256);
+
+static void bench_packet_reader(benchmark::State &state)
+{
+	long fields = state.range();
+	PacketBuilder builder(PACKET_PLAYERS, PACKET_AGREE);
+
+	for (long i = 0; i < fields; ++i)
+	{
+		builder.AddBreakString("benchmark");
+		builder.AddShort(int(i));
+		builder.AddChar(1);
+		builder.AddInt(int(i * 1000));
+	}
+
+	std::string packet = builder.Get().substr(2);
+
+	while (state.KeepRunning())
+	{
+		PacketReader reader(packet);
+
+		for (long i = 0; i < fields; ++i)
+		{
+			benchmark::DoNotOptimize(reader.GetBreakString());
+			benchmark::DoNotOptimize(reader.GetShort());
+			benchmark::DoNotOptimize(reader.GetChar());
+			benchmark::DoNotOptimize(reader.GetInt());
+		}
+	}
+
+	state.SetItemsProcessed(state.Iterations() * std::size_t(fields));
+}
+EOSERV_BENCHMARK_ARGS(bench_packet_reader, 1, 16, 256);
@@ -0,0 +1,108 @@
+/* benchmarks/bench_rng.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "benchmark.hpp"
+
+#include "util.hpp"
+#include "util/rng.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+
+// The std::rand based generator util::rand used before util::rng, kept as a baseline
+static unsigned long legacy_long_rand()
+{
+	typedef unsigned long ul;
+#if RAND_MAX < 65535
+	return ul(std::rand() & 0xFF) << 24 | ul(std::rand() & 0xFF) << 16 | ul(std::rand() & 0xFF) << 8 | ul(std::rand() & 0xFF);
+#else
+#if RAND_MAX < 4294967295
+	return ul(std::rand() & 0xFFFF) << 16 | ul(std::rand() & 0xFFFF);
+#else
+	return ul(std::rand() & 0xFFFFFFFFU);
+#endif
+#endif
+}
+
+static int legacy_rand(int min, int max)
+{
+	return int(double(legacy_long_rand()) / 4294967296.0 * double(max - min + 1) + double(min));
+}
+
+static double legacy_rand(double min, double max)
+{
+	return double(legacy_long_rand()) / 4294967296.0 * (max - min) + min;
+}
+
+static void bench_rng_legacy_int(benchmark::State &state)
+{
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(legacy_rand(1, 10));
+}
+EOSERV_BENCHMARK(bench_rng_legacy_int);
+
+static void bench_rng_legacy_double(benchmark::State &state)
+{
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(legacy_rand(0.0, 100.0));
+}
+EOSERV_BENCHMARK(bench_rng_legacy_double);
+
+static void bench_rng_util_rand_int(benchmark::State &state)
+{
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(util::rand(1, 10));
+}
+EOSERV_BENCHMARK(bench_rng_util_rand_int);
+
+static void bench_rng_range_int(benchmark::State &state)
+{
+	util::rng rng(1);
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(rng.range(1, 10));
+}
+EOSERV_BENCHMARK(bench_rng_range_int);
+
+static void bench_rng_range_double(benchmark::State &state)
+{
+	util::rng rng(1);
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(rng.range(0.0, 100.0));
+}
+EOSERV_BENCHMARK(bench_rng_range_double);
+
+static void bench_rng_legacy_batch(benchmark::State &state)
+{
+	std::vector<double> rolls(std::size_t(state.range()));
+
+	while (state.KeepRunning())
+	{
+		for (double &roll : rolls)
+			roll = legacy_rand(0.0, 100.0);
+
+		benchmark::DoNotOptimize(rolls.data());
+	}
+
+	state.SetItemsProcessed(state.Iterations() * rolls.size());
+}
+EOSERV_BENCHMARK_ARGS(bench_rng_legacy_batch, 64, 1024);
+
+static void bench_rng_fill(benchmark::State &state)
+{
+	util::rng rng(1);
+	std::vector<double> rolls(std::size_t(state.range()));
+
+	while (state.KeepRunning())
+	{
+		rng.fill(rolls.data(), rolls.size(), 0.0, 100.0);
+		benchmark::DoNotOptimize(rolls.data());
+	}
+
+	state.SetItemsProcessed(state.Iterations() * rolls.size());
+}
+EOSERV_BENCHMARK_ARGS(bench_rng_fill, 64, 1024);
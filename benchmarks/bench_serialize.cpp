@@ -0,0 +1,53 @@
+/* benchmarks/bench_serialize.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "benchmark.hpp"
+
+#include "character.hpp"
+
+#include "util.hpp"
+#include "util/id_vector.hpp"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+static void bench_item_serialize(benchmark::State &state)
+{
+	util::id_vector<Character_Item> inventory;
+
+	for (long i = 1; i <= state.range(); ++i)
+		inventory.insert(Character_Item(short(i), int(i * 37)));
+
+	std::string out;
+
+	while (state.KeepRunning())
+	{
+		out.clear();
+		ItemSerialize(out, inventory);
+		benchmark::DoNotOptimize(out);
+	}
+
+	state.SetItemsProcessed(state.Iterations() * std::size_t(state.range()));
+}
+EOSERV_BENCHMARK_ARGS(bench_item_serialize, 8, 64, 512);
+
+static void bench_quest_serialize(benchmark::State &state)
+{
+	// Active quests need a loaded quest file, so only the inactive states are covered
+	std::map<short, std::shared_ptr<Quest_Context>> active;
+	std::set<Character_QuestState> inactive;
+
+	for (long i = 1; i <= state.range(); ++i)
+		inactive.insert(Character_QuestState{short(i), "done", "kills=" + util::to_string(int(i))});
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(QuestSerialize(active, inactive));
+
+	state.SetItemsProcessed(state.Iterations() * std::size_t(state.range()));
+}
+EOSERV_BENCHMARK_ARGS(bench_quest_serialize, 4, 32);
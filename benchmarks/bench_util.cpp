@@ -0,0 +1,99 @@
+/* benchmarks/bench_util.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "benchmark.hpp"
+
+#include "config.hpp"
+#include "i18n.hpp"
+#include "timer.hpp"
+
+#include "util.hpp"
+#include "util/rpn.hpp"
+#include "util/variant.hpp"
+
+#include <cstddef>
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static void bench_rpn_eval(benchmark::State &state)
+{
+	// The default hp formula from formulas.ini
+	std::stack<std::string> formula = util::rpn_parse_v2("10 + level * 2.5 + (5 * floor(level / 10) * (floor(level / 10) + 1))"
+		" + floor(level / 10) * (level % 10) + con * 1.25 * (floor(level / 10) + 1)");
+
+	std::unordered_map<std::string, double> vars{{"level", 57.0}, {"con", 30.0}};
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(util::rpn_eval(formula, vars));
+}
+EOSERV_BENCHMARK(bench_rpn_eval);
+
+static void bench_config_read(benchmark::State &state)
+{
+	std::string contents;
+
+	for (long i = 0; i < state.range(); ++i)
+		contents += "## Setting" + util::to_string(int(i)) + " (number)\n# A description of the setting\nSetting" + util::to_string(int(i)) + " = " + util::to_string(int(i * 7)) + "\n\n";
+
+	std::string filename = benchmark::TemporaryFile("config_" + util::to_string(int(state.range())) + ".ini", contents);
+
+	while (state.KeepRunning())
+	{
+		Config config;
+		config.Read(filename);
+		benchmark::DoNotOptimize(config);
+	}
+
+	state.SetItemsProcessed(state.Iterations() * std::size_t(state.range()));
+}
+EOSERV_BENCHMARK_ARGS(bench_config_read, 16, 256);
+
+static void bench_i18n_format(benchmark::State &state)
+{
+	std::string filename = benchmark::TemporaryFile("lang.ini",
+		"announce_removed=Attention!! {1} has been removed from the game -{2} [{3}]\n"
+		"map_evacuate=Warning! - please leave this map in {1} seconds or be sent to jail.\n");
+
+	I18N i18n(filename);
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(i18n.Format("announce_removed", "Someone", "Admin", "banned"));
+}
+EOSERV_BENCHMARK(bench_i18n_format);
+
+static void bench_i18n_format_fixed(benchmark::State &state)
+{
+	std::string filename = benchmark::TemporaryFile("lang.ini", "map_evacuate_block=You cannot enter this map right now as it is being evacuated.\n");
+
+	I18N i18n(filename);
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(i18n.Format("map_evacuate_block"));
+}
+EOSERV_BENCHMARK(bench_i18n_format_fixed);
+
+static void bench_timer_callback(void *param)
+{
+	++*static_cast<std::size_t *>(param);
+}
+
+static void bench_timer_tick(benchmark::State &state)
+{
+	Timer timer;
+	std::size_t calls = 0;
+
+	// Most events are waiting, a few are due on every tick
+	for (long i = 0; i < state.range(); ++i)
+		timer.Register(new TimeEvent(bench_timer_callback, &calls, (i % 10 == 0) ? 0.0 : 3600.0, Timer::FOREVER));
+
+	while (state.KeepRunning())
+		timer.Tick();
+
+	benchmark::DoNotOptimize(calls);
+	state.SetItemsProcessed(state.Iterations() * std::size_t(state.range()));
+}
+EOSERV_BENCHMARK_ARGS(bench_timer_tick, 16, 256, 4096);
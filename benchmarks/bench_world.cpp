@@ -0,0 +1,331 @@
+/* benchmarks/bench_world.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "benchmark.hpp"
+
+#include "config.hpp"
+#include "eodata.hpp"
+#include "eoserv_config.hpp"
+#include "map.hpp"
+#include "npc.hpp"
+#include "npc_data.hpp"
+#include "packet.hpp"
+#include "timer.hpp"
+#include "world.hpp"
+
+#include "util.hpp"
+#include "util/rng.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Each map holds the same number of NPCs, so smaller maps are more crowded
+// The last map is only used by the NPC scan benchmarks, and holds many more
+static const int bench_map_sizes[] = {16, 32, 64, 128, 120};
+static const int bench_map_npcs = 200;
+static const int bench_scan_map_size = 120;
+static const int bench_scan_map_npcs = 10000;
+
+static std::string eo_number(unsigned int number, std::size_t size)
+{
+	std::array<unsigned char, 4> bytes = PacketProcessor::ENumber(number);
+	return std::string(bytes.begin(), bytes.begin() + size);
+}
+
+// Writes a pub file with one record per name, each with DATA_SIZE bytes of zeroed data unless overridden
+template <class T> static std::string bench_pub_file(const std::string &filename, const char *magic,
+	const std::vector<std::pair<std::string, std::string>> &records)
+{
+	std::string contents = magic;
+	contents += eo_number(0, 2) + eo_number(0, 2);
+	contents += eo_number(records.size(), 2);
+	contents += eo_number(0, 1);
+
+	for (const auto &record : records)
+	{
+		contents += eo_number(record.first.length(), 1);
+
+		if (std::is_same<T, ESF>::value)
+			contents += eo_number(0, 1);
+
+		contents += record.first;
+
+		std::string data = record.second;
+		data.resize(T::DATA_SIZE, char(eo_number(0, 1)[0]));
+		contents += data;
+	}
+
+	return benchmark::TemporaryFile(filename, contents);
+}
+
+static std::string bench_enf_record(ENF::Type type)
+{
+	std::string data(ENF::DATA_SIZE, char(eo_number(0, 1)[0]));
+	data.replace(7, 2, eo_number(type, 2));
+	data.replace(11, 3, eo_number(100, 3));
+	return data;
+}
+
+static std::unique_ptr<World> bench_create_world()
+{
+	Config config, aconfig;
+	aconfig.Read("admin.ini", true);
+	eoserv_config_validate_config(config);
+	eoserv_config_validate_admin(aconfig);
+
+	std::string empty = benchmark::TemporaryFile("empty.ini", "");
+
+	config["DBType"] = "sqlite";
+	config["DBHost"] = ":memory:";
+	config["ServerLanguage"] = empty;
+	config["DropsFile"] = empty;
+	config["ShopsFile"] = empty;
+	config["ArenasFile"] = empty;
+	config["FormulasFile"] = empty;
+	config["HomeFile"] = empty;
+	config["SkillsFile"] = empty;
+	config["TimedSave"] = 0;
+	config["AutoSplitPubFiles"] = false;
+	config["Quests"] = 0;
+
+	config["EIF"] = bench_pub_file<EIF>("pub.eif", "EIF", {{"Gold", ""}});
+	config["ENF"] = bench_pub_file<ENF>("pub.enf", "ENF", {{"Passive", bench_enf_record(ENF::Passive)}, {"Aggressive", bench_enf_record(ENF::Aggressive)}});
+	config["ESF"] = bench_pub_file<ESF>("pub.esf", "ESF", {{"Heal", ""}});
+	config["ECF"] = bench_pub_file<ECF>("pub.ecf", "ECF", {{"Peasant", ""}});
+
+	config["MapDir"] = "./bench_";
+	config["Maps"] = int(sizeof bench_map_sizes / sizeof bench_map_sizes[0]);
+
+	for (std::size_t i = 0; i < sizeof bench_map_sizes / sizeof bench_map_sizes[0]; ++i)
+	{
+		// Every other field is zero, which gives an open map with no tiles, warps or spawns
+		std::string emf(256, char(eo_number(0, 1)[0]));
+		emf.replace(0, 3, "EMF");
+		emf[0x25] = char(eo_number(bench_map_sizes[i] - 1, 1)[0]);
+		emf[0x26] = char(eo_number(bench_map_sizes[i] - 1, 1)[0]);
+
+		char filename[16];
+		std::snprintf(filename, sizeof filename, "%05i.emf", int(i + 1));
+		benchmark::TemporaryFile(filename, emf);
+	}
+
+	std::array<std::string, 6> dbinfo;
+	dbinfo[0] = std::string(config["DBType"]);
+	dbinfo[1] = std::string(config["DBHost"]);
+	dbinfo[5] = "0";
+
+	std::unique_ptr<World> world(new World(dbinfo, config, aconfig));
+
+	for (Map *map : world->maps)
+	{
+		int npcs = (map->width == bench_scan_map_size) ? bench_scan_map_npcs : bench_map_npcs;
+		int step = std::max(1, (map->width * map->height) / npcs);
+
+		for (int i = 0; i < npcs; ++i)
+		{
+			int tile = (i * step) % (map->width * map->height);
+			short id = (i % 2 == 0) ? 1 : 2;
+
+			NPC *npc = new NPC(map, id, tile % map->width, tile / map->width, 0, 0, i + 1);
+			map->AddNPC(npc);
+			npc->Spawn();
+		}
+	}
+
+	return world;
+}
+
+static Map *bench_map(long size)
+{
+	static std::unique_ptr<World> world = bench_create_world();
+
+	for (Map *map : world->maps)
+	{
+		if (map->width == size)
+			return map;
+	}
+
+	return nullptr;
+}
+
+static void bench_map_occupied(benchmark::State &state)
+{
+	Map *map = bench_map(state.range());
+	std::vector<std::pair<unsigned char, unsigned char>> coords(1024);
+
+	for (auto &coord : coords)
+		coord = {util::rand(0, map->width - 1), util::rand(0, map->height - 1)};
+
+	std::size_t i = 0;
+
+	while (state.KeepRunning())
+	{
+		const auto &coord = coords[i++ % coords.size()];
+		benchmark::DoNotOptimize(map->Occupied(coord.first, coord.second, Map::PlayerAndNPC));
+	}
+}
+EOSERV_BENCHMARK_ARGS(bench_map_occupied, 16, 32, 64, 128);
+
+static void bench_map_walk(benchmark::State &state)
+{
+	Map *map = bench_map(state.range());
+	std::size_t i = 0;
+
+	while (state.KeepRunning())
+	{
+		NPC *npc = map->npcs[i % map->npcs.size()];
+		benchmark::DoNotOptimize(map->Walk(npc, static_cast<Direction>((i / map->npcs.size()) % 4)));
+		++i;
+	}
+}
+EOSERV_BENCHMARK_ARGS(bench_map_walk, 16, 32, 64, 128);
+
+static void bench_npc_act(benchmark::State &state)
+{
+	Map *map = bench_map(state.range());
+
+	while (state.KeepRunning())
+	{
+		for (NPC *npc : map->npcs)
+			npc->Act();
+	}
+
+	state.SetItemsProcessed(state.Iterations() * map->npcs.size());
+}
+EOSERV_BENCHMARK_ARGS(bench_npc_act, 16, 32, 64, 128);
+
+static void bench_drop_table(NPC_Drop_Table &table, long count)
+{
+	std::vector<std::unique_ptr<NPC_Drop>> drops;
+
+	for (long i = 0; i < count; ++i)
+	{
+		std::unique_ptr<NPC_Drop> drop(new NPC_Drop);
+		drop->id = (unsigned short)(i + 1);
+		drop->min = 1;
+		drop->max = 1;
+		drop->chance = 50.0 / double(count) * double(i % 4 + 1);
+		drop->chance_offset = 0.0;
+		drops.push_back(std::move(drop));
+	}
+
+	table.Build(drops, 100.0);
+}
+
+static void bench_drop_pick(benchmark::State &state)
+{
+	NPC_Drop_Table table;
+	bench_drop_table(table, state.range());
+	util::rng rng(1);
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(table.Pick(rng));
+}
+EOSERV_BENCHMARK_ARGS(bench_drop_pick, 4, 32, 256);
+
+static void bench_drop_roll(benchmark::State &state)
+{
+	NPC_Drop_Table table;
+	bench_drop_table(table, state.range());
+	std::vector<std::size_t> passed;
+	util::rng rng(1);
+
+	while (state.KeepRunning())
+	{
+		table.Roll(rng, 1.0, passed);
+		benchmark::DoNotOptimize(passed);
+	}
+
+	state.SetItemsProcessed(state.Iterations() * std::size_t(state.range()));
+}
+EOSERV_BENCHMARK_ARGS(bench_drop_roll, 4, 32, 256);
+
+// One world_act_npcs tick for a map, which only visits the NPCs that are due
+static void bench_map_act_npcs(benchmark::State &state)
+{
+	Map *map = bench_map(state.range());
+
+	while (state.KeepRunning())
+		map->ActNPCs(Timer::GetTime());
+}
+EOSERV_BENCHMARK_ARGS(bench_map_act_npcs, 16, 128);
+
+// Drops a pile of items on a map and despawns all of them, as after a mass drop
+static void bench_map_despawn_items(benchmark::State &state)
+{
+	Map *map = bench_map(128);
+	double now = Timer::GetTime();
+
+	while (state.KeepRunning())
+	{
+		for (long i = 0; i < state.range(); ++i)
+			map->InsertItem(1, 1, (unsigned char)(i % map->width), (unsigned char)(i / map->width % map->height), 0, now + double(i % 60));
+
+		map->DespawnItems(now + 60.0);
+	}
+
+	state.SetItemsProcessed(state.Iterations() * state.range());
+}
+EOSERV_BENCHMARK_ARGS(bench_map_despawn_items, 64, 1024, 8192);
+
+// Looks for an NPC on a tile that's always empty, so every NPC on the map is checked
+static void bench_map_scan_npcs(benchmark::State &state)
+{
+	Map *map = bench_map(bench_scan_map_size);
+	unsigned char x = map->width - 1;
+	unsigned char y = map->height - 1;
+
+	while (state.KeepRunning())
+		benchmark::DoNotOptimize(map->Occupied(x, y, Map::NPCOnly));
+
+	state.SetItemsProcessed(state.Iterations() * map->npcs.size());
+}
+EOSERV_BENCHMARK(bench_map_scan_npcs);
+
+// The same scan by visiting each NPC object, as Occupied() did before the NPC columns
+static void bench_map_scan_npc_objects(benchmark::State &state)
+{
+	Map *map = bench_map(bench_scan_map_size);
+	unsigned char x = map->width - 1;
+	unsigned char y = map->height - 1;
+
+	while (state.KeepRunning())
+	{
+		bool found = false;
+
+		for (NPC *npc : map->npcs)
+		{
+			if (npc->alive && npc->x == x && npc->y == y)
+			{
+				found = true;
+				break;
+			}
+		}
+
+		benchmark::DoNotOptimize(found);
+	}
+
+	state.SetItemsProcessed(state.Iterations() * map->npcs.size());
+}
+EOSERV_BENCHMARK(bench_map_scan_npc_objects);
+
+// One world_npc_recover tick with every NPC at full health
+static void bench_map_recover_npcs(benchmark::State &state)
+{
+	Map *map = bench_map(bench_scan_map_size);
+
+	while (state.KeepRunning())
+		map->RecoverNPCs(0.1);
+
+	state.SetItemsProcessed(state.Iterations() * map->npcs.size());
+}
+EOSERV_BENCHMARK(bench_map_recover_npcs);
@@ -0,0 +1,301 @@
+/* benchmarks/benchmark.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Referenced by the server sources linked in to the suite
+volatile std::sig_atomic_t eoserv_sig_abort = false;
+volatile std::sig_atomic_t eoserv_sig_rehash = false;
+volatile bool eoserv_running = true;
+
+namespace benchmark
+{
+
+struct Benchmark
+{
+	std::string name;
+	Function function;
+	long arg;
+};
+
+struct Result
+{
+	std::string name;
+	std::size_t iterations;
+	double real_time;
+	double cpu_time;
+	double items_per_second;
+	double bytes_per_second;
+};
+
+static std::vector<Benchmark> &registry()
+{
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+static std::vector<std::string> &temporary_files()
+{
+	static std::vector<std::string> files;
+	return files;
+}
+
+State::State(std::size_t max_iterations, long arg)
+	: max_iterations(max_iterations)
+	, iterations(0)
+	, arg(arg)
+	, running(false)
+	, cpu_start(0)
+	, real_time(0.0)
+	, cpu_time(0.0)
+	, items_processed(0)
+	, bytes_processed(0)
+{ }
+
+void State::PauseTiming()
+{
+	if (!this->running)
+		return;
+
+	this->real_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->real_start).count();
+	this->cpu_time += double(std::clock() - this->cpu_start) / CLOCKS_PER_SEC;
+	this->running = false;
+}
+
+void State::ResumeTiming()
+{
+	if (this->running)
+		return;
+
+	this->running = true;
+	this->cpu_start = std::clock();
+	this->real_start = std::chrono::steady_clock::now();
+}
+
+Registration::Registration(const char *name, Function function, std::initializer_list<long> args)
+{
+	if (args.size() == 0)
+	{
+		registry().push_back(Benchmark{name, function, 0});
+		return;
+	}
+
+	for (long arg : args)
+		registry().push_back(Benchmark{std::string(name) + "/" + std::to_string(arg), function, arg});
+}
+
+std::string TemporaryFile(const std::string &name, const std::string &contents)
+{
+	std::string filename = "./bench_" + name;
+	std::FILE *fh = std::fopen(filename.c_str(), "wb");
+
+	if (!fh)
+	{
+		std::fprintf(stderr, "Could not write %s\n", filename.c_str());
+		std::exit(1);
+	}
+
+	std::fwrite(contents.data(), 1, contents.length(), fh);
+	std::fclose(fh);
+
+	if (std::find(temporary_files().begin(), temporary_files().end(), filename) == temporary_files().end())
+		temporary_files().push_back(filename);
+
+	return filename;
+}
+
+static Result run(const Benchmark &benchmark, double min_time)
+{
+	std::size_t iterations = 1;
+
+	for (;;)
+	{
+		State state(iterations, benchmark.arg);
+		benchmark.function(state);
+
+		double elapsed = state.RealTime();
+
+		if (elapsed >= min_time || iterations >= 1000000000)
+		{
+			Result result;
+			result.name = benchmark.name;
+			result.iterations = state.Iterations();
+			result.real_time = elapsed / double(iterations) * 1e9;
+			result.cpu_time = state.CPUTime() / double(iterations) * 1e9;
+			result.items_per_second = (state.items_processed && elapsed > 0.0) ? double(state.items_processed) / elapsed : 0.0;
+			result.bytes_per_second = (state.bytes_processed && elapsed > 0.0) ? double(state.bytes_processed) / elapsed : 0.0;
+			return result;
+		}
+
+		// Aim a little past the minimum time, growing at most tenfold if the last run was too short to judge
+		double multiplier = (elapsed > min_time / 10.0) ? (min_time * 1.4 / elapsed) : 10.0;
+		iterations = std::max(iterations + 1, std::size_t(double(iterations) * multiplier));
+	}
+}
+
+static std::string json_escape(const std::string &s)
+{
+	std::string result;
+
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			result += '\\';
+
+		result += c;
+	}
+
+	return result;
+}
+
+static bool write_json(const std::string &filename, const char *executable, const std::vector<Result> &results)
+{
+	std::FILE *fh = std::fopen(filename.c_str(), "w");
+
+	if (!fh)
+		return false;
+
+	char date[64];
+	std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+#ifdef NDEBUG
+	const char *build_type = "release";
+#else
+	const char *build_type = "debug";
+#endif
+
+	std::fprintf(fh, "{\n  \"context\": {\n");
+	std::fprintf(fh, "    \"date\": \"%s\",\n", date);
+	std::fprintf(fh, "    \"executable\": \"%s\",\n", json_escape(executable).c_str());
+	std::fprintf(fh, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+	std::fprintf(fh, "    \"library_build_type\": \"%s\"\n", build_type);
+	std::fprintf(fh, "  },\n  \"benchmarks\": [");
+
+	for (std::size_t i = 0; i < results.size(); ++i)
+	{
+		const Result &result = results[i];
+
+		std::fprintf(fh, "%s\n    {\n", (i == 0) ? "" : ",");
+		std::fprintf(fh, "      \"name\": \"%s\",\n", json_escape(result.name).c_str());
+		std::fprintf(fh, "      \"iterations\": %zu,\n", result.iterations);
+		std::fprintf(fh, "      \"real_time\": %.3f,\n", result.real_time);
+		std::fprintf(fh, "      \"cpu_time\": %.3f,\n", result.cpu_time);
+
+		if (result.items_per_second > 0.0)
+			std::fprintf(fh, "      \"items_per_second\": %.3f,\n", result.items_per_second);
+
+		if (result.bytes_per_second > 0.0)
+			std::fprintf(fh, "      \"bytes_per_second\": %.3f,\n", result.bytes_per_second);
+
+		std::fprintf(fh, "      \"time_unit\": \"ns\"\n    }");
+	}
+
+	std::fprintf(fh, "\n  ]\n}\n");
+
+	return std::fclose(fh) == 0;
+}
+
+static void usage(const char *name)
+{
+	std::printf(
+		"Usage: %s [options]\n"
+		"\n"
+		"  --filter TEXT       Only runs benchmarks with TEXT in their name\n"
+		"  --min-time T        Minimum seconds to run each benchmark for (0.5)\n"
+		"  --repetitions N     Runs each benchmark N times (1)\n"
+		"  --json FILE         Writes the results as JSON\n"
+		"  --list              Lists the benchmarks without running them\n",
+		name);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	using namespace benchmark;
+
+	std::string filter;
+	double min_time = 0.5;
+	int repetitions = 1;
+	std::string json;
+	bool list = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool has_value = (i + 1 < argc);
+
+		if (std::strcmp(argv[i], "--filter") == 0 && has_value)
+			filter = argv[++i];
+		else if (std::strcmp(argv[i], "--min-time") == 0 && has_value)
+			min_time = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value)
+			repetitions = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--json") == 0 && has_value)
+			json = argv[++i];
+		else if (std::strcmp(argv[i], "--list") == 0)
+			list = true;
+		else
+		{
+			usage(argv[0]);
+			return (std::strcmp(argv[i], "--help") == 0) ? 0 : 1;
+		}
+	}
+
+	std::vector<Result> results;
+
+	for (const Benchmark &benchmark : registry())
+	{
+		if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+			continue;
+
+		if (list)
+		{
+			std::printf("%s\n", benchmark.name.c_str());
+			continue;
+		}
+
+		for (int i = 0; i < repetitions; ++i)
+		{
+			Result result = run(benchmark, min_time);
+
+			std::printf("%-40s %14.1f ns %14.1f ns %12zu", result.name.c_str(), result.real_time, result.cpu_time, result.iterations);
+
+			if (result.items_per_second > 0.0)
+				std::printf("  %.4g items/s", result.items_per_second);
+
+			if (result.bytes_per_second > 0.0)
+				std::printf("  %.4g B/s", result.bytes_per_second);
+
+			std::printf("\n");
+			std::fflush(stdout);
+
+			results.push_back(result);
+		}
+	}
+
+	for (const std::string &filename : temporary_files())
+		std::remove(filename.c_str());
+
+	if (!json.empty() && !write_json(json, argv[0], results))
+	{
+		std::fprintf(stderr, "Could not write %s\n", json.c_str());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,113 @@
+/* benchmarks/benchmark.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef BENCHMARK_HPP_INCLUDED
+#define BENCHMARK_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+
+/**
+ * Passed to each benchmark function, which must run its timed code in a `while (state.KeepRunning())` loop
+ */
+class State
+{
+	private:
+		std::size_t max_iterations;
+		std::size_t iterations;
+		long arg;
+
+		bool running;
+		std::chrono::steady_clock::time_point real_start;
+		std::clock_t cpu_start;
+		double real_time;
+		double cpu_time;
+
+	public:
+		std::size_t items_processed;
+		std::size_t bytes_processed;
+
+		State(std::size_t max_iterations, long arg);
+
+		bool KeepRunning()
+		{
+			if (this->iterations < this->max_iterations)
+			{
+				if (this->iterations++ == 0)
+					this->ResumeTiming();
+
+				return true;
+			}
+
+			if (this->running)
+				this->PauseTiming();
+
+			return false;
+		}
+
+		/**
+		 * Stops the clock so per-iteration setup isn't measured
+		 */
+		void PauseTiming();
+		void ResumeTiming();
+
+		/**
+		 * Argument the benchmark was registered with, or 0
+		 */
+		long range() const { return this->arg; }
+
+		std::size_t Iterations() const { return this->iterations; }
+		double RealTime() const { return this->real_time; }
+		double CPUTime() const { return this->cpu_time; }
+
+		void SetItemsProcessed(std::size_t items) { this->items_processed = items; }
+		void SetBytesProcessed(std::size_t bytes) { this->bytes_processed = bytes; }
+};
+
+typedef void (*Function)(State &);
+
+/**
+ * Adds a benchmark to the suite, once for each argument if any are given
+ */
+struct Registration
+{
+	Registration(const char *name, Function function, std::initializer_list<long> args = {});
+};
+
+/**
+ * Keeps the compiler from discarding a value that is otherwise unused
+ */
+template <class T> inline void DoNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void *sink;
+	sink = &value;
+#endif
+}
+
+/**
+ * Writes a file in the working directory which is removed when the suite finishes
+ * @return The filename that was written
+ */
+std::string TemporaryFile(const std::string &name, const std::string &contents);
+
+}
+
+#define EOSERV_BENCHMARK(function) \
+	static benchmark::Registration function##_registration(#function, function)
+
+#define EOSERV_BENCHMARK_ARGS(function, ...) \
+	static benchmark::Registration function##_registration(#function, function, {__VA_ARGS__})
+
+#endif // BENCHMARK_HPP_INCLUDED
@@ -15,8 +15,14 @@ set(eoserv_UNITY_SOURCE_FILES
 )
 
 set(eoserv_ALL_SOURCE_FILES
+	src/admission.cpp
+	src/admission.hpp
 	src/arena.cpp
 	src/arena.hpp
+	src/banlist.cpp
+	src/banlist.hpp
+	src/board.cpp
+	src/board.hpp
 	src/character.cpp
 	src/character.hpp
 	src/command_source.cpp
@@ -61,7 +67,10 @@ set(eoserv_ALL_SOURCE_FILES
 	src/eoserver.hpp
 	src/extra/seose_compat.cpp
 	src/extra/seose_compat.hpp
+	src/fwd/admission.hpp
 	src/fwd/arena.hpp
+	src/fwd/banlist.hpp
+	src/fwd/board.hpp
 	src/fwd/character.hpp
 	src/fwd/command_source.hpp
 	src/fwd/config.hpp
@@ -80,10 +89,13 @@ set(eoserv_ALL_SOURCE_FILES
 	src/fwd/npc.hpp
 	src/fwd/npc_data.hpp
 	src/fwd/packet.hpp
+	src/fwd/packetrecord.hpp
 	src/fwd/party.hpp
+	src/fwd/passwordhash.hpp
 	src/fwd/player.hpp
 	src/fwd/quest.hpp
 	src/fwd/socket.hpp
+	src/fwd/statusserver.hpp
 	src/fwd/timer.hpp
 	src/fwd/world.hpp
 	src/guild.cpp
@@ -135,6 +147,8 @@ set(eoserv_ALL_SOURCE_FILES
 	src/main.cpp
 	src/map.cpp
 	src/map.hpp
+	src/metrics.cpp
+	src/metrics.hpp
 	src/nanohttp.cpp
 	src/nanohttp.hpp
 	src/npc.cpp
@@ -143,8 +157,14 @@ set(eoserv_ALL_SOURCE_FILES
 	src/npc_data.hpp
 	src/packet.cpp
 	src/packet.hpp
+	src/packetrecord.cpp
+	src/packetrecord.hpp
 	src/party.cpp
 	src/party.hpp
+	src/passwordhash.cpp
+	src/passwordhash.hpp
+	src/perf.cpp
+	src/perf.hpp
 	src/platform.h
 	src/player.cpp
 	src/player.hpp
@@ -155,10 +175,17 @@ set(eoserv_ALL_SOURCE_FILES
 	src/socket.cpp
 	src/socket.hpp
 	src/socket_impl.hpp
+	src/statusserver.cpp
+	src/statusserver.hpp
 	src/timer.cpp
 	src/timer.hpp
 	src/util.cpp
 	src/util.hpp
+	src/util/deadline_queue.hpp
+	src/util/id_vector.hpp
+	src/util/mpsc_queue.hpp
+	src/util/rng.cpp
+	src/util/rng.hpp
 	src/util/rpn.cpp
 	src/util/rpn.hpp
 	src/util/rpn_lex.cpp
@@ -177,6 +204,56 @@ set(eoserv_WIN32_SOURCE_FILES
 	src/extra/ntservice.hpp
 )
 
+set(eoserv_BENCHMARK_SOURCE_FILES
+	benchmarks/bench_packet.cpp
+	benchmarks/bench_rng.cpp
+	benchmarks/bench_serialize.cpp
+	benchmarks/bench_util.cpp
+	benchmarks/bench_world.cpp
+	benchmarks/benchmark.cpp
+	benchmarks/benchmark.hpp
+)
+
+set(eoserv_TEST_SOURCE_FILES
+	tests/test.cpp
+	tests/test.hpp
+	tests/test_admission.cpp
+	tests/test_eodata.cpp
+	tests/test_i18n.cpp
+	tests/test_packetrecord.cpp
+	tests/test_passwordhash.cpp
+	tests/test_world.cpp
+)
+
+set(eoloadgen_SOURCE_FILES
+	tools/loadgen/bots.cpp
+	tools/loadgen/connection.cpp
+	tools/loadgen/connection.hpp
+	tools/loadgen/loadgen.hpp
+	tools/loadgen/main.cpp
+	tools/loadgen/replay.cpp
+	tools/loadgen/stats.cpp
+	tools/loadgen/stats.hpp
+
+	# Shared with the server
+	src/console.cpp
+	src/console.hpp
+	src/hash.cpp
+	src/hash.hpp
+	src/packet.cpp
+	src/packet.hpp
+	src/packetrecord.cpp
+	src/packetrecord.hpp
+	src/sha256.c
+	src/sha256.h
+	src/util.cpp
+	src/util.hpp
+	src/util/rng.cpp
+	src/util/rng.hpp
+	src/util/variant.cpp
+	src/util/variant.hpp
+)
+
 # ----------
 
 set(ConfigFiles
@@ -238,6 +315,7 @@ set(ExtraFiles
 	install.sql
 	upgrade/0.5.2_to_0.5.3.sql
 	upgrade/0.6.2_to_0.7.0.sql
+	upgrade/0.7.0_to_0.7.1.sql
 
 	${ConfigFiles}
 	${LangFiles}
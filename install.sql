@@ -2,7 +2,7 @@
 CREATE TABLE IF NOT EXISTS `accounts`
 (
 	`username`   VARCHAR(16) NOT NULL,
-	`password`   CHAR(64)    NOT NULL,
+	`password`   VARCHAR(128) NOT NULL,
 	`fullname`   VARCHAR(64) NOT NULL,
 	`location`   VARCHAR(64) NOT NULL,
 	`email`      VARCHAR(64) NOT NULL,
@@ -81,11 +81,12 @@ CREATE TABLE IF NOT EXISTS `guilds`
 
 CREATE TABLE IF NOT EXISTS `bans`
 (
-	`ip`       INTEGER              DEFAULT NULL,
-	`hdid`     INTEGER              DEFAULT NULL,
-	`username` VARCHAR(16)          DEFAULT NULL,
-	`setter`   VARCHAR(16)          DEFAULT NULL,
-	`expires`  INTEGER     NOT NULL DEFAULT 0,
+	`ip`        INTEGER              DEFAULT NULL,
+	`ip_prefix` INTEGER              DEFAULT NULL,
+	`hdid`      INTEGER              DEFAULT NULL,
+	`username`  VARCHAR(16)          DEFAULT NULL,
+	`setter`    VARCHAR(16)          DEFAULT NULL,
+	`expires`   INTEGER     NOT NULL DEFAULT 0,
 
 	PRIMARY KEY (`ip`, `hdid`, `username`, `expires`)
 );
@@ -101,6 +102,19 @@ CREATE TABLE IF NOT EXISTS `reports`
 	PRIMARY KEY (`reporter`, `reported`, `time`)
 );
 
+CREATE TABLE IF NOT EXISTS `board_posts`
+(
+	`board`        INTEGER     NOT NULL,
+	`id`           INTEGER     NOT NULL,
+	`author`       VARCHAR(16) NOT NULL,
+	`author_admin` INTEGER     NOT NULL DEFAULT 0,
+	`subject`      TEXT        NOT NULL,
+	`body`         TEXT        NOT NULL,
+	`time`         INTEGER     NOT NULL,
+
+	PRIMARY KEY (`board`, `id`)
+);
+
 CREATE INDEX IF NOT EXISTS `character_account_index` ON `characters` (`account`);
 CREATE INDEX IF NOT EXISTS `character_guild_index` ON `characters` (`guild`);
 CREATE INDEX IF NOT EXISTS `ban_ip_index` ON `bans` (`ip`);
@@ -0,0 +1,230 @@
+/* admission.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "admission.hpp"
+
+#include "console.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+AdmissionControl::AdmissionControl()
+	: wheel_time(0)
+	, reconnect_limit(0.0)
+	, reconnect_burst(1.0)
+{ }
+
+void AdmissionControl::Configure(double reconnect_limit, int reconnect_burst)
+{
+	this->reconnect_limit = reconnect_limit;
+	this->reconnect_burst = std::max(reconnect_burst, 1);
+}
+
+void AdmissionControl::Refill(Address_Entry &entry, double now)
+{
+	if (this->reconnect_limit <= 0.0)
+		entry.tokens = this->reconnect_burst;
+	else
+		entry.tokens = std::min(this->reconnect_burst, entry.tokens + (now - entry.last_refill) / this->reconnect_limit);
+
+	entry.last_refill = now;
+}
+
+void AdmissionControl::UpdateExpiry(Address_Entry &entry)
+{
+	double refilled = entry.last_refill + (this->reconnect_burst - entry.tokens) * std::max(this->reconnect_limit, 0.0);
+	double rejections_logged = (entry.rejections > 0) ? entry.last_rejection_time + RejectionWindow : 0.0;
+
+	entry.expires = std::max(refilled, rejections_logged);
+}
+
+void AdmissionControl::Schedule(const IPAddress &ip, Address_Entry &entry)
+{
+	if (entry.scheduled)
+		return;
+
+	std::int64_t slot = std::max(std::int64_t(std::floor(entry.expires)) + 1, this->wheel_time + 1);
+
+	this->wheel[std::size_t(slot % WheelSlots)].push_back(ip);
+	entry.scheduled = true;
+}
+
+void AdmissionControl::Forget(std::unordered_map<IPAddress, Address_Entry>::iterator it)
+{
+	if (it->second.rejections > 1)
+		Console::Wrn("Connections from %s were rejected (%dx)", std::string(it->first).c_str(), it->second.rejections);
+
+	this->addresses.erase(it);
+}
+
+void AdmissionControl::Connected(const IPAddress &ip, double now)
+{
+	auto result = this->addresses.insert({ip, Address_Entry{}});
+	Address_Entry &entry = result.first->second;
+
+	if (result.second)
+	{
+		entry.tokens = this->reconnect_burst;
+		entry.last_refill = now;
+	}
+
+	++entry.connections;
+	++this->pcs[PCKey(ip, 0)];
+}
+
+void AdmissionControl::Disconnected(const IPAddress &ip, int hdid)
+{
+	auto pc = this->pcs.find(PCKey(ip, hdid));
+
+	if (pc != this->pcs.end() && --pc->second <= 0)
+		this->pcs.erase(pc);
+
+	auto it = this->addresses.find(ip);
+
+	if (it == this->addresses.end() || --it->second.connections > 0)
+		return;
+
+	it->second.connections = 0;
+	this->UpdateExpiry(it->second);
+	this->Schedule(it->first, it->second);
+}
+
+void AdmissionControl::ChangeHDID(const IPAddress &ip, int old_hdid, int new_hdid)
+{
+	if (old_hdid == new_hdid)
+		return;
+
+	auto pc = this->pcs.find(PCKey(ip, old_hdid));
+
+	if (pc != this->pcs.end() && --pc->second <= 0)
+		this->pcs.erase(pc);
+
+	++this->pcs[PCKey(ip, new_hdid)];
+}
+
+int AdmissionControl::IPConnections(const IPAddress &ip) const
+{
+	auto it = this->addresses.find(ip);
+
+	return (it != this->addresses.end()) ? it->second.connections : 0;
+}
+
+int AdmissionControl::PCConnections(const IPAddress &ip, int hdid) const
+{
+	auto it = this->pcs.find(PCKey(ip, hdid));
+
+	return (it != this->pcs.end()) ? it->second : 0;
+}
+
+bool AdmissionControl::Throttled(const IPAddress &ip, double now)
+{
+	auto it = this->addresses.find(ip);
+
+	if (it == this->addresses.end())
+		return false;
+
+	this->Refill(it->second, now);
+
+	return it->second.tokens < 1.0;
+}
+
+void AdmissionControl::Accepted(const IPAddress &ip, double now)
+{
+	auto it = this->addresses.find(ip);
+
+	if (it == this->addresses.end())
+		return;
+
+	Address_Entry &entry = it->second;
+
+	this->Refill(entry, now);
+	entry.tokens = std::max(entry.tokens - 1.0, 0.0);
+	this->UpdateExpiry(entry);
+	this->Schedule(ip, entry);
+}
+
+bool AdmissionControl::Rejected(const IPAddress &ip, double now, bool buffer)
+{
+	if (!buffer)
+		return true;
+
+	auto result = this->addresses.insert({ip, Address_Entry{}});
+	Address_Entry &entry = result.first->second;
+
+	if (result.second)
+	{
+		entry.tokens = this->reconnect_burst;
+		entry.last_refill = now;
+	}
+
+	bool log = (entry.rejections == 0);
+
+	// Buffer up to 100 rejections + 30 seconds in delayed error mode
+	if (++entry.rejections < 100)
+		entry.last_rejection_time = now;
+
+	this->Refill(entry, now);
+	this->UpdateExpiry(entry);
+	this->Schedule(ip, entry);
+
+	return log;
+}
+
+void AdmissionControl::ClearRejections(const IPAddress &ip)
+{
+	auto it = this->addresses.find(ip);
+
+	if (it == this->addresses.end())
+		return;
+
+	int &rejections = it->second.rejections;
+
+	if (rejections > 1)
+		Console::Wrn("Connections from %s were rejected (%dx)", std::string(ip).c_str(), rejections);
+
+	rejections = 0;
+}
+
+void AdmissionControl::Expire(double now)
+{
+	std::int64_t target = std::int64_t(std::floor(now));
+
+	if (target - this->wheel_time > WheelSlots)
+		this->wheel_time = target - WheelSlots;
+
+	while (this->wheel_time < target)
+	{
+		++this->wheel_time;
+
+		// An entry expiring a full turn of the wheel from now is rescheduled in to this same slot,
+		// so the slot is taken out of the wheel before it's walked
+		std::vector<IPAddress> due;
+		due.swap(this->wheel[std::size_t(this->wheel_time % WheelSlots)]);
+
+		UTIL_FOREACH_CREF(due, ip)
+		{
+			auto it = this->addresses.find(ip);
+
+			if (it == this->addresses.end() || !it->second.scheduled)
+				continue;
+
+			Address_Entry &entry = it->second;
+			entry.scheduled = false;
+
+			if (entry.connections > 0)
+				continue;
+
+			if (entry.expires > now)
+				this->Schedule(it->first, entry);
+			else
+				this->Forget(it);
+		}
+	}
+}
@@ -0,0 +1,123 @@
+/* admission.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef ADMISSION_HPP_INCLUDED
+#define ADMISSION_HPP_INCLUDED
+
+#include "fwd/admission.hpp"
+
+#include "socket.hpp"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Live connection counts and reconnect rate limits for each remote address
+ * Counters are updated as clients are created and destroyed so admission checks never scan the client list.
+ * Addresses with no connections are forgotten by a timer wheel once their reconnect limit and rejection log have expired.
+ */
+class AdmissionControl
+{
+	public:
+		/**
+		 * Number of one second slots in the expiry timer wheel
+		 */
+		static const int WheelSlots = 64;
+
+		/**
+		 * Seconds rejections from an address are buffered for when rejection logging is quiet
+		 */
+		static constexpr double RejectionWindow = 30.0;
+
+		struct Address_Entry
+		{
+			int connections = 0;
+
+			double tokens = 0.0;
+			double last_refill = 0.0;
+
+			double last_rejection_time = 0.0;
+			int rejections = 0;
+
+			double expires = 0.0;
+			bool scheduled = false;
+		};
+
+	private:
+		std::unordered_map<IPAddress, Address_Entry> addresses;
+		std::unordered_map<std::uint64_t, int> pcs;
+
+		std::array<std::vector<IPAddress>, WheelSlots> wheel;
+		std::int64_t wheel_time;
+
+		double reconnect_limit;
+		double reconnect_burst;
+
+		static std::uint64_t PCKey(const IPAddress &ip, int hdid)
+		{
+			return (std::uint64_t(ip.GetInt()) << 32) | std::uint32_t(hdid);
+		}
+
+		void Refill(Address_Entry &entry, double now);
+		void UpdateExpiry(Address_Entry &entry);
+		void Schedule(const IPAddress &ip, Address_Entry &entry);
+		void Forget(std::unordered_map<IPAddress, Address_Entry>::iterator it);
+
+	public:
+		AdmissionControl();
+
+		/**
+		 * Sets the minimum time between connections from an address, and how many connections may be made in a burst
+		 */
+		void Configure(double reconnect_limit, int reconnect_burst);
+
+		/**
+		 * Registers a newly created client, before any admission checks have been made
+		 */
+		void Connected(const IPAddress &ip, double now);
+
+		/**
+		 * Unregisters a client as it is destroyed
+		 */
+		void Disconnected(const IPAddress &ip, int hdid);
+
+		void ChangeHDID(const IPAddress &ip, int old_hdid, int new_hdid);
+
+		int IPConnections(const IPAddress &ip) const;
+		int PCConnections(const IPAddress &ip, int hdid) const;
+
+		/**
+		 * Checks if an address has used up its reconnect allowance
+		 */
+		bool Throttled(const IPAddress &ip, double now);
+
+		/**
+		 * Uses up one connection from the address' reconnect allowance
+		 */
+		void Accepted(const IPAddress &ip, double now);
+
+		/**
+		 * Counts a rejected connection
+		 * @param buffer Only report the first rejection, later ones are summarised when the address is forgotten
+		 * @return true if the rejection should be logged
+		 */
+		bool Rejected(const IPAddress &ip, double now, bool buffer);
+
+		/**
+		 * Logs a summary of buffered rejections from an address and resets its count
+		 */
+		void ClearRejections(const IPAddress &ip);
+
+		/**
+		 * Advances the timer wheel, forgetting idle addresses
+		 */
+		void Expire(double now);
+
+		std::size_t Addresses() const { return this->addresses.size(); }
+};
+
+#endif // ADMISSION_HPP_INCLUDED
@@ -13,6 +13,7 @@
 #include "world.hpp"
 
 #include "console.hpp"
+#include "perf.hpp"
 #include "util.hpp"
 
 #include <vector>
@@ -31,6 +32,7 @@ Arena::Arena(Map *map, int time, int block)
 	this->block = block;
 	this->occupants = 0;
 
+	PERF_NAME_TIMER(arena_spawn);
 	this->spawn_timer = new TimeEvent(arena_spawn, this, time, Timer::FOREVER);
 	this->map->world->timer.Register(this->spawn_timer);
 }
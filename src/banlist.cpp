@@ -0,0 +1,351 @@
+/* banlist.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "banlist.hpp"
+
+#include "database.hpp"
+
+#include "console.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static int clamp_prefix(int prefix)
+{
+	return (prefix <= 0 || prefix > 32) ? 32 : prefix;
+}
+
+static int ip_bit(std::uint32_t address, int depth)
+{
+	return (address >> (31 - depth)) & 1;
+}
+
+int BanIndex::Merge(int a, int b)
+{
+	if (a == -1) return b;
+	if (b == -1) return a;
+	if (a == 0 || b == 0) return 0;
+	return std::max(a, b);
+}
+
+bool BanIndex::Covers(int a, int b)
+{
+	return a == 0 || (b != 0 && a >= b);
+}
+
+BanIndex::BanIndex()
+{
+	this->Clear();
+}
+
+void BanIndex::Clear()
+{
+	this->usernames.clear();
+	this->hdids.clear();
+	this->ip_nodes.assign(1, IP_Node{{0, 0}, -1});
+	this->ip_bans = 0;
+}
+
+const BanIndex::IP_Node *BanIndex::FindIP(IPAddress address, int prefix) const
+{
+	std::uint32_t ip = address.GetInt();
+	std::uint32_t node = 0;
+
+	for (int depth = 0; depth < prefix; ++depth)
+	{
+		node = this->ip_nodes[node].child[ip_bit(ip, depth)];
+
+		if (node == 0)
+			return 0;
+	}
+
+	return &this->ip_nodes[node];
+}
+
+void BanIndex::Add(const Ban_Entry &entry)
+{
+	if (!entry.username.empty())
+	{
+		auto result = this->usernames.insert({entry.username, entry.expires});
+
+		if (!result.second)
+			result.first->second = Merge(result.first->second, entry.expires);
+	}
+
+	if (entry.hdid != 0)
+	{
+		auto result = this->hdids.insert({entry.hdid, entry.expires});
+
+		if (!result.second)
+			result.first->second = Merge(result.first->second, entry.expires);
+	}
+
+	if (entry.ip.GetInt() != 0)
+	{
+		std::uint32_t ip = entry.ip.GetInt();
+		int prefix = clamp_prefix(entry.ip_prefix);
+		std::uint32_t node = 0;
+
+		for (int depth = 0; depth < prefix; ++depth)
+		{
+			int bit = ip_bit(ip, depth);
+			std::uint32_t next = this->ip_nodes[node].child[bit];
+
+			if (next == 0)
+			{
+				next = std::uint32_t(this->ip_nodes.size());
+				this->ip_nodes.push_back(IP_Node{{0, 0}, -1});
+				this->ip_nodes[node].child[bit] = next;
+			}
+
+			node = next;
+		}
+
+		if (this->ip_nodes[node].expires == -1)
+			++this->ip_bans;
+
+		this->ip_nodes[node].expires = Merge(this->ip_nodes[node].expires, entry.expires);
+	}
+}
+
+bool BanIndex::Contains(const Ban_Entry &entry) const
+{
+	if (!entry.username.empty())
+	{
+		auto it = this->usernames.find(entry.username);
+
+		if (it == this->usernames.end() || !Covers(it->second, entry.expires))
+			return false;
+	}
+
+	if (entry.hdid != 0)
+	{
+		auto it = this->hdids.find(entry.hdid);
+
+		if (it == this->hdids.end() || !Covers(it->second, entry.expires))
+			return false;
+	}
+
+	if (entry.ip.GetInt() != 0)
+	{
+		const IP_Node *node = this->FindIP(entry.ip, clamp_prefix(entry.ip_prefix));
+
+		if (!node || node->expires == -1 || !Covers(node->expires, entry.expires))
+			return false;
+	}
+
+	return true;
+}
+
+int BanIndex::Check(const std::string *username, const IPAddress *address, const int *hdid, std::time_t now) const
+{
+	int expires = -1;
+
+	if (username)
+	{
+		auto it = this->usernames.find(*username);
+
+		if (it != this->usernames.end() && Active(it->second, now))
+			expires = Merge(expires, it->second);
+	}
+
+	if (hdid)
+	{
+		auto it = this->hdids.find(*hdid);
+
+		if (it != this->hdids.end() && Active(it->second, now))
+			expires = Merge(expires, it->second);
+	}
+
+	if (address && this->ip_bans > 0)
+	{
+		std::uint32_t ip = address->GetInt();
+		std::uint32_t node = 0;
+
+		for (int depth = 0; ; ++depth)
+		{
+			const IP_Node &n = this->ip_nodes[node];
+
+			if (n.expires != -1 && Active(n.expires, now))
+				expires = Merge(expires, n.expires);
+
+			if (depth == 32)
+				break;
+
+			node = n.child[ip_bit(ip, depth)];
+
+			if (node == 0)
+				break;
+		}
+	}
+
+	return expires;
+}
+
+std::size_t BanIndex::Size() const
+{
+	return this->usernames.size() + this->hdids.size() + this->ip_bans;
+}
+
+BanList::BanList()
+	: loaded(false)
+	, prefix_column(true)
+	, next_sync(0)
+	, worker_done(false)
+{ }
+
+void BanList::Read(Database &db, BanIndex &index, bool prefix_column)
+{
+	Database_Result res;
+	int now = int(std::time(0));
+
+	if (prefix_column)
+		res = db.Query("SELECT `ip`, `ip_prefix`, `hdid`, `username`, `expires` FROM `bans` WHERE `expires` = 0 OR `expires` > #", now);
+	else
+		res = db.Query("SELECT `ip`, `hdid`, `username`, `expires` FROM `bans` WHERE `expires` = 0 OR `expires` > #", now);
+
+	UTIL_FOREACH_REF(res, row)
+	{
+		Ban_Entry entry;
+
+		entry.username = static_cast<std::string>(row["username"]);
+		entry.ip = static_cast<unsigned int>(static_cast<int>(row["ip"]));
+		entry.hdid = static_cast<int>(row["hdid"]);
+		entry.expires = static_cast<int>(row["expires"]);
+
+		if (prefix_column)
+			entry.ip_prefix = clamp_prefix(static_cast<int>(row["ip_prefix"]));
+
+		index.Add(entry);
+	}
+}
+
+void BanList::Apply(std::unique_ptr<BanIndex> &&new_index)
+{
+	std::time_t now = std::time(0);
+
+	// Keep bans made since the last refresh until the database (which may be mid-transaction) reports them too
+	this->local.erase(std::remove_if(UTIL_RANGE(this->local), [&](const Ban_Entry &entry)
+	{
+		return !BanIndex::Active(entry.expires, now) || new_index->Contains(entry);
+	}), this->local.end());
+
+	UTIL_FOREACH_CREF(this->local, entry)
+	{
+		new_index->Add(entry);
+	}
+
+	this->index = std::move(*new_index);
+}
+
+void BanList::Load(Database &db)
+{
+	std::unique_ptr<BanIndex> new_index(new BanIndex);
+
+	try
+	{
+		Read(db, *new_index, true);
+	}
+	catch (Database_QueryFailed &)
+	{
+		Console::Wrn("bans table has no ip_prefix column, IP range bans are disabled (see upgrade/0.7.0_to_0.7.1.sql)");
+		this->prefix_column = false;
+		new_index->Clear();
+		Read(db, *new_index, false);
+	}
+
+	this->Apply(std::move(new_index));
+	this->loaded = true;
+
+	if (!this->sync_db)
+	{
+		std::unique_ptr<Database> sync_db(new Database);
+
+		try
+		{
+			sync_db->Connect(db);
+			this->sync_db = std::move(sync_db);
+		}
+		catch (Database_OpenFailed &e)
+		{
+			Console::Wrn("Could not open a second database connection, ban list will not be refreshed: %s", e.error());
+		}
+	}
+}
+
+void BanList::Add(const Ban_Entry &entry)
+{
+	this->index.Add(entry);
+	this->local.push_back(entry);
+}
+
+int BanList::Check(const std::string *username, const IPAddress *address, const int *hdid) const
+{
+	return this->index.Check(username, address, hdid, std::time(0));
+}
+
+void BanList::Sync(int rate)
+{
+	if (!this->loaded || !this->sync_db)
+		return;
+
+	if (this->worker.joinable())
+	{
+		if (!this->worker_done.load(std::memory_order_acquire))
+			return;
+
+		this->worker.join();
+
+		if (this->snapshot)
+			this->Apply(std::move(this->snapshot));
+		else
+			Console::Wrn("Could not refresh ban list: %s", this->worker_error.c_str());
+
+		this->snapshot.reset();
+	}
+
+	std::time_t now = std::time(0);
+
+	if (this->next_sync == 0)
+		this->next_sync = now + rate;
+
+	if (now < this->next_sync)
+		return;
+
+	this->next_sync = now + std::max(rate, 1);
+	this->worker_done.store(false, std::memory_order_relaxed);
+
+	this->worker = std::thread([this]()
+	{
+		std::unique_ptr<BanIndex> new_index(new BanIndex);
+
+		try
+		{
+			Read(*this->sync_db, *new_index, this->prefix_column);
+			this->snapshot = std::move(new_index);
+		}
+		catch (Database_Exception &e)
+		{
+			this->worker_error = e.error();
+		}
+
+		this->worker_done.store(true, std::memory_order_release);
+	});
+}
+
+BanList::~BanList()
+{
+	if (this->worker.joinable())
+		this->worker.join();
+}
@@ -0,0 +1,157 @@
+/* banlist.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef BANLIST_HPP_INCLUDED
+#define BANLIST_HPP_INCLUDED
+
+#include "fwd/banlist.hpp"
+
+#include "fwd/database.hpp"
+
+#include "socket.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A single row of the bans table
+ * Any of username, ip and hdid may be left empty (0) to not ban by that field
+ */
+struct Ban_Entry
+{
+	std::string username;
+	IPAddress ip;
+	int ip_prefix = 32;
+	int hdid = 0;
+
+	/**
+	 * Unix time the ban expires, or 0 for a permanent ban
+	 */
+	int expires = 0;
+};
+
+/**
+ * In-memory lookup structure for bans
+ * Usernames and HDIDs are hashed, IP addresses are stored in a binary prefix trie so CIDR ranges can be banned.
+ * Expiry times use the same convention as the bans table, with -1 meaning "not banned".
+ */
+class BanIndex
+{
+	private:
+		struct IP_Node
+		{
+			std::uint32_t child[2];
+			int expires;
+		};
+
+		std::unordered_map<std::string, int> usernames;
+		std::unordered_map<int, int> hdids;
+
+		/**
+		 * Node 0 is the root (0.0.0.0/0), child index 0 means no child
+		 */
+		std::vector<IP_Node> ip_nodes;
+		std::size_t ip_bans;
+
+		const IP_Node *FindIP(IPAddress address, int prefix) const;
+
+	public:
+		/**
+		 * Combines two expiry times, with permanent bans taking priority
+		 */
+		static int Merge(int a, int b);
+
+		/**
+		 * Checks if a ban with expiry time a lasts at least as long as b
+		 */
+		static bool Covers(int a, int b);
+
+		static bool Active(int expires, std::time_t now)
+		{
+			return expires == 0 || expires > now;
+		}
+
+		BanIndex();
+
+		void Clear();
+
+		void Add(const Ban_Entry &entry);
+
+		/**
+		 * Checks if every field of a ban is already covered by an exact entry
+		 */
+		bool Contains(const Ban_Entry &entry) const;
+
+		/**
+		 * Returns the expiry time of the longest active ban matching any of the given fields, or -1
+		 * An IP address matches any banned range containing it.
+		 */
+		int Check(const std::string *username, const IPAddress *address, const int *hdid, std::time_t now) const;
+
+		std::size_t Size() const;
+};
+
+/**
+ * The server's ban list, kept in memory and periodically refreshed from the bans table by a background thread
+ * Bans added locally are kept until a refresh shows they have reached the database.
+ */
+class BanList
+{
+	private:
+		BanIndex index;
+		std::vector<Ban_Entry> local;
+
+		bool loaded;
+		bool prefix_column;
+		std::time_t next_sync;
+
+		std::unique_ptr<Database> sync_db;
+		std::thread worker;
+		std::atomic<bool> worker_done;
+		std::unique_ptr<BanIndex> snapshot;
+		std::string worker_error;
+
+		static void Read(Database &db, BanIndex &index, bool prefix_column);
+
+		void Apply(std::unique_ptr<BanIndex> &&new_index);
+
+	public:
+		BanList();
+
+		/**
+		 * Loads all active bans from the database, blocking until complete
+		 * Also opens a second database connection used for background refreshes.
+		 * @throw Database_Exception
+		 */
+		void Load(Database &db);
+
+		/**
+		 * Adds a ban that has just been written to the database
+		 */
+		void Add(const Ban_Entry &entry);
+
+		int Check(const std::string *username, const IPAddress *address, const int *hdid) const;
+
+		/**
+		 * Applies the result of a finished refresh and starts a new one once rate seconds have passed
+		 * Never blocks on the database.
+		 */
+		void Sync(int rate);
+
+		bool Loaded() const { return this->loaded; }
+		bool PrefixSupported() const { return this->prefix_column; }
+		std::size_t Size() const { return this->index.Size(); }
+
+		~BanList();
+};
+
+#endif // BANLIST_HPP_INCLUDED
@@ -0,0 +1,522 @@
+/* board.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "board.hpp"
+
+#include "database.hpp"
+#include "packet.hpp"
+#include "timer.hpp"
+
+#include "console.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Timer time at which util::timeago(time, now) will next return something different
+static double timeago_expires(double time, double now)
+{
+	static const int units[] = {7*24*60*60, 24*60*60, 60*60, 60, 1};
+
+	double diff = now - time;
+
+	// Posts from the future are only possible if the clock misbehaves, check again shortly
+	if (diff < 0.0)
+		return now + 1.0;
+
+	for (int unit : units)
+	{
+		int x = int(diff / unit);
+
+		if (x > 0)
+			return time + double(x + 1) * unit;
+	}
+
+	return time + 1.0;
+}
+
+Board::Board(int id_, BoardStore *store_)
+	: first(0)
+	, count(0)
+	, store(store_)
+	, id(id_)
+	, last_id(0)
+{ }
+
+std::size_t Board::Index(short post_id) const
+{
+	std::size_t low = 0;
+	std::size_t high = this->count;
+
+	while (low < high)
+	{
+		std::size_t mid = low + (high - low) / 2;
+
+		if (this->Slot(mid).id < post_id)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low < this->count && this->Slot(low).id == post_id)
+		return low;
+
+	return this->count;
+}
+
+void Board::Push(Board_Post &&post)
+{
+	if (this->count == this->slots.size())
+	{
+		std::vector<Board_Post> grown(std::max<std::size_t>(8, this->slots.size() * 2));
+
+		for (std::size_t i = 0; i < this->count; ++i)
+			grown[i] = std::move(this->Slot(i));
+
+		this->slots.swap(grown);
+		this->first = 0;
+	}
+
+	++this->author_posts[post.author];
+	this->Slot(this->count++) = std::move(post);
+	this->Invalidate();
+}
+
+void Board::Forget(const Board_Post &post)
+{
+	auto it = this->author_posts.find(post.author);
+
+	if (it != this->author_posts.end() && --it->second <= 0)
+		this->author_posts.erase(it);
+}
+
+void Board::Invalidate()
+{
+	this->listings[0].valid = false;
+	this->listings[1].valid = false;
+}
+
+void Board::Renumber()
+{
+	for (std::size_t i = 0; i < this->count; ++i)
+		this->Slot(i).id = short(i + 1);
+
+	this->last_id = short(this->count);
+	this->Invalidate();
+
+	if (this->store)
+		this->store->Rewrite(*this);
+}
+
+const Board_Post *Board::Find(short post_id) const
+{
+	std::size_t i = this->Index(post_id);
+
+	return (i < this->count) ? &this->Slot(i) : nullptr;
+}
+
+const Board_Post &Board::Add(Board_Post &&post, std::size_t limit)
+{
+	// IDs must keep increasing for lookups to work, so close the gaps left by old posts once they run out
+	if (this->last_id == SHRT_MAX)
+		this->Renumber();
+
+	post.id = ++this->last_id;
+	this->Push(std::move(post));
+
+	const Board_Post &added = this->Slot(this->count - 1);
+
+	if (this->store)
+		this->store->Insert(*this, added);
+
+	while (this->count > std::max<std::size_t>(limit, 1))
+	{
+		Board_Post &oldest = this->Slot(0);
+
+		if (this->store)
+			this->store->Remove(*this, oldest.id);
+
+		this->Forget(oldest);
+		oldest = Board_Post();
+		this->first = (this->first + 1) % this->slots.size();
+		--this->count;
+	}
+
+	return this->Slot(this->count - 1);
+}
+
+void Board::Load(Board_Post &&post)
+{
+	this->last_id = std::max(this->last_id, post.id);
+	this->Push(std::move(post));
+}
+
+bool Board::Remove(short post_id)
+{
+	std::size_t k = this->Index(post_id);
+
+	if (k == this->count)
+		return false;
+
+	if (this->store)
+		this->store->Remove(*this, post_id);
+
+	this->Forget(this->Slot(k));
+
+	// Close the gap from whichever end is nearer
+	if (k < this->count - 1 - k)
+	{
+		for (std::size_t j = k; j > 0; --j)
+			this->Slot(j) = std::move(this->Slot(j - 1));
+
+		this->Slot(0) = Board_Post();
+		this->first = (this->first + 1) % this->slots.size();
+	}
+	else
+	{
+		for (std::size_t j = k; j + 1 < this->count; ++j)
+			this->Slot(j) = std::move(this->Slot(j + 1));
+
+		this->Slot(this->count - 1) = Board_Post();
+	}
+
+	--this->count;
+	this->Invalidate();
+
+	return true;
+}
+
+int Board::AuthorPosts(const std::string &author) const
+{
+	auto it = this->author_posts.find(author);
+
+	return (it != this->author_posts.end()) ? it->second : 0;
+}
+
+int Board::AuthorRecentPosts(const std::string &author, double since) const
+{
+	int recent = 0;
+
+	if (this->AuthorPosts(author) == 0)
+		return 0;
+
+	// Newest first, so stop at the first post that isn't recent
+	for (std::size_t i = 0; i < this->count; ++i)
+	{
+		const Board_Post &post = this->Post(i);
+
+		if (post.time <= since)
+			break;
+
+		if (post.author == author)
+			++recent;
+	}
+
+	return recent;
+}
+
+const PacketBuilder &Board::Listing(bool can_post, bool dated, double now) const
+{
+	CachedListing &listing = this->listings[can_post];
+
+	if (listing.valid && listing.dated == dated && (!dated || now < listing.expires))
+		return listing.packet;
+
+	std::size_t size_guess = 2;
+
+	for (std::size_t i = 0; i < this->count; ++i)
+	{
+		const Board_Post &post = this->Slot(i);
+		size_guess += 6 + post.author.length() + post.subject.length() + (dated ? 24 : 0);
+	}
+
+	listing.packet.SetID(PACKET_BOARD, PACKET_OPEN);
+	listing.packet.Reset(size_guess);
+	listing.packet.AddChar(this->id + 1);
+	listing.packet.AddChar(this->count);
+
+	listing.expires = now + 1.0e9;
+
+	for (std::size_t i = 0; i < this->count; ++i)
+	{
+		const Board_Post &post = this->Post(i);
+
+		listing.packet.AddShort(post.id);
+		listing.packet.AddByte(255);
+
+		// A trailing space on the author name enables the client's post button
+		if (can_post)
+			listing.packet.AddBreakString(post.author + " ");
+		else
+			listing.packet.AddBreakString(post.author);
+
+		if (dated)
+		{
+			listing.packet.AddBreakString(post.subject + " (" + util::timeago(post.time, now) + ")");
+			listing.expires = std::min(listing.expires, timeago_expires(post.time, now));
+		}
+		else
+		{
+			listing.packet.AddBreakString(post.subject);
+		}
+	}
+
+	listing.valid = true;
+	listing.dated = dated;
+
+	return listing.packet;
+}
+
+BoardStore::BoardStore()
+	: enabled(false)
+	, game_db(nullptr)
+	, direct_db(nullptr)
+	, stopping(false)
+{ }
+
+void BoardStore::Load(Database &db, Board *const *boards, std::size_t board_count)
+{
+	Database_Result res;
+
+	try
+	{
+		res = db.Query("SELECT `board`, `id`, `author`, `author_admin`, `subject`, `body`, `time` FROM `board_posts` ORDER BY `board`, `id`");
+	}
+	catch (Database_QueryFailed &)
+	{
+		Console::Wrn("board_posts table does not exist, board posts will not be saved (see upgrade/0.7.0_to_0.7.1.sql)");
+		return;
+	}
+
+	double timer_now = Timer::GetTime();
+	std::time_t now = std::time(0);
+
+	UTIL_FOREACH_REF(res, row)
+	{
+		std::size_t board = static_cast<std::size_t>(static_cast<int>(row["board"]));
+
+		if (board >= board_count)
+			continue;
+
+		Board_Post post;
+		post.id = static_cast<short>(static_cast<int>(row["id"]));
+		post.author = static_cast<std::string>(row["author"]);
+		post.author_admin = static_cast<int>(row["author_admin"]);
+		post.subject = static_cast<std::string>(row["subject"]);
+		post.body = static_cast<std::string>(row["body"]);
+		post.time = timer_now - double(now - static_cast<int>(row["time"]));
+
+		boards[board]->Load(std::move(post));
+	}
+
+	this->enabled = true;
+	this->game_db = &db;
+
+	// SQLite allows one writer at a time and the game connection holds the write lock for the whole TimedSave window
+	if (db.GetEngine() == Database::SQLite)
+	{
+		this->direct_db = &db;
+		return;
+	}
+
+	std::unique_ptr<Database> worker_db(new Database);
+
+	try
+	{
+		worker_db->Connect(db);
+		this->worker_db = std::move(worker_db);
+		this->worker = std::thread(&BoardStore::Run, this);
+	}
+	catch (Database_OpenFailed &e)
+	{
+		Console::Wrn("Could not open a second database connection, board posts will be saved on the game thread: %s", e.error());
+		this->direct_db = &db;
+	}
+}
+
+void BoardStore::Queue(Op &&op)
+{
+	if (!this->enabled)
+		return;
+
+	if (this->direct_db)
+	{
+		// Anything that failed before is written again along with this change
+		this->ops.push_back(std::move(op));
+
+		try
+		{
+			Write(*this->direct_db, this->ops);
+			this->ops.clear();
+		}
+		catch (Database_Exception &e)
+		{
+			Console::Wrn("Could not save board posts, trying again with the next change: %s", e.error());
+		}
+
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->ops.push_back(std::move(op));
+	}
+
+	this->wake.notify_one();
+}
+
+void BoardStore::Insert(const Board &board, const Board_Post &post)
+{
+	Op op;
+	op.type = Op::Insert;
+	op.board = board.id;
+	op.id = post.id;
+	op.author = post.author;
+	op.author_admin = post.author_admin;
+	op.subject = post.subject;
+	op.body = post.body;
+	op.time = std::time(0) - std::time_t(Timer::GetTime() - post.time);
+
+	this->Queue(std::move(op));
+}
+
+void BoardStore::Remove(const Board &board, short post_id)
+{
+	Op op;
+	op.type = Op::Remove;
+	op.board = board.id;
+	op.id = post_id;
+
+	this->Queue(std::move(op));
+}
+
+void BoardStore::Rewrite(const Board &board)
+{
+	Op op;
+	op.type = Op::Clear;
+	op.board = board.id;
+	op.id = 0;
+
+	this->Queue(std::move(op));
+
+	for (std::size_t i = board.Size(); i > 0; --i)
+		this->Insert(board, board.Post(i - 1));
+}
+
+void BoardStore::Write(Database &db, const std::deque<Op> &batch)
+{
+	bool own_transaction = db.BeginTransaction();
+
+	try
+	{
+		UTIL_FOREACH_CREF(batch, op)
+		{
+			switch (op.type)
+			{
+				case Op::Insert:
+					db.Query("REPLACE INTO `board_posts` (`board`, `id`, `author`, `author_admin`, `subject`, `body`, `time`) VALUES (#, #, '$', #, '$', '$', #)",
+						op.board, int(op.id), op.author.c_str(), op.author_admin, op.subject.c_str(), op.body.c_str(), int(op.time));
+					break;
+
+				case Op::Remove:
+					db.Query("DELETE FROM `board_posts` WHERE `board` = # AND `id` = #", op.board, int(op.id));
+					break;
+
+				case Op::Clear:
+					db.Query("DELETE FROM `board_posts` WHERE `board` = #", op.board);
+					break;
+			}
+		}
+
+		if (own_transaction)
+			db.Commit();
+	}
+	catch (...)
+	{
+		if (own_transaction)
+			db.Rollback();
+
+		throw;
+	}
+}
+
+void BoardStore::Run()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	for (;;)
+	{
+		this->wake.wait(lock, [this]() { return this->stopping || !this->ops.empty(); });
+
+		if (this->ops.empty())
+			break;
+
+		std::deque<Op> batch;
+		batch.swap(this->ops);
+
+		lock.unlock();
+
+		bool written = true;
+
+		try
+		{
+			Write(*this->worker_db, batch);
+		}
+		catch (Database_Exception &e)
+		{
+			Console::Wrn("Could not save board posts: %s", e.error());
+			written = false;
+		}
+
+		lock.lock();
+
+		if (written)
+			continue;
+
+		// Keep the batch ahead of anything queued since, and leave it for the destructor if shutting down
+		this->ops.insert(this->ops.begin(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+
+		if (this->stopping)
+			break;
+
+		this->wake.wait_for(lock, std::chrono::seconds(10), [this]() { return this->stopping; });
+	}
+}
+
+BoardStore::~BoardStore()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+	}
+
+	this->wake.notify_one();
+
+	if (this->worker.joinable())
+		this->worker.join();
+
+	if (this->ops.empty() || !this->game_db)
+		return;
+
+	try
+	{
+		Write(*this->game_db, this->ops);
+	}
+	catch (Database_Exception &e)
+	{
+		Console::Err("Could not save %i board changes: %s", int(this->ops.size()), e.error());
+	}
+}
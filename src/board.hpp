@@ -0,0 +1,192 @@
+/* board.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef BOARD_HPP_INCLUDED
+#define BOARD_HPP_INCLUDED
+
+#include "fwd/board.hpp"
+
+#include "fwd/database.hpp"
+#include "packet.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct Board_Post
+{
+	short id;
+	std::string author;
+	int author_admin;
+	std::string subject;
+	std::string body;
+	double time;
+};
+
+/**
+ * A town board's posts, held in a ring ordered by post ID
+ * The board listing sent to clients is cached until a post is added or removed.
+ */
+class Board
+{
+	private:
+		struct CachedListing
+		{
+			PacketBuilder packet;
+			bool valid = false;
+			bool dated = false;
+
+			/**
+			 * Timer time at which a dated listing's "(x ago)" text next changes
+			 */
+			double expires = 0.0;
+		};
+
+		std::vector<Board_Post> slots;
+		std::size_t first;
+		std::size_t count;
+
+		std::unordered_map<std::string, int> author_posts;
+
+		BoardStore *store;
+
+		// Indexed by whether the viewer may post
+		mutable CachedListing listings[2];
+
+		// i counts from the oldest post
+		Board_Post &Slot(std::size_t i) { return this->slots[(this->first + i) % this->slots.size()]; }
+		const Board_Post &Slot(std::size_t i) const { return this->slots[(this->first + i) % this->slots.size()]; }
+
+		std::size_t Index(short post_id) const;
+
+		void Push(Board_Post &&post);
+		void Forget(const Board_Post &post);
+		void Invalidate();
+
+		void Renumber();
+
+	public:
+		int id;
+		short last_id;
+
+		Board(int id_, BoardStore *store_ = nullptr);
+
+		std::size_t Size() const { return this->count; }
+
+		/**
+		 * Returns a post by position, newest first
+		 */
+		const Board_Post &Post(std::size_t i) const { return this->Slot(this->count - 1 - i); }
+
+		const Board_Post *Find(short post_id) const;
+
+		/**
+		 * Adds a new post, assigning its ID, and removes the oldest posts while there are more than limit
+		 */
+		const Board_Post &Add(Board_Post &&post, std::size_t limit);
+
+		/**
+		 * Adds a post loaded from the database, keeping its ID
+		 * Posts must be loaded in ascending ID order.
+		 */
+		void Load(Board_Post &&post);
+
+		bool Remove(short post_id);
+
+		int AuthorPosts(const std::string &author) const;
+
+		/**
+		 * Number of posts by author made after the given time
+		 */
+		int AuthorRecentPosts(const std::string &author, double since) const;
+
+		/**
+		 * Returns the BOARD_OPEN packet listing every post
+		 * @param can_post Marks the author names so the client enables its post button
+		 * @param dated Appends how long ago each post was made to its subject
+		 * @param now Current Timer time, used for dated listings
+		 */
+		const PacketBuilder &Listing(bool can_post, bool dated, double now) const;
+};
+
+/**
+ * Saves board posts to the database from a background thread, so posting never waits on a query
+ * SQLite databases are written on the game thread inside its transaction, as are others if a second connection can't be opened.
+ * Changes that fail to save are kept and tried again rather than dropped.
+ */
+class BoardStore
+{
+	private:
+		struct Op
+		{
+			enum Type
+			{
+				Insert,
+				Remove,
+				Clear
+			};
+
+			Type type;
+			int board;
+			short id;
+			std::string author;
+			int author_admin;
+			std::string subject;
+			std::string body;
+			std::time_t time;
+		};
+
+		bool enabled;
+
+		Database *game_db;
+		Database *direct_db;
+		std::unique_ptr<Database> worker_db;
+
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::deque<Op> ops;
+		bool stopping;
+
+		void Queue(Op &&op);
+
+		static void Write(Database &db, const std::deque<Op> &batch);
+
+		void Run();
+
+	public:
+		BoardStore();
+
+		/**
+		 * Loads every saved post in to the boards and starts the background writer
+		 * Saving is disabled if the board_posts table doesn't exist.
+		 */
+		void Load(Database &db, Board *const *boards, std::size_t board_count);
+
+		void Insert(const Board &board, const Board_Post &post);
+		void Remove(const Board &board, short post_id);
+
+		/**
+		 * Replaces all of a board's saved posts with its current contents
+		 */
+		void Rewrite(const Board &board);
+
+		bool Enabled() const { return this->enabled; }
+
+		/**
+		 * Writes out any queued changes before returning
+		 * Changes the background thread couldn't save are written on the game connection.
+		 */
+		~BoardStore();
+};
+
+#endif // BOARD_HPP_INCLUDED
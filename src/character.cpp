@@ -6,6 +6,7 @@
 #include "character.hpp"
 
 #include "arena.hpp"
+#include "board.hpp"
 #include "config.hpp"
 #include "database.hpp"
 #include "eoclient.hpp"
@@ -28,6 +29,9 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <list>
 #include <map>
@@ -58,51 +62,83 @@ void character_cast_spell(void *character_void)
 		character->spell_ready = true;
 }
 
-std::string ItemSerialize(const std::list<Character_Item> &list)
+static void serialize_append_int(std::string &out, int value)
 {
-	std::string serialized;
+	char buf[12];
+	char *p = buf + sizeof(buf);
+	unsigned int uvalue = (value < 0) ? 0U - unsigned(value) : unsigned(value);
 
-	UTIL_CIFOREACH(list, item)
+	do
 	{
-		serialized.append(util::to_string(item->id));
-		serialized.append(",");
-		serialized.append(util::to_string(item->amount));
-		serialized.append(";");
-	}
+		*--p = char('0' + uvalue % 10);
+		uvalue /= 10;
+	} while (uvalue != 0);
 
-	return serialized;
+	if (value < 0)
+		*--p = '-';
+
+	out.append(p, buf + sizeof(buf));
 }
 
-std::list<Character_Item> ItemUnserialize(const std::string& serialized)
+// Parses "a,b;a,b;..." pairs without allocating, calling f(a, b) for each well-formed pair
+template <class F> static void unserialize_pairs(const std::string &serialized, F f)
 {
-	std::list<Character_Item> list;
+	const char *p = serialized.c_str();
+	const char *end = p + serialized.length();
 
-	std::vector<std::string> parts = util::explode(';', serialized);
+	while (p < end)
+	{
+		const char *sep = static_cast<const char *>(std::memchr(p, ';', end - p));
+		const char *part_end = sep ? sep : end;
+		const char *comma = static_cast<const char *>(std::memchr(p, ',', part_end - p));
 
-	UTIL_FOREACH(parts, part)
+		if (comma)
+			f(int(std::strtol(p, 0, 10)), int(std::strtol(comma + 1, 0, 10)));
+
+		p = part_end + 1;
+	}
+}
+
+void ItemSerialize(std::string &out, const util::id_vector<Character_Item> &list)
+{
+	out.reserve(out.length() + list.size() * 10);
+
+	UTIL_FOREACH(list, item)
 	{
-		std::size_t pp = part.find_first_of(',', 0);
+		serialize_append_int(out, item.id);
+		out.push_back(',');
+		serialize_append_int(out, item.amount);
+		out.push_back(';');
+	}
+}
 
-		if (pp == std::string::npos)
-		{
-			continue;
-		}
+std::string ItemSerialize(const util::id_vector<Character_Item> &list)
+{
+	std::string serialized;
+	ItemSerialize(serialized, list);
+	return serialized;
+}
 
-		int id = util::to_int(part.substr(0, pp));
-		int amount = util::to_int(part.substr(pp + 1));
+util::id_vector<Character_Item> ItemUnserialize(const std::string& serialized)
+{
+	util::id_vector<Character_Item> list;
 
+	list.reserve(std::count(UTIL_CRANGE(serialized), ';'));
+
+	unserialize_pairs(serialized, [&](int id, int amount)
+	{
 		if (id < 1 || id > 65535 || amount < 1)
 		{
 			Console::Wrn("Discarding invalid inventory data: id: %d, amount: %d", id, amount);
-			continue;
+			return;
 		}
 
-		Character_Item newitem;
-		newitem.id = id;
-		newitem.amount = amount;
+		auto result = list.insert(Character_Item(id, amount));
 
-		list.emplace_back(std::move(newitem));
-	}
+		// Merge duplicate entries rather than losing them
+		if (!result.second)
+			result.first->amount = int(std::min<long long>((long long)result.first->amount + amount, 0x7FFFFFFF));
+	});
 
 	return list;
 }
@@ -147,50 +183,42 @@ std::array<int, 15> DollUnserialize(const std::string& serialized)
 	return list;
 }
 
-std::string SpellSerialize(const std::list<Character_Spell> &list)
+void SpellSerialize(std::string &out, const util::id_vector<Character_Spell> &list)
 {
-	std::string serialized;
+	out.reserve(out.length() + list.size() * 8);
 
 	UTIL_FOREACH(list, spell)
 	{
-		serialized.append(util::to_string(spell.id));
-		serialized.append(",");
-		serialized.append(util::to_string(spell.level));
-		serialized.append(";");
+		serialize_append_int(out, spell.id);
+		out.push_back(',');
+		serialize_append_int(out, spell.level);
+		out.push_back(';');
 	}
+}
 
+std::string SpellSerialize(const util::id_vector<Character_Spell> &list)
+{
+	std::string serialized;
+	SpellSerialize(serialized, list);
 	return serialized;
 }
 
-std::list<Character_Spell> SpellUnserialize(const std::string& serialized)
+util::id_vector<Character_Spell> SpellUnserialize(const std::string& serialized)
 {
-	std::list<Character_Spell> list;
+	util::id_vector<Character_Spell> list;
 
-	std::vector<std::string> parts = util::explode(';', serialized);
+	list.reserve(std::count(UTIL_CRANGE(serialized), ';'));
 
-	UTIL_FOREACH(parts, part)
+	unserialize_pairs(serialized, [&](int id, int level)
 	{
-		std::size_t pp = 0;
-		pp = part.find_first_of(',', 0);
-
-		if (pp == std::string::npos)
-			continue;
-
-		int id = util::to_int(part.substr(0, pp));
-		int level = util::to_int(part.substr(pp+1));
-
 		if (id < 1 || id > 65535 || level < 0)
 		{
 			Console::Wrn("Discarding invalid spell data: id: %d, level: %d", id, level);
-			continue;
+			return;
 		}
 
-		Character_Spell newspell;
-		newspell.id = id;
-		newspell.level = level;
-
-		list.emplace_back(std::move(newspell));
-	}
+		list.insert(Character_Spell(id, level));
+	});
 
 	return list;
 }
@@ -352,6 +380,69 @@ template <typename T> static T GetRow(std::unordered_map<std::string, util::vari
 	return row[col];
 }
 
+// Appends values to a save group snapshot, strings are length-prefixed so neighbouring values can't run together
+struct save_snapshot_writer
+{
+	std::string& out;
+
+	save_snapshot_writer(std::string& out)
+		: out(out)
+	{
+		out.clear();
+	}
+
+	save_snapshot_writer& operator <<(long long value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof value);
+		return *this;
+	}
+
+	save_snapshot_writer& operator <<(const std::string& value)
+	{
+		*this << static_cast<long long>(value.length());
+		out += value;
+		return *this;
+	}
+};
+
+// Appends "`column` = value" pairs to an UPDATE statement
+struct save_query_builder
+{
+	Database& db;
+	std::string query;
+	bool first = true;
+
+	save_query_builder(Database& db)
+		: db(db)
+		, query("UPDATE `characters` SET ")
+	{ }
+
+	void Column(const char* name)
+	{
+		if (!first)
+			query += ", ";
+
+		first = false;
+		query += '`';
+		query += name;
+		query += "` = ";
+	}
+
+	void Int(const char* name, int value)
+	{
+		Column(name);
+		query += util::to_string(value);
+	}
+
+	void Str(const char* name, const std::string& value)
+	{
+		Column(name);
+		query += '\'';
+		query += db.EscapeRaw(value);
+		query += '\'';
+	}
+};
+
 Character::Character(std::string name, World *world)
 	: muted_until(0)
 	, bot(false)
@@ -469,12 +560,24 @@ Character::Character(std::string name, World *world)
 
 	this->player = 0;
 	std::string guild_tag = util::trim(static_cast<std::string>(row["guild"]));
+	int guild_rank = GetRow<int>(row, "guild_rank");
+	std::string guild_rank_string = GetRow<std::string>(row, "guild_rank_string");
+
+	// Guild changes made while offline may not have been written yet
+	const GuildManager::Member_Update *guild_update = this->world->guildmanager->PendingMemberUpdate(this->real_name);
+
+	if (guild_update)
+	{
+		guild_tag = guild_update->guild;
+		guild_rank = guild_update->rank;
+		guild_rank_string = guild_update->rank_string;
+	}
 
 	if (!guild_tag.empty())
 	{
 		this->guild = this->world->guildmanager->GetGuild(guild_tag);
-		this->guild_rank = GetRow<int>(row, "guild_rank");
-		this->guild_rank_string = GetRow<std::string>(row, "guild_rank_string");
+		this->guild_rank = guild_rank;
+		this->guild_rank_string = guild_rank_string;
 	}
 	else
 	{
@@ -496,6 +599,17 @@ Character::Character(std::string name, World *world)
 	{
 		this->nointeract = static_cast<int>(world->config["NoInteractDefault"]);
 	}
+
+	// Everything just loaded matches the database, so nothing needs saving yet
+	this->save_forced = 0;
+	this->MarkSaveClean(SaveAll);
+
+	// Values corrected while loading still need to be written back
+	if (this->mapid != GetRow<int>(row, "map"))
+		this->MarkSaveDirty(SavePosition);
+
+	if (!guild_tag.empty() && !this->guild)
+		this->MarkSaveDirty(SaveGuild);
 }
 
 int Character::PlayerID() const
@@ -510,6 +624,9 @@ void Character::Login()
 	QuestUnserialize(this->quest_string, this);
 	this->quest_string.clear();
 
+	// Loaded quest contexts represent the saved quest string
+	this->MarkSaveClean(SaveQuest);
+
 	// Start the default 00000.eqf quest
 	if (!this->GetQuest(0))
 	{
@@ -661,43 +778,33 @@ void Character::PlayBard(unsigned char instrument, unsigned char note, bool echo
 
 int Character::HasItem(short item, bool include_trade)
 {
-	UTIL_IFOREACH(this->inventory, it)
+	const Character_Item *inventory_item = this->inventory.get(item);
+
+	if (!inventory_item)
+		return 0;
+
+	if (this->trading && !include_trade)
 	{
-		if (it->id == item)
-		{
-			if (this->trading && !include_trade)
-			{
-				UTIL_FOREACH(this->trade_inventory, trade_item)
-				{
-					if (trade_item.id == item)
-					{
-						return std::max(it->amount - trade_item.amount, 0);
-					}
-				}
-
-				return it->amount;
-			}
-			else
-			{
-				return it->amount;
-			}
-		}
+		const Character_Item *trade_item = this->trade_inventory.get(item);
+
+		if (trade_item)
+			return std::max(inventory_item->amount - trade_item->amount, 0);
 	}
 
-	return 0;
+	return inventory_item->amount;
 }
 
 bool Character::HasSpell(short spell)
 {
-	return (std::find_if(UTIL_RANGE(this->spells), [&](Character_Spell cs) { return cs.id == spell; }) != this->spells.end());
+	return this->spells.contains(spell);
 }
 
 short Character::SpellLevel(short spell)
 {
-	auto it = std::find_if(UTIL_RANGE(this->spells), [&](Character_Spell cs) { return cs.id == spell; });
+	const Character_Spell *character_spell = this->spells.get(spell);
 
-	if (it != this->spells.end())
-		return it->level;
+	if (character_spell)
+		return character_spell->level;
 	else
 		return 0;
 }
@@ -714,30 +821,21 @@ bool Character::AddItem(short item, int amount)
 		return false;
 	}
 
-	UTIL_IFOREACH(this->inventory, it)
-	{
-		if (it->id == item)
-		{
-			if (it->amount + amount < 0)
-			{
-				return false;
-			}
-
-			it->amount += amount;
+	auto result = this->inventory.insert(Character_Item(item, amount));
 
-			it->amount = std::min<int>(it->amount, this->world->config["MaxItem"]);
-
-			this->CalculateStats();
+	if (!result.second)
+	{
+		Character_Item &inventory_item = *result.first;
 
-			return true;
+		if (inventory_item.amount + amount < 0)
+		{
+			return false;
 		}
-	}
 
-	Character_Item newitem;
-	newitem.id = item;
-	newitem.amount = amount;
+		inventory_item.amount += amount;
 
-	this->inventory.push_back(newitem);
+		inventory_item.amount = std::min<int>(inventory_item.amount, this->world->config["MaxItem"]);
+	}
 
 	this->CalculateStats();
 
@@ -751,29 +849,28 @@ bool Character::DelItem(short item, int amount)
 		return false;
 	}
 
-	UTIL_IFOREACH(this->inventory, it)
-	{
-		if (it->id == item)
-		{
-			if (it->amount < 0 || it->amount - amount <= 0)
-			{
-				this->inventory.erase(it);
-			}
-			else
-			{
-				it->amount -= amount;
-			}
+	auto it = this->inventory.find(item);
 
-			this->CalculateStats();
+	if (it == this->inventory.end())
+	{
+		return false;
+	}
 
-			return true;
-		}
+	if (it->amount < 0 || it->amount - amount <= 0)
+	{
+		this->inventory.erase(it);
+	}
+	else
+	{
+		it->amount -= amount;
 	}
 
-	return false;
+	this->CalculateStats();
+
+	return true;
 }
 
-std::list<Character_Item>::iterator Character::DelItem(std::list<Character_Item>::iterator it, int amount)
+util::id_vector<Character_Item>::iterator Character::DelItem(util::id_vector<Character_Item>::iterator it, int amount)
 {
 	if (amount <= 0)
 	{
@@ -836,15 +933,8 @@ bool Character::AddTradeItem(short item, int amount)
 	// Prevent overflow
 	if (trade_add_quantity)
 	{
-		int tradeitem = 0;
-
-		UTIL_FOREACH(this->trade_inventory, trade_item)
-		{
-			if (trade_item.id == item)
-			{
-				tradeitem = trade_item.amount;
-			}
-		}
+		const Character_Item *trade_item = this->trade_inventory.get(item);
+		int tradeitem = trade_item ? trade_item->amount : 0;
 
 		if (tradeitem + amount < 0 || tradeitem + amount > int(this->world->config["MaxTrade"]))
 		{
@@ -853,24 +943,18 @@ bool Character::AddTradeItem(short item, int amount)
 
 	}
 
-	UTIL_FOREACH_REF(this->trade_inventory, character_item)
+	auto result = this->trade_inventory.insert(Character_Item(item, amount));
+
+	if (!result.second)
 	{
-		if (character_item.id == item)
-		{
-			if (trade_add_quantity)
-				character_item.amount += amount;
-			else
-				character_item.amount = amount;
+		if (trade_add_quantity)
+			result.first->amount += amount;
+		else
+			result.first->amount = amount;
 
-			return true;
-		}
+		return true;
 	}
 
-	Character_Item newitem;
-	newitem.id = item;
-	newitem.amount = amount;
-
-	this->trade_inventory.push_back(newitem);
 	this->CheckQuestRules();
 
 	return true;
@@ -878,14 +962,10 @@ bool Character::AddTradeItem(short item, int amount)
 
 bool Character::DelTradeItem(short item)
 {
-	for (std::list<Character_Item>::iterator it = this->trade_inventory.begin(); it != this->trade_inventory.end(); ++it)
+	if (this->trade_inventory.erase(item))
 	{
-		if (it->id == item)
-		{
-			this->trade_inventory.erase(it);
-			this->CheckQuestRules();
-			return true;
-		}
+		this->CheckQuestRules();
+		return true;
 	}
 
 	return false;
@@ -899,7 +979,7 @@ bool Character::AddSpell(short spell)
 	if (this->HasSpell(spell))
 		return false;
 
-	this->spells.push_back(Character_Spell(spell, 0));
+	this->spells.insert(Character_Spell(spell, 0));
 
 	this->CheckQuestRules();
 
@@ -908,9 +988,7 @@ bool Character::AddSpell(short spell)
 
 bool Character::DelSpell(short spell)
 {
-	auto remove_it = std::remove_if(UTIL_RANGE(this->spells), [&](Character_Spell cs) { return cs.id == spell; });
-	bool removed = (remove_it != this->spells.end());
-	this->spells.erase(remove_it, this->spells.end());
+	bool removed = this->spells.erase(spell);
 
 	this->CheckQuestRules();
 
@@ -1383,55 +1461,13 @@ void Character::ShowBoard(Board *board)
 		board = this->board;
 	}
 
-	const int date_res = (this->world->config["BoardDatePosts"]) ? 17 : 0;
-
-	PacketBuilder builder(PACKET_BOARD, PACKET_OPEN, 2 + board->posts.size() * (17 + int(this->world->config["BoardMaxSubjectLength"]) + date_res));
-	builder.AddChar(board->id + 1);
-	builder.AddChar(board->posts.size());
-
-	int post_count = 0;
-	int recent_post_count = 0;
-
-	UTIL_FOREACH(board->posts, post)
-	{
-		if (post->author == this->player->character->SourceName())
-		{
-			++post_count;
-
-			if (post->time + static_cast<int>(this->world->config["BoardRecentPostTime"]) > Timer::GetTime())
-			{
-				++recent_post_count;
-			}
-		}
-	}
+	double now = Timer::GetTime();
+	int post_count = board->AuthorPosts(this->SourceName());
+	int recent_post_count = board->AuthorRecentPosts(this->SourceName(), now - static_cast<int>(this->world->config["BoardRecentPostTime"]));
 
 	int posts_remaining = std::min(static_cast<int>(this->world->config["BoardMaxUserPosts"]) - post_count, static_cast<int>(this->world->config["BoardMaxUserRecentPosts"]) - recent_post_count);
 
-	UTIL_FOREACH(board->posts, post)
-	{
-		builder.AddShort(post->id);
-		builder.AddByte(255);
-
-		std::string author_extra;
-
-		if (posts_remaining > 0)
-		{
-			author_extra = " ";
-		}
-
-		builder.AddBreakString(post->author + author_extra);
-
-		std::string subject_extra;
-
-		if (this->world->config["BoardDatePosts"])
-		{
-			subject_extra = " (" + util::timeago(post->time, Timer::GetTime()) + ")";
-		}
-
-		builder.AddBreakString(post->subject + subject_extra);
-	}
-
-	this->Send(builder);
+	this->Send(board->Listing(posts_remaining > 0, this->world->config["BoardDatePosts"], now));
 }
 
 std::string Character::PaddedGuildTag()
@@ -1649,34 +1685,32 @@ void Character::DropAll(Character *killer)
 {
 	if (!CanInteractItems()) return;
 
-	std::list<Character_Item>::iterator it = this->inventory.begin();
+	util::id_vector<Character_Item> kept;
 
-	while (it != this->inventory.end())
+	UTIL_FOREACH(this->inventory, item)
 	{
-		if (this->world->eif->Get(it->id).special == EIF::Lore)
+		if (this->world->eif->Get(item.id).special == EIF::Lore)
 		{
-			++it;
+			kept.insert(item);
 			continue;
 		}
 
-		std::shared_ptr<Map_Item> map_item = this->player->character->map->AddItem(it->id, it->amount, this->x, this->y, 0);
+		std::shared_ptr<Map_Item> map_item = this->player->character->map->AddItem(item.id, item.amount, this->x, this->y, 0);
 
 		if (map_item)
 		{
 			if (killer)
 			{
-				map_item->owner = killer->PlayerID();
-				map_item->unprotecttime = Timer::GetTime() + static_cast<double>(this->world->config["ProtectPKDrop"]);
+				this->map->ProtectItem(*map_item, killer->PlayerID(), Timer::GetTime() + static_cast<double>(this->world->config["ProtectPKDrop"]));
 			}
 			else
 			{
-				map_item->owner = this->PlayerID();
-				map_item->unprotecttime = Timer::GetTime() + static_cast<double>(this->world->config["ProtectDeathDrop"]);
+				this->map->ProtectItem(*map_item, this->PlayerID(), Timer::GetTime() + static_cast<double>(this->world->config["ProtectDeathDrop"]));
 			}
 
 			PacketBuilder builder(PACKET_ITEM, PACKET_DROP, 15);
-			builder.AddShort(it->id);
-			builder.AddThree(it->amount);
+			builder.AddShort(item.id);
+			builder.AddThree(item.amount);
 			builder.AddInt(0);
 			builder.AddShort(map_item->uid);
 			builder.AddChar(this->x);
@@ -1685,10 +1719,10 @@ void Character::DropAll(Character *killer)
 			builder.AddChar(this->maxweight);
 			this->Send(builder);
 		}
-
-		it = this->inventory.erase(it);
 	}
 
+	this->inventory = std::move(kept);
+
 	this->CalculateStats();
 
 	int i = 0;
@@ -1706,13 +1740,11 @@ void Character::DropAll(Character *killer)
 		{
 			if (killer)
 			{
-				map_item->owner = killer->PlayerID();
-				map_item->unprotecttime = Timer::GetTime() + static_cast<double>(this->world->config["ProtectPKDrop"]);
+				this->map->ProtectItem(*map_item, killer->PlayerID(), Timer::GetTime() + static_cast<double>(this->world->config["ProtectPKDrop"]));
 			}
 			else
 			{
-				map_item->owner = this->PlayerID();
-				map_item->unprotecttime = Timer::GetTime() + static_cast<double>(this->world->config["ProtectDeathDrop"]);
+				this->map->ProtectItem(*map_item, this->PlayerID(), Timer::GetTime() + static_cast<double>(this->world->config["ProtectDeathDrop"]));
 			}
 
 			int subloc = 0;
@@ -2115,31 +2147,251 @@ void Character::Logout()
 	this->world->Logout(this);
 }
 
-void Character::Save()
+void Character::SaveSnapshot(SaveGroup group, std::string& out)
+{
+	save_snapshot_writer h(out);
+
+	switch (group)
+	{
+		case SaveInfo:
+			h << this->title << this->home << this->fiance << this->partner << int(this->admin) << this->clas
+			  << int(this->gender) << int(this->race) << this->hairstyle << this->haircolor;
+			break;
+
+		case SavePosition:
+			h << this->mapid << this->x << this->y << int(this->direction) << int(this->sitting) << this->hidden
+			  << ((this->nointeract & NoInteractCustom) ? this->nointeract : 0);
+			break;
+
+		case SaveStats:
+			h << this->level << this->exp << this->hp << this->tp << this->str << this->intl << this->wis << this->agi
+			  << this->con << this->cha << this->statpoints << this->skillpoints << this->karma;
+			break;
+
+		case SaveUsage:
+			h << this->Usage();
+			break;
+
+		case SaveBank:
+			h << this->bankmax << this->goldbank;
+
+			UTIL_FOREACH(this->bank, item)
+				h << item.id << item.amount;
+
+			break;
+
+		case SaveInventory:
+			UTIL_FOREACH(this->inventory, item)
+				h << item.id << item.amount;
+
+			UTIL_FOREACH(this->paperdoll, id)
+				h << id;
+
+			break;
+
+		case SaveSpells:
+			UTIL_FOREACH(this->spells, spell)
+				h << spell.id << spell.level;
+
+			break;
+
+		case SaveGuild:
+			h << (this->guild ? this->guild->tag : std::string()) << this->guild_rank << this->guild_rank_string;
+			break;
+
+		case SaveQuest:
+			if (!this->quest_string.empty())
+			{
+				h << this->quest_string;
+				break;
+			}
+
+			UTIL_FOREACH_CREF(this->quests, quest)
+			{
+				h << quest.first << static_cast<long long>(reinterpret_cast<std::uintptr_t>(quest.second.get()));
+
+				if (quest.second)
+					quest.second->ProgressSnapshot(out);
+			}
+
+			UTIL_FOREACH_CREF(this->quests_inactive, state)
+				h << state.quest_id << state.quest_state << state.quest_progress;
+
+			break;
+	}
+}
+
+int Character::SaveDirtyGroups(int groups)
+{
+	// Reused between calls to avoid reallocating it every time
+	static std::string snapshot;
+	int dirty = this->save_forced & groups;
+
+	for (int i = 0; i < SaveGroupCount; ++i)
+	{
+		if (!(groups & (1 << i)))
+			continue;
+
+		this->SaveSnapshot(SaveGroup(1 << i), snapshot);
+
+		if (snapshot != this->save_snapshot[i])
+			dirty |= 1 << i;
+	}
+
+	return dirty;
+}
+
+void Character::MarkSaveDirty(int groups)
+{
+	this->save_forced |= groups & SaveAll;
+}
+
+void Character::MarkSaveClean(int groups)
+{
+	for (int i = 0; i < SaveGroupCount; ++i)
+	{
+		if (groups & (1 << i))
+			this->SaveSnapshot(SaveGroup(1 << i), this->save_snapshot[i]);
+	}
+
+	this->save_forced &= ~groups;
+}
+
+void Character::Save(int groups)
 {
-	const std::string & quest_data = (!this->quest_string.empty())
-	                               ? this->quest_string
-	                               : QuestSerialize(this->quests, this->quests_inactive);
+	// Reused between saves to avoid reallocating them every time
+	static std::array<std::string, SaveGroupCount> snapshot;
+	int dirty = this->save_forced & groups;
 
-	int nointeract = this->nointeract;
+	for (int i = 0; i < SaveGroupCount; ++i)
+	{
+		if (!(groups & (1 << i)))
+			continue;
 
-	if (!(nointeract & NoInteractCustom))
-		nointeract = 0;
+		this->SaveSnapshot(SaveGroup(1 << i), snapshot[i]);
+
+		if (snapshot[i] != this->save_snapshot[i])
+			dirty |= 1 << i;
+	}
+
+	if (dirty == 0)
+		return;
+
+	save_query_builder q(this->world->db);
+
+	if (dirty & SaveInfo)
+	{
+		q.Str("title", this->title);
+		q.Str("home", this->home);
+		q.Str("fiance", this->fiance);
+		q.Str("partner", this->partner);
+		q.Int("admin", int(this->admin));
+		q.Int("class", this->clas);
+		q.Int("gender", int(this->gender));
+		q.Int("race", int(this->race));
+		q.Int("hairstyle", this->hairstyle);
+		q.Int("haircolor", this->haircolor);
+	}
+
+	if (dirty & SavePosition)
+	{
+		int nointeract = this->nointeract;
+
+		if (!(nointeract & NoInteractCustom))
+			nointeract = 0;
+
+		q.Int("map", this->mapid);
+		q.Int("x", this->x);
+		q.Int("y", this->y);
+		q.Int("direction", int(this->direction));
+		q.Int("sitting", int(this->sitting));
+		q.Int("hidden", int(this->hidden));
+		q.Int("nointeract", nointeract);
+	}
+
+	if (dirty & SaveStats)
+	{
+		q.Int("level", this->level);
+		q.Int("exp", this->exp);
+		q.Int("hp", this->hp);
+		q.Int("tp", this->tp);
+		q.Int("str", this->str);
+		q.Int("int", this->intl);
+		q.Int("wis", this->wis);
+		q.Int("agi", this->agi);
+		q.Int("con", this->con);
+		q.Int("cha", this->cha);
+		q.Int("statpoints", this->statpoints);
+		q.Int("skillpoints", this->skillpoints);
+		q.Int("karma", this->karma);
+	}
+
+	if (dirty & SaveUsage)
+	{
+		q.Int("usage", this->Usage());
+	}
+
+	// Serialization buffers are reused between saves to avoid reallocating them every time
+	static std::string serialize_buffer;
+
+	if (dirty & SaveBank)
+	{
+		serialize_buffer.clear();
+		ItemSerialize(serialize_buffer, this->bank);
+
+		q.Int("bankmax", this->bankmax);
+		q.Int("goldbank", this->goldbank);
+		q.Str("bank", serialize_buffer);
+	}
+
+	if (dirty & SaveInventory)
+	{
+		serialize_buffer.clear();
+		ItemSerialize(serialize_buffer, this->inventory);
+
+		q.Str("inventory", serialize_buffer);
+		q.Str("paperdoll", DollSerialize(this->paperdoll));
+	}
+
+	if (dirty & SaveSpells)
+	{
+		serialize_buffer.clear();
+		SpellSerialize(serialize_buffer, this->spells);
+
+		q.Str("spells", serialize_buffer);
+	}
+
+	if (dirty & SaveGuild)
+	{
+		q.Str("guild", this->guild ? this->guild->tag : std::string());
+		q.Int("guild_rank", this->guild_rank);
+		q.Str("guild_rank_string", this->guild_rank_string);
+	}
+
+	if (dirty & SaveQuest)
+	{
+		q.Str("quest", (!this->quest_string.empty())
+		             ? this->quest_string
+		             : QuestSerialize(this->quests, this->quests_inactive));
+		q.Str("vars", "");
+	}
+
+	q.query += " WHERE `name` = '";
+	q.query += this->world->db.EscapeRaw(this->real_name);
+	q.query += '\'';
 
 #ifdef DEBUG
 	Console::Dbg("Saving character '%s' (session lasted %i minutes)", this->real_name.c_str(), int(std::time(0) - this->login_time) / 60);
 #endif // DEBUG
-	this->world->db.Query("UPDATE `characters` SET `title` = '$', `home` = '$', `fiance` = '$', `partner` = '$', `admin` = #, `class` = #, `gender` = #, `race` = #, "
-		"`hairstyle` = #, `haircolor` = #, `map` = #, `x` = #, `y` = #, `direction` = #, `level` = #, `exp` = #, `hp` = #, `tp` = #, "
-		"`str` = #, `int` = #, `wis` = #, `agi` = #, `con` = #, `cha` = #, `statpoints` = #, `skillpoints` = #, `karma` = #, `sitting` = #, `hidden` = #, "
-		"`nointeract` = #, `bankmax` = #, `goldbank` = #, `usage` = #, `inventory` = '$', `bank` = '$', `paperdoll` = '$', "
-		"`spells` = '$', `guild` = '$', `guild_rank` = #, `guild_rank_string` = '$', `quest` = '$', `vars` = '$' WHERE `name` = '$'",
-		this->title.c_str(), this->home.c_str(), this->fiance.c_str(), this->partner.c_str(), int(this->admin), this->clas, int(this->gender), int(this->race),
-		this->hairstyle, this->haircolor, this->mapid, this->x, this->y, int(this->direction), this->level, this->exp, this->hp, this->tp,
-		this->str, this->intl, this->wis, this->agi, this->con, this->cha, this->statpoints, this->skillpoints, this->karma, int(this->sitting), int(this->hidden),
-		nointeract, this->bankmax, this->goldbank, this->Usage(), ItemSerialize(this->inventory).c_str(), ItemSerialize(this->bank).c_str(),
-		DollSerialize(this->paperdoll).c_str(), SpellSerialize(this->spells).c_str(), (this->guild ? this->guild->tag.c_str() : ""),
-		this->guild_rank, this->guild_rank_string.c_str(), quest_data.c_str(), "", this->real_name.c_str());
+	this->world->db.RawQuery(q.query.c_str());
+
+	for (int i = 0; i < SaveGroupCount; ++i)
+	{
+		if (dirty & (1 << i))
+			this->save_snapshot[i].swap(snapshot[i]);
+	}
+
+	this->save_forced &= ~dirty;
 }
 
 AdminLevel Character::SourceAccess() const
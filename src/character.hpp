@@ -9,6 +9,7 @@
 #include "fwd/character.hpp"
 
 #include "fwd/arena.hpp"
+#include "fwd/board.hpp"
 #include "fwd/guild.hpp"
 #include "fwd/npc.hpp"
 #include "fwd/packet.hpp"
@@ -21,6 +22,8 @@
 #include "eodata.hpp"
 #include "map.hpp"
 
+#include "util/id_vector.hpp"
+
 #include <array>
 #include <deque>
 #include <list>
@@ -67,12 +70,17 @@ void character_cast_spell(void *character_void);
 /**
  * Serialize a list of items in to a text format that can be restored with ItemUnserialize
  */
-std::string ItemSerialize(const std::list<Character_Item> &list);
+std::string ItemSerialize(const util::id_vector<Character_Item> &list);
+
+/**
+ * Serialize a list of items, appending to an existing buffer
+ */
+void ItemSerialize(std::string &out, const util::id_vector<Character_Item> &list);
 
 /**
  * Convert a string generated by ItemSerialze back to a list of items
  */
-std::list<Character_Item> ItemUnserialize(const std::string& serialized);
+util::id_vector<Character_Item> ItemUnserialize(const std::string& serialized);
 
 /**
  * Serialize a paperdoll of 15 items in to a string that can be restored with DollUnserialize
@@ -87,12 +95,17 @@ std::array<int, 15> DollUnserialize(const std::string& serialized);
 /**
  * Serialize a list of spells in to a text format that can be restored with SpellUnserialize
  */
-std::string SpellSerialize(const std::list<Character_Spell> &list);
+std::string SpellSerialize(const util::id_vector<Character_Spell> &list);
+
+/**
+ * Serialize a list of spells, appending to an existing buffer
+ */
+void SpellSerialize(std::string &out, const util::id_vector<Character_Spell> &list);
 
 /**
  * Convert a string generated by SpellSerialze back to a list of items
  */
-std::list<Character_Spell> SpellUnserialize(const std::string& serialized);
+util::id_vector<Character_Spell> SpellUnserialize(const std::string& serialized);
 
 /**
  * One type of item in a Characters inventory
@@ -130,6 +143,11 @@ struct Character_QuestState
 	}
 };
 
+/**
+ * Serialize active and inactive quest states in to the text format stored in the database
+ */
+std::string QuestSerialize(const std::map<short, std::shared_ptr<Quest_Context>>& list, const std::set<Character_QuestState>& list_inactive);
+
 class Character : public Command_Source
 {
 	public:
@@ -210,7 +228,7 @@ class Character : public Command_Source
 		bool trading;
 		Character *trade_partner;
 		bool trade_agree;
-		std::list<Character_Item> trade_inventory;
+		util::id_vector<Character_Item> trade_inventory;
 
 		Character *party_trust_send;
 		Character *party_trust_recv;
@@ -267,16 +285,45 @@ class Character : public Command_Source
 			Bracer2
 		};
 
-		std::list<Character_Item> inventory;
-		std::list<Character_Item> bank;
+		util::id_vector<Character_Item> inventory;
+		util::id_vector<Character_Item> bank;
 		std::array<int, 15> paperdoll;
 		std::array<int, 15> cosmetic_paperdoll;
-		std::list<Character_Spell> spells;
+		util::id_vector<Character_Spell> spells;
 		std::list<NPC *> unregister_npc;
 		std::map<short, std::shared_ptr<Quest_Context>> quests;
 		std::set<Character_QuestState> quests_inactive;
 		std::string quest_string;
 
+		/**
+		 * Groups of database columns that are saved together by Save()
+		 */
+		enum SaveGroup
+		{
+			SaveInfo      = 0x001,
+			SavePosition  = 0x002,
+			SaveStats     = 0x004,
+			SaveUsage     = 0x008,
+			SaveBank      = 0x010,
+			SaveInventory = 0x020,
+			SaveSpells    = 0x040,
+			SaveGuild     = 0x080,
+			SaveQuest     = 0x100
+		};
+
+		static constexpr int SaveGroupCount = 9;
+		static constexpr int SaveAll = 0x1FF;
+
+		/**
+		 * Values of each save group as of the last successful save, indexed by flag bit
+		 */
+		std::array<std::string, SaveGroupCount> save_snapshot;
+
+		/**
+		 * Save groups explicitly flagged with MarkSaveDirty()
+		 */
+		int save_forced;
+
 		Character(std::string name, World *);
 
 		bool IsHideInvisible() const { return hidden & HideInvisible; }
@@ -314,7 +361,7 @@ class Character : public Command_Source
 		bool AddItem(short item, int amount);
 		bool DelItem(short item, int amount);
 		int CanHoldItem(short item, int max_amount);
-		std::list<Character_Item>::iterator DelItem(std::list<Character_Item>::iterator, int amount);
+		util::id_vector<Character_Item>::iterator DelItem(util::id_vector<Character_Item>::iterator, int amount);
 		bool AddTradeItem(short item, int amount);
 		bool DelTradeItem(short item);
 		bool AddSpell(short spell);
@@ -367,7 +414,31 @@ class Character : public Command_Source
 		void Send(const PacketBuilder &);
 
 		void Logout();
-		void Save();
+
+		/**
+		 * Writes the current values of one save group to out, which is compared against save_snapshot to find changes
+		 */
+		void SaveSnapshot(SaveGroup group, std::string &out);
+
+		/**
+		 * Returns the subset of the given SaveGroup flags that have changed since the last save
+		 */
+		int SaveDirtyGroups(int groups = SaveAll);
+
+		/**
+		 * Marks save groups as needing to be written on the next save
+		 */
+		void MarkSaveDirty(int groups);
+
+		/**
+		 * Marks save groups as matching the database, for when they were written by other means
+		 */
+		void MarkSaveClean(int groups);
+
+		/**
+		 * Writes changed columns to the database, limited to the given SaveGroup flags
+		 */
+		void Save(int groups = SaveAll);
 
 		AdminLevel SourceAccess() const;
 		AdminLevel SourceDutyAccess() const;
@@ -60,8 +60,7 @@ void DropItem(const std::vector<std::string>& arguments, Character* from)
 
 		if (item)
 		{
-			item->owner = from->PlayerID();
-			item->unprotecttime = Timer::GetTime() + double(from->world->config["ProtectPlayerDrop"]);
+			from->map->ProtectItem(*item, from->PlayerID(), Timer::GetTime() + double(from->world->config["ProtectPlayerDrop"]));
 			from->DelItem(id, amount);
 
 			PacketBuilder reply(PACKET_ITEM, PACKET_DROP, 15);
@@ -102,7 +101,7 @@ void SpawnNPC(const std::vector<std::string>& arguments, Character* from)
 			break;
 
 		NPC *npc = new NPC(from->map, id, from->x, from->y, speed, direction, index, true);
-		from->map->npcs.push_back(npc);
+		from->map->AddNPC(npc);
 		npc->Spawn();
 	}
 }
@@ -145,7 +144,7 @@ void Learn(const std::vector<std::string>& arguments, Character* from)
 
 	if (level >= 0)
 	{
-		auto it = std::find_if(UTIL_RANGE(from->spells), [&](Character_Spell spell) { return spell.id == skill_id; });
+		auto it = from->spells.find(skill_id);
 
 		if (it != from->spells.end())
 		{
@@ -13,6 +13,8 @@
 
 #include "../util.hpp"
 
+#include <cstdint>
+#include <cstdio>
 #include <functional>
 #include <string>
 #include <vector>
@@ -68,6 +70,45 @@ void Ban(const std::vector<std::string>& arguments, Command_Source* from, bool a
 		}, announce);
 }
 
+void IPBan(const std::vector<std::string>& arguments, Command_Source* from)
+{
+	World* world = from->SourceWorld();
+	unsigned int o1, o2, o3, o4;
+	int prefix = 32;
+	int duration = -1;
+
+	int fields = std::sscanf(arguments[0].c_str(), "%u.%u.%u.%u/%d", &o1, &o2, &o3, &o4, &prefix);
+
+	if (fields < 4 || o1 > 255 || o2 > 255 || o3 > 255 || o4 > 255 || prefix < 8 || prefix > 32
+	 || (prefix != 32 && !world->bans.PrefixSupported()))
+	{
+		from->ServerMsg(world->i18n.Format("invalid_ip_range"));
+		return;
+	}
+
+	if (arguments.size() >= 2)
+	{
+		if (util::lowercase(arguments[1]) != "forever")
+			duration = int(util::tdparse(arguments[1]));
+	}
+	else
+	{
+		duration = int(util::tdparse(world->config["DefaultBanLength"]));
+	}
+
+	std::uint32_t mask = std::uint32_t(0xFFFFFFFFull << (32 - prefix));
+	IPAddress address((o1 << 24 | o2 << 16 | o3 << 8 | o4) & mask);
+
+	world->BanIP(from, address, prefix, duration);
+
+	std::string range = static_cast<std::string>(address);
+
+	if (prefix != 32)
+		range += "/" + util::to_string(prefix);
+
+	from->ServerMsg(world->i18n.Format("ip_range_banned", range));
+}
+
 void Jail(const std::vector<std::string>& arguments, Command_Source* from, bool announce = true)
 {
 	Character* victim = from->SourceWorld()->GetCharacter(arguments[0]);
@@ -103,6 +144,7 @@ COMMAND_HANDLER_REGISTER(moderation)
 	Register({"skick", {"victim"}, {}, 2}, std::bind(Kick, _1, _2, false));
 	Register({"ban", {"victim"}, {"duration"}}, std::bind(Ban, _1, _2, true));
 	Register({"sban", {"victim"}, {"duration"}, 2}, std::bind(Ban, _1, _2, false));
+	Register({"ipban", {"address"}, {"duration"}, 3}, IPBan);
 	Register({"jail", {"victim"}, {}}, std::bind(Jail, _1, _2, true));
 	Register({"sjail", {"victim"}, {}, 2}, std::bind(Jail, _1, _2, false));
 	Register({"unjail", {"victim"}, {}}, Unjail);
@@ -14,8 +14,10 @@
 #include "../world.hpp"
 
 #include "../console.hpp"
+#include "../perf.hpp"
 #include "../util.hpp"
 
+#include <algorithm>
 #include <csignal>
 #include <string>
 #include <vector>
@@ -28,50 +30,33 @@ namespace Commands
 void ReloadMap(const std::vector<std::string>& arguments, Character* from)
 {
 	World* world = from->SourceWorld();
-	Map* map = from->map;
-	bool isnew = false;
+	int mapid = from->map->id;
 
 	if (arguments.size() >= 1)
 	{
-		int mapid = util::to_int(arguments[0]);
+		int argid = std::max(util::to_int(arguments[0]), 1);
 
-		if (mapid < 1)
-			mapid = 1;
-
-		if (world->maps.size() > mapid - 1)
-		{
-			map = world->maps[mapid - 1];
-		}
-		else if (mapid <= static_cast<int>(world->config["Maps"]))
-		{
-			isnew = true;
-
-			while (world->maps.size() < mapid)
-			{
-				int newmapid = world->maps.size() + 1;
-				world->maps.push_back(new Map(newmapid, world));
-			}
-		}
+		if (argid <= static_cast<int>(world->maps.size()) || argid <= static_cast<int>(world->config["Maps"]))
+			mapid = argid;
 	}
 
-	if (map && !isnew)
-	{
-		map->Reload();
-	}
+	if (!world->ReloadMap(mapid, from))
+		from->ServerMsg(world->i18n.Format("map_reload_busy"));
 }
 
 void ReloadPub(const std::vector<std::string>& arguments, Command_Source* from)
 {
 	(void)arguments;
 
-	Console::Out("Pub files reloaded by %s", from->SourceName().c_str());
-
 	bool quiet = true;
 
 	if (arguments.size() >= 1)
 		quiet = (arguments[0] != "announce");
 
-	from->SourceWorld()->ReloadPub(quiet);
+	if (from->SourceWorld()->ReloadPub(from, quiet))
+		Console::Out("Pub files being reloaded by %s", from->SourceName().c_str());
+	else
+		from->ServerMsg(from->SourceWorld()->i18n.Format("pub_reload_busy"));
 }
 
 void ReloadConfig(const std::vector<std::string>& arguments, Command_Source* from)
@@ -107,6 +92,55 @@ void Uptime(const std::vector<std::string>& arguments, Command_Source* from)
 	from->ServerMsg(buffer);
 }
 
+void Profiler(const std::vector<std::string>& arguments, Command_Source* from)
+{
+#ifdef PERF_PROFILER
+	std::string action;
+
+	if (arguments.size() >= 1)
+		action = util::lowercase(arguments[0]);
+
+	if (action == "on")
+	{
+		Perf::Enable(true);
+		from->ServerMsg("Profiler enabled");
+	}
+	else if (action == "off")
+	{
+		Perf::Enable(false);
+		from->ServerMsg("Profiler disabled");
+	}
+	else if (action == "reset")
+	{
+		Perf::Reset();
+		from->ServerMsg("Profiler statistics reset");
+	}
+	else if (action == "dump")
+	{
+		std::string filename = from->SourceWorld()->config["ProfilerDumpFile"];
+
+		if (filename.empty())
+			filename = "perf.log";
+
+		if (Perf::Dump(filename))
+			from->ServerMsg("Profiler report written to " + filename);
+		else
+			from->ServerMsg("Could not write profiler report to " + filename);
+	}
+	else
+	{
+		UTIL_FOREACH_CREF(Perf::Report(5), line)
+		{
+			from->ServerMsg(line);
+		}
+	}
+#else // PERF_PROFILER
+	(void)arguments;
+
+	from->ServerMsg("Profiler support was not compiled in");
+#endif // PERF_PROFILER
+}
+
 COMMAND_HANDLER_REGISTER(server)
 	RegisterCharacter({"remap", {}, {"mapid"}, 3}, ReloadMap);
 	Register({"repub", {}, {"announce"}, 3}, ReloadPub);
@@ -114,6 +148,7 @@ COMMAND_HANDLER_REGISTER(server)
 	Register({"request", {}, {}, 3}, ReloadQuest);
 	Register({"shutdown", {}, {}, 8}, Shutdown);
 	Register({"uptime"}, Uptime);
+	Register({"perf", {}, {"action"}, 4}, Profiler);
 COMMAND_HANDLER_REGISTER_END(server)
 
 }
@@ -5,10 +5,22 @@
 
 #include "console.hpp"
 
+#include "util/mpsc_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 #include "platform.h"
 
@@ -21,7 +33,8 @@ namespace Console
 
 bool Styled[2] = {true, true};
 
-static int day = -1;
+// Last day a date header was written for, shared by every thread that writes log lines
+static std::atomic<int> day(-1);
 
 #ifdef WIN32
 
@@ -78,64 +91,472 @@ void ResetTextColor(Stream stream)
 
 #endif // WIN32
 
-static void print_timestamp(FILE* fh)
+// std::localtime shares one buffer between threads, and log records are formatted by whichever thread writes them
+static std::tm local_time(std::time_t rawtime)
+{
+	std::tm tm;
+
+#ifdef WIN32
+	localtime_s(&tm, &rawtime);
+#else // WIN32
+	localtime_r(&rawtime, &tm);
+#endif // WIN32
+
+	return tm;
+}
+
+static void print_timestamp(FILE* fh, std::time_t rawtime)
 {
-	std::time_t rawtime;
 	char timestr[256];
-	std::time(&rawtime);
-	struct std::tm* tm = std::localtime(&rawtime);
+	std::tm tm = local_time(rawtime);
 
-	int new_day = tm->tm_year * 1000 + tm->tm_yday;
+	int new_day = tm.tm_year * 1000 + tm.tm_yday;
 
-	if (new_day != day)
+	if (day.exchange(new_day, std::memory_order_relaxed) != new_day)
 	{
-		day = new_day;
-		std::strftime(timestr, 256, "%a %b %e %Y", tm);
+		std::strftime(timestr, 256, "%a %b %e %Y", &tm);
 		std::fprintf(fh, "\n\n--- %s ---\n\n", timestr);
 	}
 
-	std::strftime(timestr, 256, "%H:%M:%S ", tm);
+	std::strftime(timestr, 256, "%H:%M:%S ", &tm);
 	std::fputs(timestr, fh);
 }
 
-#define CONSOLE_GENERIC_OUT(prefix, stream, color, bold) \
+enum Level
+{
+	LEVEL_OUT,
+	LEVEL_WRN,
+	LEVEL_ERR,
+	LEVEL_DBG
+};
+
+static const char* level_prefix[] = {"   ", "WRN", "ERR", "DBG"};
+static const char* level_name[] = {"info", "warning", "error", "debug"};
+static const Color level_color[] = {COLOR_GREY, COLOR_YELLOW, COLOR_RED, COLOR_GREY};
+static const bool level_bold[] = {true, true, true, false};
+
+static const std::size_t record_text_size = 1000;
+
+/**
+ * One formatted log line waiting to be written
+ */
+struct Record
+{
+	std::time_t time;
+	unsigned char level;
+	unsigned char streams;
+	unsigned short length;
+	char text[record_text_size];
+};
+
+static void format_record(Record& record, Level level, int streams, const char* f, va_list args)
+{
+	record.time = std::time(0);
+	record.level = level;
+	record.streams = streams;
+
+	int length = std::vsnprintf(record.text, record_text_size, f, args);
+
+	if (length < 0)
+		length = 0;
+
+	if (std::size_t(length) >= record_text_size)
+	{
+		length = record_text_size - 1;
+		std::memcpy(record.text + length - 3, "...", 3);
+	}
+
+	record.length = length;
+}
+
+static std::atomic<bool> json_format(false);
+
+static void write_json_string(FILE* fh, const char* text, std::size_t length)
+{
+	std::fputc('"', fh);
+
+	for (std::size_t i = 0; i < length; ++i)
+	{
+		unsigned char c = text[i];
+
+		if (c == '"' || c == '\\')
+		{
+			std::fputc('\\', fh);
+			std::fputc(c, fh);
+		}
+		else if (c < 0x20)
+		{
+			std::fprintf(fh, "\\u%04x", c);
+		}
+		else
+		{
+			std::fputc(c, fh);
+		}
+	}
+
+	std::fputc('"', fh);
+}
+
+static void write_record_stream(const Record& record, Stream stream)
+{
+	FILE* fh = (stream == STREAM_OUT) ? stdout : stderr;
+
+	if (json_format.load(std::memory_order_relaxed))
+	{
+		char timestr[32];
+		std::tm tm = local_time(record.time);
+		std::strftime(timestr, sizeof(timestr), "%Y-%m-%dT%H:%M:%S", &tm);
+		std::fprintf(fh, "{\"time\":\"%s\",\"level\":\"%s\",\"message\":", timestr, level_name[record.level]);
+		write_json_string(fh, record.text, record.length);
+		std::fputs("}\n", fh);
+		return;
+	}
+
+	Color color = level_color[record.level];
+
+	if (Styled[stream]) SetTextColor(stream, COLOR_GREY, false);
+	print_timestamp(fh, record.time);
+	if (Styled[stream] && color != COLOR_GREY) SetTextColor(stream, color, level_bold[record.level]);
+	std::fputc('[', fh);
+	std::fputs(level_prefix[record.level], fh);
+	std::fputs("] ", fh);
+	std::fwrite(record.text, 1, record.length, fh);
+	std::fputc('\n', fh);
+	if (Styled[stream]) ResetTextColor(stream);
+}
+
+static void write_record(const Record& record)
+{
+	if (record.streams & (1 << STREAM_OUT))
+		write_record_stream(record, STREAM_OUT);
+
+	if (record.streams & (1 << STREAM_ERR))
+		write_record_stream(record, STREAM_ERR);
+}
+
+/**
+ * State of the background log writer
+ * Once started it runs until the process exits, so logging never has to wait for it to be replaced.
+ */
+struct AsyncWriter
+{
+	struct RateEntry
+	{
+		std::time_t window;
+		int count;
+		int suppressed;
+		Record sample;
+	};
+
+	util::mpsc_queue<Record> queue;
+	std::atomic<int> rate_limit;
+
+	std::atomic<bool> running;
+	std::atomic<bool> sleeping;
+	std::atomic<unsigned long> dropped;
+
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+
+	// Work handed to the writer thread by RunTask(), such as reopening the log files
+	std::mutex task_mutex;
+	std::condition_variable task_done;
+	std::function<void()> task;
+	std::atomic<bool> task_pending;
+
+	std::unordered_map<std::size_t, RateEntry> rate;
+	std::time_t last_sweep;
+
+	std::thread thread;
+
+	AsyncWriter(std::size_t queue_size, int rate_limit)
+		: queue(queue_size)
+		, rate_limit(rate_limit)
+		, running(true)
+		, sleeping(false)
+		, dropped(0)
+		, task_pending(false)
+		, last_sweep(0)
+	{ }
+
+	/**
+	 * Runs a function on the writer thread between writes and waits for it to finish
+	 */
+	void RunTask(const std::function<void()>& function)
+	{
+		std::unique_lock<std::mutex> lock(this->task_mutex);
+		this->task_done.wait(lock, [this]() { return !this->task_pending.load(); });
+		this->task = function;
+		this->task_pending.store(true);
+
+		{
+			std::lock_guard<std::mutex> wake_lock(this->wake_mutex);
+			this->wake.notify_one();
+		}
+
+		this->task_done.wait(lock, [this]() { return !this->task_pending.load(); });
+	}
+
+	void RunPendingTask()
+	{
+		if (!this->task_pending.load())
+			return;
+
+		std::lock_guard<std::mutex> lock(this->task_mutex);
+		this->task();
+		this->task = nullptr;
+		this->task_pending.store(false);
+		this->task_done.notify_all();
+	}
+
+	void ReportSuppressed(RateEntry& entry)
+	{
+		if (entry.suppressed == 0)
+			return;
+
+		Record summary = entry.sample;
+		int length = std::snprintf(summary.text, record_text_size, "(suppressed %i repeats of) %.*s",
+			entry.suppressed, int(entry.sample.length), entry.sample.text);
+		summary.length = std::min<int>(std::max(length, 0), record_text_size - 1);
+		write_record(summary);
+
+		entry.suppressed = 0;
+	}
+
+	// Returns false if the record should be suppressed
+	bool RateCheck(const Record& record)
+	{
+		int rate_limit = this->rate_limit.load(std::memory_order_relaxed);
+
+		if (rate_limit <= 0)
+			return true;
+
+		std::size_t hash = std::hash<std::string>()(std::string(record.text, record.length)) ^ record.level;
+		RateEntry& entry = this->rate[hash];
+
+		if (entry.window != record.time)
+		{
+			this->ReportSuppressed(entry);
+			entry.window = record.time;
+			entry.count = 0;
+		}
+
+		if (++entry.count > rate_limit)
+		{
+			if (entry.suppressed++ == 0)
+				entry.sample = record;
+
+			return false;
+		}
+
+		return true;
+	}
+
+	void Sweep(std::time_t now)
+	{
+		if (now == this->last_sweep)
+			return;
+
+		this->last_sweep = now;
+
+		for (auto it = this->rate.begin(); it != this->rate.end(); )
+		{
+			if (it->second.window < now)
+			{
+				this->ReportSuppressed(it->second);
+				it = this->rate.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		unsigned long lost = this->dropped.exchange(0);
+
+		if (lost > 0)
+		{
+			Record record;
+			record.time = now;
+			record.level = LEVEL_WRN;
+			record.streams = 1 << STREAM_OUT;
+			record.length = std::snprintf(record.text, record_text_size, "Log queue full: %lu messages dropped", lost);
+			write_record(record);
+		}
+	}
+
+	void Run()
+	{
+		for (;;)
+		{
+			int written = 0;
+
+			while (written < 256 && this->queue.pop_with([&](Record& record)
+			{
+				if (this->RateCheck(record))
+					write_record(record);
+			}))
+			{
+				++written;
+			}
+
+			this->Sweep(std::time(0));
+
+			if (written > 0)
+			{
+				std::fflush(stdout);
+				std::fflush(stderr);
+			}
+
+			this->RunPendingTask();
+
+			if (written > 0)
+				continue;
+
+			if (!this->running.load())
+				break;
+
+			std::unique_lock<std::mutex> lock(this->wake_mutex);
+
+			if (this->task_pending.load())
+				continue;
+
+			this->sleeping.store(true);
+			this->wake.wait_for(lock, std::chrono::milliseconds(50));
+			this->sleeping.store(false);
+		}
+
+		for (auto& entry : this->rate)
+			this->ReportSuppressed(entry.second);
+
+		std::fflush(stdout);
+		std::fflush(stderr);
+	}
+};
+
+// Created by the first StartAsync() and never freed, so a thread that has just loaded async_writer can always push to it
+static AsyncWriter* async_writer_instance = nullptr;
+
+// The writer that logging calls queue to, or null while logging is synchronous
+static std::atomic<AsyncWriter*> async_writer(nullptr);
+
+// Makes sure queued messages are written when the process exits
+static struct AsyncShutdown
+{
+	~AsyncShutdown()
+	{
+		async_writer.store(nullptr);
+
+		if (async_writer_instance)
+		{
+			async_writer_instance->running.store(false);
+
+			{
+				std::lock_guard<std::mutex> lock(async_writer_instance->wake_mutex);
+				async_writer_instance->wake.notify_one();
+			}
+
+			async_writer_instance->thread.join();
+		}
+	}
+} async_shutdown;
+
+void StartAsync(std::size_t queue_size, int rate_limit)
+{
+	if (!async_writer_instance)
+	{
+		async_writer_instance = new AsyncWriter(queue_size, rate_limit);
+		async_writer_instance->thread = std::thread(&AsyncWriter::Run, async_writer_instance);
+	}
+
+	async_writer_instance->rate_limit.store(rate_limit);
+	async_writer.store(async_writer_instance);
+}
+
+void StopAsync()
+{
+	if (!async_writer.exchange(nullptr))
+		return;
+
+	// Waits for everything queued so far to be written
+	async_writer_instance->RunTask([]() { });
+}
+
+bool Async()
+{
+	return async_writer.load() != nullptr;
+}
+
+void Reopen(const std::function<void()>& reopen)
+{
+	if (async_writer_instance)
+		async_writer_instance->RunTask(reopen);
+	else
+		reopen();
+}
+
+void SetJSON(bool enabled)
+{
+	json_format.store(enabled);
+}
+
+static void generic_out(Level level, int streams, const char* f, va_list args)
+{
+	AsyncWriter* writer = async_writer.load(std::memory_order_acquire);
+
+	if (writer)
+	{
+		bool queued = writer->queue.push_with([&](Record& record)
+		{
+			format_record(record, level, streams, f, args);
+		});
+
+		if (!queued)
+			++writer->dropped;
+		else if (writer->sleeping.load(std::memory_order_relaxed))
+			writer->wake.notify_one();
+
+		return;
+	}
+
+	Record record;
+	format_record(record, level, streams, f, args);
+	write_record(record);
+}
+
+#define CONSOLE_GENERIC_OUT(level, streams) \
 do { \
-	FILE* fh = (stream == STREAM_OUT) ? stdout : stderr; \
-	if (Styled[stream]) SetTextColor(stream, COLOR_GREY, false); \
-	print_timestamp(fh); \
-	if (Styled[stream] && color != COLOR_GREY) SetTextColor(stream, color, bold); \
 	va_list args; \
 	va_start(args, f); \
-	std::fputs("[" prefix "] ", fh); \
-	std::vfprintf(fh, f, args); \
-	std::fputs("\n", fh); \
+	generic_out(level, streams, f, args); \
 	va_end(args); \
-	if (Styled[stream]) ResetTextColor(stream); \
 } while (false)
 
 void Out(const char* f, ...)
 {
-	CONSOLE_GENERIC_OUT("   ", STREAM_OUT, COLOR_GREY, true);
+	CONSOLE_GENERIC_OUT(LEVEL_OUT, 1 << STREAM_OUT);
 }
 
 void Wrn(const char* f, ...)
 {
-	CONSOLE_GENERIC_OUT("WRN", STREAM_OUT, COLOR_YELLOW, true);
+	CONSOLE_GENERIC_OUT(LEVEL_WRN, 1 << STREAM_OUT);
 }
 
 void Err(const char* f, ...)
 {
 	if (!Styled[STREAM_ERR])
 	{
-		CONSOLE_GENERIC_OUT("ERR", STREAM_OUT, COLOR_RED, true);
+		CONSOLE_GENERIC_OUT(LEVEL_ERR, (1 << STREAM_OUT) | (1 << STREAM_ERR));
+	}
+	else
+	{
+		CONSOLE_GENERIC_OUT(LEVEL_ERR, 1 << STREAM_ERR);
 	}
-
-	CONSOLE_GENERIC_OUT("ERR", STREAM_ERR, COLOR_RED, true);
 }
 
 void Dbg(const char* f, ...)
 {
-	CONSOLE_GENERIC_OUT("DBG", STREAM_OUT, COLOR_GREY, false);
+	CONSOLE_GENERIC_OUT(LEVEL_DBG, 1 << STREAM_OUT);
 }
 
 }
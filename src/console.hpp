@@ -8,6 +8,8 @@
 
 #include "fwd/console.hpp"
 
+#include <cstddef>
+#include <functional>
 #include <string>
 
 namespace Console
@@ -38,6 +40,34 @@ void Wrn(const char* f, ...);
 void Err(const char* f, ...);
 void Dbg(const char* f, ...);
 
+/**
+ * Moves writing of log messages to a background thread. Logging calls then only
+ * format the message in to a lock-free queue, dropping messages if it is full.
+ * Calling it again only changes the rate limit, the queue size is kept from the first call.
+ * @param queue_size maximum number of messages waiting to be written
+ * @param rate_limit maximum number of identical messages written per second (0 for unlimited)
+ */
+void StartAsync(std::size_t queue_size, int rate_limit);
+
+/**
+ * Writes out any queued messages and returns to synchronous logging
+ * The writer thread is kept until the process exits, and a later StartAsync() resumes using it.
+ */
+void StopAsync();
+
+bool Async();
+
+/**
+ * Runs a function that reopens the log streams, on the writer thread if there is one so nothing is written during it
+ * Returns once the function has finished.
+ */
+void Reopen(const std::function<void()>& reopen);
+
+/**
+ * Writes log messages as one JSON object per line instead of styled text
+ */
+void SetJSON(bool enabled);
+
 }
 
 #endif // CONSOLE_HPP_INCLUDED
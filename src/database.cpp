@@ -11,6 +11,7 @@
 #include "database.hpp"
 
 #include "console.hpp"
+#include "metrics.hpp"
 #include "util.hpp"
 #include "util/variant.hpp"
 
@@ -238,6 +239,10 @@ void Database::Connect(Database::Engine type, const std::string& host, unsigned
 				throw Database_OpenFailed(sqlite3_errmsg(this->impl->sqlite_handle));
 			}
 
+			// Background connections (see Connect(const Database&)) only lock the file for one short read at a time,
+			// so waiting for them beats failing a save, but it stalls the game thread's tick for as long as it waits
+			sqlite3_busy_timeout(this->impl->sqlite_handle, 100);
+
 			this->connected = true;
 
 			break;
@@ -248,6 +253,17 @@ void Database::Connect(Database::Engine type, const std::string& host, unsigned
 	}
 }
 
+void Database::Connect(const Database& other)
+{
+	this->Connect(other.engine, other.host, other.port, other.user, other.pass, other.db);
+
+#ifdef DATABASE_SQLITE
+	// Second connections are used off the game thread, so they can wait out the game connection's commits
+	if (this->engine == SQLite)
+		sqlite3_busy_timeout(this->impl->sqlite_handle, 2000);
+#endif // DATABASE_SQLITE
+}
+
 void Database::Close()
 {
 	if (!this->connected)
@@ -280,6 +296,8 @@ Database_Result Database::RawQuery(const char* query, bool tx_control)
 		throw Database_QueryFailed("Not connected to database.");
 	}
 
+	Metrics::Scope_Timer query_timer(Metrics::query_duration);
+
 	std::size_t query_length = std::strlen(query);
 
 	Database_Result result;
@@ -552,6 +570,21 @@ Database_Result Database::Query(const char *format, ...)
 }
 
 std::string Database::Escape(const std::string& raw)
+{
+	std::string result = this->EscapeRaw(raw);
+
+	for (std::string::iterator it = result.begin(); it != result.end(); ++it)
+	{
+		if (*it == '@' || *it == '#' || *it == '$')
+		{
+			*it = '?';
+		}
+	}
+
+	return result;
+}
+
+std::string Database::EscapeRaw(const std::string& raw)
 {
 	char *escret;
 	unsigned long esclen;
@@ -577,14 +610,6 @@ std::string Database::Escape(const std::string& raw)
 #endif // DATABASE_SQLITE
 	}
 
-	for (std::string::iterator it = result.begin(); it != result.end(); ++it)
-	{
-		if (*it == '@' || *it == '#' || *it == '$')
-		{
-			*it = '?';
-		}
-	}
-
 	return result;
 }
 
@@ -137,6 +137,12 @@ class Database
 		 */
 		void Connect(Database::Engine type, const std::string& host, unsigned short port, const std::string& user, const std::string& pass, const std::string& db);
 
+		/**
+		 * Opens a second connection using the settings of another Database object, for use off the game thread
+		 * @throw Database_OpenFailed
+		 */
+		void Connect(const Database& other);
+
 		/**
 		 * Disconnects from the database
 		 */
@@ -161,6 +167,11 @@ class Database
 		 */
 		std::string Escape(const std::string&);
 
+		/**
+		 * Escapes a piece of text for direct use in RawQuery, leaving replacement tokens intact
+		 */
+		std::string EscapeRaw(const std::string&);
+
 		/**
 		 * Executes a set of queries, rolling back the result of any previous queries if one fails.
 		 * @throw Database_QueryFailed
@@ -188,6 +199,8 @@ class Database
 		 */
 		void ExecuteFile(const std::string& filename);
 
+		Engine GetEngine() const { return this->engine; }
+
 		bool Pending() const;
 		bool BeginTransaction();
 		void Commit();
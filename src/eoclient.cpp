@@ -16,6 +16,7 @@
 #include "world.hpp"
 
 #include "console.hpp"
+#include "metrics.hpp"
 #include "socket.hpp"
 #include "util.hpp"
 
@@ -55,7 +56,17 @@ void EOClient::Initialize()
 	this->version = 0;
 	this->needpong = false;
 	this->login_attempts = 0;
+	this->hdid = 0;
 	this->start = Timer::GetTime();
+
+	this->server()->admission.Connected(this->GetRemoteAddr(), this->start);
+	this->record_id = this->server()->recorder.Connect();
+}
+
+void EOClient::SetHDID(int hdid)
+{
+	this->server()->admission.ChangeHDID(this->GetRemoteAddr(), this->hdid, hdid);
+	this->hdid = hdid;
 }
 
 bool EOClient::NeedTick()
@@ -63,6 +74,17 @@ bool EOClient::NeedTick()
 	return this->upload_fh;
 }
 
+bool EOClient::UploadReady()
+{
+	if (!this->upload_fh)
+		return false;
+
+	if (this->upload_pos < this->upload_size)
+		return this->SendBufferRemaining() > 0;
+
+	return this->SendBufferRemaining() == this->send_buffer.length();
+}
+
 void EOClient::Tick()
 {
 	std::string data;
@@ -250,7 +272,11 @@ void EOClient::Execute(const std::string &data)
 	if (!this->Connected())
 		return;
 
-	PacketReader reader(processor.Decode(data));
+	std::string decoded = processor.Decode(data);
+	PacketReader reader(decoded);
+	std::size_t seq_length = 0;
+
+	Metrics::PacketIn(reader.Family(), data.length());
 
 	if (!this->accepted)
 	{
@@ -283,9 +309,15 @@ void EOClient::Execute(const std::string &data)
 		int server_seq = this->GenSequence();
 
 		if (server_seq >= 253)
+		{
 			client_seq = reader.GetShort();
+			seq_length = 2;
+		}
 		else
+		{
 			client_seq = reader.GetChar();
+			seq_length = 1;
+		}
 
 		if (this->server()->world->config["EnforceSequence"])
 		{
@@ -311,6 +343,10 @@ void EOClient::Execute(const std::string &data)
 		this->GenSequence();
 	}
 
+	// Recorded without the sequence number, which is regenerated when replaying
+	if (this->record_id != 0)
+		this->server()->recorder.Packet(this->record_id, decoded.erase(2, std::min(seq_length, decoded.length() - 2)));
+
 	queue.AddAction(reader, 0.02, true);
 }
 
@@ -474,7 +510,9 @@ bool EOClient::Upload(FileType type, const std::string &filename, std::size_t fi
 
 void EOClient::Send(const PacketBuilder &builder)
 {
-	std::string data= this->processor.Encode(builder);
+	std::string data = this->processor.Encode(builder);
+
+	Metrics::PacketOut(PacketProcessor::EPID(builder.GetID())[1], data.length());
 
 	if (this->upload_fh)
 	{
@@ -497,12 +535,16 @@ void EOClient::Send(const PacketBuilder &builder)
 	}
 	else
 	{
-		Client::Send(this->processor.Encode(builder));
+		Client::Send(data);
 	}
 }
 
 EOClient::~EOClient()
 {
+	this->server()->admission.Disconnected(this->GetRemoteAddr(), this->hdid);
+	this->server()->world->hasher.Cancel(this);
+	this->server()->recorder.Disconnect(this->record_id);
+
 	if (this->upload_fh)
 	{
 		std::fclose(this->upload_fh);
@@ -12,11 +12,13 @@
 #include "fwd/eodata.hpp"
 #include "fwd/player.hpp"
 #include "eoserver.hpp"
+#include "metrics.hpp"
 #include "packet.hpp"
 
 #include "socket.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <memory>
 #include <queue>
@@ -31,11 +33,13 @@ struct ActionQueue_Action
 	PacketReader reader;
 	double time;
 	bool auto_queue;
+	Metrics::clock::time_point queued;
 
 	ActionQueue_Action(PacketReader reader_, double time_, bool auto_queue_ = false)
 		: reader(reader_)
 		, time(time_)
 		, auto_queue(auto_queue_)
+		, queued(Metrics::clock::now())
 	{ }
 };
 
@@ -95,6 +99,8 @@ class EOClient : public Client
 		int upcoming_seq_start;
 		int seq;
 
+		std::uint32_t record_id = 0;
+
 	public:
 		EOServer *server() { return static_cast<EOServer *>(Client::server); };
 		int version;
@@ -132,6 +138,16 @@ class EOClient : public Client
 
 		virtual bool NeedTick();
 
+		/**
+		 * Checks if Tick() can put more of an upload in the send buffer, or finish it, without waiting for the socket
+		 */
+		bool UploadReady();
+
+		/**
+		 * Sets the client's hardware ID, keeping the server's per-PC connection count up to date
+		 */
+		void SetHDID(int hdid);
+
 		void Tick();
 
 		void InitNewSequence();
@@ -8,13 +8,12 @@
 #include "console.hpp"
 #include "packet.hpp"
 
-#include <cstdlib>
+#include "util.hpp"
+
 #include <cstring>
 #include <string>
 #include <type_traits>
 
-static const char *eodata_safe_fail_filename;
-
 std::string convert_pub_filename(const std::string& s)
 {
 	std::string result;
@@ -37,14 +36,13 @@ std::string convert_pub_filename(const std::string& s)
 	return result;
 }
 
-static void eodata_safe_fail(int line)
+static void eodata_safe_fail(const std::string& filename, int line)
 {
-	Console::Err("Invalid file / failed read/seek: %s -- %i", eodata_safe_fail_filename, line);
-	std::exit(1);
+	throw Pub_Exception("Invalid file / failed read/seek: " + filename + " -- " + util::to_string(line));
 }
 
-#define SAFE_SEEK(fh, offset, from) if (std::fseek(fh, offset, from) != 0) { std::fclose(fh); eodata_safe_fail(__LINE__); }
-#define SAFE_READ(buf, size, count, fh) if (std::fread(buf, size, count, fh) != static_cast<std::size_t>(count)) { std::fclose(fh); eodata_safe_fail(__LINE__); }
+#define SAFE_SEEK(fh, offset, from, filename) if (std::fseek(fh, offset, from) != 0) { std::fclose(fh); eodata_safe_fail(filename, __LINE__); }
+#define SAFE_READ(buf, size, count, fh, filename) if (std::fread(buf, size, count, fh) != static_cast<std::size_t>(count)) { std::fclose(fh); eodata_safe_fail(filename, __LINE__); }
 
 void pub_read_record(EIF_Data& newdata, char* buf)
 {
@@ -155,13 +153,9 @@ template <class T>
 int read_single_file(T& pub, Pub_File& file, bool auto_split, int version, int first_id)
 {
 	std::FILE *fh = std::fopen(file.filename.c_str(), "rb");
-	eodata_safe_fail_filename = file.filename.c_str();
 
 	if (!fh)
-	{
-		Console::Err("Could not load file: %s", file.filename.c_str());
-		std::exit(1);
-	}
+		throw Pub_Exception("Could not load file: " + file.filename);
 
 	// Only attempt to auto-split the first file
 	if (first_id != 1)
@@ -183,12 +177,12 @@ int read_single_file(T& pub, Pub_File& file, bool auto_split, int version, int f
 	if (version < 1 && auto_split == true)
 		max_entries = 64000;
 
-	SAFE_SEEK(fh, 10, SEEK_SET);
-	SAFE_READ(static_cast<void *>(&namesize), sizeof(char), 1, fh);
+	SAFE_SEEK(fh, 10, SEEK_SET, file.filename);
+	SAFE_READ(static_cast<void *>(&namesize), sizeof(char), 1, fh, file.filename);
 
 	if constexpr (std::is_same_v<T, ESF>)
 	{
-		SAFE_READ(static_cast<void *>(&shoutsize), sizeof(char), 1, fh);
+		SAFE_READ(static_cast<void *>(&shoutsize), sizeof(char), 1, fh, file.filename);
 	}
 
 	file.splits.reserve(4);
@@ -210,7 +204,7 @@ int read_single_file(T& pub, Pub_File& file, bool auto_split, int version, int f
 		name.resize(namesize);
 
 		if (namesize > 0)
-			SAFE_READ(&name[0], sizeof(char), namesize, fh);
+			SAFE_READ(&name[0], sizeof(char), namesize, fh, file.filename);
 
 		if constexpr (std::is_same_v<T, ESF>)
 		{
@@ -218,10 +212,10 @@ int read_single_file(T& pub, Pub_File& file, bool auto_split, int version, int f
 			shout.resize(shoutsize);
 
 			if (shoutsize > 0)
-				SAFE_READ(&shout[0], sizeof(char), shoutsize, fh);
+				SAFE_READ(&shout[0], sizeof(char), shoutsize, fh, file.filename);
 		}
 
-		SAFE_READ(buf, sizeof(char), T::DATA_SIZE, fh);
+		SAFE_READ(buf, sizeof(char), T::DATA_SIZE, fh, file.filename);
 
 		typename T::data_t& newdata = pub.data[first_id + i];
 
@@ -283,16 +277,13 @@ void read_pub_files(T& pub, const std::string& filename, bool auto_split)
 	std::snprintf(fn_buf, sizeof fn_buf, filename_template.c_str(), file_number);
 
 	std::FILE *fh = std::fopen(fn_buf, "rb");
-	eodata_safe_fail_filename = filename.c_str();
 
 	if (!fh)
-	{
-		Console::Err("Could not load file: %s", filename.c_str());
-		std::exit(1);
-	}
+		throw Pub_Exception("Could not load file: " + filename);
 
 	char header_buf[10];
-	SAFE_READ(header_buf, sizeof(char), 10, fh);
+	SAFE_READ(header_buf, sizeof(char), 10, fh, filename);
+	std::fclose(fh);
 
 	std::memcpy(pub.rid.data(), header_buf + 3, 4);
 	std::memcpy(pub.len.data(), header_buf + 7, 2);
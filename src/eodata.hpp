@@ -9,9 +9,23 @@
 #include "fwd/eodata.hpp"
 
 #include <array>
+#include <exception>
 #include <string>
 #include <vector>
 
+/**
+ * Exception thrown when a pub file is missing or can't be read
+ */
+class Pub_Exception : public std::exception
+{
+	protected:
+		std::string err;
+	public:
+		Pub_Exception(const std::string &e) : err(e) {}
+		const char *error() const noexcept { return err.c_str(); }
+		const char *what() const noexcept { return "Pub_Exception"; }
+};
+
 struct Pub_File
 {
 	std::string filename;
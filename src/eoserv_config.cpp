@@ -26,6 +26,10 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "LogErr"             , "error.log");
 	eoserv_config_default(config, "StyleConsole"       , true);
 	eoserv_config_default(config, "LogCommands"        , true);
+	eoserv_config_default(config, "LogAsync"           , true);
+	eoserv_config_default(config, "LogQueueSize"       , 4096);
+	eoserv_config_default(config, "LogRateLimit"       , 20);
+	eoserv_config_default(config, "LogFormat"          , "text");
 	eoserv_config_default(config, "Host"               , "0.0.0.0");
 	eoserv_config_default(config, "Port"               , 8078);
 	eoserv_config_default(config, "MaxConnections"     , 300);
@@ -33,15 +37,19 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "MaxPlayers"         , 200);
 	eoserv_config_default(config, "MaxConnectionsPerIP", 3);
 	eoserv_config_default(config, "IPReconnectLimit"   , 10.0);
+	eoserv_config_default(config, "IPReconnectBurst"   , 1);
 	eoserv_config_default(config, "MaxConnectionsPerPC", 1);
 	eoserv_config_default(config, "HangupDelay"        , 10.0);
 	eoserv_config_default(config, "QuietConnectionErrors", false);
+	eoserv_config_default(config, "CoalesceSends"      , true);
+	eoserv_config_default(config, "NetworkThread"      , false);
 	eoserv_config_default(config, "MaxLoginAttempts"   , 3);
 	eoserv_config_default(config, "CheckVersion"       , true);
 	eoserv_config_default(config, "MinVersion"         , 0);
 	eoserv_config_default(config, "MaxVersion"         , 0);
 	eoserv_config_default(config, "OldVersionCompat"   , false);
 	eoserv_config_default(config, "TimedSave"          , "5m");
+	eoserv_config_default(config, "TimedSaveBatch"     , true);
 	eoserv_config_default(config, "IgnoreHDID"         , false);
 	eoserv_config_default(config, "ServerLanguage"     , "./lang/en.ini");
 	eoserv_config_default(config, "PacketQueueMax"     , 40);
@@ -49,7 +57,20 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "EnforceSequence"    , true);
 	eoserv_config_default(config, "EnforceTimestamps"  , true);
 	eoserv_config_default(config, "EnforceSessions"    , true);
+	eoserv_config_default(config, "Profiler"           , false);
+	eoserv_config_default(config, "ProfilerTickBudget" , "50ms");
+	eoserv_config_default(config, "ProfilerDumpFile"   , "perf.log");
+	eoserv_config_default(config, "ProfilerDumpRate"   , "5m");
+	eoserv_config_default(config, "StatusHost"         , "127.0.0.1");
+	eoserv_config_default(config, "StatusPort"         , 0);
+	eoserv_config_default(config, "PacketRecord"       , "");
+	eoserv_config_default(config, "RandomSeed"         , 0);
 	eoserv_config_default(config, "PasswordSalt"       , "ChangeMe");
+	eoserv_config_default(config, "PasswordHashCost"   , 14);
+	eoserv_config_default(config, "PasswordHashBlockSize", 8);
+	eoserv_config_default(config, "PasswordHashThreads", 2);
+	eoserv_config_default(config, "PasswordHashPerIP"  , 2);
+	eoserv_config_default(config, "PasswordHashQueue"  , 100);
 	eoserv_config_default(config, "SeoseCompat"        , "ChangeMe");
 	eoserv_config_default(config, "SeoseCompatKey"     , "D4q9_f30da%#q02#)8");
 	eoserv_config_default(config, "DBType"             , "mysql");
@@ -93,6 +114,8 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "GuildMultipleFounders", true);
 	eoserv_config_default(config, "GuildAnnounce"      , true);
 	eoserv_config_default(config, "GuildDateFormat"    , "%Y/%m/%d");
+	eoserv_config_default(config, "GuildCacheSize"     , 200);
+	eoserv_config_default(config, "GuildPreload"       , "3d");
 	eoserv_config_default(config, "GuildMinDeposit"    , 1000);
 	eoserv_config_default(config, "GuildMaxNameLength" , 24);
 	eoserv_config_default(config, "GuildMaxDescLength" , 240);
@@ -191,6 +214,7 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "CreateMinSkin"      , 0);
 	eoserv_config_default(config, "CreateMaxSkin"      , 3);
 	eoserv_config_default(config, "DefaultBanLength"   , "2h");
+	eoserv_config_default(config, "BanSyncRate"        , "1m");
 	eoserv_config_default(config, "LimitDamage"        , true);
 	eoserv_config_default(config, "DeathRecover"       , 0.5);
 	eoserv_config_default(config, "Deadly"             , false);
@@ -209,6 +233,7 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "JukeboxPrice"       , 25);
 	eoserv_config_default(config, "JukeboxTimer"       , 90);
 	eoserv_config_default(config, "RespawnBossChildren", true);
+	eoserv_config_default(config, "DormantMapTime"     , 60);
 	eoserv_config_default(config, "OldReports"         , false);
 	eoserv_config_default(config, "WarpSuck"           , 15);
 	eoserv_config_default(config, "EvacuateSound"      , 51);
@@ -279,6 +304,7 @@ void eoserv_config_validate_admin(Config& config)
 	eoserv_config_default(config, "sjail"         , 3);
 	eoserv_config_default(config, "ban"           , 2);
 	eoserv_config_default(config, "sban"          , 3);
+	eoserv_config_default(config, "ipban"         , 3);
 	eoserv_config_default(config, "mute"          , 1);
 	eoserv_config_default(config, "smute"         , 3);
 	eoserv_config_default(config, "warp"          , 2);
@@ -294,6 +320,7 @@ void eoserv_config_validate_admin(Config& config)
 	eoserv_config_default(config, "rehash"        , 4);
 	eoserv_config_default(config, "repub"         , 4);
 	eoserv_config_default(config, "request"       , 4);
+	eoserv_config_default(config, "perf"          , 4);
 	eoserv_config_default(config, "sitem"         , 3);
 	eoserv_config_default(config, "ditem"         , 3);
 	eoserv_config_default(config, "snpc"          , 3);
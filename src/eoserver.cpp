@@ -7,18 +7,23 @@
 
 #include "config.hpp"
 #include "eoclient.hpp"
+#include "metrics.hpp"
 #include "packet.hpp"
+#include "statusserver.hpp"
 #include "timer.hpp"
 #include "world.hpp"
 #include "handlers/handlers.hpp"
 
 #include "console.hpp"
+#include "perf.hpp"
 #include "socket.hpp"
 #include "util.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cerrno>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <memory>
 #include <stdexcept>
@@ -70,6 +75,8 @@ void server_check_hangup(void *server_void)
 			client->Close(true);
 		}
 	}
+
+	server->admission.Expire(now);
 }
 
 void server_pump_queue(void *server_void)
@@ -98,6 +105,9 @@ void server_pump_queue(void *server_void)
 			std::unique_ptr<ActionQueue_Action> action = std::move(client->queue.queue.front());
 			client->queue.queue.pop();
 
+			if (action->auto_queue)
+				Metrics::input_latency.Record(Metrics::Elapsed(action->queued));
+
 #ifndef DEBUG_EXCEPTIONS
 			try
 			{
@@ -147,15 +157,117 @@ void server_pump_queue(void *server_void)
 	}
 }
 
+static void server_status_tick(void *server_void)
+{
+	EOServer *server = static_cast<EOServer *>(server_void);
+
+	server->TickStatus();
+}
+
+#ifdef PERF_PROFILER
+static void server_perf_dump(void *server_void)
+{
+	EOServer *server = static_cast<EOServer *>(server_void);
+
+	if (!Perf::enabled)
+		return;
+
+	std::string filename = server->world->config["ProfilerDumpFile"];
+
+	if (!Perf::Dump(filename))
+		Console::Wrn("Could not write profiler report to %s", filename.c_str());
+}
+#endif // PERF_PROFILER
+
 void EOServer::UpdateConfig()
 {
 	delete ping_timer;
 	ping_timer = new TimeEvent(server_ping_all, this, double(this->world->config["PingRate"]), Timer::FOREVER);
 	this->world->timer.Register(ping_timer);
 
+	IPAddress status_address(std::string(this->world->config["StatusHost"]));
+	unsigned short status_port = static_cast<unsigned short>(int(this->world->config["StatusPort"]));
+
+	if (status_port != this->status_port || !(status_address == this->status_address))
+	{
+		delete this->status_server;
+		this->status_server = nullptr;
+
+		delete this->status_timer;
+		this->status_timer = nullptr;
+
+		this->status_address = status_address;
+		this->status_port = status_port;
+
+		if (status_port != 0)
+		{
+			try
+			{
+				this->status_server = new StatusServer(status_address, status_port, this);
+				Console::Out("Status server listening on %s:%i", std::string(status_address).c_str(), int(status_port));
+
+				PERF_NAME_TIMER(server_status_tick);
+				this->status_timer = new TimeEvent(server_status_tick, this, 0.05, Timer::FOREVER);
+				this->world->timer.Register(this->status_timer);
+			}
+			catch (Socket_Exception& e)
+			{
+				Console::Wrn("Could not start status server on %s:%i: %s", std::string(status_address).c_str(), int(status_port), e.error());
+			}
+		}
+	}
+
+#ifdef PERF_PROFILER
+	int profiler_config = bool(this->world->config["Profiler"]);
+
+	if (profiler_config != this->profiler_config)
+	{
+		this->profiler_config = profiler_config;
+		Perf::Enable(profiler_config);
+	}
+
+	Perf::SetTickBudget(double(this->world->config["ProfilerTickBudget"]));
+
+	delete perf_dump_timer;
+	perf_dump_timer = nullptr;
+
+	if (!std::string(this->world->config["ProfilerDumpFile"]).empty() && double(this->world->config["ProfilerDumpRate"]) > 0.0)
+	{
+		PERF_NAME_TIMER(server_perf_dump);
+		perf_dump_timer = new TimeEvent(server_perf_dump, this, double(this->world->config["ProfilerDumpRate"]), Timer::FOREVER);
+		this->world->timer.Register(perf_dump_timer);
+	}
+#endif // PERF_PROFILER
+
+	this->admission.Configure(double(this->world->config["IPReconnectLimit"]), int(this->world->config["IPReconnectBurst"]));
+
+	std::string record_file = this->world->config["PacketRecord"];
+
+	if (record_file.empty())
+	{
+		this->recorder.Close();
+	}
+	else if (record_file != this->recorder.Filename())
+	{
+		if (this->recorder.Open(record_file))
+			Console::Out("Recording packets to %s", record_file.c_str());
+		else
+			Console::Wrn("Could not open packet recording file: %s", record_file.c_str());
+	}
+
 	this->QuietConnectionErrors = bool(this->world->config["QuietConnectionErrors"]);
+	this->CoalesceSends = bool(this->world->config["CoalesceSends"]);
+
+	UTIL_FOREACH(this->clients, client)
+	{
+		client->SetFlushPolicy(this->CoalesceSends ? Client::FlushBatched : Client::FlushImmediate);
+	}
+
 	this->HangupDelay = double(this->world->config["HangupDelay"]);
 
+	// Sleeping longer than ClockMaxDelta would make the clock discard the time
+	this->MaxIdleWait = std::min(0.5, double(this->world->config["ClockMaxDelta"]) / 2000.0);
+
 	this->maxconn = unsigned(int(this->world->config["MaxConnections"]));
 
 #if !defined(SOCKET_POLL) || defined(WIN32)
@@ -171,10 +283,11 @@ void EOServer::Initialize(std::array<std::string, 6> dbinfo, const Config &eoser
 {
 	this->world = new World(dbinfo, eoserv_config, admin_config);
 
-	TimeEvent *event = new TimeEvent(server_check_hangup, this, 1.0, Timer::FOREVER);
-	this->world->timer.Register(event);
+	PERF_NAME_TIMER(server_ping_all);
+	PERF_NAME_TIMER(server_check_hangup);
+	PERF_NAME_TIMER(server_pump_queue);
 
-	event = new TimeEvent(server_pump_queue, this, 0.001, Timer::FOREVER);
+	TimeEvent *event = new TimeEvent(server_check_hangup, this, 1.0, Timer::FOREVER);
 	this->world->timer.Register(event);
 
 	this->world->server = this;
@@ -186,75 +299,58 @@ void EOServer::Initialize(std::array<std::string, 6> dbinfo, const Config &eoser
 
 Client *EOServer::ClientFactory(const Socket &sock)
 {
-	 return new EOClient(sock, this);
+	EOClient *client = new EOClient(sock, this);
+	client->SetFlushPolicy(this->CoalesceSends ? Client::FlushBatched : Client::FlushImmediate);
+	return client;
+}
+
+void EOServer::TickStatus()
+{
+	if (this->status_server)
+		this->status_server->Tick();
 }
 
 void EOServer::Tick()
 {
+	PERF_SCOPE_TICK();
+
+	Metrics::clock::time_point tick_start = Metrics::clock::now();
+	std::uint64_t tick_idle;
+
 	std::vector<Client *> *active_clients = 0;
 	EOClient *newclient = static_cast<EOClient *>(this->Poll());
 
 	if (newclient)
 	{
 		double now = Timer::GetTime();
-		int ip_connections = 0;
-		bool throttle = false;
 		IPAddress remote_addr = newclient->GetRemoteAddr();
 
-		const double reconnect_limit = double(this->world->config["IPReconnectLimit"]);
 		const int max_per_ip = int(this->world->config["MaxConnectionsPerIP"]);
 
-		UTIL_IFOREACH(connection_log, connection)
+		if (this->admission.Throttled(remote_addr, now))
 		{
-			double last_connection_time = connection->second.last_connection_time;
-			double last_rejection_time = connection->second.last_rejection_time;
-
-			if (last_connection_time + reconnect_limit < now
-			 && last_rejection_time + 30.0 < now)
-			{
-				this->ClearClientRejections(connection);
-				connection = connection_log.erase(connection);
-
-				if (connection == connection_log.end())
-					break;
-
-				continue;
-			}
-
-			if (connection->first == remote_addr
-			 && last_connection_time + reconnect_limit >= now)
-			{
-				throttle = true;
-			}
-		}
-
-		UTIL_FOREACH(this->clients, client)
-		{
-			if (client->GetRemoteAddr() == newclient->GetRemoteAddr())
-			{
-				++ip_connections;
-			}
-		}
-
-		if (throttle)
-		{
-			this->RecordClientRejection(newclient->GetRemoteAddr(), "reconnecting too fast");
+			this->RecordClientRejection(remote_addr, "reconnecting too fast");
 			newclient->Close(true);
 		}
-		else if (max_per_ip != 0 && ip_connections > max_per_ip)
+		else if (max_per_ip != 0 && this->admission.IPConnections(remote_addr) > max_per_ip)
 		{
-			this->RecordClientRejection(newclient->GetRemoteAddr(), "too many connections from this address");
+			this->RecordClientRejection(remote_addr, "too many connections from this address");
 			newclient->Close(true);
 		}
 		else
 		{
-			connection_log[remote_addr].last_connection_time = Timer::GetTime();
+			this->admission.Accepted(remote_addr, now);
 		}
 	}
 
+	double wait = this->IdleWait();
+
+	Metrics::clock::time_point idle_start = Metrics::clock::now();
+
 	try
 	{
-		active_clients = this->Select(0.001);
+		PERF_SCOPE_IDLE();
+		active_clients = this->Select(wait);
 	}
 	catch (Socket_SelectFailed &e)
 	{
@@ -262,6 +358,11 @@ void EOServer::Tick()
 			throw;
 	}
 
+	tick_idle = Metrics::Elapsed(idle_start);
+
+	++Metrics::loop.wakeups;
+	Metrics::loop.idle_ns += tick_idle;
+
 	if (active_clients)
 	{
 		UTIL_FOREACH(*active_clients, client)
@@ -273,58 +374,65 @@ void EOServer::Tick()
 		active_clients->clear();
 	}
 
+	{
+		PERF_SCOPE_TIMER(server_pump_queue);
+		server_pump_queue(this);
+	}
+
+	this->world->hasher.Poll();
+	this->world->SwapPubs();
+	this->world->SwapMaps();
+
 	this->BuryTheDead();
 
 	this->world->timer.Tick();
+
+	// Everything sent during the tick goes out together
+	this->Flush();
+
+	std::uint64_t tick_total = Metrics::Elapsed(tick_start);
+	Metrics::tick_duration.Record(tick_total > tick_idle ? tick_total - tick_idle : 0);
 }
 
-void EOServer::RecordClientRejection(const IPAddress& ip, const char* reason)
+double EOServer::IdleWait()
 {
-	if (QuietConnectionErrors)
-	{
-		auto it = this->connection_log.find(ip);
-
-		if (it == this->connection_log.end() || it->second.rejections == 0)
-		{
-			Console::Wrn("Connection from %s was rejected (%s)", std::string(ip).c_str(), reason);
-			if (it == this->connection_log.end())
-			{
-				auto result = this->connection_log.insert({ip, ConnectionLogEntry{}});
-				it = result.first;
-			}
-		}
+	double now = Timer::GetTime();
+	double wake = std::min(this->world->timer.NextDeadline(), now + this->MaxIdleWait);
 
-		if (it == this->connection_log.end())
-			return;
+	if (this->world->hasher.InProgress() > 0)
+		wake = std::min(wake, now + 0.01);
 
-		auto& log = it->second;
+	if (this->world->ReloadingPub() || this->world->ReloadingMap())
+		wake = std::min(wake, now + 0.1);
 
-		// Buffer up to 100 rejections + 30 seconds in delayed error mode
-		if (++log.rejections < 100)
-			log.last_rejection_time = Timer::GetTime();
-	}
-	else
+	UTIL_FOREACH(this->clients, rawclient)
 	{
-		Console::Wrn("Connection from %s was rejected (%s)", std::string(ip).c_str(), reason);
+		EOClient *client = static_cast<EOClient *>(rawclient);
+
+		// Data left over from the last tick, or an upload to keep feeding
+		if (client->RecvPending() || client->UploadReady())
+			return 0.0;
+
+		// Select() wakes up when a blocked upload's socket can take more, but the network thread doesn't say so
+		if (client->NeedTick())
+			wake = std::min(wake, now + 0.01);
+
+		if (!client->queue.queue.empty())
+			wake = std::min(wake, client->queue.next);
 	}
+
+	return std::max(0.0, wake - now);
 }
 
-void EOServer::ClearClientRejections(const IPAddress& ip)
+void EOServer::RecordClientRejection(const IPAddress& ip, const char* reason)
 {
-	auto it = this->connection_log.find(ip);
-	if (it != this->connection_log.end())
-		ClearClientRejections(it);
+	if (this->admission.Rejected(ip, Timer::GetTime(), QuietConnectionErrors))
+		Console::Wrn("Connection from %s was rejected (%s)", std::string(ip).c_str(), reason);
 }
 
-void EOServer::ClearClientRejections(EOServer::connection_log_iterator it)
+void EOServer::ClearClientRejections(const IPAddress& ip)
 {
-	int& rejections = it->second.rejections;
-
-	if (rejections > 1)
-	{
-		Console::Wrn("Connections from %s were rejected (%dx)", std::string(it->first).c_str(), rejections);
-		rejections = 0;
-	}
+	this->admission.ClearRejections(ip);
 }
 
 EOServer::~EOServer()
@@ -361,5 +469,6 @@ EOServer::~EOServer()
 		this->BuryTheDead();
 	}
 
+	delete this->status_server;
 	delete this->world;
 }
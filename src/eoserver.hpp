@@ -10,36 +10,38 @@
 
 #include "fwd/config.hpp"
 #include "fwd/eoclient.hpp"
+#include "fwd/statusserver.hpp"
 #include "fwd/timer.hpp"
 #include "fwd/world.hpp"
 
+#include "admission.hpp"
+#include "packetrecord.hpp"
 #include "socket.hpp"
 
 #include <array>
 #include <string>
-#include <unordered_map>
 
 void server_ping_all(void *server_void);
 void server_pump_queue(void *server_void);
 
-struct ConnectionLogEntry
-{
-	double last_connection_time = 0.0;
-	double last_rejection_time = 0.0;
-	int rejections = 0;
-};
-
 /**
  * A server which accepts connections and creates EOClient instances from them
  */
 class EOServer : public Server
 {
 	private:
-		std::unordered_map<IPAddress, ConnectionLogEntry> connection_log;
-		typedef decltype(connection_log)::iterator connection_log_iterator;
 		void Initialize(std::array<std::string, 6> dbinfo, const Config &eoserv_config, const Config &admin_config);
 
 		TimeEvent* ping_timer = nullptr;
+		TimeEvent* perf_dump_timer = nullptr;
+
+		// Profiler setting last read from the config, so $perf on/off survives a rehash that doesn't change it
+		int profiler_config = -1;
+
+		StatusServer* status_server = nullptr;
+		TimeEvent* status_timer = nullptr;
+		IPAddress status_address;
+		unsigned short status_port = 0;
 
 	protected:
 		virtual Client *ClientFactory(const Socket &);
@@ -48,9 +50,22 @@ class EOServer : public Server
 		World *world;
 		double start;
 
+		AdmissionControl admission;
+
+		/**
+		 * Records packets from clients when PacketRecord is set
+		 */
+		PacketRecorder recorder;
+
 		bool QuietConnectionErrors = false;
+		bool CoalesceSends = true;
 		double HangupDelay = 10.0;
 
+		/**
+		 * Longest time Tick() will wait for network activity
+		 */
+		double MaxIdleWait = 0.5;
+
 		void UpdateConfig();
 
 		EOServer(IPAddress addr, unsigned short port, std::array<std::string, 6> dbinfo, const Config &eoserv_config, const Config &admin_config) : Server(addr, port)
@@ -58,11 +73,20 @@ class EOServer : public Server
 			this->Initialize(dbinfo, eoserv_config, admin_config);
 		}
 
+		/**
+		 * Returns how long Tick() can wait for network activity before a timer or queued action is due
+		 */
+		double IdleWait();
+
 		void Tick();
 
+		/**
+		 * Services the status HTTP server, if it is enabled
+		 */
+		void TickStatus();
+
 		void RecordClientRejection(const IPAddress& ip, const char* reason);
 		void ClearClientRejections(const IPAddress& ip);
-		void ClearClientRejections(connection_log_iterator);
 
 		~EOServer();
 };
@@ -0,0 +1,11 @@
+/* fwd/admission.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FWD_ADMISSION_HPP_INCLUDED
+#define FWD_ADMISSION_HPP_INCLUDED
+
+class AdmissionControl;
+
+#endif // FWD_ADMISSION_HPP_INCLUDED
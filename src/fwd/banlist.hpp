@@ -0,0 +1,15 @@
+/* fwd/banlist.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FWD_BANLIST_HPP_INCLUDED
+#define FWD_BANLIST_HPP_INCLUDED
+
+struct Ban_Entry;
+
+class BanIndex;
+
+class BanList;
+
+#endif // FWD_BANLIST_HPP_INCLUDED
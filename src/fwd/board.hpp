@@ -0,0 +1,15 @@
+/* fwd/board.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FWD_BOARD_HPP_INCLUDED
+#define FWD_BOARD_HPP_INCLUDED
+
+struct Board_Post;
+
+class Board;
+
+class BoardStore;
+
+#endif // FWD_BOARD_HPP_INCLUDED
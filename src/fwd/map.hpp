@@ -14,6 +14,7 @@ struct Map_Tile;
 struct Map_Chest_Item;
 struct Map_Chest_Spawn;
 struct Map_Chest;
+struct Map_File;
 
 enum MapEffect : unsigned char
 {
@@ -0,0 +1,12 @@
+/* fwd/packetrecord.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FWD_PACKETRECORD_HPP_INCLUDED
+#define FWD_PACKETRECORD_HPP_INCLUDED
+
+class PacketRecorder;
+struct PacketRecord;
+
+#endif // FWD_PACKETRECORD_HPP_INCLUDED
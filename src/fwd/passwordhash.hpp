@@ -0,0 +1,13 @@
+/* fwd/passwordhash.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FWD_PASSWORDHASH_HPP_INCLUDED
+#define FWD_PASSWORDHASH_HPP_INCLUDED
+
+struct Password_Params;
+
+class PasswordHasher;
+
+#endif // FWD_PASSWORDHASH_HPP_INCLUDED
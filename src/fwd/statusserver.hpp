@@ -0,0 +1,11 @@
+/* fwd/statusserver.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FWD_STATUSSERVER_HPP_INCLUDED
+#define FWD_STATUSSERVER_HPP_INCLUDED
+
+class StatusServer;
+
+#endif // FWD_STATUSSERVER_HPP_INCLUDED
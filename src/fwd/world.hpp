@@ -8,8 +8,6 @@
 
 class World;
 
-struct Board;
-struct Board_Post;
 struct Home;
 
 enum AccountReply : short
@@ -13,6 +13,7 @@
 #include "player.hpp"
 #include "world.hpp"
 
+#include "console.hpp"
 #include "util.hpp"
 #include "util/variant.hpp"
 
@@ -99,17 +100,62 @@ Guild_Create::~Guild_Create()
 	this->manager->CancelCreate(this->tag);
 }
 
+std::shared_ptr<Guild> GuildManager::Load(std::unordered_map<std::string, util::variant> &row)
+{
+	std::shared_ptr<Guild> guild(new Guild(this));
+	guild->tag = static_cast<std::string>(row["tag"]);
+	guild->name = static_cast<std::string>(row["name"]);
+	guild->description = util::text_word_wrap(static_cast<std::string>(row["description"]), this->world->config["GuildMaxWidth"]);
+	guild->created = static_cast<int>(row["created"]);
+	guild->ranks = RankUnserialize(static_cast<std::string>(row["ranks"]));
+	guild->bank = static_cast<int>(row["bank"]);
+
+	this->cache[guild->tag] = guild;
+	this->cache[guild->name] = guild;
+
+	return guild;
+}
+
+void GuildManager::Retain(std::shared_ptr<Guild> guild)
+{
+	// Memberless guilds are deleted as soon as they're released, so don't hold on to them
+	if (guild->members.empty())
+		return;
+
+	if (guild->retained)
+	{
+		this->recent.splice(this->recent.begin(), this->recent, guild->recent_entry);
+		return;
+	}
+
+	std::size_t cache_size = std::max(int(this->world->config["GuildCacheSize"]), 0);
+
+	if (cache_size == 0)
+		return;
+
+	this->recent.push_front(guild);
+	guild->recent_entry = this->recent.begin();
+	guild->retained = true;
+
+	while (this->recent.size() > cache_size)
+	{
+		std::shared_ptr<Guild> evicted = this->recent.back();
+		evicted->retained = false;
+		this->recent.pop_back();
+	}
+}
+
 std::shared_ptr<Guild> GuildManager::GetGuild(std::string tag)
 {
 	tag = util::uppercase(tag);
 
 	std::unordered_map<std::string, std::weak_ptr<Guild>>::iterator findguild = this->cache.find(tag);
+	std::shared_ptr<Guild> guild;
 
 	if (findguild != this->cache.end())
-	{
-		return std::shared_ptr<Guild>(findguild->second);
-	}
-	else
+		guild = findguild->second.lock();
+
+	if (!guild)
 	{
 		Database_Result res = this->world->db.Query("SELECT `tag`, `name`, `description`, `created`, `ranks`, `bank` FROM `guilds` WHERE `tag` = '$'", tag.c_str());
 
@@ -118,27 +164,19 @@ std::shared_ptr<Guild> GuildManager::GetGuild(std::string tag)
 			return std::shared_ptr<Guild>();
 		}
 
-		std::unordered_map<std::string, util::variant> row = res.front();
-		std::shared_ptr<Guild> guild(new Guild(this));
-		guild->tag = static_cast<std::string>(row["tag"]);
-		guild->name = static_cast<std::string>(row["name"]);
-		guild->description = util::text_word_wrap(static_cast<std::string>(row["description"]), this->world->config["GuildMaxWidth"]);
-		guild->created = static_cast<int>(row["created"]);
-		guild->ranks = RankUnserialize(static_cast<std::string>(row["ranks"]));
-		guild->bank = static_cast<int>(row["bank"]);
+		guild = this->Load(res.front());
 
-		res = this->world->db.Query("SELECT `name`, `guild_rank`, `guild_rank_string` FROM `characters` WHERE `guild` = '$' ORDER BY `guild_rank` ASC, `name` ASC", tag.c_str());
+		res = this->world->db.Query("SELECT `name`, `guild_rank`, `guild_rank_string` FROM `characters` WHERE `guild` = '$' ORDER BY `guild_rank` ASC, `name` ASC", guild->tag.c_str());
 
 		UTIL_FOREACH_REF(res, row)
 		{
 			guild->members.push_back(std::make_shared<Guild_Member>(row["name"], row["guild_rank"], row["guild_rank_string"]));
 		}
+	}
 
-		this->cache[guild->tag] = guild;
-		this->cache[guild->name] = guild;
+	this->Retain(guild);
 
-		return guild;
-	}
+	return guild;
 }
 
 std::shared_ptr<Guild> GuildManager::GetGuildName(std::string name)
@@ -146,41 +184,25 @@ std::shared_ptr<Guild> GuildManager::GetGuildName(std::string name)
 	name = util::lowercase(name);
 
 	std::unordered_map<std::string, std::weak_ptr<Guild>>::iterator findguild = this->cache.find(name);
+	std::shared_ptr<Guild> guild;
 
 	if (findguild != this->cache.end())
+		guild = findguild->second.lock();
+
+	if (guild)
 	{
-		return std::shared_ptr<Guild>(findguild->second);
+		this->Retain(guild);
+		return guild;
 	}
-	else
-	{
-		Database_Result res = this->world->db.Query("SELECT `tag`, `name`, `description`, `created`, `ranks`, `bank` FROM `guilds` WHERE `name` = '$'", name.c_str());
-
-		if (res.empty())
-		{
-			return std::shared_ptr<Guild>();
-		}
-
-		std::unordered_map<std::string, util::variant> row = res.front();
-		std::shared_ptr<Guild> guild(new Guild(this));
-		guild->tag = static_cast<std::string>(row["tag"]);
-		guild->name = static_cast<std::string>(row["name"]);
-		guild->description = static_cast<std::string>(row["description"]);
-		guild->created = static_cast<int>(row["created"]);
-		guild->ranks = RankUnserialize(static_cast<std::string>(row["ranks"]));
-		guild->bank = static_cast<int>(row["bank"]);
 
-		res = this->world->db.Query("SELECT `name`, `guild_rank`, `guild_rank_string` FROM `characters` WHERE `guild` = '$' ORDER BY `guild_rank` ASC, `name` ASC", static_cast<std::string>(row["tag"]).c_str());
+	Database_Result res = this->world->db.Query("SELECT `tag` FROM `guilds` WHERE `name` = '$'", name.c_str());
 
-		UTIL_FOREACH_REF(res, row)
-		{
-			guild->members.push_back(std::make_shared<Guild_Member>(row["name"], row["guild_rank"], row["guild_rank_string"]));
-		}
-
-		this->cache[guild->tag] = guild;
-		this->cache[guild->name] = guild;
-
-		return guild;
+	if (res.empty())
+	{
+		return std::shared_ptr<Guild>();
 	}
+
+	return this->GetGuild(static_cast<std::string>(res.front()["tag"]));
 }
 
 std::shared_ptr<Guild_Create> GuildManager::GetCreate(std::string tag)
@@ -244,15 +266,176 @@ std::shared_ptr<Guild> GuildManager::CreateGuild(std::shared_ptr<Guild_Create> c
 	return guild;
 }
 
+void GuildManager::Preload()
+{
+	int active_time = this->world->config["GuildPreload"];
+	int cache_size = this->world->config["GuildCacheSize"];
+
+	if (active_time <= 0 || cache_size <= 0)
+		return;
+
+	Database_Result res = this->world->db.Query("SELECT `tag`, `name`, `description`, `created`, `ranks`, `bank` FROM `guilds` WHERE `tag` IN "
+		"(SELECT `characters`.`guild` FROM `characters` INNER JOIN `accounts` ON `accounts`.`username` = `characters`.`account` WHERE `accounts`.`lastused` > #) LIMIT #",
+		int(std::time(0)) - active_time, cache_size);
+
+	if (res.empty())
+		return;
+
+	std::unordered_map<std::string, std::shared_ptr<Guild>> loaded;
+	std::string tags;
+
+	UTIL_FOREACH_REF(res, row)
+	{
+		std::string tag = static_cast<std::string>(row["tag"]);
+
+		if (this->cache.find(tag) != this->cache.end())
+			continue;
+
+		loaded[tag] = this->Load(row);
+
+		if (!tags.empty())
+			tags += ", ";
+
+		tags += "'" + this->world->db.EscapeRaw(tag) + "'";
+	}
+
+	if (loaded.empty())
+		return;
+
+	// One roster query for every guild instead of one each
+	Database_Result members = this->world->db.Query("SELECT `name`, `guild`, `guild_rank`, `guild_rank_string` FROM `characters` WHERE `guild` IN (@) ORDER BY `guild_rank` ASC, `name` ASC", tags.c_str());
+
+	UTIL_FOREACH_REF(members, row)
+	{
+		auto it = loaded.find(util::trim(static_cast<std::string>(row["guild"])));
+
+		if (it != loaded.end())
+			it->second->members.push_back(std::make_shared<Guild_Member>(row["name"], row["guild_rank"], row["guild_rank_string"]));
+	}
+
+	UTIL_FOREACH_CREF(loaded, entry)
+	{
+		this->Retain(entry.second);
+	}
+
+	Console::Out("%i guilds preloaded.", int(this->recent.size()));
+}
+
+void GuildManager::Release(Guild *guild)
+{
+	if (!guild->retained)
+		return;
+
+	guild->retained = false;
+
+	// May destroy the guild
+	this->recent.erase(guild->recent_entry);
+}
+
+void GuildManager::MarkDirty(std::shared_ptr<Guild> guild)
+{
+	if (guild->needs_save)
+		return;
+
+	guild->needs_save = true;
+	this->dirty.push_back(guild);
+}
+
+void GuildManager::QueueMemberUpdate(std::string name, std::string guild, int rank, std::string rank_string)
+{
+	name = util::lowercase(name);
+
+	this->member_updates[name] = Member_Update{guild, rank, rank_string};
+
+	if (!this->world->config["TimedSave"])
+		this->FlushMemberUpdates();
+}
+
+void GuildManager::DropMemberUpdate(std::string name)
+{
+	this->member_updates.erase(util::lowercase(name));
+}
+
+void GuildManager::DropGuildUpdates(std::string tag)
+{
+	// Queued rank changes would otherwise put members back in to a deleted guild
+	UTIL_FOREACH_REF(this->member_updates, update)
+	{
+		if (update.second.guild == tag)
+			update.second.guild.clear();
+	}
+}
+
+const GuildManager::Member_Update *GuildManager::PendingMemberUpdate(std::string name) const
+{
+	auto it = this->member_updates.find(util::lowercase(name));
+
+	return (it != this->member_updates.end()) ? &it->second : 0;
+}
+
+// Writes queued member changes in multi-row UPDATE statements
+void GuildManager::FlushMemberUpdates()
+{
+	const std::size_t batch_size = 256;
+
+	Database &db = this->world->db;
+
+	auto it = this->member_updates.begin();
+
+	while (it != this->member_updates.end())
+	{
+		std::string guild_case = " CASE `name`";
+		std::string rank_case = " CASE `name`";
+		std::string rank_string_case = " CASE `name`";
+		std::string names;
+
+		for (std::size_t i = 0; i < batch_size && it != this->member_updates.end(); ++i, ++it)
+		{
+			std::string name = "'" + db.EscapeRaw(it->first) + "'";
+			const Member_Update &update = it->second;
+
+			if (update.guild.empty())
+			{
+				guild_case += " WHEN " + name + " THEN NULL";
+				rank_case += " WHEN " + name + " THEN NULL";
+				rank_string_case += " WHEN " + name + " THEN NULL";
+			}
+			else
+			{
+				guild_case += " WHEN " + name + " THEN '" + db.EscapeRaw(update.guild) + "'";
+				rank_case += " WHEN " + name + " THEN " + util::to_string(update.rank);
+				rank_string_case += " WHEN " + name + " THEN '" + db.EscapeRaw(update.rank_string) + "'";
+			}
+
+			if (!names.empty())
+				names += ", ";
+
+			names += name;
+		}
+
+		std::string query = "UPDATE `characters` SET `guild` =" + guild_case + " END, `guild_rank` =" + rank_case + " END"
+			", `guild_rank_string` =" + rank_string_case + " END WHERE `name` IN (" + names + ")";
+
+		db.RawQuery(query.c_str());
+	}
+
+	this->member_updates.clear();
+}
+
 void GuildManager::SaveAll()
 {
-	UTIL_FOREACH(this->cache, entry)
+	std::vector<std::weak_ptr<Guild>> saving;
+	saving.swap(this->dirty);
+
+	UTIL_FOREACH(saving, entry)
 	{
-		std::shared_ptr<Guild> guild(entry.second);
+		std::shared_ptr<Guild> guild(entry.lock());
 
 		if (guild)
 			guild->Save();
 	}
+
+	this->FlushMemberUpdates();
 }
 
 bool GuildManager::ValidName(std::string name)
@@ -344,7 +527,10 @@ void Guild::AddMember(Character *joined, Character *recruiter, bool alert, int r
 	joined->guild_rank = rank;
 	joined->guild_rank_string = this->GetRank(rank);
 
+	this->manager->DropMemberUpdate(joined->real_name);
+
 	this->members.push_back(std::make_shared<Guild_Member>(joined->real_name, rank, joined->guild_rank_string));
+	this->manager->Retain(shared_from_this());
 
 	if (recruiter != joined) // Leader of new guild
 	{
@@ -375,6 +561,9 @@ void Guild::DelMember(std::string kicked, Character *kicker, bool alert)
 {
 	kicked = util::lowercase(kicked);
 
+	// Keeps the guild alive until the end of this function even if it loses its last reference
+	std::shared_ptr<Guild> guild(shared_from_this());
+
 	if (alert && this->manager->world->config["GuildAnnounce"])
 	{
 		std::string msg = manager->world->i18n.Format("guild_leave", util::ucfirst(kicked));
@@ -396,6 +585,9 @@ void Guild::DelMember(std::string kicked, Character *kicker, bool alert)
 		}
 	}
 
+	if (this->members.empty())
+		this->manager->Release(this);
+
 	World* world = this->manager->world;
 
 	UTIL_FOREACH(world->server->clients, client)
@@ -411,18 +603,22 @@ void Guild::DelMember(std::string kicked, Character *kicker, bool alert)
 					character->guild.reset();
 					character->guild_rank = 0;
 					character->guild_rank_string.clear();
-					// *this may not be valid after this point
 
 					if (character->online)
+					{
+						this->manager->DropMemberUpdate(kicked);
 						return;
+					}
 					else
+					{
 						break;
+					}
 				}
 			}
 		}
 	}
 
-	world->db.Query("UPDATE `characters` SET `guild` = NULL, `guild_rank` = NULL, `guild_rank_string` = NULL WHERE `name` = '$'", kicked.c_str());
+	this->manager->QueueMemberUpdate(kicked, "");
 }
 
 void Guild::SetMemberRank(std::string name, int rank)
@@ -452,16 +648,20 @@ void Guild::SetMemberRank(std::string name, int rank)
 						character->guild_rank_string = rank_str;
 						
 						if (character->online)
+						{
+							this->manager->DropMemberUpdate(name);
 							return;
+						}
 						else
+						{
 							break;
+						}
 					}
 				}
 			}
 		}
 
-		world->db.Query("UPDATE `characters` SET `guild_rank` = #, `guild_rank_string` = '$' WHERE `name` = '$'",
-			rank, rank_str.c_str(), name.c_str());
+		this->manager->QueueMemberUpdate(name, this->tag, rank, rank_str);
 	}
 }
 
@@ -469,7 +669,7 @@ void Guild::AddBank(int gold)
 {
 	if (gold > 0 && this->bank + gold >= 0)
 	{
-		this->needs_save = true;
+		this->MarkDirty();
 		this->bank += gold;
 		this->bank = std::min<int>(this->bank, this->manager->world->config["GuildBankMax"]);
 	}
@@ -479,7 +679,7 @@ void Guild::DelBank(int gold)
 {
 	if (gold > 0 && this->bank >= 0 && this->bank - gold >= 0)
 	{
-		this->needs_save = true;
+		this->MarkDirty();
 		this->bank -= gold;
 	}
 }
@@ -518,7 +718,7 @@ std::shared_ptr<Guild_Member> Guild::GetMember(std::string name)
 
 void Guild::SetDescription(std::string description)
 {
-	this->needs_save = true;
+	this->MarkDirty();
 
 	for (std::string::iterator i = description.begin(); i != description.end(); ++i)
 	{
@@ -531,6 +731,11 @@ void Guild::SetDescription(std::string description)
 	this->description = util::text_word_wrap(description, this->manager->world->config["GuildMaxWidth"]);
 }
 
+void Guild::MarkDirty()
+{
+	this->manager->MarkDirty(shared_from_this());
+}
+
 void Guild::Msg(Character *from, std::string message, bool echo)
 {
 	message = util::text_cap(message, static_cast<int>(this->manager->world->config["ChatMaxWidth"]) - util::text_width(util::ucfirst(from ? from->SourceName() : "Server") + "  "));
@@ -587,7 +792,24 @@ Guild::~Guild()
 	}
 	else
 	{
+		this->manager->DropGuildUpdates(this->tag);
 		this->manager->world->db.Query("UPDATE `characters` SET `guild` = NULL, `guild_rank` = NULL, `guild_rank_string` = NULL WHERE `guild` = '$'", this->tag.c_str());
 		this->manager->world->db.Query("DELETE FROM `guilds` WHERE tag = '$'", this->tag.c_str());
 	}
 }
+
+GuildManager::~GuildManager()
+{
+	this->cache_clearing = true;
+
+	this->SaveAll();
+
+	UTIL_FOREACH_REF(this->recent, guild)
+	{
+		guild->retained = false;
+	}
+
+	this->recent.clear();
+
+	this->FlushMemberUpdates();
+}
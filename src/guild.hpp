@@ -11,9 +11,13 @@
 #include "fwd/character.hpp"
 #include "fwd/world.hpp"
 
+#include "util/variant.hpp"
+
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <ctime>
+#include <list>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -69,9 +73,29 @@ class Guild_Create : public std::enable_shared_from_this<Guild_Create>
 
 /**
  * Manages when to load and save guild data
+ * Recently used guilds are kept loaded after their last member logs out, up to GuildCacheSize.
+ * Changes to offline members are queued and written in batches with the timed save.
  */
 class GuildManager
 {
+	public:
+		/**
+		 * Guild columns of a character waiting to be written to the database
+		 */
+		struct Member_Update
+		{
+			std::string guild;
+			int rank;
+			std::string rank_string;
+		};
+
+	private:
+		std::list<std::shared_ptr<Guild>> recent;
+		std::vector<std::weak_ptr<Guild>> dirty;
+		std::unordered_map<std::string, Member_Update> member_updates;
+
+		std::shared_ptr<Guild> Load(std::unordered_map<std::string, util::variant> &row);
+
 	public:
 		bool cache_clearing;
 		std::unordered_map<std::string, std::weak_ptr<Guild>> cache;
@@ -87,17 +111,63 @@ class GuildManager
 		void CancelCreate(std::string);
 		std::shared_ptr<Guild> CreateGuild(std::shared_ptr<Guild_Create>, std::string description);
 
+		/**
+		 * Loads guilds with recently active members in bulk, as configured by GuildPreload
+		 */
+		void Preload();
+
+		/**
+		 * Marks a guild as recently used, keeping it loaded while it's one of the GuildCacheSize most recent
+		 */
+		void Retain(std::shared_ptr<Guild> guild);
+
+		/**
+		 * Stops keeping a guild loaded once nothing else references it
+		 */
+		void Release(Guild *guild);
+
+		void MarkDirty(std::shared_ptr<Guild> guild);
+
+		/**
+		 * Queues a write of an offline character's guild columns, an empty guild clears them
+		 */
+		void QueueMemberUpdate(std::string name, std::string guild, int rank = 0, std::string rank_string = "");
+
+		/**
+		 * Discards a queued write for a character that is now online and saves its own guild columns
+		 */
+		void DropMemberUpdate(std::string name);
+
+		/**
+		 * Turns queued writes for members of a deleted guild in to removals
+		 */
+		void DropGuildUpdates(std::string tag);
+
+		/**
+		 * Finds a queued write that hasn't reached the database yet
+		 */
+		const Member_Update *PendingMemberUpdate(std::string name) const;
+
+		void FlushMemberUpdates();
+
+		/**
+		 * Saves modified guilds and queued member changes
+		 */
 		void SaveAll();
 
+		std::size_t Retained() const { return this->recent.size(); }
+
 		bool ValidName(std::string name);
 		bool ValidTag(std::string tag);
 		bool ValidRank(std::string rank);
 		bool ValidDescription(std::string description);
+
+		~GuildManager();
 };
 
 /**
  * Stores guild information and references to online members
- * Created by the World object when a member of the guild logs in, and destroyed when the last member logs out
+ * Created by the World object when a member of the guild logs in, and destroyed when the last member logs out and the guild drops out of GuildManager's cache
  */
 class Guild : public std::enable_shared_from_this<Guild>
 {
@@ -112,7 +182,10 @@ class Guild : public std::enable_shared_from_this<Guild>
 		int bank;
 		bool needs_save;
 
-		Guild(GuildManager *manager_) : manager(manager_), created(0), bank(0), needs_save(false) { }
+		bool retained;
+		std::list<std::shared_ptr<Guild>>::iterator recent_entry;
+
+		Guild(GuildManager *manager_) : manager(manager_), created(0), bank(0), needs_save(false), retained(false) { }
 		Guild(const Guild&) = delete;
 
 		void AddMember(Character *joined, Character *recruiter, bool alert = false, int rank = 9);
@@ -131,6 +204,11 @@ class Guild : public std::enable_shared_from_this<Guild>
 
 		void SetDescription(std::string);
 
+		/**
+		 * Flags guild information to be written at the next save
+		 */
+		void MarkDirty();
+
 		void Msg(Character *from, std::string message, bool echo = true);
 
 		void Save();
@@ -9,6 +9,7 @@
 #include "../eoclient.hpp"
 #include "../eoserver.hpp"
 #include "../packet.hpp"
+#include "../passwordhash.hpp"
 #include "../player.hpp"
 #include "../world.hpp"
 #include "../extra/seose_compat.hpp"
@@ -18,7 +19,6 @@
 #include "../util/secure_string.hpp"
 
 #include <cstddef>
-#include <memory>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -112,12 +112,31 @@ void Account_Create(EOClient *client, PacketReader &reader)
 	}
 	else
 	{
-		username = util::lowercase(username);
+		PasswordHasher::SubmitResult result = client->server()->world->CreatePlayer(client, username, std::move(password),
+			fullname, location, email, computer, util::to_string(hdid), [client, username](bool created)
+		{
+			PacketBuilder reply(PACKET_ACCOUNT, PACKET_REPLY, 4);
 
-		client->server()->world->CreatePlayer(username, std::move(password), fullname, location, email, computer, util::to_string(hdid), static_cast<std::string>(client->GetRemoteAddr()));
-		reply.AddShort(ACCOUNT_CREATED);
-		reply.AddString("OK");
-		Console::Out("New account: %s", username.c_str());
+			if (created)
+			{
+				reply.AddShort(ACCOUNT_CREATED);
+				reply.AddString("OK");
+				Console::Out("New account: %s", username.c_str());
+			}
+			else
+			{
+				reply.AddShort(ACCOUNT_EXISTS);
+				reply.AddString("NO");
+			}
+
+			client->Send(reply);
+		});
+
+		if (result == PasswordHasher::Submitted || result == PasswordHasher::OwnerBusy)
+			return;
+
+		reply.AddShort(ACCOUNT_NOT_APPROVED);
+		reply.AddString("NO");
 	}
 
 	client->Send(reply);
@@ -159,25 +178,38 @@ void Account_Agree(Player *player, PacketReader &reader)
 	if (player->world->config["SeoseCompat"])
 		newpassword = std::move(seose_str_hash(newpassword.str(), player->world->config["SeoseCompatKey"]));
 
-	{
-		std::unique_ptr<Player> changepass(player->world->Login(username, std::move(oldpassword)));
+	EOClient *client = player->client;
+	World *world = player->world;
 
-		if (!changepass)
+	PasswordHasher::SubmitResult result = world->LoginCheck(client, username, std::move(oldpassword),
+		[client, world, username, newpassword](LoginReply login_reply) mutable
+	{
+		if (login_reply != LOGIN_WRONG_USERPASS)
 		{
-			PacketBuilder reply(PACKET_ACCOUNT, PACKET_REPLY, 4);
-			reply.AddShort(ACCOUNT_CHANGE_FAILED);
-			reply.AddString("NO");
-			player->Send(reply);
-			return;
+			PasswordHasher::SubmitResult result = world->ChangePassword(client, username, std::move(newpassword), [client]()
+			{
+				PacketBuilder reply(PACKET_ACCOUNT, PACKET_REPLY, 4);
+				reply.AddShort(ACCOUNT_CHANGED);
+				reply.AddString("OK");
+				client->Send(reply);
+			});
+
+			if (result == PasswordHasher::Submitted)
+				return;
 		}
 
-		changepass->ChangePass(std::move(newpassword));
-	}
+		PacketBuilder reply(PACKET_ACCOUNT, PACKET_REPLY, 4);
+		reply.AddShort(ACCOUNT_CHANGE_FAILED);
+		reply.AddString("NO");
+		client->Send(reply);
+	});
 
-	PacketBuilder reply(PACKET_ACCOUNT, PACKET_REPLY, 4);
-	reply.AddShort(ACCOUNT_CHANGED);
-	reply.AddString("OK");
+	if (result == PasswordHasher::Submitted || result == PasswordHasher::OwnerBusy)
+		return;
 
+	PacketBuilder reply(PACKET_ACCOUNT, PACKET_REPLY, 4);
+	reply.AddShort(ACCOUNT_CHANGE_FAILED);
+	reply.AddString("NO");
 	player->Send(reply);
 }
 
@@ -5,6 +5,7 @@
 
 #include "handlers.hpp"
 
+#include "../board.hpp"
 #include "../character.hpp"
 #include "../config.hpp"
 #include "../map.hpp"
@@ -16,6 +17,7 @@
 
 #include <cstddef>
 #include <string>
+#include <utility>
 
 namespace Handlers
 {
@@ -35,18 +37,12 @@ void Board_Remove(Character *character, PacketReader &reader)
 			return;
 		}
 
-		UTIL_IFOREACH(character->board->posts, post)
+		const Board_Post *post = character->board->Find(postid);
+
+		if (post && (post->author_admin < character->admin
+		 || post->author == character->SourceName()))
 		{
-			if ((*post)->id == postid)
-			{
-				if ((*post)->author_admin < character->admin
-				 || (*post)->author == character->SourceName())
-				{
-					delete *post;
-					character->board->posts.erase(post);
-				}
-				break;
-			}
+			character->board->Remove(postid);
 		}
 
 		// Not in the official EO servers, but nice to use
@@ -73,61 +69,34 @@ void Board_Create(Character *character, PacketReader &reader)
 	subject = subject.substr(0, static_cast<int>(character->world->config["BoardMaxSubjectLength"]));
 	body = body.substr(0, static_cast<int>(character->world->config["BoardMaxPostLength"]));
 
-	int post_count = 0;
-	int recent_post_count = 0;
-
 	if (character->board)
 	{
-		UTIL_FOREACH(character->board->posts, post)
-		{
-			if (post->author == character->SourceName())
-			{
-				++post_count;
-
-				if (post_count >= static_cast<int>(character->world->config["BoardMaxUserPosts"]))
-				{
-					// Not in the official EO servers, but nice to use
-					character->ShowBoard();
-					return;
-				}
+		int post_count = character->board->AuthorPosts(character->SourceName());
+		int recent_post_count = character->board->AuthorRecentPosts(character->SourceName(),
+			Timer::GetTime() - static_cast<int>(character->world->config["BoardRecentPostTime"]));
 
-				if (post->time + static_cast<int>(character->world->config["BoardRecentPostTime"]) > Timer::GetTime())
-				{
-					++recent_post_count;
-
-					if (recent_post_count >= static_cast<int>(character->world->config["BoardMaxUserRecentPosts"]))
-					{
-						// Not in the official EO servers, but nice to use
-						character->ShowBoard();
-						return;
-					}
-				}
-			}
+		if (post_count >= static_cast<int>(character->world->config["BoardMaxUserPosts"])
+		 || recent_post_count >= static_cast<int>(character->world->config["BoardMaxUserRecentPosts"]))
+		{
+			// Not in the official EO servers, but nice to use
+			character->ShowBoard();
+			return;
 		}
 
-		Board_Post *newpost = new Board_Post;
-		newpost->id = ++character->board->last_id;
-		newpost->author = character->SourceName();
-		newpost->author_admin = character->admin;
-		newpost->subject = subject;
-		newpost->body = body;
-		newpost->time = Timer::GetTime();
-
-		character->board->posts.push_front(newpost);
+		Board_Post newpost;
+		newpost.author = character->SourceName();
+		newpost.author_admin = character->admin;
+		newpost.subject = subject;
+		newpost.body = body;
+		newpost.time = Timer::GetTime();
 
 		if (character->board->id == static_cast<int>(character->world->config["AdminBoard"]))
 		{
-			if (character->board->posts.size() > static_cast<std::size_t>(static_cast<int>(character->world->config["AdminBoardLimit"])))
-			{
-				character->board->posts.pop_back();
-			}
+			character->board->Add(std::move(newpost), static_cast<int>(character->world->config["AdminBoardLimit"]));
 		}
 		else
 		{
-			if (character->board->posts.size() > static_cast<std::size_t>(static_cast<int>(character->world->config["BoardMaxPosts"])))
-			{
-				character->board->posts.pop_back();
-			}
+			character->board->Add(std::move(newpost), static_cast<int>(character->world->config["BoardMaxPosts"]));
 		}
 
 		// Not in the official EO servers, but nice to use
@@ -143,16 +112,14 @@ void Board_Take(Character *character, PacketReader &reader)
 
 	if (character->board)
 	{
-		UTIL_FOREACH(character->board->posts, post)
+		const Board_Post *post = character->board->Find(postid);
+
+		if (post)
 		{
-			if (post->id == postid)
-			{
-				PacketBuilder reply(PACKET_BOARD, PACKET_PLAYER, 2 + post->body.length());
-				reply.AddShort(postid);
-				reply.AddString(post->body);
-				character->Send(reply);
-				break;
-			}
+			PacketBuilder reply(PACKET_BOARD, PACKET_PLAYER, 2 + post->body.length());
+			reply.AddShort(postid);
+			reply.AddString(post->body);
+			character->Send(reply);
 		}
 	}
 }
@@ -199,7 +199,7 @@ void Guild_Agree(Character *character, PacketReader &reader)
 							character->guild->ranks[i] = new_ranks[i];
 						}
 
-						character->guild->needs_save = true;
+						character->guild->MarkDirty();
 
 						PacketBuilder reply(PACKET_GUILD, PACKET_REPLY, 2);
 						reply.AddShort(GUILD_RANKS_UPDATED);
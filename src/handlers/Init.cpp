@@ -48,9 +48,11 @@ void Init_Init(EOClient *client, PacketReader &reader)
 	unsigned hdid_len = reader.GetChar();
 	std::string hdid_str = reader.GetEndString();
 
+	int hdid;
+
 	try
 	{
-		client->hdid = int(util::to_uint_raw(hdid_str));
+		hdid = int(util::to_uint_raw(hdid_str));
 	}
 	catch (std::invalid_argument&)
 	{
@@ -66,17 +68,9 @@ void Init_Init(EOClient *client, PacketReader &reader)
 		return;
 	}
 
-	int pc_connections = 0;
-
-	UTIL_FOREACH(client->server()->clients, checkclient)
-	{
-		EOClient *checkeoclient = static_cast<EOClient *>(checkclient);
+	client->SetHDID(hdid);
 
-		if (checkeoclient->hdid == client->hdid && checkeoclient->GetRemoteAddr() == client->GetRemoteAddr())
-		{
-			++pc_connections;
-		}
-	}
+	int pc_connections = client->server()->admission.PCConnections(client->GetRemoteAddr(), client->hdid);
 
 	const bool ignore_hdid = client->server()->world->config["IgnoreHDID"];
 
@@ -405,8 +405,7 @@ void Item_Drop(Character *character, PacketReader &reader)
 
 		if (item)
 		{
-			item->owner = character->PlayerID();
-			item->unprotecttime = Timer::GetTime() + static_cast<double>(character->world->config["ProtectPlayerDrop"]);
+			character->map->ProtectItem(*item, character->PlayerID(), Timer::GetTime() + static_cast<double>(character->world->config["ProtectPlayerDrop"]));
 			character->DelItem(id, amount);
 
 			PacketBuilder reply(PACKET_ITEM, PACKET_DROP, 15);
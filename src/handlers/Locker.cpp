@@ -62,23 +62,22 @@ void Locker_Add(Character *character, PacketReader &reader)
 	{
 		if (character->map->GetSpec(x, y) == Map_Tile::BankVault)
 		{
-			UTIL_IFOREACH(character->bank, it)
+			Character_Item *bank_item = character->bank.get(item);
+
+			if (bank_item)
 			{
-				if (it->id == item)
+				if (bank_item->amount + amount < 0)
 				{
-					if (it->amount + amount < 0)
-					{
-						return;
-					}
+					return;
+				}
 
-					amount = std::min<int>(amount, static_cast<int>(character->world->config["MaxBank"]) - it->amount);
+				amount = std::min<int>(amount, static_cast<int>(character->world->config["MaxBank"]) - bank_item->amount);
 
-					it->amount += amount;
+				bank_item->amount += amount;
 
-					PacketBuilder reply = add_common(character, item, amount);
-					character->Send(reply);
-					return;
-				}
+				PacketBuilder reply = add_common(character, item, amount);
+				character->Send(reply);
+				return;
 			}
 
 			if (character->bank.size() >= lockermax)
@@ -115,37 +114,34 @@ void Locker_Take(Character *character, PacketReader &reader)
 	{
 		if (character->map->GetSpec(x, y) == Map_Tile::BankVault)
 		{
-			UTIL_IFOREACH(character->bank, it)
-			{
-				if (it->id == item)
-				{
-					int amount = it->amount;
-					int taken = character->CanHoldItem(it->id, amount);
+			auto it = character->bank.find(item);
 
-					character->AddItem(item, taken);
+			if (it != character->bank.end())
+			{
+				int amount = it->amount;
+				int taken = character->CanHoldItem(it->id, amount);
 
-					character->CalculateStats();
+				character->AddItem(item, taken);
 
-					PacketBuilder reply(PACKET_LOCKER, PACKET_GET, 7 + character->bank.size() * 5);
-					reply.AddShort(item);
-					reply.AddThree(taken);
-					reply.AddChar(character->weight);
-					reply.AddChar(character->maxweight);
+				character->CalculateStats();
 
-					it->amount -= taken;
+				PacketBuilder reply(PACKET_LOCKER, PACKET_GET, 7 + character->bank.size() * 5);
+				reply.AddShort(item);
+				reply.AddThree(taken);
+				reply.AddChar(character->weight);
+				reply.AddChar(character->maxweight);
 
-					if (it->amount <= 0)
-						character->bank.erase(it);
+				it->amount -= taken;
 
-					UTIL_FOREACH(character->bank, item)
-					{
-						reply.AddShort(item.id);
-						reply.AddThree(item.amount);
-					}
-					character->Send(reply);
+				if (it->amount <= 0)
+					character->bank.erase(it);
 
-					break;
+				UTIL_FOREACH(character->bank, item)
+				{
+					reply.AddShort(item.id);
+					reply.AddThree(item.amount);
 				}
+				character->Send(reply);
 			}
 		}
 	}
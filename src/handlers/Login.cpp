@@ -10,6 +10,7 @@
 #include "../eodata.hpp"
 #include "../eoserver.hpp"
 #include "../packet.hpp"
+#include "../passwordhash.hpp"
 #include "../player.hpp"
 #include "../world.hpp"
 #include "../extra/seose_compat.hpp"
@@ -24,6 +25,62 @@
 namespace Handlers
 {
 
+// Finishes a login once the password has been checked
+static void Login_Finish(EOClient *client, const std::string& username, LoginReply login_reply)
+{
+	if (login_reply != LOGIN_OK)
+	{
+		PacketBuilder reply(PACKET_LOGIN, PACKET_REPLY, 2);
+		reply.AddShort(login_reply);
+		client->Send(reply);
+
+		int max_login_attempts = int(client->server()->world->config["MaxLoginAttempts"]);
+
+		if (max_login_attempts != 0 && ++client->login_attempts >= max_login_attempts)
+		{
+			client->Close();
+		}
+
+		return;
+	}
+
+	client->player = client->server()->world->Login(username);
+
+	if (!client->player)
+	{
+		// Someone deleted the account between checking it and logging in
+		PacketBuilder reply(PACKET_LOGIN, PACKET_REPLY, 2);
+		reply.AddShort(LOGIN_WRONG_USER);
+		client->Send(reply);
+		return;
+	}
+
+	client->player->id = client->id;
+	client->player->client = client;
+	client->state = EOClient::LoggedIn;
+
+	PacketBuilder reply(PACKET_LOGIN, PACKET_REPLY, 5 + client->player->characters.size() * 34);
+	reply.AddShort(LOGIN_OK);
+	reply.AddChar(client->player->characters.size());
+	reply.AddByte(2);
+	reply.AddByte(255);
+	UTIL_FOREACH(client->player->characters, character)
+	{
+		reply.AddBreakString(character->SourceName());
+		reply.AddInt(character->id);
+		reply.AddChar(character->level);
+		reply.AddChar(character->gender);
+		reply.AddChar(character->hairstyle);
+		reply.AddChar(character->haircolor);
+		reply.AddChar(character->race);
+		reply.AddChar(character->admin);
+		character->AddPaperdollData(reply, "BAHSW");
+
+		reply.AddByte(255);
+	}
+	client->Send(reply);
+}
+
 // Log in to an account
 void Login_Request(EOClient *client, PacketReader &reader)
 {
@@ -76,59 +133,19 @@ void Login_Request(EOClient *client, PacketReader &reader)
 		return;
 	}
 
-	LoginReply login_reply = client->server()->world->LoginCheck(username, std::move(password));
-
-	if (login_reply != LOGIN_OK)
-	{
-		PacketBuilder reply(PACKET_LOGIN, PACKET_REPLY, 2);
-		reply.AddShort(login_reply);
-		client->Send(reply);
-
-		int max_login_attempts = int(client->server()->world->config["MaxLoginAttempts"]);
-
-		if (max_login_attempts != 0 && ++client->login_attempts >= max_login_attempts)
-		{
-			client->Close();
-		}
+	PasswordHasher::SubmitResult result = client->server()->world->LoginCheck(client, username, std::move(password),
+		[client, username](LoginReply login_reply) { Login_Finish(client, username, login_reply); });
 
+	// A login from this client is already being checked
+	if (result == PasswordHasher::OwnerBusy)
 		return;
-	}
-
-	client->player = client->server()->world->Login(username);
 
-	if (!client->player)
+	if (result != PasswordHasher::Submitted)
 	{
-		// Someone deleted the account between checking it and logging in
 		PacketBuilder reply(PACKET_LOGIN, PACKET_REPLY, 2);
-		reply.AddShort(LOGIN_WRONG_USER);
+		reply.AddShort(LOGIN_BUSY);
 		client->Send(reply);
-		return;
 	}
-
-	client->player->id = client->id;
-	client->player->client = client;
-	client->state = EOClient::LoggedIn;
-
-	PacketBuilder reply(PACKET_LOGIN, PACKET_REPLY, 5 + client->player->characters.size() * 34);
-	reply.AddShort(LOGIN_OK);
-	reply.AddChar(client->player->characters.size());
-	reply.AddByte(2);
-	reply.AddByte(255);
-	UTIL_FOREACH(client->player->characters, character)
-	{
-		reply.AddBreakString(character->SourceName());
-		reply.AddInt(character->id);
-		reply.AddChar(character->level);
-		reply.AddChar(character->gender);
-		reply.AddChar(character->hairstyle);
-		reply.AddChar(character->haircolor);
-		reply.AddChar(character->race);
-		reply.AddChar(character->admin);
-		character->AddPaperdollData(reply, "BAHSW");
-
-		reply.AddByte(255);
-	}
-	client->Send(reply);
 }
 
 PACKET_HANDLER_REGISTER(PACKET_LOGIN)
@@ -13,6 +13,7 @@
 #include "../timer.hpp"
 #include "../world.hpp"
 
+#include "../perf.hpp"
 #include "../util.hpp"
 
 #include <algorithm>
@@ -39,6 +40,7 @@ void Spell_Request(Character *character, PacketReader &reader)
 			return;
 
 		character->spell_id = spell_id;
+		PERF_NAME_TIMER(character_cast_spell);
 		character->spell_event = new TimeEvent(character_cast_spell, character, 0.47 * spell.cast_time + character->SpellCooldownTime(), 1);
 		character->world->timer.Register(character->spell_event);
 
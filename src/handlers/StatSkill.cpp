@@ -205,20 +205,19 @@ void StatSkill_Add(Character *character, PacketReader &reader)
 				return;
 			}
 
-			UTIL_IFOREACH(character->spells, spell)
+			Character_Spell *spell = character->spells.get(stat_id);
+
+			if (spell)
 			{
-				if (spell->id == stat_id)
-				{
-					++spell->level;
-					--character->skillpoints;
-
-					reply.SetID(PACKET_STATSKILL, PACKET_ACCEPT);
-					reply.ReserveMore(6);
-					reply.AddShort(character->skillpoints);
-					reply.AddShort(stat_id);
-					reply.AddShort(spell->level);
-					character->Send(reply);
-				}
+				++spell->level;
+				--character->skillpoints;
+
+				reply.SetID(PACKET_STATSKILL, PACKET_ACCEPT);
+				reply.ReserveMore(6);
+				reply.AddShort(character->skillpoints);
+				reply.AddShort(stat_id);
+				reply.AddShort(spell->level);
+				character->Send(reply);
 			}
 
 			break;
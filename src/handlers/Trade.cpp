@@ -219,15 +219,7 @@ void Trade_Add(Character *character, PacketReader &reader)
 		return;
 	}
 
-	bool offered = false;
-	UTIL_FOREACH(character->trade_inventory, item)
-	{
-		if (item.id == itemid)
-		{
-			offered = true;
-			break;
-		}
-	}
+	bool offered = character->trade_inventory.contains(itemid);
 
 	if (!offered && character->trade_inventory.size() >= 10)
 	{
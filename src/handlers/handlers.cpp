@@ -9,6 +9,7 @@
 #include "../player.hpp"
 
 #include "../console.hpp"
+#include "../perf.hpp"
 
 #include <stdexcept>
 
@@ -100,6 +101,8 @@ void packet_handler_register::Handle(PacketFamily family, PacketAction action, E
 		return;
 	}
 
+	PERF_SCOPE_HANDLER(family, action);
+
 	switch (handler.fn_type)
 	{
 		case packet_handler::Invalid:
@@ -7,7 +7,11 @@
 
 #include "sha256.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <vector>
 
 std::string sha256(const std::string& str)
 {
@@ -27,3 +31,225 @@ std::string sha256(const std::string& str)
 
 	return std::string(cdigest, 64);
 }
+
+struct hmac_sha256_key
+{
+	sha256_context inner;
+	sha256_context outer;
+
+	explicit hmac_sha256_key(const std::string& key)
+	{
+		char block[SHA256_BLOCK_SIZE] = {};
+		char ipad[SHA256_BLOCK_SIZE];
+		char opad[SHA256_BLOCK_SIZE];
+
+		if (key.length() > SHA256_BLOCK_SIZE)
+		{
+			sha256_context ctx;
+			sha256_start(&ctx);
+			sha256_update(&ctx, key.data(), key.length());
+			sha256_finish(&ctx, block);
+		}
+		else
+		{
+			std::memcpy(block, key.data(), key.length());
+		}
+
+		for (int i = 0; i < SHA256_BLOCK_SIZE; ++i)
+		{
+			ipad[i] = char(block[i] ^ 0x36);
+			opad[i] = char(block[i] ^ 0x5C);
+		}
+
+		sha256_start(&this->inner);
+		sha256_update(&this->inner, ipad, SHA256_BLOCK_SIZE);
+		sha256_start(&this->outer);
+		sha256_update(&this->outer, opad, SHA256_BLOCK_SIZE);
+
+		std::memset(block, 0, sizeof block);
+		std::memset(ipad, 0, sizeof ipad);
+		std::memset(opad, 0, sizeof opad);
+	}
+};
+
+// PBKDF2-HMAC-SHA256 with a single iteration, which is all scrypt needs
+static void pbkdf2_sha256_1(const std::string& password, const char *salt, std::size_t salt_length, char *out, std::size_t length)
+{
+	hmac_sha256_key key(password);
+	char digest[32];
+
+	for (std::uint32_t block = 1; length > 0; ++block)
+	{
+		char counter[4] = {char(block >> 24), char(block >> 16), char(block >> 8), char(block)};
+		sha256_context ctx = key.inner;
+
+		sha256_update(&ctx, salt, salt_length);
+		sha256_update(&ctx, counter, 4);
+		sha256_finish(&ctx, digest);
+
+		ctx = key.outer;
+		sha256_update(&ctx, digest, 32);
+		sha256_finish(&ctx, digest);
+
+		std::size_t n = (length < 32) ? length : 32;
+		std::memcpy(out, digest, n);
+		out += n;
+		length -= n;
+	}
+
+	std::memset(digest, 0, sizeof digest);
+}
+
+static inline std::uint32_t rotl32(std::uint32_t x, int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static void salsa20_8(std::uint32_t b[16])
+{
+	std::uint32_t x[16];
+	std::memcpy(x, b, sizeof x);
+
+	for (int i = 0; i < 8; i += 2)
+	{
+		x[ 4] ^= rotl32(x[ 0] + x[12],  7); x[ 8] ^= rotl32(x[ 4] + x[ 0],  9);
+		x[12] ^= rotl32(x[ 8] + x[ 4], 13); x[ 0] ^= rotl32(x[12] + x[ 8], 18);
+		x[ 9] ^= rotl32(x[ 5] + x[ 1],  7); x[13] ^= rotl32(x[ 9] + x[ 5],  9);
+		x[ 1] ^= rotl32(x[13] + x[ 9], 13); x[ 5] ^= rotl32(x[ 1] + x[13], 18);
+		x[14] ^= rotl32(x[10] + x[ 6],  7); x[ 2] ^= rotl32(x[14] + x[10],  9);
+		x[ 6] ^= rotl32(x[ 2] + x[14], 13); x[10] ^= rotl32(x[ 6] + x[ 2], 18);
+		x[ 3] ^= rotl32(x[15] + x[11],  7); x[ 7] ^= rotl32(x[ 3] + x[15],  9);
+		x[11] ^= rotl32(x[ 7] + x[ 3], 13); x[15] ^= rotl32(x[11] + x[ 7], 18);
+
+		x[ 1] ^= rotl32(x[ 0] + x[ 3],  7); x[ 2] ^= rotl32(x[ 1] + x[ 0],  9);
+		x[ 3] ^= rotl32(x[ 2] + x[ 1], 13); x[ 0] ^= rotl32(x[ 3] + x[ 2], 18);
+		x[ 6] ^= rotl32(x[ 5] + x[ 4],  7); x[ 7] ^= rotl32(x[ 6] + x[ 5],  9);
+		x[ 4] ^= rotl32(x[ 7] + x[ 6], 13); x[ 5] ^= rotl32(x[ 4] + x[ 7], 18);
+		x[11] ^= rotl32(x[10] + x[ 9],  7); x[ 8] ^= rotl32(x[11] + x[10],  9);
+		x[ 9] ^= rotl32(x[ 8] + x[11], 13); x[10] ^= rotl32(x[ 9] + x[ 8], 18);
+		x[12] ^= rotl32(x[15] + x[14],  7); x[13] ^= rotl32(x[12] + x[15],  9);
+		x[14] ^= rotl32(x[13] + x[12], 13); x[15] ^= rotl32(x[14] + x[13], 18);
+	}
+
+	for (int i = 0; i < 16; ++i)
+		b[i] += x[i];
+}
+
+// in and out are 2r 64-byte blocks and must not overlap
+static void scrypt_blockmix(const std::uint32_t *in, std::uint32_t *out, unsigned int r)
+{
+	std::uint32_t x[16];
+	std::memcpy(x, &in[(2 * r - 1) * 16], sizeof x);
+
+	for (unsigned int i = 0; i < 2 * r; ++i)
+	{
+		for (int j = 0; j < 16; ++j)
+			x[j] ^= in[i * 16 + j];
+
+		salsa20_8(x);
+
+		// Even blocks go to the first half of the output, odd blocks to the second
+		std::memcpy(&out[((i & 1) * r + i / 2) * 16], x, sizeof x);
+	}
+}
+
+static void scrypt_romix(char *block, std::uint64_t n, unsigned int r, std::vector<std::uint32_t>& v)
+{
+	const std::size_t words = 32 * r;
+	std::vector<std::uint32_t> x(words);
+	std::vector<std::uint32_t> y(words);
+
+	for (std::size_t i = 0; i < words; ++i)
+	{
+		const unsigned char *p = reinterpret_cast<const unsigned char *>(block + i * 4);
+		x[i] = std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 | std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+	}
+
+	for (std::uint64_t i = 0; i < n; ++i)
+	{
+		std::memcpy(&v[i * words], x.data(), words * 4);
+		scrypt_blockmix(x.data(), y.data(), r);
+		x.swap(y);
+	}
+
+	for (std::uint64_t i = 0; i < n; ++i)
+	{
+		std::uint64_t j = x[(2 * r - 1) * 16] & (n - 1);
+
+		for (std::size_t k = 0; k < words; ++k)
+			x[k] ^= v[j * words + k];
+
+		scrypt_blockmix(x.data(), y.data(), r);
+		x.swap(y);
+	}
+
+	for (std::size_t i = 0; i < words; ++i)
+	{
+		unsigned char *p = reinterpret_cast<unsigned char *>(block + i * 4);
+		p[0] = (unsigned char)(x[i]);
+		p[1] = (unsigned char)(x[i] >> 8);
+		p[2] = (unsigned char)(x[i] >> 16);
+		p[3] = (unsigned char)(x[i] >> 24);
+	}
+}
+
+std::string scrypt(const std::string& password, const std::string& salt, std::uint64_t n, unsigned int r, unsigned int p, std::size_t dklen)
+{
+	const std::size_t block_size = 128 * r;
+	std::string b(block_size * p, '\0');
+	std::string dk(dklen, '\0');
+	std::vector<std::uint32_t> v(std::size_t(n) * 32 * r);
+
+	pbkdf2_sha256_1(password, salt.data(), salt.length(), &b[0], b.length());
+
+	for (unsigned int i = 0; i < p; ++i)
+		scrypt_romix(&b[i * block_size], n, r, v);
+
+	pbkdf2_sha256_1(password, b.data(), b.length(), &dk[0], dk.length());
+
+	std::memset(&b[0], 0, b.length());
+
+	return dk;
+}
+
+std::string hex_encode(const std::string& str)
+{
+	std::string hex(str.length() * 2, '\0');
+
+	for (std::size_t i = 0; i < str.length(); ++i)
+	{
+		hex[i*2]   = "0123456789abcdef"[((str[i] >> 4) & 0x0F)];
+		hex[i*2+1] = "0123456789abcdef"[((str[i]) & 0x0F)];
+	}
+
+	return hex;
+}
+
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+std::string hex_decode(const std::string& hex)
+{
+	if (hex.length() % 2 != 0)
+		return std::string();
+
+	std::string str(hex.length() / 2, '\0');
+
+	for (std::size_t i = 0; i < str.length(); ++i)
+	{
+		int hi = hex_value(hex[i*2]);
+		int lo = hex_value(hex[i*2+1]);
+
+		if (hi < 0 || lo < 0)
+			return std::string();
+
+		str[i] = char(hi << 4 | lo);
+	}
+
+	return str;
+}
@@ -6,6 +6,8 @@
 #ifndef HASH_HPP_INCLUDED
 #define HASH_HPP_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 /**
@@ -13,4 +15,21 @@
  */
 std::string sha256(const std::string&);
 
+/**
+ * Derives a key from a password using scrypt (RFC 7914)
+ * Uses 128 * r * n bytes of memory, n must be a power of two
+ * @return dklen raw bytes
+ */
+std::string scrypt(const std::string& password, const std::string& salt, std::uint64_t n, unsigned int r, unsigned int p, std::size_t dklen);
+
+/**
+ * Convert a string of raw bytes to lowercase hex
+ */
+std::string hex_encode(const std::string&);
+
+/**
+ * Convert a hex string to raw bytes, returns an empty string if it is not valid hex
+ */
+std::string hex_decode(const std::string&);
+
 #endif // HASH_HPP_INCLUDED
@@ -10,74 +10,147 @@
 #include "util.hpp"
 
 #include <cstddef>
+#include <cstdio>
 #include <string>
+#include <utility>
 #include <vector>
 
+void I18N_Arg::FormatInteger(int value)
+{
+	int length = std::snprintf(this->buffer, sizeof this->buffer, "%i", value);
+	this->data = this->buffer;
+	this->size = std::size_t(length);
+}
+
+void I18N_Arg::FormatFloat(double value)
+{
+	int length = std::snprintf(this->buffer, sizeof this->buffer, "%g", value);
+	this->data = this->buffer;
+	this->size = std::size_t(length);
+}
+
 I18N::I18N()
 { }
 
 I18N::I18N(const std::string& lang_file)
-	: lang_config(new Config(lang_file))
-{ }
+{
+	this->SetLangFile(lang_file);
+}
 
 void I18N::SetLangFile(const std::string& lang_file)
 {
-	lang_config->Read(lang_file);
+	Config lang_config;
+	lang_config.Read(lang_file);
+
+	UTIL_FOREACH(lang_config, entry)
+	{
+		this->templates[entry.first] = I18N::Compile(std::string(entry.second));
+	}
+}
+
+I18N::Template I18N::Compile(const std::string &format)
+{
+	Template result;
+	result.literal_length = 0;
+
+	std::size_t literal_start = 0;
+	std::size_t i = 0;
+
+	auto add_literal = [&](std::size_t end)
+	{
+		if (end > literal_start)
+		{
+			result.segments.push_back({Template::Literal, result.text.length(), end - literal_start});
+			result.text.append(format, literal_start, end - literal_start);
+			result.literal_length += end - literal_start;
+		}
+	};
+
+	while ((i = format.find('{', i)) != std::string::npos)
+	{
+		add_literal(i);
+
+		std::size_t close = format.find('}', i + 1);
+
+		// An unterminated placeholder is dropped along with the rest of the string
+		if (close == std::string::npos)
+		{
+			literal_start = format.length();
+			break;
+		}
+
+		int index = util::to_int(format.substr(i + 1, close - i - 1));
+
+		// Indexes are 1-based, anything else never matches an argument and formats as #ERROR#
+		result.segments.push_back({(index > 0) ? std::size_t(index - 1) : Template::Invalid, 0, 0});
+
+		i = close + 1;
+		literal_start = i;
+	}
+
+	add_literal(format.length());
+
+	result.fixed = true;
+
+	UTIL_FOREACH(result.segments, segment)
+	{
+		if (segment.arg != Template::Literal)
+			result.fixed = false;
+	}
+
+	return result;
+}
+
+std::string I18N::Format(const std::string& id) const
+{
+	return this->Render(id, nullptr, 0);
 }
 
-std::string I18N::FormatV(const std::string& id, std::vector<util::variant> &&v) const
+std::string I18N::Render(const std::string& id, const I18N_Arg *args, std::size_t count) const
 {
-	auto it = lang_config->find(id);
+	static const char error[] = "#ERROR#";
+
+	auto it = this->templates.find(id);
 
-	if (it == lang_config->end())
+	if (it == this->templates.end())
 	{
 		std::string result = id;
 
-		UTIL_FOREACH(v, x)
+		for (std::size_t i = 0; i < count; ++i)
 		{
-			result += " " + std::string(x);
+			result += ' ';
+			result.append(args[i].Data(), args[i].Size());
 		}
 
 		return result;
 	}
 
+	const Template &format = it->second;
+
+	if (format.fixed)
+		return format.text;
+
+	std::size_t length = format.literal_length;
+
+	UTIL_FOREACH(format.segments, segment)
+	{
+		if (segment.arg == Template::Literal)
+			continue;
+
+		length += (segment.arg < count) ? args[segment.arg].Size() : sizeof error - 1;
+	}
+
 	std::string result;
-	std::string format = std::string(it->second);
-	std::string number_buffer;
-	int state = 0;
+	result.reserve(length);
 
-	UTIL_FOREACH(format, c)
+	UTIL_FOREACH(format.segments, segment)
 	{
-		if (state == 0)
-		{
-			if (c == '{')
-			{
-				state = 1;
-			}
-			else
-			{
-				result += c;
-			}
-		}
-		else if (state == 1)
-		{
-			if (c == '}')
-			{
-				std::size_t index = int(util::variant(number_buffer)) - 1;
-
-				if (index >= v.size())
-					result += "#ERROR#";
-				else
-					result += std::string(v[index]);
-
-				number_buffer = "";
-				state = 0;
-			}
-			else
-			{
-				number_buffer += c;
-			}
-		}
+		if (segment.arg == Template::Literal)
+			result.append(format.text, segment.offset, segment.length);
+		else if (segment.arg < count)
+			result.append(args[segment.arg].Data(), args[segment.arg].Size());
+		else
+			result.append(error, sizeof error - 1);
 	}
 
 	return result;
@@ -8,32 +8,101 @@
 
 #include "fwd/i18n.hpp"
 
-#include "fwd/config.hpp"
-
-#include "util/variant.hpp"
-
-#include <memory>
+#include <cstddef>
+#include <cstring>
 #include <string>
-#include <utility>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
+/**
+ * One argument to I18N::Format
+ * Strings are referenced rather than copied, so it must not outlive the value it was made from.
+ */
+class I18N_Arg
+{
+	private:
+		const char *data;
+		std::size_t size;
+		char buffer[32];
+
+		void FormatInteger(int value);
+		void FormatFloat(double value);
+
+	public:
+		I18N_Arg(const std::string &s) : data(s.data()), size(s.length()) { }
+		I18N_Arg(const char *s) : data(s), size(std::strlen(s)) { }
+		I18N_Arg(bool b) : data(b ? "yes" : "no"), size(b ? 3 : 2) { }
+
+		template <class T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, int>::type = 0>
+		I18N_Arg(T value) { this->FormatInteger(static_cast<int>(value)); }
+
+		template <class T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+		I18N_Arg(T value) { this->FormatFloat(static_cast<double>(value)); }
+
+		I18N_Arg(const I18N_Arg &) = delete;
+		I18N_Arg &operator=(const I18N_Arg &) = delete;
+
+		const char *Data() const { return this->data; }
+		std::size_t Size() const { return this->size; }
+};
+
 class I18N
 {
 	protected:
-		std::unique_ptr<Config> lang_config;
+		/**
+		 * A language string split in to literal text and placeholders
+		 */
+		struct Template
+		{
+			static const std::size_t Literal = std::size_t(-1);
+			static const std::size_t Invalid = std::size_t(-2);
+
+			struct Segment
+			{
+				/**
+				 * Argument index, or Literal for a span of text
+				 */
+				std::size_t arg;
+				std::size_t offset;
+				std::size_t length;
+			};
+
+			std::string text;
+			std::vector<Segment> segments;
+
+			/**
+			 * Total length of the literal spans, used to size the output up front
+			 */
+			std::size_t literal_length;
+
+			/**
+			 * Set if the string has no placeholders, in which case text is the formatted result
+			 */
+			bool fixed;
+		};
+
+		std::unordered_map<std::string, Template> templates;
+
+		static Template Compile(const std::string &format);
+
+		std::string Render(const std::string &id, const I18N_Arg *args, std::size_t count) const;
 
 	public:
 		I18N();
 		I18N(const std::string& lang_file);
 
+		/**
+		 * Loads a language file, replacing only the strings it defines
+		 */
 		void SetLangFile(const std::string& lang_file);
 
-		std::string FormatV(const std::string& id, std::vector<util::variant> &&v) const;
+		std::string Format(const std::string& id) const;
 
-		template <class... Args> std::string Format(const std::string& id, Args&&... args) const
+		template <class... Args> std::string Format(const std::string& id, const Args&... args) const
 		{
-			std::vector<util::variant> v{args...};
-			return FormatV(id, std::move(v));
+			const I18N_Arg arg_list[] = {args...};
+			return this->Render(id, arg_list, sizeof...(Args));
 		}
 
 		~I18N();
@@ -5,12 +5,15 @@
 
 #include "config.hpp"
 #include "database.hpp"
+#include "eodata.hpp"
 #include "eoserv_config.hpp"
 #include "eoserver.hpp"
+#include "guild.hpp"
 #include "world.hpp"
 
 #include "console.hpp"
 #include "socket.hpp"
+#include "util.hpp"
 
 #include <array>
 #include <csignal>
@@ -296,6 +299,18 @@ int eoserv_main(int argc, char *argv[])
 			redirect_stream("output", stdout, Console::STREAM_OUT, "LogOut");
 		}
 
+		auto start_async_log = [&]()
+		{
+			Console::SetJSON(util::lowercase(config["LogFormat"]) == "json");
+
+			if (config["LogAsync"])
+				Console::StartAsync(int(config["LogQueueSize"]), int(config["LogRateLimit"]));
+			else
+				Console::StopAsync();
+		};
+
+		start_async_log();
+
 		std::array<std::string, 6> dbinfo;
 		dbinfo[0] = std::string(config["DBType"]);
 		dbinfo[1] = std::string(config["DBHost"]);
@@ -304,10 +319,21 @@ int eoserv_main(int argc, char *argv[])
 		dbinfo[4] = std::string(config["DBName"]);
 		dbinfo[5] = std::string(config["DBPort"]);
 
+		if (int(config["RandomSeed"]) != 0)
+			util::rand_seed(unsigned(int(config["RandomSeed"])));
+
 		EOServer server(static_cast<std::string>(config["Host"]), static_cast<int>(config["Port"]), dbinfo, config, aconfig);
 		server.Listen(server.MaxConnections(), int(config["ListenBacklog"]));
 		Console::Out("Listening on %s:%i (0/%i connections)", std::string(config["Host"]).c_str(), int(config["Port"]), server.MaxConnections());
 
+		if (config["NetworkThread"])
+		{
+			if (server.StartIOThread())
+				Console::Out("Client connections are read and written on a separate thread");
+			else
+				Console::Wrn("NetworkThread is not supported on this platform, client connections will be handled on the main thread");
+		}
+
 		bool tables_exist = false;
 		bool tried_install = false;
 
@@ -371,6 +397,11 @@ int eoserv_main(int argc, char *argv[])
 			}
 		}
 
+		server.world->LoadBans();
+		server.world->LoadBoards();
+		server.world->CheckPasswordStorage();
+		server.world->guildmanager->Preload();
+
 		while (eoserv_running)
 		{
 			if (eoserv_sig_abort)
@@ -391,6 +422,8 @@ int eoserv_main(int argc, char *argv[])
 				server.world->Rehash();
 
 				// Does not support changing from file logging back to '-'
+				// Reopened on the log writer thread so it's never writing to a stream being replaced
+				Console::Reopen([&]()
 				{
 					std::time_t rawtime;
 					char timestr[256];
@@ -413,7 +446,7 @@ int eoserv_main(int argc, char *argv[])
 							std::fprintf(stderr, "\n\n--- %s ---\n\n", timestr);
 						}
 
-						if (std::setvbuf(stderr, 0, _IONBF, BUFSIZ) != 0)
+						if (std::setvbuf(stderr, 0, _IOLBF, BUFSIZ) != 0)
 						{
 							Console::Wrn("Failed to change stderr buffer settings");
 						}
@@ -435,12 +468,14 @@ int eoserv_main(int argc, char *argv[])
 							std::printf("\n\n--- %s ---\n\n", timestr);
 						}
 
-						if (std::setvbuf(stdout, 0, _IONBF, BUFSIZ) != 0)
+						if (std::setvbuf(stdout, 0, _IOLBF, BUFSIZ) != 0)
 						{
 							Console::Wrn("Failed to change stdout buffer settings");
 						}
 					}
-				}
+				});
+
+				start_async_log();
 
 				Console::Out("Config reloaded");
 			}
@@ -459,6 +494,11 @@ int eoserv_main(int argc, char *argv[])
 		Console::Err("%s: %s", e.what(), e.error());
 		return 1;
 	}
+	catch (Pub_Exception &e)
+	{
+		Console::Err("%s: %s", e.what(), e.error());
+		return 1;
+	}
 	catch (std::runtime_error &e)
 	{
 		Console::Err("Runtime Error: %s", e.what());
@@ -20,12 +20,16 @@
 #include "world.hpp"
 
 #include "console.hpp"
+#include "perf.hpp"
 #include "util.hpp"
 #include "util/rpn.hpp"
 
 #include <algorithm>
+#include <climits>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iterator>
 #include <list>
 #include <memory>
@@ -36,15 +40,13 @@
 #include <utility>
 #include <vector>
 
-static const char *map_safe_fail_filename;
-
-static void map_safe_fail(int line)
+static std::string map_safe_fail(const std::string& filename, int line)
 {
-	Console::Err("Invalid file / failed read/seek: %s -- %i", map_safe_fail_filename, line);
+	return "Invalid file / failed read/seek: " + filename + " -- " + util::to_string(line);
 }
 
-#define SAFE_SEEK(fh, offset, from) if (std::fseek(fh, offset, from) != 0) { std::fclose(fh); map_safe_fail(__LINE__); return false; }
-#define SAFE_READ(buf, size, count, fh) if (std::fread(buf, size, count, fh) != static_cast<int>(count)) {  std::fclose(fh); map_safe_fail(__LINE__);return false; }
+#define SAFE_SEEK(fh, offset, from) if (std::fseek(fh, offset, from) != 0) { std::fclose(fh); error = map_safe_fail(filename, __LINE__); return false; }
+#define SAFE_READ(buf, size, count, fh) if (std::fread(buf, size, count, fh) != static_cast<int>(count)) { std::fclose(fh); error = map_safe_fail(filename, __LINE__); return false; }
 
 void map_spawn_chests(void *map_void)
 {
@@ -83,7 +85,7 @@ void map_spawn_chests(void *map_void)
 		{
 			if (!slot_spawns.empty())
 			{
-				const Map_Chest_Spawn& spawn = *std::next(slot_spawns.cbegin(), util::rand(0, slot_spawns.size() - 1));
+				const Map_Chest_Spawn& spawn = *std::next(slot_spawns.cbegin(), map->rng.range(0, slot_spawns.size() - 1));
 
 				chest->AddItem(spawn.item.id, spawn.item.amount, spawn.slot);
 				needs_update = true;
@@ -337,18 +339,66 @@ Map::Map(int id, World *world)
 {
 	this->id = id;
 	this->world = world;
+
+	Map_File file;
+	std::string error;
+	bool loaded = false;
+
+	if (id >= 0)
+	{
+		loaded = file.Read(Map::Filename(world, id), id, error);
+
+		if (!loaded && !error.empty())
+			Console::Err("%s", error.c_str());
+	}
+
+	this->Initialize(loaded ? &file : nullptr);
+}
+
+Map::Map(int id, World *world, const Map_File *file)
+{
+	this->id = id;
+	this->world = world;
+
+	this->Initialize(file);
+}
+
+std::string Map::Filename(World *world, int id)
+{
+	char namebuf[6];
+
+	std::string filename = world->config["MapDir"];
+	std::snprintf(namebuf, sizeof namebuf, "%05i", id);
+	filename.append(namebuf);
+	filename.append(".emf");
+
+	return filename;
+}
+
+void Map::Initialize(const Map_File *file)
+{
 	this->exists = false;
 	this->jukebox_protect = 0.0;
 	this->arena = 0;
 	this->evacuate_lock = false;
 	this->has_timed_spikes = false;
+	this->boss_npc = nullptr;
+	this->dormant = true;
+	this->dormant_since = Timer::GetTime();
+	this->empty_since = this->dormant_since;
+	this->rng.seed(util::rng::stream_seed(Map::RNGStream + this->id));
 
 	this->LoadArena();
 
-	this->Load();
+	if (file)
+		this->Load(*file);
+
+	if (this->world->dormant_map_time <= 0.0)
+		this->Wake();
 
 	if (!this->chests.empty())
 	{
+		PERF_NAME_TIMER(map_spawn_chests);
 		TimeEvent *event = new TimeEvent(map_spawn_chests, this, 60.0, Timer::FOREVER);
 		this->world->timer.Register(event);
 	}
@@ -439,22 +489,8 @@ void Map::LoadArena()
 	}
 }
 
-bool Map::Load()
+bool Map_File::Read(const std::string &filename, short id, std::string &error)
 {
-	char namebuf[6];
-
-	if (this->id < 0)
-	{
-		return false;
-	}
-
-	std::string filename = this->world->config["MapDir"];
-	std::sprintf(namebuf, "%05i", this->id);
-	filename.append(namebuf);
-	filename.append(".emf");
-
-	map_safe_fail_filename = filename.c_str();
-
 	std::FILE *fh = std::fopen(filename.c_str(), "rb");
 
 	if (!fh)
@@ -472,7 +508,7 @@ bool Map::Load()
 	SAFE_SEEK(fh, 0x1F, SEEK_SET);
 	SAFE_READ(buf, sizeof(char), 2, fh);
 	this->pk = PacketProcessor::Number(buf[0]) == 3;
-	this->effect = static_cast<EffectType>(PacketProcessor::Number(buf[1]));
+	this->effect = static_cast<Map::EffectType>(PacketProcessor::Number(buf[1]));
 
 	SAFE_SEEK(fh, 0x25, SEEK_SET);
 	SAFE_READ(buf, sizeof(char), 2, fh);
@@ -522,23 +558,17 @@ bool Map::Load()
 			unsigned char xloc = PacketProcessor::Number(buf[0]);
 			unsigned char spec = PacketProcessor::Number(buf[1]);
 
-			if (!this->InBounds(xloc, yloc))
+			if (xloc >= this->width || yloc >= this->height)
 			{
-				Console::Wrn("Tile spec on map %i is outside of map bounds (%ix%i)", this->id, xloc, yloc);
+				Console::Wrn("Tile spec on map %i is outside of map bounds (%ix%i)", id, xloc, yloc);
 				continue;
 			}
 
-			this->GetTile(xloc, yloc).tilespec = static_cast<Map_Tile::TileSpec>(spec);
+			this->tiles[yloc * this->width + xloc].tilespec = static_cast<Map_Tile::TileSpec>(spec);
 
 			if (spec == Map_Tile::Chest)
 			{
-				Map_Chest chest;
-				chest.maxchest = static_cast<int>(this->world->config["MaxChest"]);
-				chest.chestslots = static_cast<int>(this->world->config["ChestSlots"]);
-				chest.x = xloc;
-				chest.y = yloc;
-				chest.slots = 0;
-				this->chests.push_back(std::make_shared<Map_Chest>(chest));
+				this->chests.push_back({xloc, yloc});
 			}
 
 			if (spec == Map_Tile::Spikes1)
@@ -566,113 +596,155 @@ bool Map::Load()
 			newwarp.levelreq = PacketProcessor::Number(buf[5]);
 			newwarp.spec = static_cast<Map_Warp::WarpSpec>(PacketProcessor::Number(buf[6], buf[7]));
 
-			if (!this->InBounds(xloc, yloc))
+			if (xloc >= this->width || yloc >= this->height)
 			{
-				Console::Wrn("Warp on map %i is outside of map bounds (%ix%i)", this->id, xloc, yloc);
+				Console::Wrn("Warp on map %i is outside of map bounds (%ix%i)", id, xloc, yloc);
 				continue;
 			}
 
-			try
-			{
-				this->GetTile(xloc, yloc).warp = newwarp;
-			}
-			catch (...)
-			{
-				std::fclose(fh);
-				map_safe_fail(__LINE__);
-				return false;
-			}
+			this->tiles[yloc * this->width + xloc].warp = newwarp;
 		}
 	}
 
 	SAFE_SEEK(fh, 0x2E, SEEK_SET);
 	SAFE_READ(buf, sizeof(char), 1, fh);
 	outersize = PacketProcessor::Number(buf[0]);
-	int index = 0;
 	for (int i = 0; i < outersize; ++i)
 	{
 		SAFE_READ(buf, sizeof(char), 8, fh);
-		unsigned char x = PacketProcessor::Number(buf[0]);
-		unsigned char y = PacketProcessor::Number(buf[1]);
-		short npc_id = PacketProcessor::Number(buf[2], buf[3]);
-		unsigned char spawntype = PacketProcessor::Number(buf[4]);
-		short spawntime = PacketProcessor::Number(buf[5], buf[6]);
-		unsigned char amount = PacketProcessor::Number(buf[7]);
 
-		if (!this->world->enf->Get(npc_id))
+		NPC_Spawn spawn;
+		spawn.x = PacketProcessor::Number(buf[0]);
+		spawn.y = PacketProcessor::Number(buf[1]);
+		spawn.id = PacketProcessor::Number(buf[2], buf[3]);
+		spawn.spawntype = PacketProcessor::Number(buf[4]);
+		spawn.spawntime = PacketProcessor::Number(buf[5], buf[6]);
+		spawn.amount = PacketProcessor::Number(buf[7]);
+		this->npc_spawns.push_back(spawn);
+	}
+
+	SAFE_READ(buf, sizeof(char), 1, fh);
+	outersize = PacketProcessor::Number(buf[0]);
+	if (outersize)
+	{
+		SAFE_SEEK(fh, 4 * outersize, SEEK_CUR);
+	}
+
+	SAFE_READ(buf, sizeof(char), 1, fh);
+	outersize = PacketProcessor::Number(buf[0]);
+	for (int i = 0; i < outersize; ++i)
+	{
+		SAFE_READ(buf, sizeof(char), 12, fh);
+
+		Chest_Spawn spawn;
+		spawn.x = PacketProcessor::Number(buf[0]);
+		spawn.y = PacketProcessor::Number(buf[1]);
+		spawn.slot = PacketProcessor::Number(buf[4]);
+		spawn.item = PacketProcessor::Number(buf[5], buf[6]);
+		spawn.time = PacketProcessor::Number(buf[7], buf[8]);
+		spawn.amount = PacketProcessor::Number(buf[9], buf[10], buf[11]);
+		this->chest_spawns.push_back(spawn);
+	}
+
+	SAFE_SEEK(fh, 0x00, SEEK_END);
+	this->filesize = std::ftell(fh);
+
+	std::fclose(fh);
+
+	return true;
+}
+
+void Map::Load(const Map_File &file)
+{
+	std::memcpy(this->rid, file.rid, sizeof this->rid);
+	this->pk = file.pk;
+	this->effect = file.effect;
+	this->filesize = file.filesize;
+	this->width = file.width;
+	this->height = file.height;
+	this->scroll = file.scroll;
+	this->relog_x = file.relog_x;
+	this->relog_y = file.relog_y;
+	this->has_timed_spikes = file.has_timed_spikes;
+
+	this->tiles = file.tiles;
+
+	UTIL_FOREACH(file.chests, position)
+	{
+		Map_Chest chest;
+		chest.maxchest = static_cast<int>(this->world->config["MaxChest"]);
+		chest.chestslots = static_cast<int>(this->world->config["ChestSlots"]);
+		chest.x = position.first;
+		chest.y = position.second;
+		chest.slots = 0;
+		this->chests.push_back(std::make_shared<Map_Chest>(chest));
+	}
+
+	int index = 0;
+
+	UTIL_FOREACH(file.npc_spawns, spawn)
+	{
+		if (!this->world->enf->Get(spawn.id))
 		{
-			Console::Wrn("An NPC spawn on map %i uses a non-existent NPC (#%i at %ix%i)", this->id, npc_id, x, y);
+			Console::Wrn("An NPC spawn on map %i uses a non-existent NPC (#%i at %ix%i)", this->id, spawn.id, spawn.x, spawn.y);
 		}
 
-		for (int ii = 0; ii < amount; ++ii)
+		for (int ii = 0; ii < spawn.amount; ++ii)
 		{
-			if (!this->InBounds(x, y))
+			if (!this->InBounds(spawn.x, spawn.y))
 			{
-				Console::Wrn("An NPC spawn on map %i is outside of map bounds (%s at %ix%i)", this->id, this->world->enf->Get(npc_id).name.c_str(), x, y);
+				Console::Wrn("An NPC spawn on map %i is outside of map bounds (%s at %ix%i)", this->id, this->world->enf->Get(spawn.id).name.c_str(), spawn.x, spawn.y);
 				continue;
 			}
 
-			NPC *newnpc = new NPC(this, npc_id, x, y, spawntype, spawntime, index++);
-			this->npcs.push_back(newnpc);
+			NPC *newnpc = new NPC(this, spawn.id, spawn.x, spawn.y, spawn.spawntype, spawn.spawntime, index++);
+			this->AppendNPC(newnpc);
 
 			newnpc->Spawn();
 		}
 	}
 
-	SAFE_READ(buf, sizeof(char), 1, fh);
-	outersize = PacketProcessor::Number(buf[0]);
-	if (outersize)
+	this->IndexBossNPCs();
+
+	// Children spawned before their boss was loaded
+	UTIL_FOREACH(this->child_npcs, npc)
 	{
-		SAFE_SEEK(fh, 4 * outersize, SEEK_CUR);
+		if (!npc->parent)
+			npc->parent = this->boss_npc;
 	}
 
-	SAFE_READ(buf, sizeof(char), 1, fh);
-	outersize = PacketProcessor::Number(buf[0]);
-	for (int i = 0; i < outersize; ++i)
+	UTIL_FOREACH(file.chest_spawns, spawn)
 	{
-		SAFE_READ(buf, sizeof(char), 12, fh);
-		unsigned char x = PacketProcessor::Number(buf[0]);
-		unsigned char y = PacketProcessor::Number(buf[1]);
-		short slot = PacketProcessor::Number(buf[4]);
-		short itemid = PacketProcessor::Number(buf[5], buf[6]);
-		short time = PacketProcessor::Number(buf[7], buf[8]);
-		int amount = PacketProcessor::Number(buf[9], buf[10], buf[11]);
-
-		if (itemid != this->world->eif->Get(itemid).id)
+		if (spawn.item != this->world->eif->Get(spawn.item).id)
 		{
-			Console::Wrn("A chest spawn on map %i uses a non-existent item (#%i at %ix%i)", this->id, itemid, x, y);
+			Console::Wrn("A chest spawn on map %i uses a non-existent item (#%i at %ix%i)", this->id, spawn.item, spawn.x, spawn.y);
 		}
 
 		UTIL_FOREACH(this->chests, chest)
 		{
-			if (chest->x == x && chest->y == y)
+			if (chest->x == spawn.x && chest->y == spawn.y)
 			{
-				Map_Chest_Spawn spawn;
+				Map_Chest_Spawn chest_spawn;
 
-				spawn.slot = slot+1;
-				spawn.time = time;
-				spawn.last_taken = Timer::GetTime();
-				spawn.item.id = itemid;
-				spawn.item.amount = amount;
+				chest_spawn.slot = spawn.slot+1;
+				chest_spawn.time = spawn.time;
+				chest_spawn.last_taken = Timer::GetTime();
+				chest_spawn.item.id = spawn.item;
+				chest_spawn.item.amount = spawn.amount;
 
-				chest->spawns.push_back(spawn);
-				chest->slots = std::max(chest->slots, slot+1);
+				chest->spawns.push_back(chest_spawn);
+				chest->slots = std::max(chest->slots, spawn.slot+1);
 				goto skip_warning;
 			}
 		}
-		Console::Wrn("A chest spawn on map %i points to a non-chest (%s x%i at %ix%i)", this->id, this->world->eif->Get(itemid).name.c_str(), amount, x, y);
+		Console::Wrn("A chest spawn on map %i points to a non-chest (%s x%i at %ix%i)", this->id, this->world->eif->Get(spawn.item).name.c_str(), spawn.amount, spawn.x, spawn.y);
 		skip_warning:
 		;
 	}
 
-	SAFE_SEEK(fh, 0x00, SEEK_END);
-	this->filesize = std::ftell(fh);
-
-	std::fclose(fh);
+	this->IndexSuckWarps();
 
 	this->exists = true;
-
-	return true;
 }
 
 void Map::Unload()
@@ -691,6 +763,11 @@ void Map::Unload()
 	}
 
 	this->npcs.clear();
+	this->npc_columns.resize(0);
+	this->act_queue.clear();
+	this->spawn_queue.clear();
+	this->child_npcs.clear();
+	this->boss_npc = nullptr;
 
 	if (this->arena)
 	{
@@ -704,40 +781,258 @@ void Map::Unload()
 
 	this->chests.clear();
 	this->tiles.clear();
+	this->warp_suck_tiles.clear();
 }
 
-int Map::GenerateItemID() const
+unsigned char Map::GenerateNPCIndex() const
 {
-	int lowest_free_id = 1;
+	unsigned char lowest_free_id = 1;
 	restart_loop:
-	UTIL_FOREACH(this->items, item)
+	UTIL_FOREACH(this->npcs, npc)
 	{
-		if (item->uid == lowest_free_id)
+		if (npc->index == lowest_free_id)
 		{
-			lowest_free_id = item->uid + 1;
+			lowest_free_id = npc->index + 1;
 			goto restart_loop;
 		}
 	}
 	return lowest_free_id;
 }
 
-unsigned char Map::GenerateNPCIndex() const
+void Map::Sleep()
 {
-	unsigned char lowest_free_id = 1;
-	restart_loop:
+	if (this->dormant)
+		return;
+
+	this->dormant = true;
+	this->dormant_since = Timer::GetTime();
+
+	std::vector<Map *> &awake_maps = this->world->awake_maps;
+	auto it = std::find(UTIL_RANGE(awake_maps), this);
+
+	if (it != awake_maps.end())
+	{
+		*it = awake_maps.back();
+		awake_maps.pop_back();
+	}
+}
+
+void Map::Wake()
+{
+	if (!this->dormant)
+		return;
+
+	this->dormant = false;
+	this->world->awake_maps.push_back(this);
+
+	double current_time = Timer::GetTime();
+	double elapsed = current_time - this->dormant_since;
+
+	double recover_speed = this->world->config["NPCRecoverSpeed"];
+	double recover_rate = this->world->config["NPCRecoverRate"];
+	long long recover_ticks = (recover_speed > 0.0) ? static_cast<long long>(elapsed / recover_speed) : 0;
+
 	UTIL_FOREACH(this->npcs, npc)
 	{
-		if (npc->index == lowest_free_id)
+		if (!npc->alive)
+			continue;
+
+		// Each world_npc_recover tick adds the same truncated amount, so the missed ticks can be added at once
+		if (recover_ticks > 0 && npc->hp < npc->ENF().hp)
 		{
-			lowest_free_id = npc->index + 1;
-			goto restart_loop;
+			long long recovered = recover_ticks * static_cast<long long>(npc->ENF().hp * recover_rate);
+			npc->hp = static_cast<int>(std::min<long long>(npc->hp + recovered, npc->ENF().hp));
+		}
+
+		// Anything that would have wandered is somewhere around its spawn point by now
+		if (!npc->temporary && npc->spawn_type < 7 && elapsed >= npc->act_speed)
+		{
+			npc->alive = false;
+			this->SyncNPC(npc);
+			npc->Place();
+			npc->alive = true;
+		}
+
+		this->SyncNPC(npc);
+
+		npc->last_act = current_time;
+		this->act_queue.push(npc, npc->last_act + npc->act_speed);
+	}
+
+	this->SpawnNPCs(current_time);
+}
+
+void Map::SpawnNPCs(double current_time)
+{
+	bool respawn_children = this->world->config["RespawnBossChildren"];
+
+	while (!this->spawn_queue.empty() && this->spawn_queue.top_deadline() < current_time)
+	{
+		NPC *npc = this->spawn_queue.pop();
+
+		// A child that can't come back on its own waits for its boss, which spawns all of its children
+		if (npc->ENF().child && !(npc->parent && npc->parent->alive && respawn_children))
+			continue;
+
+#ifdef DEBUG
+		Console::Dbg("Spawning NPC %i on map %i", npc->id, this->id);
+#endif // DEBUG
+		npc->Spawn();
+	}
+}
+
+void Map::ActNPCs(double current_time)
+{
+	thread_local std::vector<NPC *> due;
+
+	// Collected first, since Act() queues each NPC again
+	while (!this->act_queue.empty() && this->act_queue.top_deadline() < current_time)
+	{
+		due.push_back(this->act_queue.pop());
+	}
+
+	UTIL_FOREACH(due, npc)
+	{
+		npc->Act();
+	}
+
+	due.clear();
+}
+
+void Map::RescheduleRespawns()
+{
+	UTIL_FOREACH(this->npcs, npc)
+	{
+		if (this->spawn_queue.contains(npc))
+			npc->QueueRespawn();
+	}
+}
+
+void Map::AppendNPC(NPC *npc)
+{
+	npc->column = this->npcs.size();
+	this->npcs.push_back(npc);
+	this->npc_columns.resize(this->npcs.size());
+	this->SyncNPC(npc);
+}
+
+void Map::AddNPC(NPC *npc)
+{
+	this->AppendNPC(npc);
+
+	if (npc->ENF().child || npc->ENF().boss)
+		this->IndexBossNPCs();
+}
+
+void Map::RemoveNPC(NPC *npc)
+{
+	auto it = std::find(UTIL_RANGE(this->npcs), npc);
+
+	if (it != this->npcs.end())
+	{
+		std::size_t i = it - this->npcs.begin();
+
+		this->npcs.erase(it);
+		this->npc_columns.erase(i);
+
+		for (; i < this->npcs.size(); ++i)
+			this->npcs[i]->column = i;
+
+		npc->column = std::size_t(-1);
+	}
+
+	this->act_queue.erase(npc);
+	this->spawn_queue.erase(npc);
+
+	if (npc == this->boss_npc || npc->ENF().child)
+		this->IndexBossNPCs();
+
+	UTIL_FOREACH(this->npcs, other)
+	{
+		if (other->parent == npc)
+			other->parent = nullptr;
+	}
+}
+
+void Map::SyncNPC(const NPC *npc)
+{
+	std::size_t i = npc->column;
+
+	// Not on the map's list yet, AppendNPC() copies everything when it is
+	if (i >= this->npcs.size() || this->npcs[i] != npc)
+		return;
+
+	this->npc_columns.alive[i] = npc->alive;
+	this->npc_columns.x[i] = npc->x;
+	this->npc_columns.y[i] = npc->y;
+	this->npc_columns.hp[i] = npc->hp;
+	this->npc_columns.max_hp[i] = npc->ENF().hp;
+}
+
+void Map::RecoverNPCs(double rate)
+{
+	Map_NPC_Columns &columns = this->npc_columns;
+
+	for (std::size_t i = 0; i < columns.size(); ++i)
+	{
+		if (columns.alive[i] && columns.hp[i] < columns.max_hp[i])
+		{
+			columns.hp[i] = std::min(columns.hp[i] + int(columns.max_hp[i] * rate), columns.max_hp[i]);
+			this->npcs[i]->hp = columns.hp[i];
+		}
+	}
+}
+
+void Map::IndexBossNPCs()
+{
+	this->child_npcs.clear();
+	this->boss_npc = nullptr;
+
+	UTIL_FOREACH(this->npcs, npc)
+	{
+		if (npc->ENF().child)
+			this->child_npcs.push_back(npc);
+
+		if (npc->ENF().boss && !this->boss_npc)
+			this->boss_npc = npc;
+	}
+}
+
+void Map::IndexSuckWarps()
+{
+	this->warp_suck_tiles.assign(std::size_t(this->width) * this->height, false);
+
+	for (int y = 0; y < this->height; ++y)
+	{
+		for (int x = 0; x < this->width; ++x)
+		{
+			const Map_Warp &warp = this->GetWarp(x, y);
+
+			// Locked doors never pull anyone in
+			if (!warp || (warp.spec != Map_Warp::Door && warp.spec != Map_Warp::NoDoor))
+				continue;
+
+			this->warp_suck_tiles[std::size_t(y) * this->width + x] = true;
+
+			if (x > 0)
+				this->warp_suck_tiles[std::size_t(y) * this->width + x - 1] = true;
+
+			if (x + 1 < this->width)
+				this->warp_suck_tiles[std::size_t(y) * this->width + x + 1] = true;
+
+			if (y > 0)
+				this->warp_suck_tiles[std::size_t(y - 1) * this->width + x] = true;
+
+			if (y + 1 < this->height)
+				this->warp_suck_tiles[std::size_t(y + 1) * this->width + x] = true;
 		}
 	}
-	return lowest_free_id;
 }
 
 void Map::Enter(Character *character, WarpAnimation animation)
 {
+	this->Wake();
+
 	this->characters.push_back(character);
 	character->map = this;
 	character->last_walk = Timer::GetTime();
@@ -814,6 +1109,9 @@ void Map::Leave(Character *character, WarpAnimation animation, bool silent)
 		this->characters.end()
 	);
 
+	if (this->characters.empty())
+		this->empty_since = Timer::GetTime();
+
 	character->map = 0;
 }
 
@@ -1041,22 +1339,27 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 		}
 	}
 
-	UTIL_FOREACH(this->npcs, checknpc)
+	const Map_NPC_Columns &columns = this->npc_columns;
+
+	for (std::size_t n = 0; n < columns.size(); ++n)
 	{
-		if (!checknpc->alive)
+		// Only NPCs on the edge of the view can have come in to or gone out of it
+		int distance = util::path_length(from->x, from->y, columns.x[n], columns.y[n]);
+
+		if (!columns.alive[n] || (distance != seedistance && distance != seedistance + 1))
 		{
 			continue;
 		}
 
 		for (std::size_t i = 0; i < oldcoords.size(); ++i)
 		{
-			if (checknpc->x == oldcoords[i].first && checknpc->y == oldcoords[i].second)
+			if (columns.x[n] == oldcoords[i].first && columns.y[n] == oldcoords[i].second)
 			{
-				oldnpcs.push_back(checknpc);
+				oldnpcs.push_back(this->npcs[n]);
 			}
-			else if (checknpc->x == newcoords[i].first && checknpc->y == newcoords[i].second)
+			else if (columns.x[n] == newcoords[i].first && columns.y[n] == newcoords[i].second)
 			{
-				newnpcs.push_back(checknpc);
+				newnpcs.push_back(this->npcs[n]);
 			}
 		}
 	}
@@ -1279,6 +1582,7 @@ Map::WalkResult Map::Walk(NPC *from, Direction direction)
 
 	from->x = target_x;
 	from->y = target_y;
+	this->SyncNPC(from);
 
 	int newx;
 	int newy;
@@ -1499,8 +1803,8 @@ void Map::Attack(Character *from, Direction direction)
 			if ((npc->ENF().type == ENF::Passive || npc->ENF().type == ENF::Aggressive || from->SourceDutyAccess() >= static_cast<int>(this->world->admin_config["killnpc"]))
 			 && npc->alive && npc->x == target_x && npc->y == target_y)
 			{
-				int amount = util::rand(from->mindam, from->maxdam);
-				double rand = util::rand(0.0, 1.0);
+				int amount = this->rng.range(from->mindam, from->maxdam);
+				double rand = this->rng.range(0.0, 1.0);
 				// Checks if target is facing you
 				bool critical = std::abs(int(npc->direction) - from->direction) != 2 || rand < static_cast<double>(this->world->config["CriticalRate"]);
 
@@ -1588,8 +1892,8 @@ bool Map::AttackPK(Character *from, Direction direction)
 		{
 			if (character->mapid == this->id && !character->nowhere && character->x == target_x && character->y == target_y)
 			{
-				int amount = util::rand(from->mindam, from->maxdam);
-				double rand = util::rand(0.0, 1.0);
+				int amount = this->rng.range(from->mindam, from->maxdam);
+				double rand = this->rng.range(0.0, 1.0);
 				// Checks if target is facing you
 				bool critical = std::abs(int(character->direction) - from->direction) != 2 || rand < static_cast<double>(this->world->config["CriticalRate"]);
 
@@ -1785,9 +2089,21 @@ bool Map::Occupied(unsigned char x, unsigned char y, Map::OccupiedTarget target,
 
 	if (target != Map::PlayerOnly)
 	{
-		UTIL_FOREACH(this->npcs, npc)
+		const Map_NPC_Columns &columns = this->npc_columns;
+		const std::size_t size = columns.size();
+
+		// Checked a block at a time without branching, so the compiler can vectorize it
+		for (std::size_t start = 0; start < size; start += 64)
 		{
-			if (npc->alive && npc->x == x && npc->y == y)
+			const std::size_t end = std::min(start + 64, size);
+			unsigned char found = 0;
+
+			for (std::size_t i = start; i < end; ++i)
+			{
+				found |= columns.alive[i] & (columns.x[i] == x) & (columns.y[i] == y);
+			}
+
+			if (found)
 			{
 				return true;
 			}
@@ -1844,6 +2160,7 @@ bool Map::OpenDoor(Character *from, unsigned char x, unsigned char y)
 		close->x = x;
 		close->y = y;
 
+		PERF_NAME_TIMER(map_close_door);
 		TimeEvent *event = new TimeEvent(map_close_door, close, this->world->config["DoorTimer"], 1);
 		this->world->timer.Register(event);
 
@@ -1922,8 +2239,8 @@ void Map::SpellAttack(Character *from, NPC *npc, unsigned short spell_id)
 	{
 		from->tp -= spell.tp;
 
-		int amount = util::rand(from->mindam + spell.mindam, from->maxdam + spell.maxdam);
-		double rand = util::rand(0.0, 1.0);
+		int amount = this->rng.range(from->mindam + spell.mindam, from->maxdam + spell.maxdam);
+		double rand = this->rng.range(0.0, 1.0);
 
 		bool critical = rand < static_cast<double>(this->world->config["CriticalRate"]);
 
@@ -1971,8 +2288,8 @@ void Map::SpellAttackPK(Character *from, Character *victim, unsigned short spell
 
 		from->tp -= spell.tp;
 
-		int amount = util::rand(from->mindam + spell.mindam, from->maxdam + spell.maxdam);
-		double rand = util::rand(0.0, 1.0);
+		int amount = this->rng.range(from->mindam + spell.mindam, from->maxdam + spell.maxdam);
+		double rand = this->rng.range(0.0, 1.0);
 
 		bool critical = rand < static_cast<double>(this->world->config["CriticalRate"]);
 
@@ -2166,29 +2483,30 @@ void Map::SpellGroup(Character *from, unsigned short spell_id)
 
 std::shared_ptr<Map_Item> Map::AddItem(short id, int amount, unsigned char x, unsigned char y, Character *from)
 {
-	std::shared_ptr<Map_Item> newitem(std::make_shared<Map_Item>(0, id, amount, x, y, 0, 0));
-
 	if (from || (from && from->SourceAccess() <= ADMIN_GM))
 	{
 		int ontile = 0;
-		int onmap = 0;
 
 		UTIL_FOREACH(this->items, item)
 		{
-			++onmap;
 			if (item->x == x && item->y == y)
 			{
 				++ontile;
 			}
 		}
 
-		if (ontile >= static_cast<int>(this->world->config["MaxTile"]) || onmap >= static_cast<int>(this->world->config["MaxMap"]))
+		if (ontile >= static_cast<int>(this->world->config["MaxTile"]) || this->items.size() >= static_cast<std::size_t>(static_cast<int>(this->world->config["MaxMap"])))
 		{
-			return newitem;
+			return std::make_shared<Map_Item>(0, id, amount, x, y, 0, 0);
 		}
 	}
 
-	newitem->uid = GenerateItemID();
+	std::shared_ptr<Map_Item> newitem = this->InsertItem(id, amount, x, y, 0, 0);
+
+	if (!newitem)
+	{
+		return std::make_shared<Map_Item>(0, id, amount, x, y, 0, 0);
+	}
 
 	PacketBuilder builder(PACKET_ITEM, PACKET_ADD, 9);
 	builder.AddShort(id);
@@ -2207,56 +2525,96 @@ std::shared_ptr<Map_Item> Map::AddItem(short id, int amount, unsigned char x, un
 		character->Send(builder);
 	}
 
+	return newitem;
+}
+
+std::shared_ptr<Map_Item> Map::InsertItem(short id, int amount, unsigned char x, unsigned char y, unsigned int owner, double unprotecttime)
+{
+	short uid;
+
+	if (!this->free_item_uids.empty())
+	{
+		uid = this->free_item_uids.back();
+		this->free_item_uids.pop_back();
+	}
+	else if (this->item_index.size() < std::size_t(SHRT_MAX))
+	{
+		this->item_index.push_back(item_expiry_queue_type::npos);
+		uid = short(this->item_index.size());
+	}
+	else
+	{
+		return std::shared_ptr<Map_Item>();
+	}
+
+	std::shared_ptr<Map_Item> newitem(std::make_shared<Map_Item>(uid, id, amount, x, y, owner, unprotecttime));
+
+	this->item_index[uid - 1] = this->items.size();
 	this->items.push_back(newitem);
+	this->item_expiry.push(newitem.get(), unprotecttime);
+
 	return newitem;
 }
 
+void Map::ProtectItem(Map_Item &item, unsigned int owner, double unprotecttime)
+{
+	item.owner = owner;
+	item.unprotecttime = unprotecttime;
+
+	// AddItem hands back an unlisted item when the map is full
+	if (item_expiry_queue_type::contains(&item))
+		this->item_expiry.push(&item, unprotecttime);
+}
+
+void Map::DespawnItems(double before)
+{
+	while (!this->item_expiry.empty() && this->item_expiry.top_deadline() < before)
+	{
+		std::size_t i = this->item_index[this->item_expiry.top()->uid - 1];
+		this->RemoveItem(i, 0);
+	}
+}
+
 std::shared_ptr<Map_Item> Map::GetItem(short uid)
 {
-	UTIL_FOREACH(this->items, item)
+	if (uid <= 0 || std::size_t(uid) > this->item_index.size() || this->item_index[uid - 1] == item_expiry_queue_type::npos)
 	{
-		if (item->uid == uid)
-		{
-			return item;
-		}
+		return std::shared_ptr<Map_Item>();
 	}
 
-	return std::shared_ptr<Map_Item>();
+	return this->items[this->item_index[uid - 1]];
 }
 
 std::shared_ptr<const Map_Item> Map::GetItem(short uid) const
 {
-	UTIL_FOREACH(this->items, item)
+	if (uid <= 0 || std::size_t(uid) > this->item_index.size() || this->item_index[uid - 1] == item_expiry_queue_type::npos)
 	{
-		if (item->uid == uid)
-		{
-			return item;
-		}
+		return std::shared_ptr<const Map_Item>();
 	}
 
-	return std::shared_ptr<Map_Item>();
+	return this->items[this->item_index[uid - 1]];
 }
 
 void Map::DelItem(short uid, Character *from)
 {
-	UTIL_IFOREACH(this->items, it)
+	if (uid <= 0 || std::size_t(uid) > this->item_index.size() || this->item_index[uid - 1] == item_expiry_queue_type::npos)
 	{
-		if ((*it)->uid == uid)
-		{
-			this->DelItem(it, from);
-			break;
-		}
+		return;
 	}
+
+	this->RemoveItem(this->item_index[uid - 1], from);
 }
 
-std::list<std::shared_ptr<Map_Item>>::iterator Map::DelItem(std::list<std::shared_ptr<Map_Item>>::iterator it, Character *from)
+void Map::RemoveItem(std::size_t i, Character *from)
 {
+	std::shared_ptr<Map_Item> item = this->items[i];
+
 	PacketBuilder builder(PACKET_ITEM, PACKET_REMOVE, 2);
-	builder.AddShort((*it)->uid);
+	builder.AddShort(item->uid);
 
 	UTIL_FOREACH(this->characters, character)
 	{
-		if ((from && character == from) || !character->InRange(**it))
+		if ((from && character == from) || !character->InRange(*item))
 		{
 			continue;
 		}
@@ -2264,7 +2622,18 @@ std::list<std::shared_ptr<Map_Item>>::iterator Map::DelItem(std::list<std::share
 		character->Send(builder);
 	}
 
-	return this->items.erase(it);
+	this->item_expiry.erase(item.get());
+
+	// Fill the gap with the last item so removal doesn't shift the rest
+	if (i + 1 != this->items.size())
+	{
+		this->items[i] = std::move(this->items.back());
+		this->item_index[this->items[i]->uid - 1] = i;
+	}
+
+	this->items.pop_back();
+	this->item_index[item->uid - 1] = item_expiry_queue_type::npos;
+	this->free_item_uids.push_back(item->uid);
 }
 
 void Map::DelSomeItem(short uid, int amount, Character *from)
@@ -2272,51 +2641,48 @@ void Map::DelSomeItem(short uid, int amount, Character *from)
 	if (amount < 0)
 		return;
 
-	UTIL_IFOREACH(this->items, it)
-	{
-		if ((*it)->uid == uid)
-		{
-			if (amount < (*it)->amount)
-			{
-				(*it)->amount -= amount;
-
-				PacketBuilder builder(PACKET_ITEM, PACKET_REMOVE, 2);
-				builder.AddShort((*it)->uid);
-
-				UTIL_FOREACH(this->characters, character)
-				{
-					if ((from && character == from) || !character->InRange(**it))
-					{
-						continue;
-					}
+	std::shared_ptr<Map_Item> item = this->GetItem(uid);
 
-					character->Send(builder);
-				}
+	if (!item)
+		return;
 
-				builder.Reset(9);
-				builder.SetID(PACKET_ITEM, PACKET_ADD);
-				builder.AddShort((*it)->id);
-				builder.AddShort((*it)->uid);
-				builder.AddThree((*it)->amount);
-				builder.AddChar((*it)->x);
-				builder.AddChar((*it)->y);
+	if (amount < item->amount)
+	{
+		item->amount -= amount;
 
-				UTIL_FOREACH(this->characters, character)
-				{
-					if (!character->InRange(**it))
-						continue;
+		PacketBuilder builder(PACKET_ITEM, PACKET_REMOVE, 2);
+		builder.AddShort(item->uid);
 
-					character->Send(builder);
-				}
-			}
-			else
+		UTIL_FOREACH(this->characters, character)
+		{
+			if ((from && character == from) || !character->InRange(*item))
 			{
-				this->DelItem(it, from);
+				continue;
 			}
 
-			break;
+			character->Send(builder);
+		}
+
+		builder.Reset(9);
+		builder.SetID(PACKET_ITEM, PACKET_ADD);
+		builder.AddShort(item->id);
+		builder.AddShort(item->uid);
+		builder.AddThree(item->amount);
+		builder.AddChar(item->x);
+		builder.AddChar(item->y);
+
+		UTIL_FOREACH(this->characters, character)
+		{
+			if (!character->InRange(*item))
+				continue;
+
+			character->Send(builder);
 		}
 	}
+	else
+	{
+		this->DelItem(uid, from);
+	}
 }
 
 bool Map::InBounds(unsigned char x, unsigned char y) const
@@ -2417,6 +2783,7 @@ bool Map::Evacuate()
 		evac->map = this;
 		evac->step = int(evac->map->world->config["EvacuateLength"]) / int(evac->map->world->config["EvacuateTick"]);
 
+		PERF_NAME_TIMER(map_evacuate);
 		TimeEvent *event = new TimeEvent(map_evacuate, evac, this->world->config["EvacuateTick"], evac->step);
 		this->world->timer.Register(event);
 
@@ -2429,43 +2796,17 @@ bool Map::Evacuate()
 	}
 }
 
-bool Map::Reload()
+bool Map::Reload(const Map_File &file)
 {
-	char namebuf[6];
-	char checkrid[4];
-
-	std::string filename = this->world->config["MapDir"];
-	std::sprintf(namebuf, "%05i", this->id);
-	filename.append(namebuf);
-	filename.append(".emf");
-
-	std::FILE *fh = std::fopen(filename.c_str(), "rb");
-
-	if (!fh)
+	if (this->exists && std::memcmp(this->rid, file.rid, sizeof this->rid) == 0)
 	{
-		Console::Err("Could not load file: %s", filename.c_str());
 		return false;
 	}
 
-	SAFE_SEEK(fh, 0x03, SEEK_SET);
-	SAFE_READ(checkrid, sizeof(char), 4, fh);
-
-	std::fclose(fh);
-
-	if (this->rid[0] == checkrid[0] && this->rid[1] == checkrid[1]
-	 && this->rid[2] == checkrid[2] && this->rid[3] == checkrid[3])
-	{
-		return true;
-	}
-
 	std::list<Character *> temp = this->characters;
 
 	this->Unload();
-
-	if (!this->Load())
-	{
-		return false;
-	}
+	this->Load(file);
 
 	this->characters = temp;
 
@@ -2475,8 +2816,6 @@ bool Map::Reload()
 		character->Refresh(); // TODO: Find a better way to reload NPCs
 	}
 
-	this->exists = true;
-
 	return true;
 }
 
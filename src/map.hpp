@@ -12,10 +12,17 @@
 #include "fwd/character.hpp"
 #include "fwd/npc.hpp"
 #include "fwd/world.hpp"
+#include "npc.hpp"
 
+#include "util/deadline_queue.hpp"
+#include "util/rng.hpp"
+
+#include <cstddef>
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -31,8 +38,13 @@ struct Map_Item
 	unsigned int owner; // Player ID
 	double unprotecttime;
 
+	/**
+	 * Position in the map's expiry queue, kept up to date by the queue
+	 */
+	std::size_t expiry_slot;
+
 	Map_Item(short uid_, short id_, int amount_, unsigned char x_, unsigned char y_, unsigned int owner_, double unprotecttime_)
-	 : uid(uid_), id(id_), amount(amount_), x(x_), y(y_), owner(owner_), unprotecttime(unprotecttime_) { }
+	 : uid(uid_), id(id_), amount(amount_), x(x_), y(y_), owner(owner_), unprotecttime(unprotecttime_), expiry_slot(std::size_t(-1)) { }
 };
 
 /**
@@ -201,15 +213,54 @@ struct Map_Chest
 	void Update(Map *map, Character *exclude = 0) const;
 };
 
+/**
+ * Copies of the NPC fields that are scanned across a whole map, one column per field in the same order as Map::npcs
+ * Scans read these instead of visiting each NPC, and Map::SyncNPC() keeps them up to date.
+ */
+struct Map_NPC_Columns
+{
+	std::vector<unsigned char> alive;
+	std::vector<unsigned char> x;
+	std::vector<unsigned char> y;
+	std::vector<int> hp;
+	std::vector<int> max_hp;
+
+	std::size_t size() const { return this->alive.size(); }
+
+	void resize(std::size_t size)
+	{
+		this->alive.resize(size);
+		this->x.resize(size);
+		this->y.resize(size);
+		this->hp.resize(size);
+		this->max_hp.resize(size);
+	}
+
+	void erase(std::size_t i)
+	{
+		this->alive.erase(this->alive.begin() + i);
+		this->x.erase(this->x.begin() + i);
+		this->y.erase(this->y.begin() + i);
+		this->hp.erase(this->hp.begin() + i);
+		this->max_hp.erase(this->max_hp.begin() + i);
+	}
+};
+
 /**
  * Contains all information about a map, holds reference to contained Characters and manages NPCs on it
  */
 class Map
 {
 	private:
-		bool Load();
+		void Initialize(const Map_File *file);
+
+		void Load(const Map_File &file);
 		void Unload();
 
+		void RemoveItem(std::size_t i, Character *from);
+
+		void AppendNPC(NPC *npc);
+
 	public:
 		enum WalkResult
 		{
@@ -242,23 +293,148 @@ class Map
 		unsigned char relog_y;
 		std::list<Character *> characters;
 		std::vector<NPC *> npcs;
+		Map_NPC_Columns npc_columns;
+
+		/**
+		 * Living NPCs by when they next act, and dead ones by when they respawn
+		 */
+		typedef util::deadline_queue<NPC, &NPC::act_slot> act_queue_type;
+		typedef util::deadline_queue<NPC, &NPC::spawn_slot> spawn_queue_type;
+
+		act_queue_type act_queue;
+		spawn_queue_type spawn_queue;
+
+		/**
+		 * NPCs that are a boss's children, and the boss they follow, kept up to date by IndexBossNPCs()
+		 */
+		std::vector<NPC *> child_npcs;
+		NPC *boss_npc;
 		std::vector<std::shared_ptr<Map_Chest>> chests;
-		std::list<std::shared_ptr<Map_Item>> items;
+
+		typedef util::deadline_queue<Map_Item, &Map_Item::expiry_slot> item_expiry_queue_type;
+
+		/**
+		 * Items on the floor in no particular order, add and remove them through the Map so the index stays valid
+		 */
+		std::vector<std::shared_ptr<Map_Item>> items;
+
+		/**
+		 * Position of each item in items by uid - 1 (or npos), with the uids that are free to reuse
+		 */
+		std::vector<std::size_t> item_index;
+		std::vector<short> free_item_uids;
+
+		/**
+		 * Items ordered by the time their protection ends, for despawning
+		 */
+		item_expiry_queue_type item_expiry;
+
 		std::vector<Map_Tile> tiles;
+
+		/**
+		 * Marks the tiles on or next to a warp that WarpSuck can pull characters through, built by IndexSuckWarps()
+		 */
+		std::vector<bool> warp_suck_tiles;
+
 		bool exists;
 		double jukebox_protect;
 		std::string jukebox_player;
 		bool evacuate_lock;
 		bool has_timed_spikes;
 
+		/**
+		 * Set once the map has been empty for DormantMapTime, NPCs and timed effects are suspended until Wake()
+		 */
+		bool dormant;
+		double dormant_since;
+		double empty_since;
+
+		/**
+		 * Generator for everything random that happens on the map, seeded per map so runs can be repeated
+		 */
+		util::rng rng;
+
+		/**
+		 * Offset of map IDs in the global seed's streams, keeping them clear of thread generators
+		 */
+		static const std::uint64_t RNGStream = std::uint64_t(1) << 62;
+
 		Arena *arena;
 
+		/**
+		 * Reads the map's file and builds the map from it
+		 */
 		Map(int id, World *world);
+
+		/**
+		 * Builds the map from a file already read by Map_File::Read(), or an empty map if file is null
+		 */
+		Map(int id, World *world, const Map_File *file);
+
+		static std::string Filename(World *world, int id);
+
 		void LoadArena();
 
-		int GenerateItemID() const;
 		unsigned char GenerateNPCIndex() const;
 
+		/**
+		 * Removes the map from World::awake_maps
+		 */
+		void Sleep();
+
+		/**
+		 * Returns a dormant map to World::awake_maps, catching its NPCs up on the time spent asleep
+		 */
+		void Wake();
+
+		/**
+		 * Respawns dead NPCs whose spawn time has passed
+		 */
+		void SpawnNPCs(double current_time);
+
+		/**
+		 * Runs Act() for every NPC that is due, at most once each
+		 */
+		void ActNPCs(double current_time);
+
+		/**
+		 * Moves every queued respawn to match the current SpawnRate
+		 */
+		void RescheduleRespawns();
+
+		void AddNPC(NPC *npc);
+
+		/**
+		 * Takes an NPC off the map, the caller is responsible for deleting it
+		 */
+		void RemoveNPC(NPC *npc);
+
+		/**
+		 * Copies an NPC's position, HP and whether it's alive in to npc_columns
+		 * Must be called after changing any of them.
+		 */
+		void SyncNPC(const NPC *npc);
+
+		/**
+		 * Adds rate times their max HP to every injured NPC
+		 */
+		void RecoverNPCs(double rate);
+
+		/**
+		 * Rebuilds child_npcs and boss_npc, which depend on the NPCs' pub file entries
+		 */
+		void IndexBossNPCs();
+
+		/**
+		 * Rebuilds warp_suck_tiles from the map's warps
+		 */
+		void IndexSuckWarps();
+
+		bool NearSuckWarp(unsigned char x, unsigned char y) const
+		{
+			return x < this->width && y < this->height && this->warp_suck_tiles[std::size_t(y) * this->width + x];
+		}
+
 		void Enter(Character *, WarpAnimation animation = WARP_ANIMATION_NONE);
 		void Leave(Character *, WarpAnimation animation = WARP_ANIMATION_NONE, bool silent = false);
 
@@ -288,7 +464,21 @@ class Map
 
 		void DelItem(short uid, Character *from = 0);
 		void DelSomeItem(short uid, int amount, Character *from = 0);
-		std::list<std::shared_ptr<Map_Item>>::iterator DelItem(std::list<std::shared_ptr<Map_Item>>::iterator it, Character *from = 0);
+
+		/**
+		 * Puts an item on the floor without telling anyone, returns nothing if every uid is in use
+		 */
+		std::shared_ptr<Map_Item> InsertItem(short id, int amount, unsigned char x, unsigned char y, unsigned int owner, double unprotecttime);
+
+		/**
+		 * Changes who may pick up an item and until when, the item must be on this map
+		 */
+		void ProtectItem(Map_Item &item, unsigned int owner, double unprotecttime);
+
+		/**
+		 * Removes every item whose protection ended before the given time
+		 */
+		void DespawnItems(double before);
 
 		bool InBounds(unsigned char x, unsigned char y) const;
 		bool Walkable(unsigned char x, unsigned char y, bool npc = false) const;
@@ -305,7 +495,11 @@ class Map
 
 		bool Evacuate();
 
-		bool Reload();
+		/**
+		 * Replaces the map with a new copy of its file, keeping the characters on it
+		 * @return false if the file hasn't changed
+		 */
+		bool Reload(const Map_File &file);
 
 		void TimedSpikes();
 		void TimedDrains();
@@ -327,4 +521,53 @@ class Map
 		~Map();
 };
 
+/**
+ * The contents of an EMF file, which doesn't depend on the world and so can be read on any thread
+ */
+struct Map_File
+{
+	struct NPC_Spawn
+	{
+		unsigned char x;
+		unsigned char y;
+		short id;
+		unsigned char spawntype;
+		short spawntime;
+		unsigned char amount;
+	};
+
+	struct Chest_Spawn
+	{
+		unsigned char x;
+		unsigned char y;
+		short slot;
+		short item;
+		short time;
+		int amount;
+	};
+
+	char rid[4];
+	bool pk;
+	Map::EffectType effect;
+	int filesize;
+	unsigned char width;
+	unsigned char height;
+	bool scroll;
+	unsigned char relog_x;
+	unsigned char relog_y;
+	bool has_timed_spikes;
+
+	std::vector<Map_Tile> tiles;
+	std::vector<std::pair<unsigned char, unsigned char>> chests;
+	std::vector<NPC_Spawn> npc_spawns;
+	std::vector<Chest_Spawn> chest_spawns;
+
+	/**
+	 * Reads a map file
+	 * @param id Map ID to name in warnings
+	 * @param error Set to the reason if the file is invalid, left empty if it doesn't exist
+	 */
+	bool Read(const std::string &filename, short id, std::string &error);
+};
+
 #endif // MAP_HPP_INCLUDED
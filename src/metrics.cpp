@@ -0,0 +1,52 @@
+/* metrics.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "metrics.hpp"
+
+#include <cstdint>
+
+namespace Metrics
+{
+
+const double Histogram::bounds[Histogram::Buckets] = {
+	0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 1.0
+};
+
+Histogram::Histogram()
+	: sum_ns(0)
+{
+	for (std::atomic<std::uint64_t> &count : this->counts)
+		count.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::Record(std::uint64_t ns)
+{
+	double seconds = double(ns) / 1000000000.0;
+	int bucket = 0;
+
+	while (bucket < Buckets && seconds > bounds[bucket])
+		++bucket;
+
+	this->counts[bucket].fetch_add(1, std::memory_order_relaxed);
+	this->sum_ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+std::uint64_t Histogram::Cumulative(int bucket) const
+{
+	std::uint64_t total = 0;
+
+	for (int i = 0; i <= bucket; ++i)
+		total += this->counts[i].load(std::memory_order_relaxed);
+
+	return total;
+}
+
+Traffic traffic;
+Loop loop;
+Histogram tick_duration;
+Histogram query_duration;
+Histogram input_latency;
+
+}
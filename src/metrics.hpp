@@ -0,0 +1,135 @@
+/* metrics.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef METRICS_HPP_INCLUDED
+#define METRICS_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Always-on server health counters, exported by StatusServer
+ */
+namespace Metrics
+{
+
+typedef std::chrono::steady_clock clock;
+
+/**
+ * Cumulative latency histogram with fixed bucket bounds, as exported to Prometheus
+ * Safe to record to from any thread
+ */
+class Histogram
+{
+	public:
+		static const int Buckets = 10;
+
+		/**
+		 * Upper bound of each bucket in seconds, excluding the final +Inf bucket
+		 */
+		static const double bounds[Buckets];
+
+	private:
+		std::array<std::atomic<std::uint64_t>, Buckets + 1> counts;
+		std::atomic<std::uint64_t> sum_ns;
+
+	public:
+		Histogram();
+
+		void Record(std::uint64_t ns);
+
+		/**
+		 * Returns the number of samples less than or equal to bounds[bucket]
+		 * Passing Buckets returns the total number of samples
+		 */
+		std::uint64_t Cumulative(int bucket) const;
+
+		std::uint64_t Count() const { return this->Cumulative(Buckets); }
+		double Sum() const { return double(this->sum_ns.load(std::memory_order_relaxed)) / 1000000000.0; }
+};
+
+/**
+ * Packet and byte counters, only updated from the main thread
+ */
+struct Traffic
+{
+	std::array<std::uint64_t, 256> packets_in{};
+	std::array<std::uint64_t, 256> packets_out{};
+	std::uint64_t bytes_in = 0;
+	std::uint64_t bytes_out = 0;
+};
+
+/**
+ * Main loop counters, only updated from the main thread
+ */
+struct Loop
+{
+	/**
+	 * Number of times the main loop has woken up
+	 */
+	std::uint64_t wakeups = 0;
+
+	/**
+	 * Time spent waiting for network activity or the next timer
+	 */
+	std::uint64_t idle_ns = 0;
+};
+
+extern Traffic traffic;
+extern Loop loop;
+extern Histogram tick_duration;
+extern Histogram query_duration;
+
+/**
+ * Time from a packet being read to its handler first being called
+ */
+extern Histogram input_latency;
+
+inline void PacketIn(unsigned char family, std::size_t bytes)
+{
+	++traffic.packets_in[family];
+	traffic.bytes_in += bytes;
+}
+
+inline void PacketOut(unsigned char family, std::size_t bytes)
+{
+	++traffic.packets_out[family];
+	traffic.bytes_out += bytes;
+}
+
+inline std::uint64_t Elapsed(clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+}
+
+/**
+ * Records the time until it goes out of scope to a histogram
+ */
+class Scope_Timer
+{
+	private:
+		Histogram &histogram;
+		clock::time_point start;
+
+	public:
+		explicit Scope_Timer(Histogram &histogram)
+			: histogram(histogram)
+			, start(clock::now())
+		{ }
+
+		Scope_Timer(const Scope_Timer&) = delete;
+
+		~Scope_Timer()
+		{
+			this->histogram.Record(Elapsed(this->start));
+		}
+};
+
+}
+
+#endif // METRICS_HPP_INCLUDED
@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <cstdio>
 #include <list>
 #include <memory>
@@ -75,6 +76,10 @@ NPC::NPC(Map *map, short id, unsigned char x, unsigned char y, unsigned char spa
 	}
 
 	this->parent = 0;
+
+	this->act_slot = Map::act_queue_type::npos;
+	this->spawn_slot = Map::spawn_queue_type::npos;
+	this->column = std::size_t(-1);
 }
 
 const NPC_Data& NPC::Data() const
@@ -87,79 +92,85 @@ const ENF_Data& NPC::ENF() const
 	return this->Data().ENF();
 }
 
-void NPC::Spawn(NPC *parent)
+void NPC::Place()
 {
-	if (this->alive)
-		return;
-
-	if (this->ENF().boss && !parent)
+	bool found = false;
+	for (int i = 0; i < 200; ++i)
 	{
-		UTIL_FOREACH(this->map->npcs, npc)
+		if (this->temporary && i == 0)
 		{
-			if (npc->ENF().child)
-			{
-				npc->Spawn(this);
-			}
+			this->x = this->spawn_x;
+			this->y = this->spawn_y;
 		}
-	}
-
-	if (parent)
-	{
-		this->parent = parent;
-	}
-
-	if (this->spawn_type < 7)
-	{
-		bool found = false;
-		for (int i = 0; i < 200; ++i)
+		else
 		{
-			if (this->temporary && i == 0)
-			{
-				this->x = this->spawn_x;
-				this->y = this->spawn_y;
-			}
-			else
-			{
-				this->x = util::rand(this->spawn_x-2, this->spawn_x+2);
-				this->y = util::rand(this->spawn_y-2, this->spawn_y+2);
-			}
+			this->x = this->map->rng.range(this->spawn_x-2, this->spawn_x+2);
+			this->y = this->map->rng.range(this->spawn_y-2, this->spawn_y+2);
+		}
 
-			if (this->map->Walkable(this->x, this->y, true) && (i > 100 || !this->map->Occupied(this->x, this->y, Map::NPCOnly)))
-			{
-				this->direction = static_cast<Direction>(util::rand(0,3));
-				found = true;
-				break;
-			}
+		if (this->map->Walkable(this->x, this->y, true) && (i > 100 || !this->map->Occupied(this->x, this->y, Map::NPCOnly)))
+		{
+			this->direction = static_cast<Direction>(this->map->rng.range(0,3));
+			found = true;
+			break;
 		}
+	}
 
-		if (!found)
+	if (!found)
+	{
+		Console::Wrn("An NPC on map %i at %i,%i is being placed by linear scan of spawn area (%s)", this->map->id, this->spawn_x, this->spawn_y, this->map->world->enf->Get(this->id).name.c_str());
+		for (this->x = this->spawn_x-2; this->x <= spawn_x+2; ++this->x)
 		{
-			Console::Wrn("An NPC on map %i at %i,%i is being placed by linear scan of spawn area (%s)", this->map->id, this->spawn_x, this->spawn_y, this->map->world->enf->Get(this->id).name.c_str());
-			for (this->x = this->spawn_x-2; this->x <= spawn_x+2; ++this->x)
+			for (this->y = this->spawn_y-2; this->y <= this->spawn_y+2; ++this->y)
 			{
-				for (this->y = this->spawn_y-2; this->y <= this->spawn_y+2; ++this->y)
+				if (this->map->Walkable(this->x, this->y, true))
 				{
-					if (this->map->Walkable(this->x, this->y, true))
-					{
-						Console::Wrn("Placed at valid location: %i,%i", this->x, this->y);
-						found = true;
-						goto end_linear_scan;
-					}
+					Console::Wrn("Placed at valid location: %i,%i", this->x, this->y);
+					found = true;
+					goto end_linear_scan;
 				}
 			}
 		}
-		end_linear_scan:
+	}
+	end_linear_scan:
+
+	if (!found)
+	{
+		Console::Err("NPC couldn't spawn anywhere valid!");
+	}
 
-		if (!found)
+	this->map->SyncNPC(this);
+}
+
+void NPC::Spawn(NPC *parent)
+{
+	if (this->alive)
+		return;
+
+	if (this->ENF().boss && !parent)
+	{
+		UTIL_FOREACH(this->map->child_npcs, npc)
 		{
-			Console::Err("NPC couldn't spawn anywhere valid!");
+			npc->Spawn(this);
 		}
 	}
 
+	if (parent)
+	{
+		this->parent = parent;
+	}
+
+	if (this->spawn_type < 7)
+		this->Place();
+
 	this->alive = true;
 	this->hp = this->ENF().hp;
 	this->last_act = Timer::GetTime();
 	this->act_speed = speed_table[this->spawn_type];
+	this->map->SyncNPC(this);
+
+	this->map->spawn_queue.erase(this);
+	this->map->act_queue.push(this, this->last_act + this->act_speed);
 
 	PacketBuilder builder(PACKET_RANGE, PACKET_REPLY, 8);
 	builder.AddChar(0);
@@ -179,22 +190,24 @@ void NPC::Spawn(NPC *parent)
 	}
 }
 
+void NPC::QueueRespawn()
+{
+	this->map->act_queue.erase(this);
+
+	if (!this->temporary)
+		this->map->spawn_queue.push(this, this->dead_since + double(this->spawn_time) * double(this->map->world->config["SpawnRate"]));
+}
+
 void NPC::Act()
 {
 	// Needed for the server startup spawn to work properly
 	if (this->ENF().child && !this->parent)
 	{
-		UTIL_FOREACH(this->map->npcs, npc)
-		{
-			if (npc->ENF().boss)
-			{
-				this->parent = npc;
-				break;
-			}
-		}
+		this->parent = this->map->boss_npc;
 	}
 
-	this->last_act += double(util::rand(int(this->act_speed * 750.0), int(this->act_speed * 1250.0))) / 1000.0;
+	this->last_act += double(this->map->rng.range(int(this->act_speed * 750.0), int(this->act_speed * 1250.0))) / 1000.0;
+	this->map->act_queue.push(this, this->last_act + this->act_speed);
 
 	if (this->spawn_type == 7)
 	{
@@ -336,7 +349,7 @@ void NPC::Act()
 
 			if (this->Walk(static_cast<Direction>(this->direction)) == Map::WalkFail)
 			{
-				this->Walk(static_cast<Direction>(util::rand(0,3)));
+				this->Walk(static_cast<Direction>(this->map->rng.range(0,3)));
 			}
 		}
 	}
@@ -347,7 +360,7 @@ void NPC::Act()
 		int act;
 		if (this->walk_idle_for == 0)
 		{
-			act = util::rand(1,10);
+			act = this->map->rng.range(1,10);
 		}
 		else
 		{
@@ -362,12 +375,12 @@ void NPC::Act()
 
 		if (act >= 7 && act <= 9) // 30% change direction
 		{
-			this->Walk(static_cast<Direction>(util::rand(0,3)));
+			this->Walk(static_cast<Direction>(this->map->rng.range(0,3)));
 		}
 
 		if (act == 10) // 10% take a break
 		{
-			this->walk_idle_for = util::rand(1,4);
+			this->walk_idle_for = this->map->rng.range(1,4);
 		}
 	}
 }
@@ -396,6 +409,8 @@ void NPC::Damage(Character *from, int amount, int spell_id)
 		amount = 0;
 	}
 
+	this->map->SyncNPC(this);
+
 	if (this->totaldamage + limitamount > this->totaldamage)
 		this->totaldamage += limitamount;
 
@@ -496,11 +511,12 @@ void NPC::RemoveFromView(Character *target)
 
 void NPC::Killed(Character *from, int amount, int spell_id)
 {
-	double droprate = this->map->world->config["DropRate"];
-	double exprate = this->map->world->config["ExpRate"];
-	int sharemode = this->map->world->config["ShareMode"];
-	int partysharemode = this->map->world->config["PartyShareMode"];
-	int dropratemode = this->map->world->config["DropRateMode"];
+	const World *world = this->map->world;
+	double droprate = world->drop_rate;
+	double exprate = world->exp_rate;
+	int sharemode = world->share_mode;
+	int partysharemode = world->party_share_mode;
+	int dropratemode = world->drop_rate_mode;
 	std::set<Party *> parties;
 
 	int most_damage_counter = 0;
@@ -508,49 +524,31 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 	NPC_Drop *drop = nullptr;
 
 	this->alive = false;
+	this->map->SyncNPC(this);
 
 	this->dead_since = int(Timer::GetTime());
+	this->QueueRespawn();
 
-	if (dropratemode == 1)
-	{
-		std::vector<NPC_Drop *> drops;
+	const NPC_Data &data = this->Data();
 
-		UTIL_FOREACH_CREF(this->Data().drops, checkdrop)
-		{
-			if (util::rand(0.0, 100.0) <= checkdrop->chance * droprate)
-			{
-				drops.push_back(checkdrop.get());
-			}
-		}
-
-		if (drops.size() > 0)
-		{
-			drop = drops[util::rand(0, drops.size()-1)];
-		}
-	}
-	else if (dropratemode == 2)
+	if (dropratemode == 1 || dropratemode == 2)
 	{
-		UTIL_FOREACH_CREF(this->Data().drops, checkdrop)
+		thread_local std::vector<std::size_t> passed;
+		data.drop_table.Roll(this->map->rng, droprate, passed);
+
+		if (passed.size() > 0)
 		{
-			if (util::rand(0.0, 100.0) <= checkdrop->chance * droprate)
-			{
-				drop = checkdrop.get();
-				break;
-			}
+			// Mode 1 picks any one of the successful rolls, mode 2 the first
+			std::size_t i = (dropratemode == 1) ? passed[this->map->rng.range(0, passed.size() - 1)] : passed[0];
+			drop = data.drops[i].get();
 		}
 	}
 	else if (dropratemode == 3)
 	{
-		double roll = util::rand(0.0, this->Data().drops_chance_total);
+		int i = data.drop_table.Pick(this->map->rng);
 
-		UTIL_FOREACH_CREF(this->Data().drops, checkdrop)
-		{
-			if (roll >= checkdrop->chance_offset && roll < checkdrop->chance_offset+checkdrop->chance)
-			{
-				drop = checkdrop.get();
-				break;
-			}
-		}
+		if (i >= 0)
+			drop = data.drops[i].get();
 	}
 
 	if (sharemode == 1)
@@ -566,6 +564,7 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 	}
 
 	int dropuid = 0;
+	std::shared_ptr<Map_Item> dropitem;
 	int dropid = 0;
 	int dropamount = 0;
 	Character* drop_winner = nullptr;
@@ -573,15 +572,22 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 	if (drop)
 	{
 		dropid = drop->id;
-		dropamount = std::min<int>(util::rand(drop->min, drop->max), this->map->world->config["MaxItem"]);
+		dropamount = std::min<int>(this->map->rng.range(drop->min, drop->max), this->map->world->config["MaxItem"]);
 
 		if (dropid <= 0 || static_cast<std::size_t>(dropid) >= this->map->world->eif->data.size() || dropamount <= 0)
 			goto abort_drop;
 
-		dropuid = this->map->GenerateItemID();
+		dropitem = this->map->InsertItem(dropid, dropamount, this->x, this->y, from->PlayerID(), Timer::GetTime() + static_cast<int>(this->map->world->config["ProtectNPCDrop"]));
 
-		std::shared_ptr<Map_Item> newitem(std::make_shared<Map_Item>(dropuid, dropid, dropamount, this->x, this->y, from->PlayerID(), Timer::GetTime() + static_cast<int>(this->map->world->config["ProtectNPCDrop"])));
-		this->map->items.push_back(newitem);
+		// Every item uid on the map is taken
+		if (!dropitem)
+		{
+			dropid = 0;
+			dropamount = 0;
+			goto abort_drop;
+		}
+
+		dropuid = dropitem->uid;
 
 		// Selects a random number between 0 and maxhp, and decides the winner based on that
 		switch (sharemode)
@@ -596,7 +602,7 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 
 			case 2:
 			{
-				int rewarded_hp = util::rand(0, this->totaldamage - 1);
+				int rewarded_hp = this->map->rng.range(0, this->totaldamage - 1);
 				int count_hp = 0;
 				UTIL_FOREACH_CREF(this->damagelist, opponent)
 				{
@@ -616,7 +622,7 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 
 			case 3:
 			{
-				int rand = util::rand(0, this->damagelist.size() - 1);
+				int rand = this->map->rng.range(0, this->damagelist.size() - 1);
 				int i = 0;
 				UTIL_FOREACH_CREF(this->damagelist, opponent)
 				{
@@ -636,7 +642,7 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 	abort_drop:
 
 	if (drop_winner)
-		this->map->items.back()->owner = drop_winner->PlayerID();
+		dropitem->owner = drop_winner->PlayerID();
 
 	UTIL_FOREACH(this->map->characters, character)
 	{
@@ -833,9 +839,9 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 	{
 		std::vector<NPC*> child_npcs;
 
-		UTIL_FOREACH(this->map->npcs, npc)
+		UTIL_FOREACH(this->map->child_npcs, npc)
 		{
-			if (npc->ENF().child && !npc->ENF().boss && npc->alive)
+			if (!npc->ENF().boss && npc->alive)
 			{
 				child_npcs.push_back(npc);
 			}
@@ -868,10 +874,7 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 
 	if (this->temporary)
 	{
-		this->map->npcs.erase(
-			std::remove(this->map->npcs.begin(), this->map->npcs.end(), this),
-			this->map->npcs.end()
-		);
+		this->map->RemoveNPC(this);
 	}
 
 	UTIL_FOREACH(from->quests, q)
@@ -895,8 +898,10 @@ void NPC::Die(bool show)
 		return;
 
 	this->alive = false;
+	this->map->SyncNPC(this);
 	this->parent = 0;
 	this->dead_since = int(Timer::GetTime());
+	this->QueueRespawn();
 
 	UTIL_FOREACH_CREF(this->damagelist, opponent)
 	{
@@ -933,10 +938,7 @@ void NPC::Die(bool show)
 
 	if (this->temporary)
 	{
-		this->map->npcs.erase(
-			std::remove(this->map->npcs.begin(), this->map->npcs.end(), this),
-			this->map->npcs.end()
-		);
+		this->map->RemoveNPC(this);
 
 		delete this;
 	}
@@ -944,8 +946,8 @@ void NPC::Die(bool show)
 
 void NPC::Attack(Character *target)
 {
-	int amount = util::rand(this->ENF().mindam, this->ENF().maxdam + static_cast<int>(this->map->world->config["NPCAdjustMaxDam"]));
-	double rand = util::rand(0.0, 1.0);
+	int amount = this->map->rng.range(this->ENF().mindam, this->ENF().maxdam + static_cast<int>(this->map->world->config["NPCAdjustMaxDam"]));
+	double rand = this->map->rng.range(0.0, 1.0);
 	// Checks if target is facing you
 	bool critical = std::abs(int(target->direction) - this->direction) != 2 || rand < static_cast<double>(this->map->world->config["CriticalRate"]);
 
@@ -14,6 +14,7 @@
 #include "fwd/npc_data.hpp"
 
 #include <array>
+#include <cstddef>
 #include <list>
 #include <memory>
 #include <string>
@@ -56,6 +57,17 @@ class NPC
 		short spawn_time;
 		unsigned char spawn_x, spawn_y;
 
+		/**
+		 * Positions in the map's act and respawn queues
+		 */
+		std::size_t act_slot;
+		std::size_t spawn_slot;
+
+		/**
+		 * Position in the map's npcs list and NPC columns
+		 */
+		std::size_t column;
+
 		int id;
 
 		static void SetSpeedTable(std::array<double, 7> speeds);
@@ -65,7 +77,17 @@ class NPC
 		const NPC_Data& Data() const;
 		const ENF_Data& ENF() const;
 
+		/**
+		 * Moves the NPC to a random free tile around its spawn point
+		 */
+		void Place();
+
 		void Spawn(NPC *parent = 0);
+
+		/**
+		 * Takes a dead NPC out of its map's act queue and schedules its respawn
+		 */
+		void QueueRespawn();
 		void Act();
 
 		bool Walk(Direction);
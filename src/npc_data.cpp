@@ -10,10 +10,13 @@
 
 #include "console.hpp"
 #include "util.hpp"
+#include "util/rng.hpp"
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstdio>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -38,6 +41,7 @@ void NPC_Data::UnloadShopDrop()
 	this->skill_learn.clear();
 
 	this->drops_chance_total = 0.0;
+	this->drop_table.Build(this->drops, 0.0);
 
 	this->citizenship.reset();
 }
@@ -89,6 +93,8 @@ void NPC_Data::LoadShopDrop()
 			{
 				this->drops_chance_total = 100.0;
 			}
+
+			this->drop_table.Build(this->drops, this->drops_chance_total);
 		}
 	}
 
@@ -296,6 +302,111 @@ void NPC_Data::LoadShopDrop()
 	}
 }
 
+void NPC_Drop_Table::Build(const std::vector<std::unique_ptr<NPC_Drop>> &drops, double chance_total)
+{
+	this->chances.clear();
+	this->alias_probability.clear();
+	this->alias.clear();
+
+	if (drops.empty())
+		return;
+
+	std::size_t n = drops.size() + 1;
+	std::vector<double> weights(n);
+	double sum = 0.0;
+
+	for (std::size_t i = 0; i < drops.size(); ++i)
+	{
+		this->chances.push_back(drops[i]->chance);
+		weights[i] = std::max(drops[i]->chance, 0.0);
+		sum += weights[i];
+	}
+
+	weights[n - 1] = std::max(chance_total - sum, 0.0);
+	sum += weights[n - 1];
+
+	if (sum <= 0.0)
+		return;
+
+	// Vose's method: pair each under-full slot with an over-full one that tops it up
+	this->alias_probability.resize(n);
+	this->alias.resize(n);
+
+	std::vector<std::size_t> small, large;
+
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		weights[i] *= double(n) / sum;
+		(weights[i] < 1.0 ? small : large).push_back(i);
+	}
+
+	while (!small.empty() && !large.empty())
+	{
+		std::size_t s = small.back();
+		std::size_t l = large.back();
+		small.pop_back();
+
+		this->alias_probability[s] = weights[s];
+		this->alias[s] = l;
+
+		weights[l] -= 1.0 - weights[s];
+
+		if (weights[l] < 1.0)
+		{
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+
+	// Anything left over is full, give or take rounding error
+	for (std::size_t i : large)
+	{
+		this->alias_probability[i] = 1.0;
+		this->alias[i] = i;
+	}
+
+	for (std::size_t i : small)
+	{
+		this->alias_probability[i] = 1.0;
+		this->alias[i] = i;
+	}
+}
+
+int NPC_Drop_Table::Pick(util::rng &rng) const
+{
+	std::size_t n = this->alias.size();
+
+	if (n == 0)
+		return -1;
+
+	double roll = rng.range(0.0, double(n));
+	std::size_t i = std::min(std::size_t(roll), n - 1);
+	std::size_t outcome = (roll - double(i) < this->alias_probability[i]) ? i : this->alias[i];
+
+	return (outcome == n - 1) ? -1 : int(outcome);
+}
+
+void NPC_Drop_Table::Roll(util::rng &rng, double rate, std::vector<std::size_t> &passed) const
+{
+	std::size_t n = this->chances.size();
+	double rolls[64];
+
+	passed.clear();
+
+	for (std::size_t base = 0; base < n; base += 64)
+	{
+		std::size_t count = std::min<std::size_t>(n - base, 64);
+
+		rng.fill(rolls, count, 0.0, 100.0);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (rolls[i] <= this->chances[base + i] * rate)
+				passed.push_back(base + i);
+		}
+	}
+}
+
 NPC_Data::~NPC_Data()
 {
 
@@ -12,7 +12,10 @@
 #include "fwd/eodata.hpp"
 #include "fwd/world.hpp"
 
+#include "util/rng.hpp"
+
 #include <array>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -29,6 +32,37 @@ struct NPC_Drop
 	double chance_offset;
 };
 
+/**
+ * Drop chances of an NPC arranged for fast rolls, rebuilt whenever its drops are loaded
+ */
+struct NPC_Drop_Table
+{
+	/**
+	 * Drop chances in percent, in the same order as NPC_Data::drops
+	 */
+	std::vector<double> chances;
+
+	/**
+	 * Walker alias table over every drop plus a final "no drop" outcome
+	 * The last outcome covers whatever is left when the chances add up to less than 100%.
+	 */
+	std::vector<double> alias_probability;
+	std::vector<std::size_t> alias;
+
+	void Build(const std::vector<std::unique_ptr<NPC_Drop>> &drops, double chance_total);
+
+	/**
+	 * Drops one item with chances proportional to their rates (DropRateMode 3)
+	 * @return Index in to NPC_Data::drops, or -1 for no drop
+	 */
+	int Pick(util::rng &rng) const;
+
+	/**
+	 * Rolls every drop's chance at once, storing the indexes of the ones that succeed (DropRateMode 1 and 2)
+	 */
+	void Roll(util::rng &rng, double rate, std::vector<std::size_t> &passed) const;
+};
+
 /**
  * Used by the NPC_Data class to store trade shop data
  */
@@ -86,6 +120,7 @@ class NPC_Data
 		short id;
 		std::vector<std::unique_ptr<NPC_Drop>> drops;
 		double drops_chance_total;
+		NPC_Drop_Table drop_table;
 		std::string shop_name;
 		std::string skill_name;
 		std::vector<std::unique_ptr<NPC_Shop_Trade_Item>> shop_trade;
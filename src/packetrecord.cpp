@@ -0,0 +1,149 @@
+/* packetrecord.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "packetrecord.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static double record_clock()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char record_magic[8] = {'E', 'O', 'R', 'E', 'C', '0', '0', '1'};
+
+// Recordings are little-endian regardless of the host
+static void put_uint(std::string &buffer, std::uint64_t value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i)
+		buffer.push_back(char((value >> (i * 8)) & 0xFF));
+}
+
+static std::uint64_t get_uint(const unsigned char *buffer, int bytes)
+{
+	std::uint64_t value = 0;
+
+	for (int i = 0; i < bytes; ++i)
+		value |= std::uint64_t(buffer[i]) << (i * 8);
+
+	return value;
+}
+
+PacketRecorder::PacketRecorder()
+	: fh(nullptr)
+	, start(0.0)
+	, next_connection(1)
+{ }
+
+bool PacketRecorder::Open(const std::string &filename)
+{
+	this->Close();
+
+	this->fh = std::fopen(filename.c_str(), "wb");
+
+	if (!this->fh)
+		return false;
+
+	std::fwrite(record_magic, 1, sizeof record_magic, this->fh);
+	std::fflush(this->fh);
+
+	this->filename = filename;
+	this->start = record_clock();
+
+	// next_connection keeps counting, clients connected before a reopen still write with their old IDs
+
+	return true;
+}
+
+void PacketRecorder::Close()
+{
+	if (!this->fh)
+		return;
+
+	std::fclose(this->fh);
+	this->fh = nullptr;
+	this->filename.clear();
+}
+
+void PacketRecorder::Write(std::uint32_t connection, PacketRecord::Event event, const std::string &data)
+{
+	if (!this->fh || connection == 0)
+		return;
+
+	std::uint64_t microseconds = std::uint64_t((record_clock() - this->start) * 1000000.0);
+
+	std::string buffer;
+	buffer.reserve(17 + data.length());
+
+	put_uint(buffer, microseconds, 8);
+	put_uint(buffer, connection, 4);
+	buffer.push_back(char(event));
+	put_uint(buffer, data.length(), 4);
+	buffer += data;
+
+	std::fwrite(buffer.data(), 1, buffer.length(), this->fh);
+}
+
+std::uint32_t PacketRecorder::Connect()
+{
+	if (!this->fh)
+		return 0;
+
+	std::uint32_t connection = this->next_connection++;
+
+	this->Write(connection, PacketRecord::Connect, std::string());
+
+	return connection;
+}
+
+void PacketRecorder::Packet(std::uint32_t connection, const std::string &data)
+{
+	this->Write(connection, PacketRecord::Packet, data);
+}
+
+void PacketRecorder::Disconnect(std::uint32_t connection)
+{
+	this->Write(connection, PacketRecord::Disconnect, std::string());
+
+	// Keeps the file usable while the server is still running
+	if (this->fh)
+		std::fflush(this->fh);
+}
+
+bool PacketRecorder::ReadHeader(std::FILE *fh)
+{
+	char magic[sizeof record_magic];
+
+	return std::fread(magic, 1, sizeof magic, fh) == sizeof magic && std::memcmp(magic, record_magic, sizeof magic) == 0;
+}
+
+bool PacketRecorder::Read(std::FILE *fh, PacketRecord &record)
+{
+	unsigned char header[17];
+
+	if (std::fread(header, 1, sizeof header, fh) != sizeof header)
+		return false;
+
+	record.time = double(get_uint(header, 8)) / 1000000.0;
+	record.connection = std::uint32_t(get_uint(header + 8, 4));
+	record.event = PacketRecord::Event(header[12]);
+
+	std::size_t length = std::size_t(get_uint(header + 13, 4));
+	record.data.resize(length);
+
+	if (length > 0 && std::fread(&record.data[0], 1, length, fh) != length)
+		return false;
+
+	return true;
+}
+
+PacketRecorder::~PacketRecorder()
+{
+	this->Close();
+}
@@ -0,0 +1,86 @@
+/* packetrecord.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef PACKETRECORD_HPP_INCLUDED
+#define PACKETRECORD_HPP_INCLUDED
+
+#include "fwd/packetrecord.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * One event in a packet recording
+ * Packets are stored decoded with their sequence number removed, so they can be re-sequenced and re-encoded when replayed.
+ */
+struct PacketRecord
+{
+	enum Event : unsigned char
+	{
+		Connect = 0,
+		Packet = 1,
+		Disconnect = 2
+	};
+
+	/**
+	 * Seconds since the recording was started
+	 */
+	double time = 0.0;
+
+	std::uint32_t connection = 0;
+	Event event = Packet;
+	std::string data;
+};
+
+/**
+ * Writes the packets received from every client to a file, for replaying with eoloadgen
+ */
+class PacketRecorder
+{
+	private:
+		std::FILE *fh;
+		std::string filename;
+		double start;
+		std::uint32_t next_connection;
+
+		void Write(std::uint32_t connection, PacketRecord::Event event, const std::string &data);
+
+	public:
+		PacketRecorder();
+
+		/**
+		 * Starts recording to a file, replacing its contents
+		 * @return false if the file could not be opened
+		 */
+		bool Open(const std::string &filename);
+		void Close();
+
+		bool IsOpen() const { return this->fh != nullptr; }
+		const std::string &Filename() const { return this->filename; }
+
+		/**
+		 * Records a new connection
+		 * @return An ID to pass to the other recording functions
+		 */
+		std::uint32_t Connect();
+		void Packet(std::uint32_t connection, const std::string &data);
+		void Disconnect(std::uint32_t connection);
+
+		/**
+		 * Checks the header at the start of a recording file
+		 */
+		static bool ReadHeader(std::FILE *fh);
+
+		/**
+		 * Reads the next event from a recording file
+		 * @return false at the end of the file
+		 */
+		static bool Read(std::FILE *fh, PacketRecord &record);
+
+		~PacketRecorder();
+};
+
+#endif // PACKETRECORD_HPP_INCLUDED
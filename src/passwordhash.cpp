@@ -0,0 +1,343 @@
+/* passwordhash.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "passwordhash.hpp"
+
+#include "hash.hpp"
+#include "util.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static const char *scrypt_prefix = "$scrypt$";
+static const std::size_t salt_length = 16;
+static const std::size_t key_length = 32;
+
+static bool constant_time_equal(const std::string& a, const std::string& b)
+{
+	if (a.length() != b.length())
+		return false;
+
+	unsigned char diff = 0;
+
+	for (std::size_t i = 0; i < a.length(); ++i)
+		diff |= (unsigned char)(a[i] ^ b[i]);
+
+	return diff == 0;
+}
+
+static bool parse_scrypt(const std::string& stored, Password_Params& params, std::string& salt, std::string& hash)
+{
+	if (stored.compare(0, std::strlen(scrypt_prefix), scrypt_prefix) != 0)
+		return false;
+
+	std::vector<std::string> parts = util::explode('$', stored.substr(std::strlen(scrypt_prefix)));
+
+	if (parts.size() != 5)
+		return false;
+
+	params.cost = util::to_int(parts[0]);
+	params.block_size = util::to_int(parts[1]);
+	params.parallel = util::to_int(parts[2]);
+	salt = hex_decode(parts[3]);
+	hash = hex_decode(parts[4]);
+
+	return params.cost > 0 && params.cost < 32 && params.block_size > 0 && params.parallel > 0
+	    && params.block_size * params.parallel < (1 << 16) && !salt.empty() && !hash.empty();
+}
+
+static std::string random_bytes(std::size_t length)
+{
+	std::random_device rng;
+	std::string bytes(length, '\0');
+
+	for (char& c : bytes)
+		c = char(rng() & 0xFF);
+
+	return bytes;
+}
+
+static std::string format_scrypt(const Password_Params& params, const std::string& salt, const std::string& hash)
+{
+	return scrypt_prefix + util::to_string(params.cost) + "$" + util::to_string(params.block_size) + "$" + util::to_string(params.parallel)
+	     + "$" + hex_encode(salt) + "$" + hex_encode(hash);
+}
+
+std::string PasswordHasher::Hash(const std::string& input, const Password_Params& params)
+{
+	if (params.cost <= 0)
+		return sha256(input);
+
+	std::string salt = random_bytes(salt_length);
+	std::string hash = scrypt(input, salt, std::uint64_t(1) << params.cost, params.block_size, params.parallel, key_length);
+
+	return format_scrypt(params, salt, hash);
+}
+
+bool PasswordHasher::Verify(const std::string& stored, const std::string& input)
+{
+	Password_Params params;
+	std::string salt;
+	std::string hash;
+
+	if (parse_scrypt(stored, params, salt, hash))
+		return constant_time_equal(scrypt(input, salt, std::uint64_t(1) << params.cost, params.block_size, params.parallel, hash.length()), hash);
+
+	return constant_time_equal(sha256(input), stored);
+}
+
+bool PasswordHasher::NeedsRehash(const std::string& stored, const Password_Params& params)
+{
+	// Never downgrade to sha256
+	if (params.cost <= 0)
+		return false;
+
+	Password_Params stored_params;
+	std::string salt;
+	std::string hash;
+
+	if (!parse_scrypt(stored, stored_params, salt, hash))
+		return true;
+
+	return stored_params.cost != params.cost || stored_params.block_size != params.block_size || stored_params.parallel != params.parallel;
+}
+
+PasswordHasher::PasswordHasher()
+	: per_address(0)
+	, queue_max(0)
+	, next_id(0)
+	, stopping(false)
+	, results_waiting(0)
+{ }
+
+void PasswordHasher::Configure(std::size_t threads, const Password_Params& params, std::size_t per_address, std::size_t queue_max)
+{
+	this->params = params;
+	this->per_address = per_address;
+	this->queue_max = queue_max;
+
+	// Random bytes in place of the key cost the same to check as a real hash, and won't match anything
+	if (params.cost <= 0)
+		this->dummy_hash = hex_encode(random_bytes(key_length));
+	else
+		this->dummy_hash = format_scrypt(params, random_bytes(salt_length), random_bytes(key_length));
+
+	if (threads != this->workers.size())
+	{
+		this->StopWorkers();
+		this->StartWorkers(threads);
+	}
+}
+
+void PasswordHasher::StartWorkers(std::size_t threads)
+{
+	this->stopping = false;
+
+	for (std::size_t i = 0; i < threads; ++i)
+		this->workers.emplace_back(&PasswordHasher::Work, this);
+}
+
+void PasswordHasher::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->job_mutex);
+		this->stopping = true;
+	}
+
+	this->job_ready.notify_all();
+
+	UTIL_FOREACH_REF(this->workers, worker)
+	{
+		worker.join();
+	}
+
+	this->workers.clear();
+
+	// Anything left over is finished on this thread so no callback is lost
+	while (!this->jobs.empty())
+	{
+		this->Run(this->jobs.front());
+		this->jobs.pop_front();
+	}
+}
+
+void PasswordHasher::Run(Job &job)
+{
+	Result result;
+	result.id = job.id;
+
+	if (job.verify)
+	{
+		result.match = Verify(job.stored, job.input.str());
+
+		if (result.match && NeedsRehash(job.stored, job.params))
+			result.hash = Hash(job.input.str(), job.params);
+	}
+	else
+	{
+		result.match = true;
+		result.hash = Hash(job.input.str(), job.params);
+	}
+
+	job.input.erase();
+
+	std::lock_guard<std::mutex> lock(this->result_mutex);
+	this->results.push_back(std::move(result));
+	this->results_waiting.store(this->results.size(), std::memory_order_release);
+}
+
+void PasswordHasher::Work()
+{
+	for (;;)
+	{
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(this->job_mutex);
+			this->job_ready.wait(lock, [this]() { return this->stopping || !this->jobs.empty(); });
+
+			if (this->stopping)
+				return;
+
+			job = std::move(this->jobs.front());
+			this->jobs.pop_front();
+		}
+
+		this->Run(job);
+	}
+}
+
+PasswordHasher::SubmitResult PasswordHasher::Submit(const void *owner, const IPAddress &address, Job &&job, Pending &&pending)
+{
+	if (this->Busy(owner))
+		return OwnerBusy;
+
+	if (this->queue_max != 0 && this->pending.size() >= this->queue_max)
+		return QueueFull;
+
+	int &address_count = this->address_pending[address];
+
+	if (this->per_address != 0 && std::size_t(address_count) >= this->per_address)
+		return AddressBusy;
+
+	++address_count;
+	++this->owner_pending[owner];
+
+	job.id = this->next_id++;
+	job.params = this->params;
+	this->pending.insert({job.id, std::move(pending)});
+
+	if (this->workers.empty())
+	{
+		this->Run(job);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->job_mutex);
+			this->jobs.push_back(std::move(job));
+		}
+
+		this->job_ready.notify_one();
+	}
+
+	return Submitted;
+}
+
+PasswordHasher::SubmitResult PasswordHasher::Verify(const void *owner, const IPAddress &address, const std::string& stored, util::secure_string&& input, VerifyCallback callback)
+{
+	Job job;
+	job.verify = true;
+	job.stored = stored;
+	job.input = std::move(input);
+
+	return this->Submit(owner, address, std::move(job), Pending{owner, address, std::move(callback), HashCallback()});
+}
+
+PasswordHasher::SubmitResult PasswordHasher::Hash(const void *owner, const IPAddress &address, util::secure_string&& input, HashCallback callback)
+{
+	Job job;
+	job.verify = false;
+	job.input = std::move(input);
+
+	return this->Submit(owner, address, std::move(job), Pending{owner, address, VerifyCallback(), std::move(callback)});
+}
+
+bool PasswordHasher::Busy(const void *owner) const
+{
+	return this->owner_pending.find(owner) != this->owner_pending.end();
+}
+
+void PasswordHasher::Cancel(const void *owner)
+{
+	if (this->owner_pending.erase(owner) == 0)
+		return;
+
+	UTIL_FOREACH_REF(this->pending, entry)
+	{
+		if (entry.second.owner == owner)
+		{
+			entry.second.owner = nullptr;
+			entry.second.verify_callback = nullptr;
+			entry.second.hash_callback = nullptr;
+		}
+	}
+}
+
+void PasswordHasher::Poll()
+{
+	if (this->results_waiting.load(std::memory_order_acquire) == 0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(this->result_mutex);
+		this->delivering.swap(this->results);
+		this->results_waiting.store(0, std::memory_order_relaxed);
+	}
+
+	UTIL_FOREACH_REF(this->delivering, result)
+	{
+		auto it = this->pending.find(result.id);
+
+		if (it == this->pending.end())
+			continue;
+
+		Pending pending = std::move(it->second);
+		this->pending.erase(it);
+
+		auto address_it = this->address_pending.find(pending.address);
+
+		if (address_it != this->address_pending.end() && --address_it->second <= 0)
+			this->address_pending.erase(address_it);
+
+		if (pending.owner)
+		{
+			auto owner_it = this->owner_pending.find(pending.owner);
+
+			if (owner_it != this->owner_pending.end() && --owner_it->second <= 0)
+				this->owner_pending.erase(owner_it);
+		}
+
+		// Callbacks may submit new jobs, nothing above is held across the call
+		if (pending.verify_callback)
+			pending.verify_callback(result.match, result.hash);
+		else if (pending.hash_callback)
+			pending.hash_callback(result.hash);
+	}
+
+	this->delivering.clear();
+}
+
+PasswordHasher::~PasswordHasher()
+{
+	this->StopWorkers();
+}
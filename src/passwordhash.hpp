@@ -0,0 +1,181 @@
+/* passwordhash.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef PASSWORDHASH_HPP_INCLUDED
+#define PASSWORDHASH_HPP_INCLUDED
+
+#include "fwd/passwordhash.hpp"
+
+#include "socket.hpp"
+#include "util/secure_string.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Password hashing settings
+ * Stored passwords are either a legacy hex sha256 digest, or "$scrypt$cost$block_size$parallel$salt$hash".
+ */
+struct Password_Params
+{
+	/**
+	 * Longest stored hash any settings produce, which the accounts.password column must be able to hold
+	 */
+	static const std::size_t StoredLength = 128;
+
+	/**
+	 * log2 of the scrypt CPU/memory cost, or 0 to store legacy sha256 hashes
+	 */
+	int cost = 0;
+	int block_size = 8;
+	int parallel = 1;
+};
+
+/**
+ * Runs password hashing on worker threads so slow key derivation never blocks the game loop
+ * Results are delivered by Poll() on the thread that owns the hasher.
+ */
+class PasswordHasher
+{
+	public:
+		/**
+		 * Called with whether the password matched, and a new hash to store if the old one used outdated settings
+		 */
+		typedef std::function<void(bool match, const std::string& rehash)> VerifyCallback;
+
+		/**
+		 * Called with the hash to store for a new password
+		 */
+		typedef std::function<void(const std::string& hash)> HashCallback;
+
+		enum SubmitResult
+		{
+			Submitted,
+			OwnerBusy,
+			AddressBusy,
+			QueueFull
+		};
+
+	private:
+		struct Job
+		{
+			std::uint64_t id;
+			bool verify;
+			std::string stored;
+			util::secure_string input;
+			Password_Params params;
+
+			Job() : input(std::string()) { }
+		};
+
+		struct Result
+		{
+			std::uint64_t id;
+			bool match;
+			std::string hash;
+		};
+
+		struct Pending
+		{
+			const void *owner;
+			IPAddress address;
+			VerifyCallback verify_callback;
+			HashCallback hash_callback;
+		};
+
+		Password_Params params;
+		std::size_t per_address;
+		std::size_t queue_max;
+
+		// Never matches, checked in place of a missing account's hash so it takes as long as a real one
+		std::string dummy_hash;
+
+		std::uint64_t next_id;
+		std::unordered_map<std::uint64_t, Pending> pending;
+		std::unordered_map<const void *, int> owner_pending;
+		std::unordered_map<IPAddress, int> address_pending;
+
+		std::vector<std::thread> workers;
+		std::mutex job_mutex;
+		std::condition_variable job_ready;
+		std::deque<Job> jobs;
+		bool stopping;
+
+		std::mutex result_mutex;
+		std::vector<Result> results;
+		std::vector<Result> delivering;
+		std::atomic<std::size_t> results_waiting;
+
+		SubmitResult Submit(const void *owner, const IPAddress &address, Job &&job, Pending &&pending);
+		void Run(Job &job);
+		void Work();
+		void StartWorkers(std::size_t threads);
+		void StopWorkers();
+
+	public:
+		/**
+		 * Hashes a password with new random salt
+		 */
+		static std::string Hash(const std::string& input, const Password_Params& params);
+
+		/**
+		 * Checks a password against a stored hash of either format
+		 */
+		static bool Verify(const std::string& stored, const std::string& input);
+
+		/**
+		 * Checks if a stored hash should be replaced to match the current settings
+		 */
+		static bool NeedsRehash(const std::string& stored, const Password_Params& params);
+
+		PasswordHasher();
+
+		/**
+		 * @param threads Number of worker threads, 0 hashes on the calling thread
+		 * @param per_address Maximum jobs in progress for one remote address
+		 * @param queue_max Maximum jobs in progress in total
+		 */
+		void Configure(std::size_t threads, const Password_Params& params, std::size_t per_address, std::size_t queue_max);
+
+		const Password_Params& Params() const { return this->params; }
+
+		/**
+		 * A hash in the current format that no password matches
+		 */
+		const std::string& DummyHash() const { return this->dummy_hash; }
+
+		SubmitResult Verify(const void *owner, const IPAddress &address, const std::string& stored, util::secure_string&& input, VerifyCallback callback);
+		SubmitResult Hash(const void *owner, const IPAddress &address, util::secure_string&& input, HashCallback callback);
+
+		/**
+		 * Checks if an owner has any jobs in progress
+		 */
+		bool Busy(const void *owner) const;
+
+		/**
+		 * Discards the callbacks of an owner's jobs, which must be done before the owner is destroyed
+		 */
+		void Cancel(const void *owner);
+
+		/**
+		 * Runs the callbacks of any finished jobs
+		 */
+		void Poll();
+
+		std::size_t InProgress() const { return this->pending.size(); }
+
+		~PasswordHasher();
+};
+
+#endif // PASSWORDHASH_HPP_INCLUDED
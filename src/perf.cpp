@@ -0,0 +1,355 @@
+/* perf.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "perf.hpp"
+
+#ifdef PERF_PROFILER
+
+#include "packet.hpp"
+
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Perf
+{
+
+static int msb64(std::uint64_t value)
+{
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(value);
+#else
+	int n = 0;
+
+	while (value >>= 1)
+		++n;
+
+	return n;
+#endif
+}
+
+Histogram::Histogram()
+{
+	this->Reset();
+}
+
+int Histogram::Bucket(std::uint64_t ns)
+{
+	if (ns < SubBuckets)
+		return int(ns);
+
+	int e = msb64(ns);
+
+	return (e - SubBucketBits + 1) * SubBuckets + int((ns >> (e - SubBucketBits)) & (SubBuckets - 1));
+}
+
+std::uint64_t Histogram::BucketValue(int bucket)
+{
+	if (bucket < SubBuckets)
+		return std::uint64_t(bucket);
+
+	int e = bucket / SubBuckets + SubBucketBits - 1;
+	std::uint64_t sub = std::uint64_t(bucket % SubBuckets);
+	std::uint64_t lower = (SubBuckets + sub) << (e - SubBucketBits);
+
+	return lower + ((std::uint64_t(1) << (e - SubBucketBits)) - 1);
+}
+
+std::uint64_t Histogram::Percentile(double p) const
+{
+	if (this->count == 0)
+		return 0;
+
+	std::uint64_t target = std::uint64_t(double(this->count) * p / 100.0 + 0.5);
+	std::uint64_t seen = 0;
+
+	if (target < 1)
+		target = 1;
+
+	for (int i = 0; i < Buckets; ++i)
+	{
+		seen += this->counts[i];
+
+		if (seen >= target)
+			return std::min(BucketValue(i), this->max);
+	}
+
+	return this->max;
+}
+
+void Histogram::Reset()
+{
+	std::fill(this->counts, this->counts + Buckets, 0);
+	this->count = 0;
+	this->total = 0;
+	this->max = 0;
+}
+
+struct Timer_Stats
+{
+	std::string name;
+	std::unique_ptr<Histogram> histogram;
+};
+
+bool enabled = false;
+
+static std::vector<std::unique_ptr<Histogram>> handler_histograms;
+static std::unordered_map<std::uintptr_t, Timer_Stats> timer_stats;
+
+static Histogram tick_histogram;
+static std::uint64_t tick_overruns = 0;
+static std::uint64_t tick_budget = 50000000;
+static std::uint64_t tick_idle = 0;
+static clock::time_point tick_start;
+static clock::time_point idle_start;
+
+static std::time_t sample_start = 0;
+
+Histogram *HandlerHistogram(unsigned char family, unsigned char action)
+{
+	if (!enabled)
+		return 0;
+
+	std::unique_ptr<Histogram> &histogram = handler_histograms[(family << 8) | action];
+
+	if (!histogram)
+		histogram.reset(new Histogram);
+
+	return histogram.get();
+}
+
+Histogram *TimerHistogram(TimerCallback callback)
+{
+	if (!enabled)
+		return 0;
+
+	Timer_Stats &stats = timer_stats[reinterpret_cast<std::uintptr_t>(callback)];
+
+	if (!stats.histogram)
+		stats.histogram.reset(new Histogram);
+
+	return stats.histogram.get();
+}
+
+void NameTimer(TimerCallback callback, const char *name)
+{
+	timer_stats[reinterpret_cast<std::uintptr_t>(callback)].name = name;
+}
+
+void Enable(bool enable)
+{
+	if (enable && !enabled)
+	{
+		if (handler_histograms.empty())
+			handler_histograms.resize(256 * 256);
+
+		Reset();
+
+		// May be switched on part way through a tick
+		tick_idle = 0;
+		tick_start = clock::now();
+	}
+
+	enabled = enable;
+}
+
+void Reset()
+{
+	UTIL_FOREACH_REF(handler_histograms, histogram)
+	{
+		if (histogram)
+			histogram->Reset();
+	}
+
+	UTIL_FOREACH_REF(timer_stats, stats)
+	{
+		if (stats.second.histogram)
+			stats.second.histogram->Reset();
+	}
+
+	tick_histogram.Reset();
+	tick_overruns = 0;
+	sample_start = std::time(0);
+}
+
+void SetTickBudget(double budget)
+{
+	tick_budget = std::uint64_t(budget * 1000000000.0);
+}
+
+static std::string format_ns(std::uint64_t ns)
+{
+	char buffer[32];
+
+	if (ns < 1000)
+		std::snprintf(buffer, sizeof(buffer), "%uns", unsigned(ns));
+	else if (ns < 1000000)
+		std::snprintf(buffer, sizeof(buffer), "%.1fus", double(ns) / 1000.0);
+	else if (ns < 1000000000)
+		std::snprintf(buffer, sizeof(buffer), "%.2fms", double(ns) / 1000000.0);
+	else
+		std::snprintf(buffer, sizeof(buffer), "%.2fs", double(ns) / 1000000000.0);
+
+	return buffer;
+}
+
+static std::string format_histogram(const std::string& name, const Histogram& histogram)
+{
+	char buffer[64];
+	std::snprintf(buffer, sizeof(buffer), "%-16s n=%llu", name.c_str(), static_cast<unsigned long long>(histogram.count));
+
+	return std::string(buffer)
+	     + " avg=" + format_ns(histogram.count ? histogram.total / histogram.count : 0)
+	     + " p50=" + format_ns(histogram.Percentile(50.0))
+	     + " p99=" + format_ns(histogram.Percentile(99.0))
+	     + " max=" + format_ns(histogram.max)
+	     + " sum=" + format_ns(histogram.total);
+}
+
+static void report_section(std::vector<std::string>& lines, std::vector<std::pair<std::string, const Histogram *>>& entries, std::size_t top)
+{
+	std::sort(UTIL_RANGE(entries), [](const std::pair<std::string, const Histogram *>& a, const std::pair<std::string, const Histogram *>& b)
+	{
+		return a.second->total > b.second->total;
+	});
+
+	if (top != 0 && entries.size() > top)
+		entries.resize(top);
+
+	UTIL_FOREACH_CREF(entries, entry)
+	{
+		lines.push_back(format_histogram(entry.first, *entry.second));
+	}
+}
+
+std::vector<std::string> Report(std::size_t top)
+{
+	std::vector<std::string> lines;
+	char buffer[128];
+
+	if (!enabled)
+	{
+		lines.push_back("Profiler is disabled");
+		return lines;
+	}
+
+	std::snprintf(buffer, sizeof(buffer), "Sampling for %lds, %llu tick overruns (>%s)",
+		long(std::time(0) - sample_start), static_cast<unsigned long long>(tick_overruns), format_ns(tick_budget).c_str());
+	lines.push_back(buffer);
+
+	lines.push_back(format_histogram("tick", tick_histogram));
+
+	std::vector<std::pair<std::string, const Histogram *>> entries;
+
+	for (std::size_t i = 0; i < handler_histograms.size(); ++i)
+	{
+		const Histogram *histogram = handler_histograms[i].get();
+
+		if (!histogram || histogram->count == 0)
+			continue;
+
+		std::string name = PacketProcessor::GetFamilyName(PacketFamily(i >> 8)) + "_" + PacketProcessor::GetActionName(PacketAction(i & 0xFF));
+		entries.push_back(std::make_pair(name, histogram));
+	}
+
+	lines.push_back("Packet handlers:");
+	report_section(lines, entries, top);
+
+	entries.clear();
+
+	UTIL_FOREACH_CREF(timer_stats, stats)
+	{
+		const Histogram *histogram = stats.second.histogram.get();
+
+		if (!histogram || histogram->count == 0)
+			continue;
+
+		std::string name = stats.second.name;
+
+		if (name.empty())
+		{
+			std::snprintf(buffer, sizeof(buffer), "%#llx", static_cast<unsigned long long>(stats.first));
+			name = buffer;
+		}
+
+		entries.push_back(std::make_pair(name, histogram));
+	}
+
+	lines.push_back("Timers:");
+	report_section(lines, entries, top);
+
+	return lines;
+}
+
+bool Dump(const std::string& filename)
+{
+	std::FILE *fh = std::fopen(filename.c_str(), "a");
+
+	if (!fh)
+		return false;
+
+	char timestr[32];
+	std::time_t rawtime = std::time(0);
+	std::strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", std::localtime(&rawtime));
+
+	std::fprintf(fh, "--- %s ---\n", timestr);
+
+	UTIL_FOREACH_CREF(Report(0), line)
+	{
+		std::fprintf(fh, "%s\n", line.c_str());
+	}
+
+	std::fprintf(fh, "\n");
+	std::fclose(fh);
+
+	return true;
+}
+
+Tick_Scope::Tick_Scope()
+{
+	if (enabled)
+	{
+		tick_idle = 0;
+		tick_start = clock::now();
+	}
+}
+
+Tick_Scope::~Tick_Scope()
+{
+	if (!enabled)
+		return;
+
+	std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - tick_start).count();
+	std::uint64_t busy = (elapsed > tick_idle) ? elapsed - tick_idle : 0;
+
+	tick_histogram.Record(busy);
+
+	if (busy > tick_budget)
+		++tick_overruns;
+}
+
+Idle_Scope::Idle_Scope()
+{
+	if (enabled)
+		idle_start = clock::now();
+}
+
+Idle_Scope::~Idle_Scope()
+{
+	if (enabled)
+		tick_idle += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - idle_start).count();
+}
+
+}
+
+#endif // PERF_PROFILER
@@ -0,0 +1,182 @@
+/* perf.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef PERF_HPP_INCLUDED
+#define PERF_HPP_INCLUDED
+
+#include "fwd/timer.hpp"
+
+#ifdef PERF_PROFILER
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Built-in tick profiler
+ * Times packet handlers, timer callbacks and whole server ticks using a monotonic clock.
+ * All instrumentation points are macros which expand to nothing unless PERF_PROFILER is defined.
+ */
+namespace Perf
+{
+
+typedef std::chrono::steady_clock clock;
+
+/**
+ * Log-linear latency histogram in nanoseconds
+ * Each power of two is split in to 8 sub-buckets, giving at most 12.5% error at any magnitude
+ */
+class Histogram
+{
+	public:
+		static const int SubBucketBits = 3;
+		static const int SubBuckets = 1 << SubBucketBits;
+		static const int Buckets = (64 - SubBucketBits + 1) * SubBuckets;
+
+	private:
+		std::uint32_t counts[Buckets];
+
+	public:
+		std::uint64_t count;
+		std::uint64_t total;
+		std::uint64_t max;
+
+		Histogram();
+
+		static int Bucket(std::uint64_t ns);
+
+		/**
+		 * Returns the highest value that falls in to a bucket
+		 */
+		static std::uint64_t BucketValue(int bucket);
+
+		void Record(std::uint64_t ns)
+		{
+			++this->counts[Bucket(ns)];
+			++this->count;
+			this->total += ns;
+
+			if (ns > this->max)
+				this->max = ns;
+		}
+
+		/**
+		 * @param p percentile in the range 0.0 - 100.0
+		 */
+		std::uint64_t Percentile(double p) const;
+
+		void Reset();
+};
+
+extern bool enabled;
+
+/**
+ * Returns the histogram for a packet family/action, or 0 if the profiler is disabled
+ */
+Histogram *HandlerHistogram(unsigned char family, unsigned char action);
+
+/**
+ * Returns the histogram for a timer callback, or 0 if the profiler is disabled
+ */
+Histogram *TimerHistogram(TimerCallback callback);
+
+/**
+ * Gives a timer callback a readable name in reports
+ */
+void NameTimer(TimerCallback callback, const char *name);
+
+void Enable(bool enable);
+void Reset();
+
+/**
+ * Sets the tick duration (in seconds) above which a tick is counted as an overrun
+ */
+void SetTickBudget(double budget);
+
+/**
+ * Builds a report listing tick statistics and the slowest handlers and timers
+ * @param top maximum number of handlers and timers to list, or 0 for all
+ */
+std::vector<std::string> Report(std::size_t top);
+
+/**
+ * Appends a full report to a file
+ */
+bool Dump(const std::string& filename);
+
+/**
+ * Records the time spent in a scope to a histogram
+ */
+class Scope
+{
+	private:
+		Histogram *histogram;
+		clock::time_point start;
+
+	public:
+		explicit Scope(Histogram *histogram)
+			: histogram(histogram)
+		{
+			if (histogram)
+				this->start = clock::now();
+		}
+
+		Scope(const Scope&) = delete;
+
+		~Scope()
+		{
+			if (this->histogram)
+				this->histogram->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - this->start).count());
+		}
+};
+
+/**
+ * Records the busy time of a server tick and counts overruns
+ */
+class Tick_Scope
+{
+	public:
+		Tick_Scope();
+		Tick_Scope(const Tick_Scope&) = delete;
+		~Tick_Scope();
+};
+
+/**
+ * Excludes time spent waiting for network activity from the enclosing Tick_Scope
+ */
+class Idle_Scope
+{
+	public:
+		Idle_Scope();
+		Idle_Scope(const Idle_Scope&) = delete;
+		~Idle_Scope();
+};
+
+}
+
+#define PERF_SCOPE_HANDLER(family, action) Perf::Scope perf_scope_(Perf::HandlerHistogram((family), (action)))
+#define PERF_SCOPE_TIMER(callback) Perf::Scope perf_scope_(Perf::TimerHistogram(callback))
+#define PERF_SCOPE_TICK() Perf::Tick_Scope perf_tick_scope_
+#define PERF_SCOPE_IDLE() Perf::Idle_Scope perf_idle_scope_
+// Each call site names its callback once, so it costs nothing on the paths that create timers
+#define PERF_NAME_TIMER(callback) \
+do { \
+	static const bool perf_named_ = (Perf::NameTimer((callback), #callback), true); \
+	(void)perf_named_; \
+} while (false)
+
+#else // PERF_PROFILER
+
+#define PERF_SCOPE_HANDLER(family, action)
+#define PERF_SCOPE_TIMER(callback)
+#define PERF_SCOPE_TICK()
+#define PERF_SCOPE_IDLE()
+#define PERF_NAME_TIMER(callback) ((void)0)
+
+#endif // PERF_PROFILER
+
+#endif // PERF_HPP_INCLUDED
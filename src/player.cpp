@@ -12,9 +12,7 @@
 #include "world.hpp"
 
 #include "console.hpp"
-#include "hash.hpp"
 #include "util.hpp"
-#include "util/secure_string.hpp"
 
 #include <algorithm>
 #include <ctime>
@@ -94,16 +92,6 @@ bool Player::AddCharacter(std::string name, Gender gender, int hairstyle, int ha
 	return true;
 }
 
-void Player::ChangePass(util::secure_string&& password)
-{
-	{
-		util::secure_string password_buffer(std::move(std::string(this->world->config["PasswordSalt"]) + this->username + password.str()));
-		password = sha256(password_buffer.str());
-	}
-
-	this->world->db.Query("UPDATE `accounts` SET `password` = '$' WHERE username = '$'", password.str().c_str(), this->username.c_str());
-}
-
 AdminLevel Player::Admin() const
 {
 	AdminLevel admin = ADMIN_PLAYER;
@@ -13,7 +13,6 @@
 #include "fwd/packet.hpp"
 #include "fwd/world.hpp"
 
-#include "util/secure_string.hpp"
 
 #include <string>
 #include <vector>
@@ -38,7 +37,6 @@ class Player
 
 		static bool ValidName(std::string username);
 		bool AddCharacter(std::string name, Gender gender, int hairstyle, int haircolor, Skin race);
-		void ChangePass(util::secure_string&& password);
 
 		AdminLevel Admin() const;
 
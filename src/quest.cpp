@@ -986,6 +986,22 @@ std::string Quest_Context::SerializeProgress() const
 	return serialized;
 }
 
+void Quest_Context::ProgressSnapshot(std::string &out) const
+{
+	std::size_t count = this->progress.size();
+
+	out += this->StateName();
+	out += '\0';
+	out.append(reinterpret_cast<const char *>(&count), sizeof count);
+
+	UTIL_FOREACH_CREF(this->progress, entry)
+	{
+		out += entry.first;
+		out += '\0';
+		out.append(reinterpret_cast<const char *>(&entry.second), sizeof entry.second);
+	}
+}
+
 std::string::const_iterator Quest_Context::UnserializeProgress(std::string::const_iterator it, std::string::const_iterator end)
 {
 	if (it == end || *it != '{')
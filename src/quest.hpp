@@ -13,6 +13,7 @@
 #include "fwd/world.hpp"
 #include "eoplus/context.hpp"
 
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <string>
@@ -72,6 +73,11 @@ class Quest_Context : public EOPlus::Context
 		ProgressInfo Progress() const;
 
 		std::string SerializeProgress() const;
+
+		/**
+		 * Appends the quest state and progress to a save snapshot, used to detect unsaved changes without serializing
+		 */
+		void ProgressSnapshot(std::string &out) const;
 		std::string::const_iterator UnserializeProgress(std::string::const_iterator it, std::string::const_iterator begin);
 
 		bool DialogInput(char link_id);
@@ -14,11 +14,17 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "platform.h"
@@ -210,17 +216,308 @@ bool IPAddress::operator ==(const IPAddress &other) const
 	return (this->address == other.address);
 }
 
+#ifndef WIN32
+/**
+ * A connection's data on its way between the game thread and the network thread
+ * Only the network thread's own buffers may be touched without holding IO_Thread::mutex.
+ */
+struct IO_Channel
+{
+	SOCKET sock;
+
+	// Set by the game thread
+	std::string out;
+	bool closed = false;
+
+	// Set by the network thread
+	std::string in;
+	bool failed = false;
+
+	// Network thread only
+	std::string reading;
+	std::string writing;
+	std::size_t written = 0;
+	bool broken = false;
+
+	IO_Channel(SOCKET sock)
+		: sock(sock)
+	{ }
+};
+
+/**
+ * Reads and writes a server's client sockets from a separate thread
+ * The thread also watches the listening socket, but leaves accepting to the game thread.
+ */
+struct IO_Thread
+{
+	SOCKET listener;
+	std::size_t in_max;
+	int wake_pipe[2];
+
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::vector<std::shared_ptr<IO_Channel>> channels;
+
+	// Set when there's input, a failure or a new connection for the game thread
+	bool pending = false;
+	bool accept_pending = false;
+	bool polling = false;
+	bool stopping = false;
+
+	std::thread thread;
+
+	IO_Thread(SOCKET listener, std::size_t in_max)
+		: listener(listener)
+		, in_max(in_max)
+		, wake_pipe{-1, -1}
+	{ }
+
+	/**
+	 * Interrupts the thread's poll() so it picks up changes, the mutex must be held
+	 */
+	void Wake()
+	{
+		if (!this->polling)
+			return;
+
+		this->polling = false;
+
+		char c = 0;
+		ssize_t result = write(this->wake_pipe[1], &c, 1);
+		(void)result;
+	}
+
+	void Run();
+
+	~IO_Thread()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+			this->Wake();
+		}
+
+		if (this->thread.joinable())
+			this->thread.join();
+
+		UTIL_FOREACH_CREF(this->channels, channel)
+		{
+			if (channel->closed)
+				close(channel->sock);
+		}
+
+		if (this->wake_pipe[0] != -1)
+		{
+			close(this->wake_pipe[0]);
+			close(this->wake_pipe[1]);
+		}
+	}
+};
+
+void IO_Thread::Run()
+{
+	std::vector<std::shared_ptr<IO_Channel>> active;
+	std::vector<pollfd> fds;
+	char buf[8192];
+
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			if (this->stopping)
+				break;
+
+			active.clear();
+			fds.clear();
+
+			pollfd fd;
+			fd.revents = 0;
+
+			fd.fd = this->wake_pipe[0];
+			fd.events = POLLIN;
+			fds.push_back(fd);
+
+			fd.fd = this->listener;
+			fd.events = this->accept_pending ? 0 : POLLIN;
+			fds.push_back(fd);
+
+			for (std::size_t i = 0; i < this->channels.size(); )
+			{
+				IO_Channel &channel = *this->channels[i];
+
+				// Sockets are only ever closed here, so poll() can't be watching one that's been reused
+				if (channel.closed)
+				{
+					close(channel.sock);
+					this->channels[i] = std::move(this->channels.back());
+					this->channels.pop_back();
+					continue;
+				}
+
+				++i;
+
+				if (channel.failed)
+					continue;
+
+				if (channel.writing.empty() && !channel.out.empty())
+				{
+					channel.writing.swap(channel.out);
+					channel.written = 0;
+				}
+
+				fd.fd = channel.sock;
+				fd.events = 0;
+
+				if (channel.in.size() < this->in_max)
+					fd.events |= POLLIN;
+
+				if (!channel.writing.empty())
+					fd.events |= POLLOUT;
+
+				fds.push_back(fd);
+				active.push_back(this->channels[i - 1]);
+			}
+
+			this->polling = true;
+		}
+
+		if (poll(&fds[0], fds.size(), -1) == -1)
+		{
+			if (errno != EINTR)
+			{
+				Console::Err("Network thread poll() failed: %s", OSErrorString());
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+
+			continue;
+		}
+
+		// Empty the wake pipe so it doesn't stay readable
+		if (fds[0].revents & POLLIN)
+		{
+			while (read(this->wake_pipe[0], buf, sizeof(buf)) > 0)
+				continue;
+		}
+
+		bool notify = false;
+
+		for (std::size_t i = 0; i < active.size(); ++i)
+		{
+			IO_Channel &channel = *active[i];
+			short revents = fds[i + 2].revents;
+
+			if (revents & (POLLERR | POLLHUP | POLLNVAL))
+			{
+				channel.broken = true;
+				continue;
+			}
+
+			if (revents & POLLIN)
+			{
+				const ssize_t received = recv(channel.sock, buf, sizeof(buf), MSG_DONTWAIT);
+
+				if (received > 0)
+					channel.reading.append(buf, received);
+				else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+					channel.broken = true;
+			}
+
+			if (revents & POLLOUT)
+			{
+				int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+				flags |= MSG_NOSIGNAL;
+#endif // MSG_NOSIGNAL
+
+				const ssize_t written = send(channel.sock, channel.writing.data() + channel.written, channel.writing.length() - channel.written, flags);
+
+				if (written >= 0)
+				{
+					channel.written += written;
+
+					if (channel.written == channel.writing.length())
+					{
+						channel.writing.clear();
+						channel.written = 0;
+					}
+				}
+				else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				{
+					channel.broken = true;
+				}
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			this->polling = false;
+
+			if (fds[1].revents & POLLIN)
+			{
+				this->accept_pending = true;
+				notify = true;
+			}
+
+			UTIL_FOREACH_CREF(active, channel)
+			{
+				if (!channel->reading.empty())
+				{
+					channel->in.append(channel->reading);
+					channel->reading.clear();
+					notify = true;
+				}
+
+				if (channel->broken && !channel->failed)
+				{
+					channel->failed = true;
+					notify = true;
+				}
+			}
+
+			if (notify)
+				this->pending = true;
+		}
+
+		if (notify)
+			this->ready.notify_one();
+	}
+}
+#endif // WIN32
+
 struct Client::impl_
 {
 	SOCKET sock;
 	sockaddr_in sin;
 
+#ifndef WIN32
+	// Set when the server's network thread handles this client's socket
+	std::shared_ptr<IO_Channel> channel;
+#endif // WIN32
+
 	impl_(const SOCKET &sock = SOCKET(), const sockaddr_in &sin = sockaddr_in())
 		: sock(sock)
 		, sin(sin)
 	{ }
 };
 
+struct Server::impl_
+{
+	fd_set read_fds;
+	fd_set write_fds;
+	fd_set except_fds;
+	SOCKET sock;
+
+#ifndef WIN32
+	std::unique_ptr<IO_Thread> io;
+#endif // WIN32
+
+	impl_(const SOCKET &sock = INVALID_SOCKET)
+		: sock(sock)
+	{ }
+};
+
 Client::Client()
 	: impl(new impl_(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)))
 	, server(0)
@@ -375,6 +672,17 @@ void Client::Send(const std::string &data)
 	}
 
 	this->send_buffer_used += data.length();
+
+	if (this->flush_policy == FlushImmediate)
+	{
+		if (!this->DoSend())
+			this->Close(true);
+	}
+	else if (this->server && !this->flush_queued)
+	{
+		this->flush_queued = true;
+		this->server->flush_queue.push_back(this);
+	}
 }
 
 bool Client::DoRecv()
@@ -410,11 +718,26 @@ bool Client::DoRecv()
 
 bool Client::DoSend()
 {
-	char buf[8192];
+	if (this->send_buffer_used == 0)
+		return true;
+
+#ifndef WIN32
+	if (this->impl->channel)
+	{
+		IO_Thread &io = *this->server->impl->io;
+		std::lock_guard<std::mutex> lock(io.mutex);
+		this->server->IOHandOver(this);
+		io.Wake();
+		return true;
+	}
+#endif // WIN32
 
 	const std::size_t mask = this->send_buffer.length() - 1;
 	const std::size_t gpos = this->send_buffer_gpos;
 
+#ifdef WIN32
+	char buf[8192];
+
 	std::size_t to_send;
 	for (to_send = 0; to_send < std::min(this->send_buffer_used, sizeof(buf)); ++to_send)
 	{
@@ -426,6 +749,30 @@ bool Client::DoSend()
 
 	if (written < 0 || written == SOCKET_ERROR)
 		return false;
+#else // WIN32
+	// The pending data wraps around the end of the buffer at most once, so it's written straight from the buffer in one call
+	const std::size_t head = std::min(this->send_buffer_used, this->send_buffer.length() - gpos);
+
+	iovec iov[2];
+	iov[0].iov_base = &this->send_buffer[gpos];
+	iov[0].iov_len = head;
+	iov[1].iov_base = &this->send_buffer[0];
+	iov[1].iov_len = this->send_buffer_used - head;
+
+	msghdr msg = msghdr();
+	msg.msg_iov = iov;
+	msg.msg_iovlen = (iov[1].iov_len > 0) ? 2 : 1;
+
+	int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+	flags |= MSG_NOSIGNAL;
+#endif // MSG_NOSIGNAL
+
+	const ssize_t written = sendmsg(this->impl->sock, &msg, flags);
+
+	if (written < 0)
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif // WIN32
 
 	this->send_buffer_gpos = (gpos + written) & mask;
 	this->send_buffer_used -= written;
@@ -593,19 +940,13 @@ time_t Client::ConnectTime() const
 Client::~Client()
 {
 	this->Close(true);
-}
-
-struct Server::impl_
-{
-	fd_set read_fds;
-	fd_set write_fds;
-	fd_set except_fds;
-	SOCKET sock;
 
-	impl_(const SOCKET &sock = INVALID_SOCKET)
-		: sock(sock)
-	{ }
-};
+	if (this->flush_queued)
+	{
+		std::vector<Client *> &queue = this->server->flush_queue;
+		queue.erase(std::remove(UTIL_RANGE(queue), this), queue.end());
+	}
+}
 
 Server::Server()
 	: impl(new impl_(socket(AF_INET, SOCK_STREAM, 0)))
@@ -681,6 +1022,20 @@ Client *Server::Poll()
 	unsigned long nonblocking;
 #endif // WIN32
 
+#ifndef WIN32
+	// The network thread says when there's a connection waiting
+	if (this->impl->io)
+	{
+		std::lock_guard<std::mutex> lock(this->impl->io->mutex);
+
+		if (!this->impl->io->accept_pending)
+			return 0;
+
+		this->impl->io->accept_pending = false;
+		this->impl->io->Wake();
+	}
+#endif // WIN32
+
 #ifdef WIN32
 	nonblocking = 1;
 	ioctlsocket(this->impl->sock, FIONBIO, &nonblocking);
@@ -709,11 +1064,7 @@ Client *Server::Poll()
 			if (!client->accepted)
 			{
 				client->Close(true);
-#ifdef WIN32
-				closesocket(client->impl->sock);
-#else // WIN32
-				close(client->impl->sock);
-#endif // WIN32
+				this->CloseSocket(client);
 				delete client;
 				it = this->clients.erase(it);
 				if (it == this->clients.end())
@@ -734,7 +1085,7 @@ Client *Server::Poll()
 	}
 
 #if !defined(SOCKET_POLL) && !defined(WIN32)
-	if (newsock >= FD_SETSIZE)
+	if (!this->impl->io && newsock >= FD_SETSIZE)
 	{
 		Console::Wrn("Client rejected due to file descriptor limits (%d / %d)", int(newsock), int(FD_SETSIZE) - 1);
 		this->maxconn = std::min<unsigned>(this->maxconn, this->clients.size() - 1);
@@ -751,6 +1102,17 @@ Client *Server::Poll()
 	newclient->SetRecvBuffer(this->recv_buffer_max);
 	newclient->SetSendBuffer(this->send_buffer_max);
 
+#ifndef WIN32
+	if (this->impl->io)
+	{
+		newclient->impl->channel = std::make_shared<IO_Channel>(newsock);
+
+		std::lock_guard<std::mutex> lock(this->impl->io->mutex);
+		this->impl->io->channels.push_back(newclient->impl->channel);
+		this->impl->io->Wake();
+	}
+#endif // WIN32
+
 	this->clients.push_back(newclient);
 
 	return newclient;
@@ -764,10 +1126,14 @@ std::vector<Client *> *Server::Select(double timeout)
 	int result;
 	pollfd fd;
 
+	if (this->impl->io)
+		return this->IOSelect(timeout);
+
 	fds.reserve(this->clients.size() + 1);
 
+	// Readable when there's a connection waiting for Poll()
 	fd.fd = this->impl->sock;
-	fd.events = POLLERR;
+	fd.events = POLLIN;
 	fds.push_back(fd);
 
 	UTIL_FOREACH(this->clients, client)
@@ -789,7 +1155,7 @@ std::vector<Client *> *Server::Select(double timeout)
 		fds.push_back(fd);
 	}
 
-	result = poll(&fds[0], fds.size(), long(timeout * 1000));
+	result = poll(&fds[0], fds.size(), long(std::ceil(timeout * 1000)));
 
 	if (result == -1)
 	{
@@ -798,7 +1164,7 @@ std::vector<Client *> *Server::Select(double timeout)
 
 	if (result > 0)
 	{
-		if (fds[0].revents & POLLERR == POLLERR)
+		if (fds[0].revents & POLLERR)
 		{
 			throw Socket_Exception("There was an exception on the listening socket.");
 		}
@@ -852,6 +1218,11 @@ std::vector<Client *> *Server::Select(double timeout)
 	SOCKET nfds = this->impl->sock;
 	int result;
 
+#ifndef WIN32
+	if (this->impl->io)
+		return this->IOSelect(timeout);
+#endif // WIN32
+
 	FD_ZERO(&this->impl->read_fds);
 	FD_ZERO(&this->impl->write_fds);
 	FD_ZERO(&this->impl->except_fds);
@@ -876,6 +1247,7 @@ std::vector<Client *> *Server::Select(double timeout)
 		}
 	}
 
+	FD_SET(this->impl->sock, &this->impl->read_fds);
 	FD_SET(this->impl->sock, &this->impl->except_fds);
 
 	result = select(nfds+1, &this->impl->read_fds, &this->impl->write_fds, &this->impl->except_fds, &timeout_val);
@@ -941,6 +1313,175 @@ std::vector<Client *> *Server::Select(double timeout)
 }
 #endif // defined(SOCKET_POLL) && !defined(WIN32)
 
+void Server::Flush()
+{
+#ifndef WIN32
+	if (this->impl->io)
+	{
+		std::lock_guard<std::mutex> lock(this->impl->io->mutex);
+
+		UTIL_FOREACH(this->flush_queue, client)
+		{
+			client->flush_queued = false;
+			this->IOHandOver(client);
+		}
+
+		this->flush_queue.clear();
+		this->impl->io->Wake();
+		return;
+	}
+#endif // WIN32
+
+	UTIL_FOREACH(this->flush_queue, client)
+	{
+		client->flush_queued = false;
+
+		if (!client->DoSend())
+			client->Close(true);
+	}
+
+	this->flush_queue.clear();
+}
+
+#ifndef WIN32
+void Server::IOHandOver(Client *client)
+{
+	IO_Channel &channel = *client->impl->channel;
+
+	// File uploads fill a send buffer bigger than this, so they're handed over a piece at a time
+	const std::size_t space = (channel.out.length() < this->send_buffer_max) ? this->send_buffer_max - channel.out.length() : 0;
+	const std::size_t length = std::min(client->send_buffer_used, space);
+
+	if (length == 0)
+		return;
+
+	const std::size_t mask = client->send_buffer.length() - 1;
+	const std::size_t gpos = client->send_buffer_gpos;
+	const std::size_t head = std::min(length, client->send_buffer.length() - gpos);
+
+	channel.out.append(&client->send_buffer[gpos], head);
+	channel.out.append(&client->send_buffer[0], length - head);
+
+	client->send_buffer_gpos = (gpos + length) & mask;
+	client->send_buffer_used -= length;
+}
+
+std::vector<Client *> *Server::IOSelect(double timeout)
+{
+	static std::vector<Client *> selected;
+	IO_Thread &io = *this->impl->io;
+	bool wake = false;
+
+	std::unique_lock<std::mutex> lock(io.mutex);
+
+	// Anything sent since the last Flush() goes out while waiting
+	UTIL_FOREACH(this->clients, client)
+	{
+		if (client->send_buffer_used > 0 && client->impl->channel)
+		{
+			this->IOHandOver(client);
+			wake = true;
+		}
+	}
+
+	if (wake)
+		io.Wake();
+
+	if (!io.pending && timeout > 0.0)
+		io.ready.wait_for(lock, std::chrono::duration<double>(timeout), [&io]() { return io.pending; });
+
+	io.pending = false;
+	wake = false;
+
+	UTIL_FOREACH(this->clients, client)
+	{
+		IO_Channel *channel = client->impl->channel.get();
+
+		if (!channel)
+			continue;
+
+		if (channel->failed)
+			client->Close(true);
+
+		if (!channel->in.empty())
+		{
+			const std::size_t mask = client->recv_buffer.length() - 1;
+			const std::size_t length = std::min(channel->in.length(), client->recv_buffer.length() - client->recv_buffer_used);
+
+			for (std::size_t i = 0; i < length; ++i)
+			{
+				client->recv_buffer_ppos = (client->recv_buffer_ppos + 1) & mask;
+				client->recv_buffer[client->recv_buffer_ppos] = channel->in[i];
+			}
+
+			client->recv_buffer_used += length;
+
+			// The thread stops reading from a client that's this far behind
+			if (channel->in.length() >= io.in_max && length > 0)
+				wake = true;
+
+			channel->in.erase(0, length);
+		}
+
+		if (client->recv_buffer_used > 0 || client->NeedTick())
+		{
+			selected.push_back(client);
+		}
+	}
+
+	if (wake)
+		io.Wake();
+
+	return &selected;
+}
+#endif // WIN32
+
+bool Server::StartIOThread()
+{
+#ifdef WIN32
+	return false;
+#else // WIN32
+	if (this->impl->io)
+		return true;
+
+	std::unique_ptr<IO_Thread> io(new IO_Thread(this->impl->sock, this->recv_buffer_max));
+
+	if (pipe(io->wake_pipe) != 0)
+		return false;
+
+	fcntl(io->wake_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(io->wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+	UTIL_FOREACH(this->clients, client)
+	{
+		client->impl->channel = std::make_shared<IO_Channel>(client->impl->sock);
+		io->channels.push_back(client->impl->channel);
+	}
+
+	io->thread = std::thread(&IO_Thread::Run, io.get());
+	this->impl->io = std::move(io);
+
+	return true;
+#endif // WIN32
+}
+
+void Server::CloseSocket(Client *client)
+{
+#ifdef WIN32
+	closesocket(client->impl->sock);
+#else // WIN32
+	if (client->impl->channel && this->impl->io)
+	{
+		std::lock_guard<std::mutex> lock(this->impl->io->mutex);
+		client->impl->channel->closed = true;
+		this->impl->io->Wake();
+		return;
+	}
+
+	close(client->impl->sock);
+#endif // WIN32
+}
+
 void Server::BuryTheDead()
 {
 	UTIL_IFOREACH(this->clients, it)
@@ -949,11 +1490,7 @@ void Server::BuryTheDead()
 
 		if (!client->Connected() && ((client->send_buffer.length() == 0 && client->recv_buffer.length() == 0) || client->closed_time + 2 < std::time(0)))
 		{
-#ifdef WIN32
-			closesocket(client->impl->sock);
-#else // WIN32
-			close(client->impl->sock);
-#endif // WIN32
+			this->CloseSocket(client);
 			delete client;
 			it = this->clients.erase(it);
 			if (it == this->clients.end())
@@ -964,6 +1501,11 @@ void Server::BuryTheDead()
 
 Server::~Server()
 {
+#ifndef WIN32
+	// Stopped first so the remaining sockets can be closed here
+	this->impl->io.reset();
+#endif // WIN32
+
 	UTIL_FOREACH(this->clients, client)
 	{
 #ifdef WIN32
@@ -214,6 +214,20 @@ struct Socket;
  */
 class Client
 {
+	public:
+		enum FlushPolicy
+		{
+			/**
+			 * Sent data waits for Server::Flush(), so everything sent during a tick goes out in one write.
+			 */
+			FlushBatched,
+
+			/**
+			 * Sent data is written straight away, for the lowest latency.
+			 */
+			FlushImmediate
+		};
+
 	private:
 		struct impl_;
 		std::unique_ptr<impl_> impl;
@@ -236,6 +250,10 @@ class Client
 		std::size_t send_buffer_ppos;
 		std::size_t send_buffer_used;
 
+		// Servers that call Flush() each tick opt in to FlushBatched
+		FlushPolicy flush_policy = FlushImmediate;
+		bool flush_queued = false;
+
 	public:
 		Client();
 		Client(const IPAddress &addr, std::uint16_t port);
@@ -253,12 +271,22 @@ class Client
 		std::size_t RecvBufferRemaining() { return this->recv_buffer.length() - this->recv_buffer_used; }
 		std::size_t SendBufferRemaining() { return this->send_buffer.length() - this->send_buffer_used; }
 
+		bool RecvPending() const { return this->recv_buffer_used > 0; }
+
 		std::string Recv(std::size_t length);
 		void Send(const std::string &data);
 
 		bool DoRecv();
+
+		/**
+		 * Writes as much of the send buffer as the socket will take without blocking.
+		 * @return false if the connection failed.
+		 */
 		bool DoSend();
 
+		void SetFlushPolicy(FlushPolicy policy) { this->flush_policy = policy; }
+		FlushPolicy GetFlushPolicy() const { return this->flush_policy; }
+
 		bool Select(double timeout);
 
 		bool Accepted() const { return accepted; }
@@ -351,6 +379,28 @@ class Server
 		 */
 		unsigned int maxconn;
 
+		/**
+		 * Clients that have been sent data since the last Flush().
+		 */
+		std::vector<Client *> flush_queue;
+
+	private:
+		/**
+		 * Moves as much of a client's unsent data to the network thread as its limit allows, whose mutex must be held.
+		 * The rest stays in the send buffer, so a client that stops reading is closed when that fills up.
+		 */
+		void IOHandOver(Client *client);
+
+		/**
+		 * Select() for when the network thread is running: waits for it to report input, then copies it in.
+		 */
+		std::vector<Client *> *IOSelect(double timeout);
+
+		/**
+		 * Closes a client's socket, or has the network thread close it.
+		 */
+		void CloseSocket(Client *client);
+
 	public:
 		/**
 		 * List of connected clients.
@@ -402,6 +452,20 @@ class Server
 		 */
 		std::vector<Client *> *Select(double timeout);
 
+		/**
+		 * Moves all reading and writing of client sockets to a separate thread.
+		 * Select() then waits for the thread instead of polling, and Flush() passes data to it without blocking.
+		 * Should be called after Listen(), and can't be undone.
+		 * @return false if the thread couldn't be started or isn't supported on this platform.
+		 */
+		bool StartIOThread();
+
+		/**
+		 * Writes out the data sent to clients since the last call, one write per client.
+		 * Clients that haven't been sent anything aren't touched.
+		 */
+		void Flush();
+
 		/**
 		 * Destroys any dead clients, should be called periodically.
 		 * All pointers to Client objects from this Server should be considered invalid after execution.
@@ -424,6 +488,8 @@ class Server
 		}
 
 		virtual ~Server();
+
+	friend class Client;
 };
 
 
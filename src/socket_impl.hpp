@@ -29,9 +29,8 @@ typedef int socklen_t;
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/select.h>
-#ifdef SOCKET_POLL
+#include <sys/uio.h>
 #include <sys/poll.h>
-#endif // SOCKET_POLL
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
@@ -0,0 +1,368 @@
+/* statusserver.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "statusserver.hpp"
+
+#include "config.hpp"
+#include "eoclient.hpp"
+#include "eoserver.hpp"
+#include "map.hpp"
+#include "metrics.hpp"
+#include "packet.hpp"
+#include "timer.hpp"
+#include "world.hpp"
+
+#include "util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+class StatusClient : public Client
+{
+	public:
+		std::array<char, 1024> request;
+		std::size_t request_length = 0;
+		bool answered = false;
+
+		StatusClient(const Socket &sock, Server *server)
+			: Client(sock, server)
+		{
+			// StatusServer::Tick() never calls Flush(), responses are written as soon as they're sent
+			this->SetFlushPolicy(FlushImmediate);
+		}
+
+		/**
+		 * Moves received data in to the request buffer
+		 * @return true once the end of the request headers has been received
+		 */
+		bool ReadRequest()
+		{
+			const std::size_t mask = this->recv_buffer.length() - 1;
+
+			while (this->recv_buffer_used > 0 && this->request_length < this->request.size())
+			{
+				this->recv_buffer_gpos = (this->recv_buffer_gpos + 1) & mask;
+				this->request[this->request_length++] = this->recv_buffer[this->recv_buffer_gpos];
+				--this->recv_buffer_used;
+			}
+
+			for (std::size_t i = 1; i < this->request_length; ++i)
+			{
+				if (this->request[i] == '\n' && (this->request[i - 1] == '\n' || (i >= 3 && std::memcmp(&this->request[i - 3], "\r\n\r", 3) == 0)))
+					return true;
+			}
+
+			return false;
+		}
+
+		bool RequestFull() const
+		{
+			return this->request_length == this->request.size();
+		}
+};
+
+static void append_format(std::string &out, const char *format, ...)
+{
+	char buffer[512];
+	va_list args;
+
+	va_start(args, format);
+	int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	if (length > 0)
+		out.append(buffer, std::min<std::size_t>(length, sizeof(buffer) - 1));
+}
+
+static void append_metric_header(std::string &out, const char *name, const char *type, const char *help)
+{
+	append_format(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void append_histogram(std::string &out, const char *name, const char *help, const Metrics::Histogram &histogram)
+{
+	append_metric_header(out, name, "histogram", help);
+
+	for (int i = 0; i < Metrics::Histogram::Buckets; ++i)
+		append_format(out, "%s_bucket{le=\"%g\"} %llu\n", name, Metrics::Histogram::bounds[i], static_cast<unsigned long long>(histogram.Cumulative(i)));
+
+	append_format(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, static_cast<unsigned long long>(histogram.Count()));
+	append_format(out, "%s_sum %.6f\n", name, histogram.Sum());
+	append_format(out, "%s_count %llu\n", name, static_cast<unsigned long long>(histogram.Count()));
+}
+
+static void action_queue_depth(EOServer *eoserver, std::size_t &total, std::size_t &max)
+{
+	total = 0;
+	max = 0;
+
+	UTIL_FOREACH(eoserver->clients, rawclient)
+	{
+		EOClient *client = static_cast<EOClient *>(rawclient);
+		std::size_t depth = client->queue.queue.size();
+
+		total += depth;
+		max = std::max(max, depth);
+	}
+}
+
+StatusServer::StatusServer(const IPAddress &addr, std::uint16_t port, EOServer *eoserver)
+	: Server(addr, port)
+	, eoserver(eoserver)
+{
+	this->recv_buffer_max = 1024;
+	this->send_buffer_max = 128 * 1024;
+
+	this->Listen(MaxConnections, MaxConnections);
+
+	for (std::size_t i = 0; i < this->family_names.size(); ++i)
+	{
+		std::string name = PacketProcessor::GetFamilyName(PacketFamily(i));
+
+		if (name == "UNKNOWN")
+			name = util::to_string(int(i));
+
+		this->family_names[i] = name;
+	}
+
+	this->body.reserve(this->send_buffer_max);
+	this->response.reserve(this->send_buffer_max);
+}
+
+Client *StatusServer::ClientFactory(const Socket &sock)
+{
+	return new StatusClient(sock, this);
+}
+
+void StatusServer::RenderMetrics()
+{
+	World *world = this->eoserver->world;
+	std::string &out = this->body;
+	std::size_t queue_total;
+	std::size_t queue_max;
+
+	action_queue_depth(this->eoserver, queue_total, queue_max);
+
+	out.clear();
+
+	append_metric_header(out, "eoserv_uptime_seconds", "gauge", "Time since the server was started.");
+	append_format(out, "eoserv_uptime_seconds %.3f\n", Timer::GetTime() - this->eoserver->start);
+
+	append_metric_header(out, "eoserv_connections", "gauge", "Open game client connections.");
+	append_format(out, "eoserv_connections %d\n", this->eoserver->Connections());
+
+	append_metric_header(out, "eoserv_connections_max", "gauge", "Maximum number of game client connections.");
+	append_format(out, "eoserv_connections_max %d\n", this->eoserver->MaxConnections());
+
+	append_metric_header(out, "eoserv_players_online", "gauge", "Characters logged in to the world.");
+	append_format(out, "eoserv_players_online %d\n", int(world->characters.size()));
+
+	append_metric_header(out, "eoserv_action_queue_depth", "gauge", "Packets waiting in client action queues.");
+	append_format(out, "eoserv_action_queue_depth %d\n", int(queue_total));
+
+	append_metric_header(out, "eoserv_action_queue_depth_max", "gauge", "Longest client action queue.");
+	append_format(out, "eoserv_action_queue_depth_max %d\n", int(queue_max));
+
+	append_histogram(out, "eoserv_tick_duration_seconds", "Time spent processing each server tick, excluding waiting for network activity.", Metrics::tick_duration);
+	append_histogram(out, "eoserv_input_latency_seconds", "Time from a packet being read to its handler being called, including action queue delays.", Metrics::input_latency);
+
+	append_metric_header(out, "eoserv_loop_wakeups_total", "counter", "Times the main loop has woken up.");
+	append_format(out, "eoserv_loop_wakeups_total %llu\n", static_cast<unsigned long long>(Metrics::loop.wakeups));
+
+	append_metric_header(out, "eoserv_idle_seconds_total", "counter", "Time the main loop has spent waiting for network activity or timers.");
+	append_format(out, "eoserv_idle_seconds_total %.6f\n", double(Metrics::loop.idle_ns) / 1000000000.0);
+
+	append_metric_header(out, "eoserv_cpu_seconds_total", "counter", "Processor time used by the server, on all threads.");
+	append_format(out, "eoserv_cpu_seconds_total %.6f\n", double(std::clock()) / CLOCKS_PER_SEC);
+	append_histogram(out, "eoserv_db_query_duration_seconds", "Database query latency.", Metrics::query_duration);
+
+	append_metric_header(out, "eoserv_packets_received_total", "counter", "Packets received from game clients by family.");
+
+	for (std::size_t i = 0; i < Metrics::traffic.packets_in.size(); ++i)
+	{
+		if (Metrics::traffic.packets_in[i] != 0)
+			append_format(out, "eoserv_packets_received_total{family=\"%s\"} %llu\n", this->family_names[i].c_str(), static_cast<unsigned long long>(Metrics::traffic.packets_in[i]));
+	}
+
+	append_metric_header(out, "eoserv_packets_sent_total", "counter", "Packets sent to game clients by family.");
+
+	for (std::size_t i = 0; i < Metrics::traffic.packets_out.size(); ++i)
+	{
+		if (Metrics::traffic.packets_out[i] != 0)
+			append_format(out, "eoserv_packets_sent_total{family=\"%s\"} %llu\n", this->family_names[i].c_str(), static_cast<unsigned long long>(Metrics::traffic.packets_out[i]));
+	}
+
+	append_metric_header(out, "eoserv_bytes_received_total", "counter", "Packet bytes received from game clients.");
+	append_format(out, "eoserv_bytes_received_total %llu\n", static_cast<unsigned long long>(Metrics::traffic.bytes_in));
+
+	append_metric_header(out, "eoserv_bytes_sent_total", "counter", "Packet bytes sent to game clients.");
+	append_format(out, "eoserv_bytes_sent_total %llu\n", static_cast<unsigned long long>(Metrics::traffic.bytes_out));
+
+	append_metric_header(out, "eoserv_map_players", "gauge", "Characters on each map.");
+
+	UTIL_FOREACH(world->maps, map)
+	{
+		if (map->exists)
+			append_format(out, "eoserv_map_players{map=\"%d\"} %d\n", int(map->id), int(map->characters.size()));
+	}
+}
+
+void StatusServer::RenderStatus()
+{
+	World *world = this->eoserver->world;
+	std::string &out = this->body;
+	std::size_t queue_total;
+	std::size_t queue_max;
+
+	action_queue_depth(this->eoserver, queue_total, queue_max);
+
+	std::uint64_t ticks = Metrics::tick_duration.Count();
+	std::uint64_t queries = Metrics::query_duration.Count();
+	std::uint64_t inputs = Metrics::input_latency.Count();
+
+	out.clear();
+
+	append_format(out, "{\"uptime\":%.3f,\"connections\":%d,\"max_connections\":%d,\"players\":%d,",
+		Timer::GetTime() - this->eoserver->start, this->eoserver->Connections(), this->eoserver->MaxConnections(), int(world->characters.size()));
+
+	append_format(out, "\"action_queue\":{\"total\":%d,\"max\":%d},", int(queue_total), int(queue_max));
+
+	append_format(out, "\"tick\":{\"count\":%llu,\"avg_ms\":%.3f},", static_cast<unsigned long long>(ticks),
+		ticks ? Metrics::tick_duration.Sum() * 1000.0 / double(ticks) : 0.0);
+
+	append_format(out, "\"db\":{\"queries\":%llu,\"avg_ms\":%.3f},", static_cast<unsigned long long>(queries),
+		queries ? Metrics::query_duration.Sum() * 1000.0 / double(queries) : 0.0);
+
+	append_format(out, "\"loop\":{\"wakeups\":%llu,\"idle_seconds\":%.3f,\"cpu_seconds\":%.3f},",
+		static_cast<unsigned long long>(Metrics::loop.wakeups), double(Metrics::loop.idle_ns) / 1000000000.0, double(std::clock()) / CLOCKS_PER_SEC);
+
+	append_format(out, "\"input_latency\":{\"count\":%llu,\"avg_ms\":%.3f},", static_cast<unsigned long long>(inputs),
+		inputs ? Metrics::input_latency.Sum() * 1000.0 / double(inputs) : 0.0);
+
+	out += "\"maps\":[";
+
+	bool first = true;
+
+	UTIL_FOREACH(world->maps, map)
+	{
+		if (map->characters.empty())
+			continue;
+
+		append_format(out, "%s{\"id\":%d,\"players\":%d}", first ? "" : ",", int(map->id), int(map->characters.size()));
+		first = false;
+	}
+
+	out += "]}\n";
+}
+
+void StatusServer::Respond(Client *client, const char *status, const char *content_type)
+{
+	this->response.clear();
+
+	append_format(this->response, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n",
+		status, content_type, int(this->body.length()));
+
+	this->response += this->body;
+
+	client->Send(this->response);
+	client->FinishWriting();
+	client->Close();
+}
+
+void StatusServer::Tick()
+{
+	std::vector<Client *> *active_clients = 0;
+
+	while (this->Poll())
+		;
+
+	try
+	{
+		active_clients = this->Select(0.0);
+	}
+	catch (Socket_SelectFailed &e)
+	{
+		if (errno != EINTR)
+			throw;
+	}
+
+	if (active_clients)
+	{
+		UTIL_FOREACH(*active_clients, rawclient)
+		{
+			StatusClient *client = static_cast<StatusClient *>(rawclient);
+
+			if (!client->Connected() || client->answered)
+				continue;
+
+			if (!client->ReadRequest())
+			{
+				if (client->RequestFull())
+				{
+					client->answered = true;
+					this->body = "Request too large\n";
+					this->Respond(client, "431 Request Header Fields Too Large", "text/plain");
+				}
+
+				continue;
+			}
+
+			client->answered = true;
+
+			const char *request = client->request.data();
+			std::size_t length = client->request_length;
+
+			if (length <= 4 || std::memcmp(request, "GET ", 4) != 0)
+			{
+				this->body = "Method not allowed\n";
+				this->Respond(client, "405 Method Not Allowed", "text/plain");
+				continue;
+			}
+
+			const char *path = request + 4;
+			std::size_t path_length = 0;
+
+			while (4 + path_length < length && path[path_length] != ' ' && path[path_length] != '?' && path[path_length] != '\r')
+				++path_length;
+
+			if (path_length == 8 && std::memcmp(path, "/metrics", 8) == 0)
+			{
+				this->RenderMetrics();
+				this->Respond(client, "200 OK", "text/plain; version=0.0.4");
+			}
+			else if ((path_length == 7 && std::memcmp(path, "/status", 7) == 0) || (path_length == 1 && path[0] == '/'))
+			{
+				this->RenderStatus();
+				this->Respond(client, "200 OK", "application/json");
+			}
+			else
+			{
+				this->body = "Not found\n";
+				this->Respond(client, "404 Not Found", "text/plain");
+			}
+		}
+
+		active_clients->clear();
+	}
+
+	std::time_t now = std::time(0);
+
+	UTIL_FOREACH(this->clients, client)
+	{
+		if (client->Connected() && client->ConnectTime() + RequestTimeout < now)
+			client->Close(true);
+	}
+
+	this->BuryTheDead();
+}
@@ -0,0 +1,62 @@
+/* statusserver.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef STATUSSERVER_HPP_INCLUDED
+#define STATUSSERVER_HPP_INCLUDED
+
+#include "fwd/statusserver.hpp"
+
+#include "fwd/eoserver.hpp"
+
+#include "socket.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+ * Minimal HTTP/1.1 server exposing server health for monitoring tools
+ * GET /metrics returns Prometheus text format, GET /status (or /) returns JSON.
+ * Each connection is answered once and then closed.
+ * Response buffers are reused, so serving does not allocate once warmed up.
+ */
+class StatusServer : public Server
+{
+	private:
+		EOServer *eoserver;
+
+		std::string body;
+		std::string response;
+
+		std::array<std::string, 256> family_names;
+
+		void RenderMetrics();
+		void RenderStatus();
+
+		void Respond(Client *client, const char *status, const char *content_type);
+
+	protected:
+		virtual Client *ClientFactory(const Socket &);
+
+	public:
+		/**
+		 * Maximum number of monitoring connections open at once
+		 */
+		static const int MaxConnections = 8;
+
+		/**
+		 * Seconds a connection may stay open without sending a complete request
+		 */
+		static const int RequestTimeout = 10;
+
+		StatusServer(const IPAddress &addr, std::uint16_t port, EOServer *eoserver);
+
+		/**
+		 * Accepts connections and answers any complete requests without blocking
+		 */
+		void Tick();
+};
+
+#endif // STATUSSERVER_HPP_INCLUDED
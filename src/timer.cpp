@@ -8,11 +8,14 @@
 #include "database.hpp"
 
 #include "console.hpp"
+#include "perf.hpp"
 #include "socket.hpp"
 #include "util.hpp"
 
+#include <algorithm>
 #include <ctime>
 #include <exception>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 
@@ -193,6 +196,8 @@ void Timer::Tick()
 				}
 			}
 
+			PERF_SCOPE_TIMER(timer->callback);
+
 #ifndef DEBUG_EXCEPTIONS
 			try
 			{
@@ -237,6 +242,19 @@ void Timer::Tick()
 	}
 }
 
+double Timer::NextDeadline() const
+{
+	double deadline = std::numeric_limits<double>::infinity();
+
+	UTIL_FOREACH(this->timers, timer)
+	{
+		deadline = std::min(deadline, timer->lasttime + timer->speed);
+	}
+
+	// Events fire once the clock has passed their deadline, and the clock counts whole milliseconds
+	return deadline + 0.001;
+}
+
 void Timer::Register(TimeEvent *timer)
 {
 	if (timer->lifetime == 0)
@@ -83,6 +83,12 @@ class Timer
 		 */
 		void Tick();
 
+		/**
+		 * Returns the earliest time at which Tick() will call an event
+		 * Returns infinity if there are no events.
+		 */
+		double NextDeadline() const;
+
 		/**
 		 * Register a TimeEvent object with the Timer object
 		 */
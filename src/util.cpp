@@ -16,6 +16,7 @@
 #include <utility>
 #include <vector>
 
+#include "util/rng.hpp"
 #include "util/variant.hpp"
 
 #include "platform.h"
@@ -272,49 +273,19 @@ std::string ucfirst(const std::string& subject)
 	return result;
 }
 
-struct rand_init
-{
-	rand_init()
-	{
-		static bool initialized;
-
-		if (!initialized)
-		{
-			initialized = true;
-			init();
-		}
-	}
-
-	void init() const
-	{
-		std::srand(std::time(0));
-	}
-};
-
-rand_init rand_init_instance;
-
-static unsigned long long_rand()
+int rand(int min, int max)
 {
-	typedef unsigned long ul;
-#if RAND_MAX < 65535
-	return ul(std::rand() & 0xFF) << 24 | ul(std::rand() & 0xFF) << 16 | ul(std::rand() & 0xFF) << 8 | ul(std::rand() & 0xFF);
-#else
-#if RAND_MAX < 4294967295
-	return ul(std::rand() & 0xFFFF) << 16 | ul(std::rand() & 0xFFFF);
-#else
-	return ul(std::rand() & 0xFFFFFFFFU);
-#endif
-#endif
+	return rng::thread().range(min, max);
 }
 
-int rand(int min, int max)
+double rand(double min, double max)
 {
-	return int(double(long_rand()) / 4294967296.0 * double(max - min + 1) + double(min));
+	return rng::thread().range(min, max);
 }
 
-double rand(double min, double max)
+void rand_seed(unsigned int seed)
 {
-	return double(long_rand()) / 4294967296.0 * (max - min) + min;
+	rng::seed_all(seed);
 }
 
 double round(double subject)
@@ -82,9 +82,18 @@ std::string uppercase(const std::string&);
 
 std::string ucfirst(const std::string&);
 
+/**
+ * Random numbers from the calling thread's util::rng
+ */
 int rand(int min, int max);
 double rand(double min, double max);
 
+/**
+ * Restarts the calling thread's rand() sequence from a fixed seed
+ * Threads and per-map generators created afterwards are seeded from it too.
+ */
+void rand_seed(unsigned int seed);
+
 double round(double);
 
 std::string timeago(double time, double current_time);
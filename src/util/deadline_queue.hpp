@@ -0,0 +1,162 @@
+/* util/deadline_queue.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef UTIL_DEADLINE_QUEUE_HPP_INCLUDED
+#define UTIL_DEADLINE_QUEUE_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+namespace util
+{
+
+/**
+ * A min-heap of objects ordered by deadline, for finding which timers are due
+ * without visiting every object.
+ * Each object records its position in the heap in the member given by Slot, so
+ * it can be rescheduled or removed in O(log n). An object can be in any number
+ * of queues as long as each uses a different Slot member.
+ * Objects must be removed (or the queue cleared) before they are destroyed.
+ */
+template <class T, std::size_t T::*Slot> class deadline_queue
+{
+	public:
+		static const std::size_t npos = std::size_t(-1);
+
+	private:
+		struct entry
+		{
+			double deadline;
+			T *item;
+		};
+
+		std::vector<entry> heap_;
+
+		void place(std::size_t i, const entry &e)
+		{
+			this->heap_[i] = e;
+			e.item->*Slot = i;
+		}
+
+		void sift_up(std::size_t i)
+		{
+			entry e = this->heap_[i];
+
+			while (i > 0)
+			{
+				std::size_t parent = (i - 1) / 2;
+
+				if (!(e.deadline < this->heap_[parent].deadline))
+					break;
+
+				this->place(i, this->heap_[parent]);
+				i = parent;
+			}
+
+			this->place(i, e);
+		}
+
+		void sift_down(std::size_t i)
+		{
+			entry e = this->heap_[i];
+			std::size_t size = this->heap_.size();
+
+			for (;;)
+			{
+				std::size_t child = i * 2 + 1;
+
+				if (child >= size)
+					break;
+
+				if (child + 1 < size && this->heap_[child + 1].deadline < this->heap_[child].deadline)
+					++child;
+
+				if (!(this->heap_[child].deadline < e.deadline))
+					break;
+
+				this->place(i, this->heap_[child]);
+				i = child;
+			}
+
+			this->place(i, e);
+		}
+
+		void remove_at(std::size_t i)
+		{
+			this->heap_[i].item->*Slot = npos;
+
+			entry last = this->heap_.back();
+			this->heap_.pop_back();
+
+			if (i == this->heap_.size())
+				return;
+
+			this->place(i, last);
+
+			if (i > 0 && last.deadline < this->heap_[(i - 1) / 2].deadline)
+				this->sift_up(i);
+			else
+				this->sift_down(i);
+		}
+
+	public:
+		bool empty() const { return this->heap_.empty(); }
+		std::size_t size() const { return this->heap_.size(); }
+
+		static bool contains(const T *item) { return item->*Slot != npos; }
+
+		/**
+		 * Adds an object, or moves it to a new deadline if it's already queued
+		 */
+		void push(T *item, double deadline)
+		{
+			std::size_t i = item->*Slot;
+
+			if (i == npos)
+			{
+				this->heap_.push_back(entry{deadline, item});
+				this->sift_up(this->heap_.size() - 1);
+				return;
+			}
+
+			double old_deadline = this->heap_[i].deadline;
+			this->heap_[i].deadline = deadline;
+
+			if (deadline < old_deadline)
+				this->sift_up(i);
+			else
+				this->sift_down(i);
+		}
+
+		void erase(T *item)
+		{
+			if (item->*Slot != npos)
+				this->remove_at(item->*Slot);
+		}
+
+		T *top() const { return this->heap_.front().item; }
+		double top_deadline() const { return this->heap_.front().deadline; }
+
+		T *pop()
+		{
+			T *item = this->heap_.front().item;
+			this->remove_at(0);
+			return item;
+		}
+
+		void clear()
+		{
+			for (const entry &e : this->heap_)
+				e.item->*Slot = npos;
+
+			this->heap_.clear();
+		}
+};
+
+template <class T, std::size_t T::*Slot> const std::size_t deadline_queue<T, Slot>::npos;
+
+}
+
+#endif // UTIL_DEADLINE_QUEUE_HPP_INCLUDED
@@ -0,0 +1,225 @@
+/* util/id_vector.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef UTIL_ID_VECTOR_HPP_INCLUDED
+#define UTIL_ID_VECTOR_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace util
+{
+
+/**
+ * A contiguous list of objects with a unique "id" member, kept in insertion
+ * order, with an open-addressing index from id to slot for O(1) lookup.
+ * The id of an element must not be changed while it is stored.
+ */
+template <class T> class id_vector
+{
+	public:
+		typedef typename std::vector<T>::iterator iterator;
+		typedef typename std::vector<T>::const_iterator const_iterator;
+		typedef typename std::vector<T>::size_type size_type;
+		typedef T value_type;
+
+	private:
+		typedef std::uint32_t slot_type;
+
+		std::vector<T> items_;
+
+		/**
+		 * Linear-probed hash table of (slot + 1), 0 means empty.
+		 * Always a power of two in size and at most half full.
+		 */
+		std::vector<slot_type> index_;
+
+		std::size_t mask() const
+		{
+			return this->index_.size() - 1;
+		}
+
+		std::size_t home(int id) const
+		{
+			return (std::uint32_t(id) * 0x9E3779B1U) & this->mask();
+		}
+
+		// Returns the table position holding id, or the empty position it would be placed at
+		std::size_t probe(int id) const
+		{
+			std::size_t i = this->home(id);
+
+			while (this->index_[i] != 0 && this->items_[this->index_[i] - 1].id != id)
+				i = (i + 1) & this->mask();
+
+			return i;
+		}
+
+		void rehash(std::size_t count)
+		{
+			std::size_t capacity = 16;
+
+			while (capacity < count * 2)
+				capacity *= 2;
+
+			if (capacity == this->index_.size())
+				return;
+
+			this->index_.assign(capacity, 0);
+
+			for (std::size_t slot = 0; slot < this->items_.size(); ++slot)
+				this->index_[this->probe(this->items_[slot].id)] = slot_type(slot + 1);
+		}
+
+		void unindex(std::size_t i)
+		{
+			std::size_t j = i;
+
+			for (;;)
+			{
+				j = (j + 1) & this->mask();
+
+				if (this->index_[j] == 0)
+					break;
+
+				std::size_t k = this->home(this->items_[this->index_[j] - 1].id);
+
+				// Entry at j may stay if its home position lies cyclically within (i, j]
+				if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+					continue;
+
+				this->index_[i] = this->index_[j];
+				i = j;
+			}
+
+			this->index_[i] = 0;
+		}
+
+	public:
+		id_vector()
+			: index_(16, 0)
+		{ }
+
+		iterator begin() { return this->items_.begin(); }
+		iterator end() { return this->items_.end(); }
+		const_iterator begin() const { return this->items_.begin(); }
+		const_iterator end() const { return this->items_.end(); }
+		const_iterator cbegin() const { return this->items_.cbegin(); }
+		const_iterator cend() const { return this->items_.cend(); }
+
+		size_type size() const { return this->items_.size(); }
+		bool empty() const { return this->items_.empty(); }
+
+		void reserve(size_type count)
+		{
+			this->items_.reserve(count);
+
+			if (count * 2 > this->index_.size())
+				this->rehash(count);
+		}
+
+		void clear()
+		{
+			this->items_.clear();
+			this->index_.assign(16, 0);
+		}
+
+		iterator find(int id)
+		{
+			slot_type slot = this->index_[this->probe(id)];
+			return slot ? this->items_.begin() + (slot - 1) : this->items_.end();
+		}
+
+		const_iterator find(int id) const
+		{
+			slot_type slot = this->index_[this->probe(id)];
+			return slot ? this->items_.begin() + (slot - 1) : this->items_.end();
+		}
+
+		T *get(int id)
+		{
+			slot_type slot = this->index_[this->probe(id)];
+			return slot ? &this->items_[slot - 1] : nullptr;
+		}
+
+		const T *get(int id) const
+		{
+			slot_type slot = this->index_[this->probe(id)];
+			return slot ? &this->items_[slot - 1] : nullptr;
+		}
+
+		bool contains(int id) const
+		{
+			return this->index_[this->probe(id)] != 0;
+		}
+
+		/**
+		 * Appends an element if its id is not already present
+		 * @return iterator to the element with that id, and whether it was inserted
+		 */
+		std::pair<iterator, bool> insert(const T &value)
+		{
+			std::size_t i = this->probe(value.id);
+
+			if (this->index_[i] != 0)
+				return std::make_pair(this->items_.begin() + (this->index_[i] - 1), false);
+
+			if ((this->items_.size() + 1) * 2 > this->index_.size())
+			{
+				this->items_.push_back(value);
+				this->rehash(this->items_.size());
+			}
+			else
+			{
+				this->items_.push_back(value);
+				this->index_[i] = slot_type(this->items_.size());
+			}
+
+			return std::make_pair(this->items_.end() - 1, true);
+		}
+
+		/**
+		 * Alias of insert() for code written against sequence containers
+		 */
+		void push_back(const T &value)
+		{
+			this->insert(value);
+		}
+
+		/**
+		 * Removes an element, preserving the order of the remaining elements
+		 * @return iterator to the element following the removed one
+		 */
+		iterator erase(const_iterator it)
+		{
+			std::size_t pos = std::size_t(it - this->items_.cbegin());
+
+			this->unindex(this->probe(it->id));
+
+			// Re-point the entries of every element that is about to shift down by one.
+			// Ids are unique, so a stale entry can never falsely match another id mid-update.
+			for (std::size_t slot = pos + 1; slot < this->items_.size(); ++slot)
+				this->index_[this->probe(this->items_[slot].id)] = slot_type(slot);
+
+			return this->items_.erase(this->items_.begin() + pos);
+		}
+
+		bool erase(int id)
+		{
+			const_iterator it = static_cast<const id_vector *>(this)->find(id);
+
+			if (it == this->items_.cend())
+				return false;
+
+			this->erase(it);
+			return true;
+		}
+};
+
+}
+
+#endif // UTIL_ID_VECTOR_HPP_INCLUDED
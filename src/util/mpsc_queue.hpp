@@ -0,0 +1,155 @@
+/* util/mpsc_queue.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef UTIL_MPSC_QUEUE_HPP_INCLUDED
+#define UTIL_MPSC_QUEUE_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace util
+{
+
+/**
+ * Bounded lock-free queue for any number of producer threads and a single
+ * consumer thread. Pushing never blocks or allocates: it fails when full.
+ * Based on Dmitry Vyukov's bounded MPMC queue.
+ */
+template <class T> class mpsc_queue
+{
+	private:
+		struct cell
+		{
+			std::atomic<std::size_t> sequence;
+			T data;
+		};
+
+		std::unique_ptr<cell[]> buffer_;
+		std::size_t mask_;
+
+		alignas(64) std::atomic<std::size_t> enqueue_pos_;
+		alignas(64) std::size_t dequeue_pos_;
+
+	public:
+		/**
+		 * @param capacity maximum number of queued elements, rounded up to a power of two
+		 */
+		explicit mpsc_queue(std::size_t capacity)
+			: enqueue_pos_(0)
+			, dequeue_pos_(0)
+		{
+			std::size_t size = 2;
+
+			while (size < capacity)
+				size *= 2;
+
+			this->buffer_.reset(new cell[size]);
+			this->mask_ = size - 1;
+
+			for (std::size_t i = 0; i < size; ++i)
+				this->buffer_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		mpsc_queue(const mpsc_queue&) = delete;
+		mpsc_queue& operator =(const mpsc_queue&) = delete;
+
+		std::size_t capacity() const
+		{
+			return this->mask_ + 1;
+		}
+
+		/**
+		 * Claims a slot and calls fill(T&) to write the element in place.
+		 * Safe to call from any thread.
+		 * @return false if the queue was full
+		 */
+		template <class F> bool push_with(F&& fill)
+		{
+			cell *c;
+			std::size_t pos = this->enqueue_pos_.load(std::memory_order_relaxed);
+
+			for (;;)
+			{
+				c = &this->buffer_[pos & this->mask_];
+				std::size_t seq = c->sequence.load(std::memory_order_acquire);
+				std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos);
+
+				if (diff == 0)
+				{
+					if (this->enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = this->enqueue_pos_.load(std::memory_order_relaxed);
+				}
+			}
+
+			fill(c->data);
+			c->sequence.store(pos + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		bool try_push(const T& value)
+		{
+			return this->push_with([&](T& slot) { slot = value; });
+		}
+
+		bool try_push(T&& value)
+		{
+			return this->push_with([&](T& slot) { slot = std::move(value); });
+		}
+
+		/**
+		 * Removes the oldest element. Must only be called from the consumer thread.
+		 * @return false if the queue was empty
+		 */
+		bool try_pop(T& value)
+		{
+			cell *c = &this->buffer_[this->dequeue_pos_ & this->mask_];
+			std::size_t seq = c->sequence.load(std::memory_order_acquire);
+
+			if (std::intptr_t(seq) - std::intptr_t(this->dequeue_pos_ + 1) < 0)
+				return false;
+
+			value = std::move(c->data);
+			c->sequence.store(this->dequeue_pos_ + this->mask_ + 1, std::memory_order_release);
+			++this->dequeue_pos_;
+
+			return true;
+		}
+
+		/**
+		 * Calls consume(T&) on the oldest element in place, then removes it.
+		 * Must only be called from the consumer thread.
+		 * @return false if the queue was empty
+		 */
+		template <class F> bool pop_with(F&& consume)
+		{
+			cell *c = &this->buffer_[this->dequeue_pos_ & this->mask_];
+			std::size_t seq = c->sequence.load(std::memory_order_acquire);
+
+			if (std::intptr_t(seq) - std::intptr_t(this->dequeue_pos_ + 1) < 0)
+				return false;
+
+			consume(c->data);
+			c->sequence.store(this->dequeue_pos_ + this->mask_ + 1, std::memory_order_release);
+			++this->dequeue_pos_;
+
+			return true;
+		}
+};
+
+}
+
+#endif // UTIL_MPSC_QUEUE_HPP_INCLUDED
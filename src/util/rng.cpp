@@ -0,0 +1,100 @@
+/* util/rng.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "rng.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+namespace util
+{
+
+static std::atomic<std::uint64_t> rng_global_seed(std::uint64_t(std::time(0)));
+
+// Stream numbers handed out to threads and default-constructed generators
+static std::atomic<std::uint64_t> rng_next_stream(0);
+
+static std::uint64_t splitmix64(std::uint64_t &x)
+{
+	std::uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+rng::rng()
+{
+	this->seed(rng::stream_seed(rng_next_stream.fetch_add(1) | (std::uint64_t(1) << 63)));
+}
+
+rng::rng(std::uint64_t seed)
+{
+	this->seed(seed);
+}
+
+void rng::seed(std::uint64_t seed)
+{
+	for (int i = 0; i < 4; ++i)
+		this->s_[i] = splitmix64(seed);
+}
+
+void rng::fill(int *out, std::size_t count, int min, int max)
+{
+	if (max <= min)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			out[i] = min;
+
+		return;
+	}
+
+	std::uint64_t span = std::uint64_t(std::int64_t(max) - std::int64_t(min)) + 1;
+
+	if (span > 0xFFFFFFFFULL)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			out[i] = int(std::int64_t(min) + std::int64_t(this->next32()));
+
+		return;
+	}
+
+	std::uint32_t bound = std::uint32_t(span);
+
+	for (std::size_t i = 0; i < count; ++i)
+		out[i] = int(std::int64_t(min) + std::int64_t(this->bounded(bound)));
+}
+
+void rng::fill(double *out, std::size_t count, double min, double max)
+{
+	double scale = (max - min) * (1.0 / 9007199254740992.0);
+
+	for (std::size_t i = 0; i < count; ++i)
+		out[i] = double((*this)() >> 11) * scale + min;
+}
+
+rng &rng::thread()
+{
+	thread_local rng generator(rng::stream_seed(rng_next_stream.fetch_add(1)));
+	return generator;
+}
+
+void rng::seed_all(std::uint64_t seed)
+{
+	rng &generator = rng::thread();
+
+	rng_global_seed = seed;
+	rng_next_stream = 1;
+	generator.seed(rng::stream_seed(0));
+}
+
+std::uint64_t rng::stream_seed(std::uint64_t stream)
+{
+	std::uint64_t x = rng_global_seed.load() ^ (stream * 0xD1B54A32D192ED03ULL);
+	return splitmix64(x);
+}
+
+}
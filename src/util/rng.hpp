@@ -0,0 +1,148 @@
+/* util/rng.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef UTIL_RNG_HPP_INCLUDED
+#define UTIL_RNG_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+
+/**
+ * Fast non-cryptographic random number generator (xoshiro256**).
+ * Each instance has its own state, so one can be kept per thread or per map
+ * without locking. Satisfies UniformRandomBitGenerator for use with <random>.
+ */
+class rng
+{
+	private:
+		std::uint64_t s_[4];
+
+		static std::uint64_t rotl(std::uint64_t x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+
+	public:
+		typedef std::uint64_t result_type;
+
+		/**
+		 * Seeds from the next unused stream of the global seed, see stream_seed()
+		 */
+		rng();
+		explicit rng(std::uint64_t seed);
+
+		void seed(std::uint64_t seed);
+
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return ~result_type(0); }
+
+		result_type operator ()()
+		{
+			std::uint64_t result = rotl(this->s_[1] * 5, 7) * 9;
+			std::uint64_t t = this->s_[1] << 17;
+
+			this->s_[2] ^= this->s_[0];
+			this->s_[3] ^= this->s_[1];
+			this->s_[1] ^= this->s_[2];
+			this->s_[0] ^= this->s_[3];
+			this->s_[2] ^= t;
+			this->s_[3] = rotl(this->s_[3], 45);
+
+			return result;
+		}
+
+		std::uint32_t next32()
+		{
+			return std::uint32_t((*this)() >> 32);
+		}
+
+		/**
+		 * Unbiased integer in [0, bound), using Lemire's multiply-and-reject method
+		 */
+		std::uint32_t bounded(std::uint32_t bound)
+		{
+			std::uint64_t m = std::uint64_t(this->next32()) * bound;
+			std::uint32_t low = std::uint32_t(m);
+
+			if (low < bound)
+			{
+				std::uint32_t threshold = std::uint32_t(-bound) % bound;
+
+				while (low < threshold)
+				{
+					m = std::uint64_t(this->next32()) * bound;
+					low = std::uint32_t(m);
+				}
+			}
+
+			return std::uint32_t(m >> 32);
+		}
+
+		/**
+		 * Unbiased integer in [min, max], or min if max < min
+		 */
+		int range(int min, int max)
+		{
+			if (max <= min)
+				return min;
+
+			std::uint64_t span = std::uint64_t(std::int64_t(max) - std::int64_t(min)) + 1;
+
+			if (span > 0xFFFFFFFFULL)
+				return int(std::int64_t(min) + std::int64_t(this->next32()));
+
+			return int(std::int64_t(min) + std::int64_t(this->bounded(std::uint32_t(span))));
+		}
+
+		/**
+		 * Uniform double in [0, 1) with 53 bits of precision
+		 */
+		double real()
+		{
+			return double((*this)() >> 11) * (1.0 / 9007199254740992.0);
+		}
+
+		/**
+		 * Uniform double in [min, max)
+		 */
+		double range(double min, double max)
+		{
+			return this->real() * (max - min) + min;
+		}
+
+		/**
+		 * Fills an array with unbiased integers in [min, max], for batches of rolls
+		 */
+		void fill(int *out, std::size_t count, int min, int max);
+
+		/**
+		 * Fills an array with doubles in [min, max)
+		 */
+		void fill(double *out, std::size_t count, double min, double max);
+
+		/**
+		 * Generator for the calling thread, seeded on first use
+		 */
+		static rng &thread();
+
+		/**
+		 * Sets the global seed and reseeds the calling thread's generator from it
+		 * Generators created afterwards, and threads that first use thread() afterwards, derive their seeds from it.
+		 */
+		static void seed_all(std::uint64_t seed);
+
+		/**
+		 * Seed for an independent stream, such as one per map, derived from the global seed
+		 * The same global seed and stream number always give the same sequence.
+		 */
+		static std::uint64_t stream_seed(std::uint64_t stream);
+};
+
+}
+
+#endif // UTIL_RNG_HPP_INCLUDED
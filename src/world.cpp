@@ -5,6 +5,7 @@
 
 #include "world.hpp"
 
+#include "board.hpp"
 #include "character.hpp"
 #include "command_source.hpp"
 #include "config.hpp"
@@ -28,6 +29,7 @@
 
 #include "console.hpp"
 #include "hash.hpp"
+#include "perf.hpp"
 #include "util.hpp"
 #include "util/rpn.hpp"
 #include "util/secure_string.hpp"
@@ -45,25 +47,17 @@
 #include <utility>
 #include <vector>
 
+// Maps can wake up while these run (a character killed by an NPC respawns elsewhere), so awake_maps is walked by index
+
 void world_spawn_npcs(void *world_void)
 {
 	World *world(static_cast<World *>(world_void));
 
-	double spawnrate = world->config["SpawnRate"];
 	double current_time = Timer::GetTime();
-	UTIL_FOREACH(world->maps, map)
+
+	for (std::size_t i = 0; i < world->awake_maps.size(); ++i)
 	{
-		UTIL_FOREACH(map->npcs, npc)
-		{
-			if ((!npc->alive && npc->dead_since + (double(npc->spawn_time) * spawnrate) < current_time)
-			 && (!npc->ENF().child || (npc->parent && npc->parent->alive && world->config["RespawnBossChildren"])))
-			{
-#ifdef DEBUG
-				Console::Dbg("Spawning NPC %i on map %i", npc->id, map->id);
-#endif // DEBUG
-				npc->Spawn();
-			}
-		}
+		world->awake_maps[i]->SpawnNPCs(current_time);
 	}
 }
 
@@ -72,14 +66,30 @@ void world_act_npcs(void *world_void)
 	World *world(static_cast<World *>(world_void));
 
 	double current_time = Timer::GetTime();
-	UTIL_FOREACH(world->maps, map)
+
+	for (std::size_t i = 0; i < world->awake_maps.size(); ++i)
 	{
-		UTIL_FOREACH(map->npcs, npc)
+		world->awake_maps[i]->ActNPCs(current_time);
+	}
+}
+
+void world_sleep_maps(void *world_void)
+{
+	World *world(static_cast<World *>(world_void));
+
+	if (world->dormant_map_time <= 0.0)
+		return;
+
+	double current_time = Timer::GetTime();
+
+	// Sleep() moves the last awake map in to the removed one's place, so go backwards
+	for (std::size_t i = world->awake_maps.size(); i > 0; --i)
+	{
+		Map *map = world->awake_maps[i - 1];
+
+		if (map->characters.empty() && map->empty_since + world->dormant_map_time <= current_time)
 		{
-			if (npc->alive && npc->last_act + npc->act_speed < current_time)
-			{
-				npc->Act();
-			}
+			map->Sleep();
 		}
 	}
 }
@@ -130,17 +140,11 @@ void world_npc_recover(void *world_void)
 {
 	World *world(static_cast<World *>(world_void));
 
-	UTIL_FOREACH(world->maps, map)
-	{
-		UTIL_FOREACH(map->npcs, npc)
-		{
-			if (npc->alive && npc->hp < npc->ENF().hp)
-			{
-				npc->hp += npc->ENF().hp * double(world->config["NPCRecoverRate"]);
+	double rate = world->config["NPCRecoverRate"];
 
-				npc->hp = std::min(npc->hp, npc->ENF().hp);
-			}
-		}
+	for (std::size_t i = 0; i < world->awake_maps.size(); ++i)
+	{
+		world->awake_maps[i]->RecoverNPCs(rate);
 	}
 }
 
@@ -168,13 +172,20 @@ void world_warp_suck(void *world_void)
 	double now = Timer::GetTime();
 	double delay = world->config["WarpSuck"];
 
-	UTIL_FOREACH(world->maps, map)
+	// Dormant maps have nobody on them
+	UTIL_FOREACH(world->awake_maps, map)
 	{
 		UTIL_FOREACH(map->characters, character)
 		{
 			if (character->last_walk + delay >= now)
 				continue;
 
+			character->last_walk = now;
+
+			// Almost everyone is nowhere near a warp
+			if (!map->NearSuckWarp(character->x, character->y))
+				continue;
+
 			auto check_warp = [&](bool test, unsigned char x, unsigned char y)
 			{
 				if (!test || !map->InBounds(x, y))
@@ -188,8 +199,6 @@ void world_warp_suck(void *world_void)
 				actions.push_back({character, warp.map, warp.x, warp.y});
 			};
 
-			character->last_walk = now;
-
 			check_warp(true,                       character->x,     character->y);
 			check_warp(character->x > 0,           character->x - 1, character->y);
 			check_warp(character->x < map->width,  character->x + 1, character->y);
@@ -216,17 +225,44 @@ void world_despawn_items(void *world_void)
 {
 	World *world = static_cast<World *>(world_void);
 
+	double before = Timer::GetTime() - static_cast<double>(world->config["ItemDespawnRate"]);
+
 	UTIL_FOREACH(world->maps, map)
 	{
-		restart_loop:
-		UTIL_FOREACH(map->items, item)
+		map->DespawnItems(before);
+	}
+}
+
+// Writes the usage counter of many characters in one multi-row UPDATE statement
+static void world_save_usage_batch(World *world, const std::vector<Character *>& characters)
+{
+	const std::size_t batch_size = 256;
+
+	for (std::size_t begin = 0; begin < characters.size(); begin += batch_size)
+	{
+		std::size_t end = std::min(begin + batch_size, characters.size());
+
+		std::string query = "UPDATE `characters` SET `usage` = CASE `name`";
+		std::string names;
+
+		for (std::size_t i = begin; i < end; ++i)
 		{
-			if (item->unprotecttime < (Timer::GetTime() - static_cast<double>(world->config["ItemDespawnRate"])))
-			{
-				map->DelItem(item->uid, 0);
-				goto restart_loop;
-			}
+			std::string name = world->db.EscapeRaw(characters[i]->real_name);
+
+			query += " WHEN '" + name + "' THEN " + util::to_string(characters[i]->Usage());
+
+			if (i != begin)
+				names += ", ";
+
+			names += "'" + name + "'";
 		}
+
+		query += " END WHERE `name` IN (" + names + ")";
+
+		world->db.RawQuery(query.c_str());
+
+		for (std::size_t i = begin; i < end; ++i)
+			characters[i]->MarkSaveClean(Character::SaveUsage);
 	}
 }
 
@@ -237,9 +273,26 @@ void world_timed_save(void *world_void)
 	if (!world->config["TimedSave"])
 		return;
 
-	UTIL_FOREACH(world->characters, character)
+	if (world->config["TimedSaveBatch"])
 	{
-		character->Save();
+		std::vector<Character *> usage_batch;
+
+		UTIL_FOREACH(world->characters, character)
+		{
+			character->Save(Character::SaveAll & ~Character::SaveUsage);
+
+			if (character->SaveDirtyGroups(Character::SaveUsage))
+				usage_batch.push_back(character);
+		}
+
+		world_save_usage_batch(world, usage_batch);
+	}
+	else
+	{
+		UTIL_FOREACH(world->characters, character)
+		{
+			character->Save();
+		}
 	}
 
 	world->guildmanager->SaveAll();
@@ -261,10 +314,10 @@ void world_spikes(void *world_void)
 {
 	World *world = static_cast<World *>(world_void);
 	
-	for (Map* map : world->maps)
+	for (std::size_t i = 0; i < world->awake_maps.size(); ++i)
 	{
-		if (map->exists)
-			map->TimedSpikes();
+		if (world->awake_maps[i]->exists)
+			world->awake_maps[i]->TimedSpikes();
 	}
 }
 
@@ -272,10 +325,10 @@ void world_drains(void *world_void)
 {
 	World *world = static_cast<World *>(world_void);
 	
-	for (Map* map : world->maps)
+	for (std::size_t i = 0; i < world->awake_maps.size(); ++i)
 	{
-		if (map->exists)
-			map->TimedDrains();
+		if (world->awake_maps[i]->exists)
+			world->awake_maps[i]->TimedDrains();
 	}
 }
 
@@ -283,13 +336,20 @@ void world_quakes(void *world_void)
 {
 	World *world = static_cast<World *>(world_void);
 	
-	for (Map* map : world->maps)
+	for (std::size_t i = 0; i < world->awake_maps.size(); ++i)
 	{
-		if (map->exists)
-			map->TimedQuakes();
+		if (world->awake_maps[i]->exists)
+			world->awake_maps[i]->TimedQuakes();
 	}
 }
 
+void world_sync_bans(void *world_void)
+{
+	World *world = static_cast<World *>(world_void);
+
+	world->bans.Sync(world->config["BanSyncRate"]);
+}
+
 void World::UpdateConfig()
 {
 	this->timer.SetMaxDelta(this->config["ClockMaxDelta"]);
@@ -337,6 +397,42 @@ void World::UpdateConfig()
 	}
 
 
+	UTIL_FOREACH(this->maps, map)
+	{
+		map->RescheduleRespawns();
+	}
+
+
+	this->dormant_map_time = this->config["DormantMapTime"];
+
+	if (this->dormant_map_time <= 0.0)
+	{
+		UTIL_FOREACH(this->maps, map)
+		{
+			map->Wake();
+		}
+	}
+
+
+	this->drop_rate = this->config["DropRate"];
+	this->exp_rate = this->config["ExpRate"];
+	this->drop_rate_mode = this->config["DropRateMode"];
+	this->share_mode = this->config["ShareMode"];
+	this->party_share_mode = this->config["PartyShareMode"];
+
+
+	Password_Params password_params;
+
+	// Until the accounts table is known to fit the longer hashes, keep storing sha256 hashes
+	if (this->password_storage)
+		password_params.cost = util::clamp<int>(this->config["PasswordHashCost"], 0, 20);
+
+	password_params.block_size = util::clamp<int>(this->config["PasswordHashBlockSize"], 1, 32);
+
+	this->hasher.Configure(std::max(int(this->config["PasswordHashThreads"]), 0), password_params,
+		std::max(int(this->config["PasswordHashPerIP"]), 0), std::max(int(this->config["PasswordHashQueue"]), 0));
+
+
 	if (this->db.Pending() && !this->config["TimedSave"])
 	{
 		try
@@ -352,7 +448,11 @@ void World::UpdateConfig()
 }
 
 World::World(std::array<std::string, 6> dbinfo, const Config &eoserv_config, const Config &admin_config)
-	: i18n(eoserv_config.find("ServerLanguage")->second)
+	: password_storage(false)
+	, pub_reload_ready(false)
+	, pub_reload_quiet(true)
+	, map_reload_ready(false)
+	, i18n(eoserv_config.find("ServerLanguage")->second)
 	, admin_count(0)
 {
 	if (int(this->timer.resolution * 1000.0) > 1)
@@ -406,10 +506,10 @@ World::World(std::array<std::string, 6> dbinfo, const Config &eoserv_config, con
 
 	bool auto_split = this->config["AutoSplitPubFiles"];
 
-	this->eif = new EIF(this->config["EIF"], auto_split);
-	this->enf = new ENF(this->config["ENF"], auto_split);
-	this->esf = new ESF(this->config["ESF"], auto_split);
-	this->ecf = new ECF(this->config["ECF"], auto_split);
+	this->eif = std::make_shared<EIF>(this->config["EIF"], auto_split);
+	this->enf = std::make_shared<ENF>(this->config["ENF"], auto_split);
+	this->esf = std::make_shared<ESF>(this->config["ESF"], auto_split);
+	this->ecf = std::make_shared<ECF>(this->config["ECF"], auto_split);
 
 	std::size_t num_npcs = this->enf->data.size();
 	this->npc_data.resize(num_npcs);
@@ -455,12 +555,28 @@ World::World(std::array<std::string, 6> dbinfo, const Config &eoserv_config, con
 
 	this->last_character_id = 0;
 
+	PERF_NAME_TIMER(world_spawn_npcs);
+	PERF_NAME_TIMER(world_act_npcs);
+	PERF_NAME_TIMER(world_sleep_maps);
+	PERF_NAME_TIMER(world_recover);
+	PERF_NAME_TIMER(world_npc_recover);
+	PERF_NAME_TIMER(world_warp_suck);
+	PERF_NAME_TIMER(world_despawn_items);
+	PERF_NAME_TIMER(world_timed_save);
+	PERF_NAME_TIMER(world_spikes);
+	PERF_NAME_TIMER(world_drains);
+	PERF_NAME_TIMER(world_quakes);
+	PERF_NAME_TIMER(world_sync_bans);
+
 	TimeEvent *event = new TimeEvent(world_spawn_npcs, this, 1.0, Timer::FOREVER);
 	this->timer.Register(event);
 
 	event = new TimeEvent(world_act_npcs, this, 0.05, Timer::FOREVER);
 	this->timer.Register(event);
 
+	event = new TimeEvent(world_sleep_maps, this, 1.0, Timer::FOREVER);
+	this->timer.Register(event);
+
 	if (int(this->config["RecoverSpeed"]) > 0)
 	{
 		event = new TimeEvent(world_recover, this, double(this->config["RecoverSpeed"]), Timer::FOREVER);
@@ -509,6 +625,12 @@ World::World(std::array<std::string, 6> dbinfo, const Config &eoserv_config, con
 		this->timer.Register(event);
 	}
 
+	if (this->config["BanSyncRate"])
+	{
+		event = new TimeEvent(world_sync_bans, this, 1.0, Timer::FOREVER);
+		this->timer.Register(event);
+	}
+
 	exp_table[0] = 0;
 	for (std::size_t i = 1; i < this->exp_table.size(); ++i)
 	{
@@ -517,7 +639,7 @@ World::World(std::array<std::string, 6> dbinfo, const Config &eoserv_config, con
 
 	for (std::size_t i = 0; i < this->boards.size(); ++i)
 	{
-		this->boards[i] = new Board(i);
+		this->boards[i] = new Board(i, &this->board_store);
 	}
 
 	this->guildmanager = new GuildManager(this);
@@ -559,6 +681,28 @@ void World::Command(std::string command, const std::vector<std::string>& argumen
 	Commands::Handle(util::lowercase(command), arguments, from);
 }
 
+void World::LoadBans()
+{
+	this->bans.Load(this->db);
+
+	Console::Out("%i bans loaded.", static_cast<int>(this->bans.Size()));
+}
+
+void World::LoadBoards()
+{
+	this->board_store.Load(this->db, this->boards.data(), this->boards.size());
+
+	std::size_t post_count = 0;
+
+	UTIL_FOREACH(this->boards, board)
+	{
+		post_count += board->Size();
+	}
+
+	if (this->board_store.Enabled())
+		Console::Out("%i board posts loaded.", static_cast<int>(post_count));
+}
+
 void World::LoadHome()
 {
 	this->homes.clear();
@@ -801,19 +945,18 @@ void World::AdminReport(Character *from, std::string reportee, std::string messa
 		std::string chat_log_dump;
 		Board *admin_board = this->boards[boardid];
 
-		Board_Post *newpost = new Board_Post;
-		newpost->id = ++admin_board->last_id;
-		newpost->author = from->SourceName();
-		newpost->author_admin = from->admin;
-		newpost->subject = std::string(" [Report] ") + util::ucfirst(from->SourceName()) + " reports: " + reportee;
-		newpost->body = message;
-		newpost->time = Timer::GetTime();
+		Board_Post newpost;
+		newpost.author = from->SourceName();
+		newpost.author_admin = from->admin;
+		newpost.subject = std::string(" [Report] ") + util::ucfirst(from->SourceName()) + " reports: " + reportee;
+		newpost.body = message;
+		newpost.time = Timer::GetTime();
 
 		if (int(this->config["ReportChatLogSize"]) > 0)
 		{
 			chat_log_dump = from->GetChatLogDump();
-			newpost->body += "\r\n\r\n";
-			newpost->body += chat_log_dump;
+			newpost.body += "\r\n\r\n";
+			newpost.body += chat_log_dump;
 		}
 
 		if (this->config["LogReports"])
@@ -835,12 +978,7 @@ void World::AdminReport(Character *from, std::string reportee, std::string messa
 			}
 		}
 
-		admin_board->posts.push_front(newpost);
-
-		if (admin_board->posts.size() > static_cast<std::size_t>(static_cast<int>(this->config["AdminBoardLimit"])))
-		{
-			admin_board->posts.pop_back();
-		}
+		admin_board->Add(std::move(newpost), static_cast<int>(this->config["AdminBoardLimit"]));
 	}
 }
 
@@ -868,20 +1006,14 @@ void World::AdminRequest(Character *from, std::string message)
 	{
 		Board *admin_board = this->server->world->boards[boardid];
 
-		Board_Post *newpost = new Board_Post;
-		newpost->id = ++admin_board->last_id;
-		newpost->author = from->SourceName();
-		newpost->author_admin = from->admin;
-		newpost->subject = std::string(" [Request] ") + util::ucfirst(from->SourceName()) + " needs help";
-		newpost->body = message;
-		newpost->time = Timer::GetTime();
-
-		admin_board->posts.push_front(newpost);
+		Board_Post newpost;
+		newpost.author = from->SourceName();
+		newpost.author_admin = from->admin;
+		newpost.subject = std::string(" [Request] ") + util::ucfirst(from->SourceName()) + " needs help";
+		newpost.body = message;
+		newpost.time = Timer::GetTime();
 
-		if (admin_board->posts.size() > static_cast<std::size_t>(static_cast<int>(this->server->world->config["AdminBoardLimit"])))
-		{
-			admin_board->posts.pop_back();
-		}
+		admin_board->Add(std::move(newpost), static_cast<int>(this->server->world->config["AdminBoardLimit"]));
 	}
 }
 
@@ -914,32 +1046,78 @@ void World::Rehash()
 	}
 }
 
-void World::ReloadPub(bool quiet)
+bool World::ReloadPub(Command_Source *from, bool quiet)
 {
-	auto eif_id = this->eif->rid;
-	auto enf_id = this->enf->rid;
-	auto esf_id = this->esf->rid;
-	auto ecf_id = this->ecf->rid;
+	if (this->pub_reload_thread.joinable())
+	{
+		return false;
+	}
 
+	std::string eif_file = this->config["EIF"];
+	std::string enf_file = this->config["ENF"];
+	std::string esf_file = this->config["ESF"];
+	std::string ecf_file = this->config["ECF"];
 	bool auto_split = this->config["AutoSplitPubFiles"];
 
-	this->eif->Read(this->config["EIF"], auto_split);
-	this->enf->Read(this->config["ENF"], auto_split);
-	this->esf->Read(this->config["ESF"], auto_split);
-	this->ecf->Read(this->config["ECF"], auto_split);
+	this->pub_reload_quiet = quiet;
+	this->pub_reload_admin = from->SourceName();
 
-	if (eif_id != this->eif->rid || enf_id != this->enf->rid
-	 || esf_id != this->esf->rid || ecf_id != this->ecf->rid)
+	this->pub_reload_thread = std::thread([=]()
 	{
-		if (!quiet)
+		std::unique_ptr<Pub_Snapshot> snapshot(new Pub_Snapshot);
+
+		try
 		{
-			UTIL_FOREACH(this->characters, character)
-			{
-				character->ServerMsg("The server has been reloaded, please log out and in again.");
-			}
+			snapshot->eif = std::make_shared<EIF>(eif_file, auto_split);
+			snapshot->enf = std::make_shared<ENF>(enf_file, auto_split);
+			snapshot->esf = std::make_shared<ESF>(esf_file, auto_split);
+			snapshot->ecf = std::make_shared<ECF>(ecf_file, auto_split);
+		}
+		catch (Pub_Exception &e)
+		{
+			snapshot.reset(new Pub_Snapshot);
+			snapshot->error = e.error();
 		}
+
+		this->pub_reload = std::move(snapshot);
+		this->pub_reload_ready.store(true, std::memory_order_release);
+	});
+
+	return true;
+}
+
+void World::SwapPubs()
+{
+	if (!this->pub_reload_ready.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	this->pub_reload_thread.join();
+	this->pub_reload_ready.store(false, std::memory_order_relaxed);
+
+	std::unique_ptr<Pub_Snapshot> snapshot = std::move(this->pub_reload);
+
+	if (!snapshot->error.empty())
+	{
+		Console::Err("Pub files could not be reloaded: %s", snapshot->error.c_str());
+
+		Character *admin = this->GetCharacter(this->pub_reload_admin);
+
+		if (admin)
+			admin->ServerMsg(this->i18n.Format("pub_reload_failed", snapshot->error));
+
+		return;
 	}
 
+	bool changed = snapshot->eif->rid != this->eif->rid || snapshot->enf->rid != this->enf->rid
+	            || snapshot->esf->rid != this->esf->rid || snapshot->ecf->rid != this->ecf->rid;
+
+	this->eif = std::move(snapshot->eif);
+	this->enf = std::move(snapshot->enf);
+	this->esf = std::move(snapshot->esf);
+	this->ecf = std::move(snapshot->ecf);
+
 	std::size_t current_npcs = this->npc_data.size();
 	std::size_t new_npcs = this->enf->data.size();
 
@@ -947,7 +1125,116 @@ void World::ReloadPub(bool quiet)
 
 	for (std::size_t i = current_npcs; i < new_npcs; ++i)
 	{
-		npc_data[i]->LoadShopDrop();
+		auto& npc = this->npc_data[i];
+		npc.reset(new NPC_Data(this, i));
+		if (npc->id != 0)
+			npc->LoadShopDrop();
+	}
+
+	// Boss and child flags and max HP may have changed
+	UTIL_FOREACH(this->maps, map)
+	{
+		map->IndexBossNPCs();
+
+		UTIL_FOREACH(map->npcs, npc)
+		{
+			map->SyncNPC(npc);
+		}
+	}
+
+	Console::Out("Pub files reloaded");
+
+	if (changed && !this->pub_reload_quiet)
+	{
+		UTIL_FOREACH(this->characters, character)
+		{
+			character->ServerMsg("The server has been reloaded, please log out and in again.");
+		}
+	}
+}
+
+bool World::ReloadMap(int id, Command_Source *from)
+{
+	if (this->map_reload_thread.joinable())
+	{
+		return false;
+	}
+
+	// New maps are added in order, so any missing before this one are read as well
+	int first_id = std::min(id, int(this->maps.size()) + 1);
+	std::vector<std::string> filenames;
+
+	for (int i = first_id; i <= id; ++i)
+	{
+		filenames.push_back(Map::Filename(this, i));
+	}
+
+	this->map_reload_admin = from->SourceName();
+
+	this->map_reload_thread = std::thread([=]()
+	{
+		std::unique_ptr<Map_Snapshot> snapshot(new Map_Snapshot);
+		snapshot->first_id = first_id;
+
+		for (std::size_t i = 0; i < filenames.size(); ++i)
+		{
+			std::unique_ptr<Map_File> file(new Map_File);
+			std::string error;
+
+			if (!file->Read(filenames[i], short(first_id + int(i)), error))
+			{
+				file.reset();
+
+				if (error.empty())
+					error = "Could not load file: " + filenames[i];
+			}
+
+			snapshot->files.push_back(std::move(file));
+			snapshot->errors.push_back(std::move(error));
+		}
+
+		this->map_reload = std::move(snapshot);
+		this->map_reload_ready.store(true, std::memory_order_release);
+	});
+
+	return true;
+}
+
+void World::SwapMaps()
+{
+	if (!this->map_reload_ready.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	this->map_reload_thread.join();
+	this->map_reload_ready.store(false, std::memory_order_relaxed);
+
+	std::unique_ptr<Map_Snapshot> snapshot = std::move(this->map_reload);
+	Character *admin = this->GetCharacter(this->map_reload_admin);
+
+	for (std::size_t i = 0; i < snapshot->files.size(); ++i)
+	{
+		int id = snapshot->first_id + int(i);
+		const Map_File *file = snapshot->files[i].get();
+
+		if (!file)
+		{
+			Console::Err("Map %i could not be reloaded: %s", id, snapshot->errors[i].c_str());
+
+			if (admin)
+				admin->ServerMsg(this->i18n.Format("map_reload_failed", id, snapshot->errors[i]));
+		}
+
+		if (id <= int(this->maps.size()))
+		{
+			if (file)
+				this->maps[id - 1]->Reload(*file);
+		}
+		else if (id == int(this->maps.size()) + 1)
+		{
+			this->maps.push_back(new Map(id, this, file));
+		}
 	}
 }
 
@@ -1229,55 +1516,122 @@ void World::DeleteCharacter(std::string name)
 	this->db.Query("DELETE FROM `characters` WHERE name = '$'", name.c_str());
 }
 
-Player *World::Login(const std::string& username, util::secure_string&& password)
+Player *World::Login(std::string username)
 {
-	if (LoginCheck(username, std::move(password)) == LOGIN_WRONG_USERPASS)
-		return 0;
-
 	return new Player(username, this);
 }
 
-Player *World::Login(std::string username)
+PasswordHasher::SubmitResult World::LoginCheck(EOClient *client, const std::string& username, util::secure_string&& password,
+	std::function<void(LoginReply)> done)
 {
-	return new Player(username, this);
+	if (this->hasher.Busy(client))
+		return PasswordHasher::OwnerBusy;
+
+	Database_Result res = this->db.Query("SELECT `password` FROM `accounts` WHERE `username` = '$'", username.c_str());
+
+	// An unknown account is still checked against a hash, so it takes as long and counts against the same limits as a real one
+	bool exists = !res.empty();
+	std::string stored = exists ? std::string(res.front()["password"]) : this->hasher.DummyHash();
+	util::secure_string password_buffer(std::move(std::string(this->config["PasswordSalt"]) + username + password.str()));
+	password.erase();
+
+	return this->hasher.Verify(client, client->GetRemoteAddr(), stored, std::move(password_buffer),
+		[this, username, stored, exists, done](bool match, const std::string& rehash)
+	{
+		if (!exists || !match)
+		{
+			done(LOGIN_WRONG_USERPASS);
+			return;
+		}
+
+		// Only replace the hash if the password hasn't been changed in the meantime
+		if (!rehash.empty())
+			this->db.Query("UPDATE `accounts` SET `password` = '$' WHERE `username` = '$' AND `password` = '$'", rehash.c_str(), username.c_str(), stored.c_str());
+
+		done(this->PlayerOnline(username) ? LOGIN_LOGGEDIN : LOGIN_OK);
+	});
 }
 
-LoginReply World::LoginCheck(const std::string& username, util::secure_string&& password)
+PasswordHasher::SubmitResult World::CreatePlayer(EOClient *client, const std::string& username, util::secure_string&& password,
+	const std::string& fullname, const std::string& location, const std::string& email,
+	const std::string& computer, const std::string& hdid, std::function<void(bool)> done)
 {
+	std::string ip = client->GetRemoteAddr();
+	util::secure_string password_buffer(std::move(std::string(this->config["PasswordSalt"]) + username + password.str()));
+	password.erase();
+
+	return this->hasher.Hash(client, client->GetRemoteAddr(), std::move(password_buffer),
+		[this, username, fullname, location, email, computer, hdid, ip, done](const std::string& hash)
 	{
-		util::secure_string password_buffer(std::move(std::string(this->config["PasswordSalt"]) + username + password.str()));
-		password = sha256(password_buffer.str());
-	}
+		bool created;
 
-	Database_Result res = this->db.Query("SELECT 1 FROM `accounts` WHERE `username` = '$' AND `password` = '$'", username.c_str(), password.str().c_str());
+		try
+		{
+			// Another client may have taken the name while the password was hashed
+			Database_Result result = this->db.Query("INSERT INTO `accounts` (`username`, `password`, `fullname`, `location`, `email`, `computer`, `hdid`, `regip`, `created`) VALUES ('$','$','$','$','$','$','$','$',#)",
+				username.c_str(), hash.c_str(), fullname.c_str(), location.c_str(), email.c_str(), computer.c_str(), hdid.c_str(), ip.c_str(), int(std::time(0)));
 
-	if (res.empty())
-	{
-		return LOGIN_WRONG_USERPASS;
-	}
-	else if (this->PlayerOnline(username))
-	{
-		return LOGIN_LOGGEDIN;
-	}
-	else
+			created = !result.Error();
+		}
+		catch (Database_Exception &)
+		{
+			created = false;
+		}
+
+		done(created);
+	});
+}
+
+PasswordHasher::SubmitResult World::ChangePassword(EOClient *client, const std::string& username, util::secure_string&& password,
+	std::function<void()> done)
+{
+	util::secure_string password_buffer(std::move(std::string(this->config["PasswordSalt"]) + username + password.str()));
+	password.erase();
+
+	return this->hasher.Hash(client, client->GetRemoteAddr(), std::move(password_buffer), [this, username, done](const std::string& hash)
 	{
-		return LOGIN_OK;
-	}
+		this->db.Query("UPDATE `accounts` SET `password` = '$' WHERE username = '$'", hash.c_str(), username.c_str());
+		done();
+	});
 }
 
-bool World::CreatePlayer(const std::string& username, util::secure_string&& password,
-	const std::string& fullname, const std::string& location, const std::string& email,
-	const std::string& computer, const std::string& hdid, const std::string& ip)
+void World::CheckPasswordStorage()
 {
+	bool fits = false;
+
+	try
+	{
+		if (this->db.GetEngine() == Database::SQLite)
+		{
+			// SQLite doesn't enforce VARCHAR lengths, so any password column holds a full hash
+			Database_Result res = this->db.Query("PRAGMA table_info(`accounts`)");
+
+			UTIL_FOREACH_REF(res, column)
+			{
+				if (static_cast<std::string>(column["name"]) == "password")
+					fits = true;
+			}
+		}
+		else
+		{
+			// TEXT columns report lengths that overflow an int
+			Database_Result res = this->db.Query("SELECT LEAST(`CHARACTER_MAXIMUM_LENGTH`, 65535) AS `length` FROM `information_schema`.`COLUMNS` "
+				"WHERE `TABLE_SCHEMA` = DATABASE() AND `TABLE_NAME` = 'accounts' AND `COLUMN_NAME` = 'password'");
+
+			fits = !res.empty() && int(res.front()["length"]) >= int(Password_Params::StoredLength);
+		}
+	}
+	catch (Database_Exception &)
 	{
-		util::secure_string password_buffer(std::move(std::string(this->config["PasswordSalt"]) + username + password.str()));
-		password = sha256(password_buffer.str());
+		fits = false;
 	}
 
-	Database_Result result = this->db.Query("INSERT INTO `accounts` (`username`, `password`, `fullname`, `location`, `email`, `computer`, `hdid`, `regip`, `created`) VALUES ('$','$','$','$','$','$','$','$',#)",
-		username.c_str(), password.str().c_str(), fullname.c_str(), location.c_str(), email.c_str(), computer.c_str(), hdid.c_str(), ip.c_str(), int(std::time(0)));
+	this->password_storage = fits;
+
+	if (!fits && int(this->config["PasswordHashCost"]) > 0)
+		Console::Wrn("accounts.password column is too short for scrypt hashes, storing sha256 hashes (see upgrade/0.7.0_to_0.7.1.sql)");
 
-	return !result.Error();
+	this->UpdateConfig();
 }
 
 bool World::PlayerExists(std::string username)
@@ -1354,21 +1708,18 @@ void World::Ban(Command_Source *from, Character *victim, int duration, bool anno
 	if (announce)
 		this->ServerMsg(i18n.Format("announce_removed", victim->SourceName(), from_str, i18n.Format("banned")));
 
-	std::string query("INSERT INTO bans (username, ip, hdid, expires, setter) VALUES ");
-
-	query += "('" + db.Escape(victim->player->username) + "', ";
-	query += util::to_string(static_cast<int>(victim->player->client->GetRemoteAddr())) + ", ";
-	query += util::to_string(victim->player->client->hdid) + ", ";
+	Ban_Entry entry;
+	entry.username = victim->player->username;
+	entry.ip = victim->player->client->GetRemoteAddr();
+	entry.hdid = victim->player->client->hdid;
+	entry.expires = (duration == -1) ? 0 : int(std::time(0) + duration);
 
-	if (duration == -1)
-	{
-		query += "0";
-	}
-	else
-	{
-		query += util::to_string(int(std::time(0) + duration));
-	}
+	std::string query("INSERT INTO bans (username, ip, hdid, expires, setter) VALUES ");
 
+	query += "('" + db.Escape(entry.username) + "', ";
+	query += util::to_string(static_cast<int>(entry.ip.GetInt())) + ", ";
+	query += util::to_string(entry.hdid) + ", ";
+	query += util::to_string(entry.expires);
 	query += ", '" + db.Escape(from_str) + "')";
 
 	try
@@ -1381,50 +1732,64 @@ void World::Ban(Command_Source *from, Character *victim, int duration, bool anno
 		Console::Err("%s", e.error());
 	}
 
+	this->bans.Add(entry);
+
 	victim->player->client->Close();
 }
 
-void World::Mute(Command_Source *from, Character *victim, bool announce)
+void World::BanIP(Command_Source *from, const IPAddress &address, int prefix, int duration)
 {
-	if (announce && !this->config["SilentMute"])
-		this->ServerMsg(i18n.Format("announce_muted", victim->SourceName(), from ? from->SourceName() : "server", i18n.Format("banned")));
-
-	victim->Mute(from);
-}
+	std::string from_str = from ? from->SourceName() : "server";
 
-int World::CheckBan(const std::string *username, const IPAddress *address, const int *hdid)
-{
-	std::string query("SELECT COALESCE(MAX(expires),-1) AS expires FROM bans WHERE (");
+	Ban_Entry entry;
+	entry.ip = address;
+	entry.ip_prefix = prefix;
+	entry.expires = (duration == -1) ? 0 : int(std::time(0) + duration);
 
-	if (!username && !address && !hdid)
+	try
 	{
-		return -1;
+		if (prefix == 32)
+		{
+			this->db.Query("INSERT INTO bans (username, ip, hdid, expires, setter) VALUES ('', #, 0, #, '$')",
+				static_cast<int>(address.GetInt()), entry.expires, from_str.c_str());
+		}
+		else
+		{
+			this->db.Query("INSERT INTO bans (username, ip, ip_prefix, hdid, expires, setter) VALUES ('', #, #, 0, #, '$')",
+				static_cast<int>(address.GetInt()), prefix, entry.expires, from_str.c_str());
+		}
 	}
-
-	if (username)
+	catch (Database_Exception& e)
 	{
-		query += "username = '";
-		query += db.Escape(*username);
-		query += "' OR ";
+		Console::Err("Could not save ban to database.");
+		Console::Err("%s", e.error());
 	}
 
-	if (address)
-	{
-		query += "ip = ";
-		query += util::to_string(static_cast<int>(*const_cast<IPAddress *>(address)));
-		query += " OR ";
-	}
+	this->bans.Add(entry);
 
-	if (hdid)
+	BanIndex range;
+	range.Add(entry);
+
+	UTIL_FOREACH(this->server->clients, client)
 	{
-		query += "hdid = ";
-		query += util::to_string(*hdid);
-		query += " OR ";
+		IPAddress remote_addr = client->GetRemoteAddr();
+
+		if (range.Check(0, &remote_addr, 0, std::time(0)) != -1)
+			client->Close();
 	}
+}
+
+void World::Mute(Command_Source *from, Character *victim, bool announce)
+{
+	if (announce && !this->config["SilentMute"])
+		this->ServerMsg(i18n.Format("announce_muted", victim->SourceName(), from ? from->SourceName() : "server", i18n.Format("banned")));
 
-	Database_Result res = db.Query((query.substr(0, query.length()-4) + ") AND (expires > # OR expires = 0)").c_str(), int(std::time(0)));
+	victim->Mute(from);
+}
 
-	return static_cast<int>(res[0]["expires"]);
+int World::CheckBan(const std::string *username, const IPAddress *address, const int *hdid)
+{
+	return this->bans.Check(username, address, hdid);
 }
 
 static std::list<int> PKExceptUnserialize(std::string serialized)
@@ -1508,10 +1873,15 @@ World::~World()
 		delete board;
 	}
 
-	delete this->eif;
-	delete this->enf;
-	delete this->esf;
-	delete this->ecf;
+	if (this->pub_reload_thread.joinable())
+	{
+		this->pub_reload_thread.join();
+	}
+
+	if (this->map_reload_thread.joinable())
+	{
+		this->map_reload_thread.join();
+	}
 
 	delete this->guildmanager;
 
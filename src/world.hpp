@@ -10,6 +10,7 @@
 
 #include "fwd/character.hpp"
 #include "fwd/command_source.hpp"
+#include "fwd/eoclient.hpp"
 #include "fwd/eodata.hpp"
 #include "fwd/eoserver.hpp"
 #include "fwd/guild.hpp"
@@ -18,42 +19,29 @@
 #include "fwd/party.hpp"
 #include "fwd/player.hpp"
 #include "fwd/quest.hpp"
+#include "banlist.hpp"
+#include "board.hpp"
 #include "config.hpp"
 #include "database.hpp"
 #include "i18n.hpp"
 #include "map.hpp"
+#include "passwordhash.hpp"
 #include "timer.hpp"
 
 #include "fwd/socket.hpp"
 #include "util/secure_string.hpp"
 
 #include <array>
+#include <atomic>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
 #include <stack>
 #include <string>
+#include <thread>
 #include <vector>
 
-struct Board_Post
-{
-	short id;
-	std::string author;
-	int author_admin;
-	std::string subject;
-	std::string body;
-	double time;
-};
-
-struct Board
-{
-	int id;
-	short last_id;
-	std::list<Board_Post *> posts;
-
-	Board(int id_) : id(id_), last_id(0) { }
-};
-
 struct Home
 {
 	std::string id;
@@ -76,20 +64,73 @@ class World
 	protected:
 		int last_character_id;
 
+		bool password_storage;
+
 		void UpdateConfig();
 
+		/**
+		 * A complete set of pub files, read together by ReloadPub()
+		 */
+		struct Pub_Snapshot
+		{
+			std::shared_ptr<EIF> eif;
+			std::shared_ptr<ENF> enf;
+			std::shared_ptr<ESF> esf;
+			std::shared_ptr<ECF> ecf;
+
+			/**
+			 * Why the files couldn't be read, in which case the others are left empty
+			 */
+			std::string error;
+		};
+
+		std::thread pub_reload_thread;
+		std::unique_ptr<Pub_Snapshot> pub_reload;
+		std::atomic<bool> pub_reload_ready;
+		bool pub_reload_quiet;
+
+		// Name of the command source that started the reload, told if it fails
+		std::string pub_reload_admin;
+
+		/**
+		 * Map files read by ReloadMap(), for consecutive map IDs starting at first_id
+		 */
+		struct Map_Snapshot
+		{
+			int first_id;
+
+			/**
+			 * Null where a file couldn't be read, with the reason at the same position in errors
+			 */
+			std::vector<std::unique_ptr<Map_File>> files;
+			std::vector<std::string> errors;
+		};
+
+		std::thread map_reload_thread;
+		std::unique_ptr<Map_Snapshot> map_reload;
+		std::atomic<bool> map_reload_ready;
+		std::string map_reload_admin;
+
 	public:
 		Timer timer;
 
 		EOServer *server;
 		Database db;
 
+		BanList bans;
+
+		PasswordHasher hasher;
+
 		GuildManager *guildmanager;
 
-		EIF *eif;
-		ENF *enf;
-		ESF *esf;
-		ECF *ecf;
+		/**
+		 * The current pub files, which are never modified once loaded
+		 * ReloadPub() replaces them all at once between timer events, so they're safe to hold within a handler.
+		 */
+		std::shared_ptr<EIF> eif;
+		std::shared_ptr<ENF> enf;
+		std::shared_ptr<ESF> esf;
+		std::shared_ptr<ECF> ecf;
 
 		std::vector<std::unique_ptr<NPC_Data>> npc_data;
 
@@ -109,14 +150,35 @@ class World
 		std::vector<Character *> characters;
 		std::vector<Party *> parties;
 		std::vector<Map *> maps;
+
+		/**
+		 * Maps that aren't dormant, the only ones NPC and map effect timers visit
+		 */
+		std::vector<Map *> awake_maps;
+
 		std::vector<Home *> homes;
 		std::map<short, std::shared_ptr<Quest>> quests;
 
+		BoardStore board_store;
 		std::array<Board *, 8> boards;
 
 		std::array<int, 254> exp_table;
 		std::vector<int> instrument_ids;
 
+		/**
+		 * Seconds a map must be empty before it goes dormant, or 0 to keep every map awake
+		 */
+		double dormant_map_time;
+
+		/**
+		 * Settings read on every NPC kill, cached by UpdateConfig
+		 */
+		double drop_rate;
+		double exp_rate;
+		int drop_rate_mode;
+		int share_mode;
+		int party_share_mode;
+
 		int admin_count;
 
 		World(std::array<std::string, 6> dbinfo, const Config &eoserv_config, const Config &admin_config);
@@ -131,6 +193,8 @@ class World
 		void Command(std::string command, const std::vector<std::string>& arguments, Command_Source* from = 0);
 
 		void LoadHome();
+		void LoadBans();
+		void LoadBoards();
 
 		int GenerateCharacterID();
 		int GeneratePlayerID();
@@ -149,13 +213,45 @@ class World
 		void Reboot(int seconds, std::string reason);
 
 		void Rehash();
-		void ReloadPub(bool quiet = false);
+
+		/**
+		 * Starts reading the pub files on a background thread, they're swapped in by SwapPubs() when ready
+		 * @param from Told if the files can't be read, in which case the current ones are kept
+		 * @return false if a reload is already in progress
+		 */
+		bool ReloadPub(Command_Source *from, bool quiet = false);
+
+		/**
+		 * Swaps in pub files finished by ReloadPub(), if there are any
+		 * Called by the server between ticks.
+		 */
+		void SwapPubs();
+
+		bool ReloadingPub() const { return this->pub_reload_thread.joinable(); }
+
+		/**
+		 * Starts reading a map file on a background thread, it's swapped in by SwapMaps() when ready
+		 * Maps between the last one loaded and id are read and created as well.
+		 * @param from Told about any file that can't be read, in which case that map is left as it is
+		 * @return false if a map reload is already in progress
+		 */
+		bool ReloadMap(int id, Command_Source *from);
+
+		/**
+		 * Applies map files finished by ReloadMap(), if there are any
+		 * Called by the server between ticks.
+		 */
+		void SwapMaps();
+
+		bool ReloadingMap() const { return this->map_reload_thread.joinable(); }
+
 		void ReloadQuests();
 
 		void Kick(Command_Source *from, Character *victim, bool announce = true);
 		void Jail(Command_Source *from, Character *victim, bool announce = true);
 		void Unjail(Command_Source *from, Character *victim);
 		void Ban(Command_Source *from, Character *victim, int duration, bool announce = true);
+		void BanIP(Command_Source *from, const IPAddress &address, int prefix, int duration);
 		void Mute(Command_Source *from, Character *victim, bool announce = true);
 
 		int CheckBan(const std::string *username, const IPAddress *address, const int *hdid);
@@ -174,13 +270,30 @@ class World
 		Character *CreateCharacter(Player *, std::string name, Gender, int hairstyle, int haircolor, Skin);
 		void DeleteCharacter(std::string name);
 
-		Player *Login(const std::string& username, util::secure_string&& password);
 		Player *Login(std::string username);
-		LoginReply LoginCheck(const std::string& username, util::secure_string&& password);
 
-		bool CreatePlayer(const std::string& username, util::secure_string&& password,
+		/**
+		 * Checks an account's password on the password hashing threads
+		 * @param done Called from the game loop with the result once the check finishes
+		 */
+		PasswordHasher::SubmitResult LoginCheck(EOClient *client, const std::string& username, util::secure_string&& password,
+			std::function<void(LoginReply)> done);
+
+		/**
+		 * Hashes a new account's password on the password hashing threads and creates the account
+		 * @param done Called from the game loop with whether the account was created
+		 */
+		PasswordHasher::SubmitResult CreatePlayer(EOClient *client, const std::string& username, util::secure_string&& password,
 			const std::string& fullname,const std::string& location, const std::string& email,
-			const std::string& computer, const std::string& hdid, const std::string& ip);
+			const std::string& computer, const std::string& hdid, std::function<void(bool)> done);
+
+		PasswordHasher::SubmitResult ChangePassword(EOClient *client, const std::string& username, util::secure_string&& password,
+			std::function<void()> done);
+
+		/**
+		 * Checks the schema to see if the accounts table can hold salted password hashes, falling back to sha256 hashes if not
+		 */
+		void CheckPasswordStorage();
 
 		bool PlayerExists(std::string username);
 		bool PlayerOnline(std::string username);
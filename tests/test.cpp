@@ -0,0 +1,107 @@
+/* tests/test.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "test.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Referenced by the server sources linked in to the suite
+volatile std::sig_atomic_t eoserv_sig_abort = false;
+volatile std::sig_atomic_t eoserv_sig_rehash = false;
+volatile bool eoserv_running = true;
+
+namespace test
+{
+
+struct Test
+{
+	std::string name;
+	Function function;
+};
+
+static std::vector<Test> &registry()
+{
+	static std::vector<Test> tests;
+	return tests;
+}
+
+static std::vector<std::string> &temporary_files()
+{
+	static std::vector<std::string> files;
+	return files;
+}
+
+static int failures = 0;
+
+Registration::Registration(const char *name, Function function)
+{
+	registry().push_back(Test{name, function});
+}
+
+void Fail(const char *file, int line, const char *expression)
+{
+	std::fprintf(stderr, "%s:%i: check failed: %s\n", file, line, expression);
+	++failures;
+}
+
+std::string TemporaryFile(const std::string &name, const std::string &contents)
+{
+	std::string filename = "./test_" + name;
+	std::FILE *fh = std::fopen(filename.c_str(), "wb");
+
+	if (!fh)
+	{
+		std::fprintf(stderr, "Could not write %s\n", filename.c_str());
+		std::exit(1);
+	}
+
+	std::fwrite(contents.data(), 1, contents.length(), fh);
+	std::fclose(fh);
+
+	if (std::find(temporary_files().begin(), temporary_files().end(), filename) == temporary_files().end())
+		temporary_files().push_back(filename);
+
+	return filename;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	using namespace test;
+
+	std::string filter = (argc > 1) ? argv[1] : "";
+	int failed = 0;
+	int run = 0;
+
+	for (const Test &test : registry())
+	{
+		if (!filter.empty() && test.name.find(filter) == std::string::npos)
+			continue;
+
+		int previous_failures = failures;
+		test.function();
+		++run;
+
+		bool passed = (failures == previous_failures);
+		std::printf("%-48s %s\n", test.name.c_str(), passed ? "ok" : "FAILED");
+
+		if (!passed)
+			++failed;
+	}
+
+	for (const std::string &filename : temporary_files())
+		std::remove(filename.c_str());
+
+	std::printf("%i of %i tests passed\n", run - failed, run);
+
+	return (failed == 0) ? 0 : 1;
+}
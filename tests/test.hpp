@@ -0,0 +1,45 @@
+/* tests/test.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef TEST_HPP_INCLUDED
+#define TEST_HPP_INCLUDED
+
+#include <string>
+
+namespace test
+{
+
+typedef void (*Function)();
+
+/**
+ * Adds a test to the suite
+ */
+struct Registration
+{
+	Registration(const char *name, Function function);
+};
+
+/**
+ * Marks the running test as failed, it carries on so every failed check is reported
+ */
+void Fail(const char *file, int line, const char *expression);
+
+/**
+ * Writes a file in the working directory which is removed when the suite finishes
+ * @return The filename that was written
+ */
+std::string TemporaryFile(const std::string &name, const std::string &contents);
+
+}
+
+#define EOSERV_TEST(function) \
+	static void function(); \
+	static test::Registration function##_registration(#function, function); \
+	static void function()
+
+#define EOSERV_CHECK(expression) \
+	do { if (!(expression)) test::Fail(__FILE__, __LINE__, #expression); } while (false)
+
+#endif // TEST_HPP_INCLUDED
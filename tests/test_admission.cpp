@@ -0,0 +1,69 @@
+/* tests/test_admission.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "test.hpp"
+
+#include "admission.hpp"
+#include "socket.hpp"
+
+EOSERV_TEST(test_admission_forgets_idle_address)
+{
+	AdmissionControl admission;
+	admission.Configure(10.0, 1);
+
+	IPAddress ip(10, 0, 0, 1);
+
+	admission.Connected(ip, 0.0);
+	admission.Accepted(ip, 0.0);
+	admission.Disconnected(ip, 0);
+
+	admission.Expire(5.5);
+	EOSERV_CHECK(admission.Addresses() == 1);
+	EOSERV_CHECK(admission.Throttled(ip, 5.5));
+
+	admission.Expire(11.5);
+	EOSERV_CHECK(admission.Addresses() == 0);
+}
+
+EOSERV_TEST(test_admission_reschedules_in_to_same_slot)
+{
+	AdmissionControl admission;
+	admission.Configure(100.0, 1);
+
+	IPAddress ip(10, 0, 0, 2);
+
+	// Expires at 100 which is first seen in slot 101 % 64 = 37
+	admission.Connected(ip, 0.0);
+	admission.Accepted(ip, 0.0);
+	admission.Disconnected(ip, 0);
+
+	// When slot 37 is walked the entry is still 63 seconds from expiring and goes back in to slot 37
+	admission.Expire(37.5);
+	EOSERV_CHECK(admission.Addresses() == 1);
+
+	admission.Expire(101.5);
+	EOSERV_CHECK(admission.Addresses() == 0);
+}
+
+EOSERV_TEST(test_admission_keeps_connected_address)
+{
+	AdmissionControl admission;
+	admission.Configure(1.0, 1);
+
+	IPAddress ip(10, 0, 0, 3);
+
+	admission.Connected(ip, 0.0);
+	admission.Accepted(ip, 0.0);
+
+	admission.Expire(200.5);
+	EOSERV_CHECK(admission.Addresses() == 1);
+	EOSERV_CHECK(admission.IPConnections(ip) == 1);
+
+	admission.Disconnected(ip, 0);
+	EOSERV_CHECK(admission.IPConnections(ip) == 0);
+
+	admission.Expire(202.5);
+	EOSERV_CHECK(admission.Addresses() == 0);
+}
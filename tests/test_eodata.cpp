@@ -0,0 +1,53 @@
+/* tests/test_eodata.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "test.hpp"
+
+#include "eodata.hpp"
+#include "packet.hpp"
+
+#include <string>
+
+EOSERV_TEST(test_eodata_missing_file_throws)
+{
+	bool thrown = false;
+
+	try
+	{
+		EIF eif("./test_missing.eif", false);
+	}
+	catch (Pub_Exception &)
+	{
+		thrown = true;
+	}
+
+	EOSERV_CHECK(thrown);
+}
+
+EOSERV_TEST(test_eodata_truncated_file_throws)
+{
+	// A header claiming one record, followed by its name and only part of its data
+	std::string contents = "ENF";
+	contents += std::string(4, char(PacketProcessor::ENumber(0)[0]));
+	contents += std::string(reinterpret_cast<const char *>(PacketProcessor::ENumber(1).data()), 2);
+	contents += char(PacketProcessor::ENumber(0)[0]);
+	contents += char(PacketProcessor::ENumber(1)[0]);
+	contents += "X";
+	contents += std::string(ENF::DATA_SIZE / 2, char(PacketProcessor::ENumber(0)[0]));
+
+	std::string filename = test::TemporaryFile("truncated.enf", contents);
+	bool thrown = false;
+
+	try
+	{
+		ENF enf(filename, false);
+	}
+	catch (Pub_Exception &e)
+	{
+		thrown = std::string(e.error()).find(filename) != std::string::npos;
+	}
+
+	EOSERV_CHECK(thrown);
+}
@@ -0,0 +1,30 @@
+/* tests/test_i18n.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "test.hpp"
+
+#include "i18n.hpp"
+
+#include <string>
+
+EOSERV_TEST(test_i18n_partial_file_keeps_other_strings)
+{
+	I18N i18n(test::TemporaryFile("lang_base.ini", "greeting=Hello {1}\nfarewell=Goodbye\n"));
+
+	// A translation that only defines some strings falls back to the ones already loaded
+	i18n.SetLangFile(test::TemporaryFile("lang_partial.ini", "greeting=Hallo {1}\n"));
+
+	EOSERV_CHECK(i18n.Format("greeting", "Bob") == "Hallo Bob");
+	EOSERV_CHECK(i18n.Format("farewell") == "Goodbye");
+	EOSERV_CHECK(i18n.Format("missing", 5) == "missing 5");
+}
+
+EOSERV_TEST(test_i18n_formats_arguments)
+{
+	I18N i18n(test::TemporaryFile("lang_args.ini", "line={1} {2} {3} {4}\n"));
+
+	EOSERV_CHECK(i18n.Format("line", -12, 2.5, true, std::string("x")) == "-12 2.5 yes x");
+	EOSERV_CHECK(i18n.Format("line", 1) == "1 #ERROR# #ERROR# #ERROR#");
+}
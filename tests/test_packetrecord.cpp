@@ -0,0 +1,31 @@
+/* tests/test_packetrecord.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "test.hpp"
+
+#include "packetrecord.hpp"
+
+#include <cstdint>
+#include <string>
+
+EOSERV_TEST(test_packetrecord_ids_survive_reopen)
+{
+	std::string filename = test::TemporaryFile("record.eorec", "");
+	PacketRecorder recorder;
+
+	EOSERV_CHECK(recorder.Connect() == 0);
+
+	EOSERV_CHECK(recorder.Open(filename));
+	std::uint32_t first = recorder.Connect();
+	EOSERV_CHECK(first != 0);
+
+	// A rehash reopens the file while clients recorded in the old one are still connected
+	EOSERV_CHECK(recorder.Open(filename));
+	std::uint32_t second = recorder.Connect();
+	EOSERV_CHECK(second != 0);
+	EOSERV_CHECK(second != first);
+
+	recorder.Close();
+}
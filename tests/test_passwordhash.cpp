@@ -0,0 +1,41 @@
+/* tests/test_passwordhash.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "test.hpp"
+
+#include "passwordhash.hpp"
+#include "socket.hpp"
+
+#include <string>
+
+EOSERV_TEST(test_passwordhash_dummy_hash)
+{
+	PasswordHasher hasher;
+	Password_Params params;
+	params.cost = 4;
+	params.block_size = 1;
+
+	hasher.Configure(0, params, 1, 0);
+
+	const std::string &dummy = hasher.DummyHash();
+	EOSERV_CHECK(dummy.length() <= Password_Params::StoredLength);
+	EOSERV_CHECK(!PasswordHasher::NeedsRehash(dummy, params));
+	EOSERV_CHECK(!PasswordHasher::Verify(dummy, ""));
+	EOSERV_CHECK(!PasswordHasher::Verify(dummy, "password"));
+
+	// Checking the dummy is held to the same per-address limit as a real hash
+	int owners[2];
+	IPAddress address("127.0.0.1");
+	int calls = 0;
+
+	EOSERV_CHECK(hasher.Verify(&owners[0], address, dummy, util::secure_string(std::string("password")),
+		[&](bool match, const std::string &) { EOSERV_CHECK(!match); ++calls; }) == PasswordHasher::Submitted);
+
+	EOSERV_CHECK(hasher.Verify(&owners[1], address, dummy, util::secure_string(std::string("password")),
+		[&](bool, const std::string &) { ++calls; }) == PasswordHasher::AddressBusy);
+
+	hasher.Poll();
+	EOSERV_CHECK(calls == 1);
+}
@@ -0,0 +1,228 @@
+/* tests/test_world.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "test.hpp"
+
+#include "command_source.hpp"
+#include "config.hpp"
+#include "eodata.hpp"
+#include "eoserv_config.hpp"
+#include "map.hpp"
+#include "npc.hpp"
+#include "packet.hpp"
+#include "timer.hpp"
+#include "world.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+void world_act_npcs(void *world_void);
+
+// The first map is packed with NPCs, the others only hold a few
+static const int test_map_npcs[] = {250, 5, 5};
+
+static std::string eo_number(unsigned int number, std::size_t size)
+{
+	std::array<unsigned char, 4> bytes = PacketProcessor::ENumber(number);
+	return std::string(bytes.begin(), bytes.begin() + size);
+}
+
+// Writes a pub file with one record per name, each with DATA_SIZE bytes of zeroed data unless overridden
+template <class T> static std::string test_pub_file(const std::string &filename, const char *magic,
+	const std::vector<std::pair<std::string, std::string>> &records)
+{
+	std::string contents = magic;
+	contents += eo_number(0, 2) + eo_number(0, 2);
+	contents += eo_number(records.size(), 2);
+	contents += eo_number(0, 1);
+
+	for (const auto &record : records)
+	{
+		contents += eo_number(record.first.length(), 1);
+
+		if (std::is_same<T, ESF>::value)
+			contents += eo_number(0, 1);
+
+		contents += record.first;
+
+		std::string data = record.second;
+		data.resize(T::DATA_SIZE, char(eo_number(0, 1)[0]));
+		contents += data;
+	}
+
+	return test::TemporaryFile(filename, contents);
+}
+
+// Every other field is zero, which gives an open 32x32 map with no tiles, warps or spawns
+static std::string test_map_file(int id, unsigned char revision)
+{
+	std::string emf(256, char(eo_number(0, 1)[0]));
+	emf.replace(0, 3, "EMF");
+	emf[0x03] = char(eo_number(revision, 1)[0]);
+	emf[0x25] = char(eo_number(31, 1)[0]);
+	emf[0x26] = char(eo_number(31, 1)[0]);
+
+	char filename[16];
+	std::snprintf(filename, sizeof filename, "%05i.emf", id);
+	return test::TemporaryFile(filename, emf);
+}
+
+static std::unique_ptr<World> test_create_world()
+{
+	Config config, aconfig;
+	aconfig.Read("admin.ini", true);
+	eoserv_config_validate_config(config);
+	eoserv_config_validate_admin(aconfig);
+
+	std::string empty = test::TemporaryFile("empty.ini", "");
+
+	std::string passive(ENF::DATA_SIZE, char(eo_number(0, 1)[0]));
+	passive.replace(7, 2, eo_number(ENF::Passive, 2));
+	passive.replace(11, 3, eo_number(100, 3));
+
+	config["DBType"] = "sqlite";
+	config["DBHost"] = ":memory:";
+	config["ServerLanguage"] = empty;
+	config["DropsFile"] = empty;
+	config["ShopsFile"] = empty;
+	config["ArenasFile"] = empty;
+	config["FormulasFile"] = empty;
+	config["HomeFile"] = empty;
+	config["SkillsFile"] = empty;
+	config["TimedSave"] = 0;
+	config["AutoSplitPubFiles"] = false;
+	config["Quests"] = 0;
+
+	config["EIF"] = test_pub_file<EIF>("pub.eif", "EIF", {{"Gold", ""}});
+	config["ENF"] = test_pub_file<ENF>("pub.enf", "ENF", {{"Passive", passive}});
+	config["ESF"] = test_pub_file<ESF>("pub.esf", "ESF", {{"Heal", ""}});
+	config["ECF"] = test_pub_file<ECF>("pub.ecf", "ECF", {{"Peasant", ""}});
+
+	config["MapDir"] = "./test_";
+	config["Maps"] = int(sizeof test_map_npcs / sizeof test_map_npcs[0]);
+
+	for (std::size_t i = 0; i < sizeof test_map_npcs / sizeof test_map_npcs[0]; ++i)
+		test_map_file(int(i + 1), 0);
+
+	std::array<std::string, 6> dbinfo;
+	dbinfo[0] = std::string(config["DBType"]);
+	dbinfo[1] = std::string(config["DBHost"]);
+	dbinfo[5] = "0";
+
+	std::unique_ptr<World> world(new World(dbinfo, config, aconfig));
+
+	for (std::size_t m = 0; m < world->maps.size(); ++m)
+	{
+		Map *map = world->maps[m];
+
+		// Maps are dormant until a character enters them
+		map->Wake();
+
+		for (int i = 0; i < test_map_npcs[m]; ++i)
+		{
+			NPC *npc = new NPC(map, 1, i % map->width, i / map->width, 0, 0, i + 1);
+			map->AddNPC(npc);
+			npc->Spawn();
+		}
+	}
+
+	return world;
+}
+
+// Makes every NPC on the map due to act
+static void test_npcs_due(Map *map)
+{
+	double now = Timer::GetTime();
+
+	for (NPC *npc : map->npcs)
+		map->act_queue.push(npc, now - 1.0);
+}
+
+EOSERV_TEST(test_world_act_npcs)
+{
+	std::unique_ptr<World> world = test_create_world();
+
+	std::vector<std::vector<double>> last_acts(world->maps.size());
+
+	for (std::size_t m = 0; m < world->maps.size(); ++m)
+	{
+		test_npcs_due(world->maps[m]);
+
+		for (NPC *npc : world->maps[m]->npcs)
+			last_acts[m].push_back(npc->last_act);
+	}
+
+	world_act_npcs(world.get());
+
+	for (std::size_t m = 0; m < world->maps.size(); ++m)
+	{
+		for (std::size_t i = 0; i < world->maps[m]->npcs.size(); ++i)
+			EOSERV_CHECK(world->maps[m]->npcs[i]->last_act != last_acts[m][i]);
+	}
+}
+
+EOSERV_TEST(test_world_map_file_read)
+{
+	std::unique_ptr<World> world = test_create_world();
+
+	Map_File file;
+	std::string error;
+	EOSERV_CHECK(file.Read(Map::Filename(world.get(), 1), 1, error));
+	EOSERV_CHECK(error.empty());
+	EOSERV_CHECK(file.width == 32 && file.height == 32);
+
+	// The map is unchanged, so reloading it leaves the NPCs alone
+	EOSERV_CHECK(!world->maps[0]->Reload(file));
+	EOSERV_CHECK(world->maps[0]->npcs.size() == std::size_t(test_map_npcs[0]));
+
+	Map_File missing;
+	EOSERV_CHECK(!missing.Read("./test_missing.emf", 1, error));
+	EOSERV_CHECK(error.empty());
+
+	Map_File truncated;
+	EOSERV_CHECK(!truncated.Read(test::TemporaryFile("truncated.emf", "EMF"), 1, error));
+	EOSERV_CHECK(!error.empty());
+}
+
+EOSERV_TEST(test_world_reload_map)
+{
+	std::unique_ptr<World> world = test_create_world();
+	System_Command_Source source(world.get());
+
+	// A new revision of the first map, which has none of the NPCs the test added
+	test_map_file(1, 1);
+
+	EOSERV_CHECK(world->ReloadMap(1, &source));
+	EOSERV_CHECK(!world->ReloadMap(2, &source));
+
+	while (world->ReloadingMap())
+	{
+		world->SwapMaps();
+		std::this_thread::yield();
+	}
+
+	EOSERV_CHECK(world->maps[0]->exists);
+	EOSERV_CHECK(world->maps[0]->npcs.empty());
+	EOSERV_CHECK(world->maps[1]->npcs.size() == std::size_t(test_map_npcs[1]));
+
+	// Maps past the last one are created, even if their file is missing
+	EOSERV_CHECK(world->ReloadMap(int(world->maps.size()) + 1, &source));
+
+	while (world->ReloadingMap())
+	{
+		world->SwapMaps();
+		std::this_thread::yield();
+	}
+
+	EOSERV_CHECK(world->maps.size() == sizeof test_map_npcs / sizeof test_map_npcs[0] + 1);
+	EOSERV_CHECK(!world->maps.back()->exists);
+}
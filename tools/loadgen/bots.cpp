@@ -0,0 +1,578 @@
+/* tools/loadgen/bots.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "loadgen.hpp"
+
+#include "connection.hpp"
+#include "stats.hpp"
+
+#include "fwd/character.hpp"
+#include "fwd/world.hpp"
+
+#include "packet.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <netinet/in.h>
+#include <poll.h>
+
+namespace
+{
+
+enum Bot_Action
+{
+	ActionWalk,
+	ActionChat,
+	ActionAttack,
+	ActionWarp,
+	ActionCount
+};
+
+struct Bot
+{
+	enum Stage
+	{
+		Waiting,
+		Init,
+		Accepted,
+		Login,
+		Select,
+		Enter,
+		Playing,
+		Failed
+	};
+
+	int index;
+	std::string name;
+	LoadgenConnection connection;
+	Stage stage = Waiting;
+
+	double connect_time = 0.0;
+	double login_sent = 0.0;
+	double next_action = 0.0;
+
+	int char_id = 0;
+	int player_id = 0;
+	int x = 0;
+	int steps = 0;
+	int step = 0;
+	int chat_serial = 0;
+
+	double walk_sent = -1.0;
+	double warp_sent = -1.0;
+};
+
+struct Bot_Results
+{
+	LatencyStats login;
+	LatencyStats actions[ActionCount];
+
+	int login_failures = 0;
+	int disconnects = 0;
+	std::unordered_map<int, int> login_replies;
+};
+
+const char *action_names[ActionCount] = {"walk", "chat", "attack", "warp"};
+
+// Replies slower than this are counted as lost
+const double reply_timeout = 10.0;
+
+class BotRunner
+{
+	private:
+		const LoadgenArgs &args;
+		sockaddr_in address;
+		std::vector<std::unique_ptr<Bot>> bots;
+		Bot_Results results;
+
+		std::string password;
+		int weights[ActionCount];
+		int weight_total;
+		double interval;
+		int warp_map, warp_x, warp_y;
+		double start;
+
+		// Broadcasts are timed by every bot that receives them
+		std::unordered_map<std::uint64_t, double> chat_sent;
+		std::unordered_map<int, double> attack_sent;
+
+		int Timestamp(double now) const
+		{
+			return 100 + int((now - this->start) * 100.0);
+		}
+
+		void Fail(Bot &bot)
+		{
+			if (bot.stage == Bot::Playing)
+				++this->results.disconnects;
+			else
+				++this->results.login_failures;
+
+			bot.stage = Bot::Failed;
+			bot.connection.Close();
+		}
+
+		void Act(Bot &bot, double now);
+		void Handle(Bot &bot, PacketReader &reader, double now);
+
+	public:
+		BotRunner(const LoadgenArgs &args) : args(args) { }
+
+		int Run();
+};
+
+void BotRunner::Act(Bot &bot, double now)
+{
+	int roll = util::rand(0, this->weight_total - 1);
+	int action = 0;
+
+	while (roll >= this->weights[action])
+		roll -= this->weights[action++];
+
+	switch (action)
+	{
+		case ActionWalk:
+		{
+			if (bot.walk_sent >= 0.0)
+				break;
+
+			Direction direction = (bot.steps++ % 2 == 0) ? DIRECTION_RIGHT : DIRECTION_LEFT;
+			bot.step = (direction == DIRECTION_RIGHT) ? 1 : -1;
+			bot.x += bot.step;
+
+			PacketBuilder builder = bot.connection.Begin(PACKET_WALK, PACKET_PLAYER);
+			builder.AddChar(direction);
+			builder.AddThree(this->Timestamp(now));
+			builder.AddChar(bot.x);
+			builder.AddChar(this->warp_y);
+			bot.connection.Send(builder);
+
+			bot.walk_sent = now;
+		}
+		break;
+
+		case ActionChat:
+		{
+			int serial = bot.chat_serial++;
+			this->chat_sent[(std::uint64_t(bot.index) << 32) | std::uint32_t(serial)] = now;
+
+			PacketBuilder builder = bot.connection.Begin(PACKET_TALK, PACKET_REPORT);
+			builder.AddString("lg " + util::to_string(bot.index) + " " + util::to_string(serial));
+			bot.connection.Send(builder);
+		}
+		break;
+
+		case ActionAttack:
+		{
+			this->attack_sent[bot.player_id] = now;
+
+			PacketBuilder builder = bot.connection.Begin(PACKET_ATTACK, PACKET_USE);
+			builder.AddChar(DIRECTION_DOWN);
+			builder.AddThree(this->Timestamp(now));
+			bot.connection.Send(builder);
+		}
+		break;
+
+		case ActionWarp:
+		{
+			if (bot.warp_sent >= 0.0)
+				break;
+
+			PacketBuilder builder = bot.connection.Begin(PACKET_TALK, PACKET_REPORT);
+			builder.AddString("$warp " + util::to_string(this->warp_map) + " " + util::to_string(this->warp_x) + " " + util::to_string(this->warp_y));
+			bot.connection.Send(builder);
+
+			bot.warp_sent = now;
+		}
+		break;
+	}
+}
+
+void BotRunner::Handle(Bot &bot, PacketReader &reader, double now)
+{
+	PacketFamily family = reader.Family();
+	PacketAction action = reader.Action();
+
+	if (family == PACKET_F_INIT && action == PACKET_A_INIT)
+	{
+		if (!bot.connection.Initialized())
+		{
+			this->Fail(bot);
+			return;
+		}
+
+		bot.connection.SendAccept();
+
+		bot.stage = Bot::Accepted;
+		bot.next_action = now + loadgen_accept_delay;
+	}
+	else if (family == PACKET_LOGIN && action == PACKET_REPLY && bot.stage == Bot::Login)
+	{
+		int reply = reader.GetShort();
+		++this->results.login_replies[reply];
+
+		if (reply != LOGIN_OK || reader.GetChar() < 1)
+		{
+			this->Fail(bot);
+			return;
+		}
+
+		reader.GetByte();
+		reader.GetByte();
+		reader.GetBreakString();
+		bot.char_id = reader.GetInt();
+
+		PacketBuilder builder = bot.connection.Begin(PACKET_WELCOME, PACKET_REQUEST);
+		builder.AddInt(bot.char_id);
+		bot.connection.Send(builder);
+
+		bot.stage = Bot::Select;
+	}
+	else if (family == PACKET_WELCOME && action == PACKET_REPLY)
+	{
+		int sub = reader.GetShort();
+
+		if (sub == 1 && bot.stage == Bot::Select)
+		{
+			bot.player_id = reader.GetShort();
+
+			PacketBuilder builder = bot.connection.Begin(PACKET_WELCOME, PACKET_MSG);
+			builder.AddThree(0);
+			builder.AddInt(bot.char_id);
+			bot.connection.Send(builder);
+
+			bot.stage = Bot::Enter;
+		}
+		else if (sub == 2 && bot.stage == Bot::Enter)
+		{
+			this->results.login.Add((now - bot.login_sent) * 1000.0);
+
+			bot.stage = Bot::Playing;
+			bot.x = this->warp_x;
+			bot.next_action = now + util::rand(0.0, this->interval);
+		}
+	}
+	else if (family == PACKET_WALK && action == PACKET_REPLY)
+	{
+		if (bot.walk_sent >= 0.0)
+			this->results.actions[ActionWalk].Add((now - bot.walk_sent) * 1000.0);
+
+		bot.walk_sent = -1.0;
+	}
+	else if (family == PACKET_REFRESH && action == PACKET_REPLY)
+	{
+		// Sent instead of a walk reply when the way was blocked, try the same step again next time
+		if (bot.walk_sent >= 0.0)
+		{
+			this->results.actions[ActionWalk].Add((now - bot.walk_sent) * 1000.0);
+			bot.x -= bot.step;
+			--bot.steps;
+		}
+
+		bot.walk_sent = -1.0;
+	}
+	else if (family == PACKET_TALK && action == PACKET_PLAYER)
+	{
+		reader.GetShort();
+		std::vector<std::string> parts = util::explode(' ', reader.GetEndString());
+
+		if (parts.size() != 3 || parts[0] != "lg")
+			return;
+
+		auto it = this->chat_sent.find((std::uint64_t(util::to_int(parts[1])) << 32) | std::uint32_t(util::to_int(parts[2])));
+
+		if (it != this->chat_sent.end())
+			this->results.actions[ActionChat].Add((now - it->second) * 1000.0);
+	}
+	else if (family == PACKET_ATTACK && action == PACKET_PLAYER)
+	{
+		auto it = this->attack_sent.find(reader.GetShort());
+
+		if (it != this->attack_sent.end())
+			this->results.actions[ActionAttack].Add((now - it->second) * 1000.0);
+	}
+	else if (family == PACKET_WARP && action == PACKET_REQUEST)
+	{
+		reader.GetChar();
+		int map = reader.GetShort();
+
+		PacketBuilder builder = bot.connection.Begin(PACKET_WARP, PACKET_ACCEPT);
+		builder.AddShort(map);
+		builder.AddShort(0);
+		bot.connection.Send(builder);
+	}
+	else if (family == PACKET_WARP && action == PACKET_AGREE)
+	{
+		if (bot.warp_sent >= 0.0)
+			this->results.actions[ActionWarp].Add((now - bot.warp_sent) * 1000.0);
+
+		bot.warp_sent = -1.0;
+		bot.x = this->warp_x;
+	}
+}
+
+int BotRunner::Run()
+{
+	std::string host = this->args.Get("host", "127.0.0.1");
+	int port = this->args.GetInt("port", 8078);
+	int count = this->args.GetInt("bots", 100);
+	double rate = this->args.GetDouble("rate", 50.0);
+	double duration = this->args.GetDouble("duration", 60.0);
+	std::string status = this->args.Get("status", "");
+	std::string json = this->args.Get("json", "");
+
+	this->password = this->args.Get("password", "loadgen");
+	this->interval = this->args.GetDouble("interval", 1.0);
+	this->warp_map = this->args.GetInt("map", 1);
+	this->warp_x = this->args.GetInt("x", 10);
+	this->warp_y = this->args.GetInt("y", 10);
+
+	std::vector<std::string> mix = util::explode(',', this->args.Get("mix", "50,20,20,10"));
+	this->weight_total = 0;
+
+	for (int i = 0; i < ActionCount; ++i)
+	{
+		this->weights[i] = (std::size_t(i) < mix.size()) ? std::max(util::to_int(mix[i]), 0) : 0;
+		this->weight_total += this->weights[i];
+	}
+
+	if (count <= 0 || rate <= 0.0 || this->interval <= 0.0 || this->weight_total <= 0)
+	{
+		std::fprintf(stderr, "Invalid bot options\n");
+		return 1;
+	}
+
+	if (!loadgen_resolve(host, port, this->address))
+	{
+		std::fprintf(stderr, "Could not resolve %s\n", host.c_str());
+		return 1;
+	}
+
+	loadgen_raise_fd_limit(std::size_t(count));
+
+	double tick_count_before = 0.0;
+	double tick_total_before = 0.0;
+
+	auto read_ticks = [&](double &tick_count, double &tick_total) -> bool
+	{
+		std::string body = loadgen_http_get(status, "/status");
+		std::size_t pos = body.find("\"tick\":{\"count\":");
+
+		if (pos == std::string::npos)
+			return false;
+
+		double avg_ms = 0.0;
+		unsigned long long ticks = 0;
+
+		if (std::sscanf(body.c_str() + pos, "\"tick\":{\"count\":%llu,\"avg_ms\":%lf", &ticks, &avg_ms) != 2)
+			return false;
+
+		tick_count = double(ticks);
+		tick_total = double(ticks) * avg_ms;
+		return true;
+	};
+
+	bool have_ticks = !status.empty() && read_ticks(tick_count_before, tick_total_before);
+
+	if (!status.empty() && !have_ticks)
+		std::fprintf(stderr, "Warning: could not read tick times from http://%s/status\n", status.c_str());
+
+	this->bots.reserve(std::size_t(count));
+
+	for (int i = 0; i < count; ++i)
+	{
+		this->bots.emplace_back(new Bot);
+		this->bots.back()->index = i;
+		this->bots.back()->name = loadgen_bot_name(i);
+	}
+
+	this->start = loadgen_clock();
+	double end = this->start + double(count) / rate + duration;
+	int next_connect = 0;
+
+	std::vector<pollfd> fds;
+	std::vector<Bot *> fd_bots;
+	std::vector<std::string> packets;
+
+	std::printf("Running %i bots for %.0f seconds...\n", count, end - this->start);
+
+	for (double now = this->start; now < end; now = loadgen_clock())
+	{
+		while (next_connect < count && this->start + double(next_connect) / rate <= now)
+		{
+			Bot &bot = *this->bots[next_connect++];
+			bot.connect_time = now;
+
+			if (!bot.connection.Connect(this->address))
+			{
+				this->Fail(bot);
+				continue;
+			}
+
+			bot.connection.SendInit(util::rand(0, 11092003), util::to_string(bot.index + 1));
+			bot.stage = Bot::Init;
+		}
+
+		fds.clear();
+		fd_bots.clear();
+
+		for (int i = 0; i < next_connect; ++i)
+		{
+			Bot &bot = *this->bots[i];
+
+			if (bot.connection.GetState() == LoadgenConnection::Closed)
+				continue;
+
+			fds.push_back(pollfd{bot.connection.FD(), bot.connection.PollEvents(), 0});
+			fd_bots.push_back(&bot);
+		}
+
+		poll(fds.data(), fds.size(), 5);
+		now = loadgen_clock();
+
+		for (std::size_t i = 0; i < fds.size(); ++i)
+		{
+			Bot &bot = *fd_bots[i];
+
+			if (fds[i].revents == 0)
+				continue;
+
+			packets.clear();
+			bool open = bot.connection.Poll(fds[i].revents, packets);
+
+			for (const std::string &packet : packets)
+			{
+				if (bot.stage == Bot::Failed)
+					break;
+
+				PacketReader reader(packet);
+				this->Handle(bot, reader, now);
+			}
+
+			if (!open && bot.stage != Bot::Failed)
+				this->Fail(bot);
+		}
+
+		for (int i = 0; i < next_connect; ++i)
+		{
+			Bot &bot = *this->bots[i];
+
+			if (bot.stage == Bot::Accepted && now >= bot.next_action)
+			{
+				PacketBuilder builder = bot.connection.Begin(PACKET_LOGIN, PACKET_REQUEST);
+				builder.AddBreakString(bot.name);
+				builder.AddBreakString(this->password);
+				bot.connection.Send(builder);
+
+				bot.stage = Bot::Login;
+				bot.login_sent = now;
+			}
+
+			if (bot.stage != Bot::Playing)
+			{
+				if (bot.stage != Bot::Failed && now - bot.connect_time > reply_timeout)
+					this->Fail(bot);
+
+				continue;
+			}
+
+			if (bot.walk_sent >= 0.0 && now - bot.walk_sent > reply_timeout)
+			{
+				this->results.actions[ActionWalk].Timeout();
+				bot.walk_sent = -1.0;
+			}
+
+			if (bot.warp_sent >= 0.0 && now - bot.warp_sent > reply_timeout)
+			{
+				this->results.actions[ActionWarp].Timeout();
+				bot.warp_sent = -1.0;
+			}
+
+			if (now >= bot.next_action)
+			{
+				this->Act(bot, now);
+				bot.next_action += this->interval;
+			}
+		}
+	}
+
+	double tick_count_after = 0.0;
+	double tick_total_after = 0.0;
+	double tick_avg_ms = -1.0;
+
+	if (have_ticks && read_ticks(tick_count_after, tick_total_after) && tick_count_after > tick_count_before)
+		tick_avg_ms = (tick_total_after - tick_total_before) / (tick_count_after - tick_count_before);
+
+	int playing = 0;
+
+	for (const std::unique_ptr<Bot> &bot : this->bots)
+	{
+		if (bot->stage == Bot::Playing)
+			++playing;
+	}
+
+	std::printf("\n%i/%i bots in game, %i failed to log in, %i disconnected\n", playing, count, this->results.login_failures, this->results.disconnects);
+
+	for (const auto &reply : this->results.login_replies)
+	{
+		if (reply.first != LOGIN_OK)
+			std::printf("Login reply %i: %i\n", reply.first, reply.second);
+	}
+
+	if (tick_avg_ms >= 0.0)
+		std::printf("Average server tick: %.3f ms\n", tick_avg_ms);
+
+	std::printf("\n%-8s %8s %8s %9s %9s %9s %9s %9s\n", "", "count", "timeout", "mean ms", "p50 ms", "p90 ms", "p99 ms", "max ms");
+	this->results.login.Print("login");
+
+	for (int i = 0; i < ActionCount; ++i)
+		this->results.actions[i].Print(action_names[i]);
+
+	if (!json.empty())
+	{
+		std::FILE *fh = std::fopen(json.c_str(), "w");
+
+		if (!fh)
+		{
+			std::fprintf(stderr, "Could not open %s\n", json.c_str());
+			return 1;
+		}
+
+		std::fprintf(fh, "{\"bots\":%i,\"playing\":%i,\"login_failures\":%i,\"disconnects\":%i,\"duration\":%.3f,",
+			count, playing, this->results.login_failures, this->results.disconnects, duration);
+
+		if (tick_avg_ms >= 0.0)
+			std::fprintf(fh, "\"tick_avg_ms\":%.3f,", tick_avg_ms);
+
+		this->results.login.WriteJSON(fh, "login");
+
+		for (int i = 0; i < ActionCount; ++i)
+		{
+			std::fputc(',', fh);
+			this->results.actions[i].WriteJSON(fh, action_names[i]);
+		}
+
+		std::fputs("}\n", fh);
+		std::fclose(fh);
+	}
+
+	return 0;
+}
+
+}
+
+int loadgen_bots(const LoadgenArgs &args)
+{
+	BotRunner runner(args);
+
+	return runner.Run();
+}
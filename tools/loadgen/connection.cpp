@@ -0,0 +1,292 @@
+/* tools/loadgen/connection.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "connection.hpp"
+
+#include "fwd/eoclient.hpp"
+#include "fwd/world.hpp"
+
+#include "packet.hpp"
+
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+LoadgenConnection::LoadgenConnection()
+	: fd(-1)
+	, state(Closed)
+	, seq_start(0)
+	, seq(0)
+	, initialized(false)
+	, server_emulti_e(0)
+	, server_emulti_d(0)
+	, client_id(0)
+{ }
+
+bool LoadgenConnection::Connect(const sockaddr_in &address)
+{
+	this->Close();
+
+	this->processor = PacketProcessor();
+	this->seq_start = 0;
+	this->seq = 0;
+	this->initialized = false;
+	this->client_id = 0;
+
+	this->fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (this->fd < 0)
+		return false;
+
+	int nodelay = 1;
+	setsockopt(this->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof nodelay);
+	fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) | O_NONBLOCK);
+
+	if (connect(this->fd, reinterpret_cast<const sockaddr *>(&address), sizeof address) == 0)
+	{
+		this->state = Connected;
+	}
+	else if (errno == EINPROGRESS)
+	{
+		this->state = Connecting;
+	}
+	else
+	{
+		this->Close();
+		return false;
+	}
+
+	return true;
+}
+
+void LoadgenConnection::Close()
+{
+	if (this->fd >= 0)
+		close(this->fd);
+
+	this->fd = -1;
+	this->state = Closed;
+	this->send_buffer.clear();
+	this->recv_buffer.clear();
+}
+
+short LoadgenConnection::PollEvents() const
+{
+	if (this->state == Connecting || !this->send_buffer.empty())
+		return POLLIN | POLLOUT;
+
+	return POLLIN;
+}
+
+void LoadgenConnection::SendInit(int challenge, const std::string &hdid)
+{
+	PacketBuilder builder(PACKET_F_INIT, PACKET_A_INIT, 6 + hdid.length());
+	builder.AddThree(challenge);
+	builder.AddChar(0);
+	builder.AddChar(0);
+	builder.AddChar(28); // version
+	builder.AddChar(112); // protocol
+	builder.AddChar(hdid.length());
+	builder.AddString(hdid);
+
+	this->SendInit(builder);
+}
+
+void LoadgenConnection::SendInit(const PacketBuilder &builder)
+{
+	// The server counts the Init packet towards the sequence too
+	this->seq = (this->seq + 1) % 10;
+
+	this->Send(builder);
+}
+
+void LoadgenConnection::SendAccept()
+{
+	PacketBuilder builder = this->Begin(PACKET_CONNECTION, PACKET_ACCEPT);
+	builder.AddShort(this->server_emulti_d);
+	builder.AddShort(this->server_emulti_e);
+	builder.AddShort(this->client_id);
+	this->Send(builder);
+}
+
+PacketBuilder LoadgenConnection::Begin(PacketFamily family, PacketAction action)
+{
+	int sequence = this->seq_start + this->seq;
+	this->seq = (this->seq + 1) % 10;
+
+	PacketBuilder builder(family, action);
+
+	if (sequence >= 253)
+		builder.AddShort(sequence);
+	else
+		builder.AddChar(sequence);
+
+	return builder;
+}
+
+void LoadgenConnection::Send(const PacketBuilder &builder)
+{
+	if (this->state == Closed)
+		return;
+
+	this->send_buffer += this->processor.Encode(builder.Get());
+
+	if (this->state == Connected)
+		this->Flush();
+}
+
+bool LoadgenConnection::Flush()
+{
+	while (!this->send_buffer.empty())
+	{
+		ssize_t sent = send(this->fd, this->send_buffer.data(), this->send_buffer.length(), MSG_NOSIGNAL);
+
+		if (sent < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				return true;
+
+			this->Close();
+			return false;
+		}
+
+		this->send_buffer.erase(0, std::size_t(sent));
+	}
+
+	return true;
+}
+
+bool LoadgenConnection::Receive(const std::string &decoded)
+{
+	PacketReader reader(decoded);
+
+	if (reader.Family() == PACKET_F_INIT && reader.Action() == PACKET_A_INIT)
+	{
+		if (reader.GetByte() != INIT_OK)
+			return true;
+
+		int s1 = reader.GetByte();
+		int s2 = reader.GetByte();
+		this->server_emulti_e = reader.GetByte();
+		this->server_emulti_d = reader.GetByte();
+		this->client_id = reader.GetShort();
+
+		this->seq_start = s1 * 7 + s2 - 13;
+		this->processor.SetEMulti(this->server_emulti_d, this->server_emulti_e);
+		this->initialized = true;
+	}
+	else if (reader.Family() == PACKET_CONNECTION && reader.Action() == PACKET_PLAYER)
+	{
+		int s1 = reader.GetShort();
+		int s2 = reader.GetChar();
+
+		// The server switches sequence when it receives the ping reply, so the reply itself uses the new one
+		this->seq_start = s1 - s2;
+
+		PacketBuilder builder = this->Begin(PACKET_CONNECTION, PACKET_PING);
+		builder.AddString("k");
+		this->Send(builder);
+
+		return false;
+	}
+	else if (reader.Family() == PACKET_ACCOUNT && reader.Action() == PACKET_REPLY)
+	{
+		if (reader.GetShort() == ACCOUNT_CONTINUE)
+			this->seq_start = reader.GetChar();
+	}
+
+	return true;
+}
+
+bool LoadgenConnection::Poll(short revents, std::vector<std::string> &packets)
+{
+	if (this->state == Closed)
+		return false;
+
+	if (this->state == Connecting)
+	{
+		if (!(revents & (POLLOUT | POLLERR | POLLHUP)))
+			return true;
+
+		int error = 0;
+		socklen_t error_size = sizeof error;
+
+		if (getsockopt(this->fd, SOL_SOCKET, SO_ERROR, &error, &error_size) != 0 || error != 0)
+		{
+			this->Close();
+			return false;
+		}
+
+		this->state = Connected;
+	}
+
+	if (revents & (POLLIN | POLLHUP | POLLERR))
+	{
+		char buffer[8192];
+		bool hangup = false;
+
+		for (;;)
+		{
+			ssize_t received = recv(this->fd, buffer, sizeof buffer, 0);
+
+			if (received > 0)
+			{
+				this->recv_buffer.append(buffer, std::size_t(received));
+				continue;
+			}
+
+			if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+				break;
+
+			hangup = true;
+			break;
+		}
+
+		// Replies sent while handling packets may close the connection, so work on a copy of the buffer
+		std::string data;
+		data.swap(this->recv_buffer);
+		std::size_t pos = 0;
+
+		while (data.length() - pos >= 2)
+		{
+			std::size_t length = PacketProcessor::Number(data[pos], data[pos + 1]);
+
+			if (data.length() - pos - 2 < length)
+				break;
+
+			if (length >= 2)
+			{
+				std::string decoded = this->processor.Decode(data.substr(pos + 2, length));
+
+				if (this->Receive(decoded))
+					packets.push_back(decoded);
+			}
+
+			pos += 2 + length;
+		}
+
+		if (hangup)
+			this->Close();
+		else if (this->state != Closed)
+			this->recv_buffer = data.substr(pos);
+	}
+
+	if (this->state == Closed)
+		return false;
+
+	return this->Flush();
+}
+
+LoadgenConnection::~LoadgenConnection()
+{
+	this->Close();
+}
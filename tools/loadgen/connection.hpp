@@ -0,0 +1,95 @@
+/* tools/loadgen/connection.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef LOADGEN_CONNECTION_HPP_INCLUDED
+#define LOADGEN_CONNECTION_HPP_INCLUDED
+
+#include "packet.hpp"
+
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+
+/**
+ * A game client connection on a non-blocking socket
+ * Follows the same sequence and encoding rules as EOClient, from the client's side. Pings and sequence changes from the server are answered automatically.
+ */
+class LoadgenConnection
+{
+	public:
+		enum State
+		{
+			Closed,
+			Connecting,
+			Connected
+		};
+
+	private:
+		int fd;
+		State state;
+
+		PacketProcessor processor;
+		int seq_start;
+		int seq;
+
+		bool initialized;
+		int server_emulti_e;
+		int server_emulti_d;
+		int client_id;
+
+		std::string send_buffer;
+		std::string recv_buffer;
+
+		bool Flush();
+		bool Receive(const std::string &decoded);
+
+	public:
+		LoadgenConnection();
+		LoadgenConnection(const LoadgenConnection &) = delete;
+		LoadgenConnection &operator=(const LoadgenConnection &) = delete;
+
+		bool Connect(const sockaddr_in &address);
+		void Close();
+
+		State GetState() const { return this->state; }
+		int FD() const { return this->fd; }
+
+		/**
+		 * Checks if the server has answered the Init packet, after which other packets may be sent
+		 */
+		bool Initialized() const { return this->initialized; }
+		int ClientID() const { return this->client_id; }
+
+		/**
+		 * Events the socket should be polled for
+		 */
+		short PollEvents() const;
+
+		void SendInit(int challenge, const std::string &hdid);
+		void SendInit(const PacketBuilder &builder);
+
+		/**
+		 * Sends the Connection Accept packet confirming the values from the Init reply
+		 */
+		void SendAccept();
+
+		/**
+		 * Starts a packet with the next sequence number
+		 * Packets must be sent in the same order they were started.
+		 */
+		PacketBuilder Begin(PacketFamily family, PacketAction action);
+		void Send(const PacketBuilder &builder);
+
+		/**
+		 * Handles socket activity, appending each decoded packet that was received
+		 * @return false if the connection was closed
+		 */
+		bool Poll(short revents, std::vector<std::string> &packets);
+
+		~LoadgenConnection();
+};
+
+#endif // LOADGEN_CONNECTION_HPP_INCLUDED
@@ -0,0 +1,68 @@
+/* tools/loadgen/loadgen.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef LOADGEN_LOADGEN_HPP_INCLUDED
+#define LOADGEN_LOADGEN_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include <netinet/in.h>
+
+/**
+ * Seconds to wait after sending Connection Accept, which gets no reply
+ * The server rejects anything but connection packets until it has handled it.
+ */
+const double loadgen_accept_delay = 0.2;
+
+/**
+ * Command line options in the form "--name value"
+ * Options given without a value are set to "1".
+ */
+class LoadgenArgs
+{
+	private:
+		std::unordered_map<std::string, std::string> values;
+
+	public:
+		/**
+		 * @return false if an argument was not an option
+		 */
+		bool Parse(int argc, char **argv, int first);
+
+		bool Has(const std::string &name) const;
+		std::string Get(const std::string &name, const std::string &def) const;
+		int GetInt(const std::string &name, int def) const;
+		double GetDouble(const std::string &name, double def) const;
+};
+
+/**
+ * Seconds on a monotonic clock
+ */
+double loadgen_clock();
+
+bool loadgen_resolve(const std::string &host, int port, sockaddr_in &address);
+
+/**
+ * Raises the open file limit to fit the given number of connections
+ */
+void loadgen_raise_fd_limit(std::size_t connections);
+
+/**
+ * Fetches the response body of an HTTP GET request, or an empty string on failure
+ */
+std::string loadgen_http_get(const std::string &host_port, const std::string &path);
+
+/**
+ * Account and character name used by a bot, which must only contain letters
+ */
+std::string loadgen_bot_name(int index);
+
+int loadgen_setup(const LoadgenArgs &args);
+int loadgen_bots(const LoadgenArgs &args);
+int loadgen_replay(const std::string &filename, const LoadgenArgs &args);
+
+#endif // LOADGEN_LOADGEN_HPP_INCLUDED
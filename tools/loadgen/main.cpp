@@ -0,0 +1,286 @@
+/* tools/loadgen/main.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "loadgen.hpp"
+
+#include "hash.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void usage(const char *name)
+{
+	std::printf(
+		"Usage: %s <mode> [options]\n"
+		"\n"
+		"  setup                 Prints SQL creating the bot accounts and characters\n"
+		"    --bots N            Number of bots (100)\n"
+		"    --salt SALT         PasswordSalt from the server config\n"
+		"    --password PASS     Password for every bot account (loadgen)\n"
+		"    --map M --x X --y Y Where the bot characters start (1, 10, 10)\n"
+		"    --admin             Makes the bots admins so they can use $warp\n"
+		"\n"
+		"  bots                  Logs in scripted bots and measures response times\n"
+		"    --host H --port P   Server address (127.0.0.1, 8078)\n"
+		"    --bots N            Number of bots (100)\n"
+		"    --rate R            New connections per second (50)\n"
+		"    --duration T        Seconds to keep running once every bot has connected (60)\n"
+		"    --interval I        Seconds between each bot's actions (1)\n"
+		"    --mix W,C,A,P       Weights of walk, chat, attack and warp actions (50,20,20,10)\n"
+		"    --password PASS     Password for every bot account (loadgen)\n"
+		"    --map M --x X --y Y Where $warp sends the bots (1, 10, 10)\n"
+		"    --status H:P        Status server to read the average tick time from\n"
+		"    --json FILE         Writes the results as JSON\n"
+		"\n"
+		"  replay FILE           Replays a recording made with the PacketRecord option\n"
+		"    --host H --port P   Server address (127.0.0.1, 8078)\n"
+		"    --speed S           Playback speed multiplier (1)\n"
+		"\n"
+		"The server should be configured with MaxConnectionsPerIP, MaxConnectionsPerPC and\n"
+		"IPReconnectLimit set to 0, and built with SOCKET_POLL for more than 1000 bots.\n",
+		name);
+}
+
+bool LoadgenArgs::Parse(int argc, char **argv, int first)
+{
+	for (int i = first; i < argc; ++i)
+	{
+		if (std::strncmp(argv[i], "--", 2) != 0)
+			return false;
+
+		std::string name(argv[i] + 2);
+
+		if (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0)
+			this->values[name] = argv[++i];
+		else
+			this->values[name] = "1";
+	}
+
+	return true;
+}
+
+bool LoadgenArgs::Has(const std::string &name) const
+{
+	return this->values.find(name) != this->values.end();
+}
+
+std::string LoadgenArgs::Get(const std::string &name, const std::string &def) const
+{
+	auto it = this->values.find(name);
+
+	return (it != this->values.end()) ? it->second : def;
+}
+
+int LoadgenArgs::GetInt(const std::string &name, int def) const
+{
+	auto it = this->values.find(name);
+
+	return (it != this->values.end()) ? util::to_int(it->second) : def;
+}
+
+double LoadgenArgs::GetDouble(const std::string &name, double def) const
+{
+	auto it = this->values.find(name);
+
+	return (it != this->values.end()) ? util::tdparse(it->second) : def;
+}
+
+double loadgen_clock()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool loadgen_resolve(const std::string &host, int port, sockaddr_in &address)
+{
+	addrinfo hints;
+	addrinfo *result;
+
+	std::memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0)
+		return false;
+
+	std::memcpy(&address, result->ai_addr, sizeof address);
+	address.sin_port = htons(port);
+
+	freeaddrinfo(result);
+
+	return true;
+}
+
+void loadgen_raise_fd_limit(std::size_t connections)
+{
+	rlimit limit;
+
+	if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+		return;
+
+	rlim_t wanted = rlim_t(connections + 64);
+
+	if (limit.rlim_cur >= wanted)
+		return;
+
+	limit.rlim_cur = std::min(wanted, limit.rlim_max);
+
+	if (setrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur < wanted)
+		std::fprintf(stderr, "Warning: open file limit is %llu, not enough for %zu connections\n",
+			static_cast<unsigned long long>(limit.rlim_cur), connections);
+}
+
+std::string loadgen_http_get(const std::string &host_port, const std::string &path)
+{
+	std::size_t colon = host_port.find_last_of(':');
+
+	if (colon == std::string::npos)
+		return std::string();
+
+	sockaddr_in address;
+
+	if (!loadgen_resolve(host_port.substr(0, colon), util::to_int(host_port.substr(colon + 1)), address))
+		return std::string();
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0)
+		return std::string();
+
+	timeval timeout = {5, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+
+	std::string response;
+
+	if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof address) == 0)
+	{
+		std::string request = "GET " + path + " HTTP/1.0\r\nHost: " + host_port + "\r\nConnection: close\r\n\r\n";
+
+		if (send(fd, request.data(), request.length(), MSG_NOSIGNAL) == ssize_t(request.length()))
+		{
+			char buffer[4096];
+			ssize_t received;
+
+			while ((received = recv(fd, buffer, sizeof buffer, 0)) > 0)
+				response.append(buffer, std::size_t(received));
+		}
+	}
+
+	close(fd);
+
+	std::size_t body = response.find("\r\n\r\n");
+
+	return (body != std::string::npos) ? response.substr(body + 4) : std::string();
+}
+
+std::string loadgen_bot_name(int index)
+{
+	std::string name = "lg";
+
+	for (int i = 4; i >= 0; --i)
+	{
+		int divisor = 1;
+
+		for (int j = 0; j < i; ++j)
+			divisor *= 26;
+
+		name += char('a' + (index / divisor) % 26);
+	}
+
+	return name;
+}
+
+int loadgen_setup(const LoadgenArgs &args)
+{
+	int bots = args.GetInt("bots", 100);
+	std::string salt = args.Get("salt", "");
+	std::string password = args.Get("password", "loadgen");
+	int map = args.GetInt("map", 1);
+	int x = args.GetInt("x", 10);
+	int y = args.GetInt("y", 10);
+	int admin = args.Has("admin") ? 2 : 0;
+
+	if (!args.Has("salt"))
+		std::fprintf(stderr, "Warning: no --salt given, the bots can only log in if PasswordSalt is empty\n");
+
+	std::printf("BEGIN;\n");
+
+	for (int i = 0; i < bots; ++i)
+	{
+		std::string name = loadgen_bot_name(i);
+
+		// Stored as legacy sha256 hashes, which the server upgrades on first login if scrypt is enabled
+		std::printf("INSERT INTO `accounts` (`username`, `password`, `fullname`, `location`, `email`, `computer`, `hdid`, `regip`, `created`)"
+			" VALUES ('%s', '%s', 'loadgen', '', '', 'loadgen', 0, '127.0.0.1', 0);\n",
+			name.c_str(), sha256(salt + name + password).c_str());
+
+		std::printf("INSERT INTO `characters` (`name`, `account`, `admin`, `map`, `x`, `y`, `inventory`, `bank`, `paperdoll`, `spells`, `quest`, `vars`)"
+			" VALUES ('%s', '%s', %i, %i, %i, %i, '', '', '', '', '', '');\n",
+			name.c_str(), name.c_str(), admin, map, x, y);
+	}
+
+	std::printf("COMMIT;\n");
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || std::strcmp(argv[1], "--help") == 0)
+	{
+		usage(argv[0]);
+		return (argc < 2) ? 1 : 0;
+	}
+
+	std::string mode = argv[1];
+	LoadgenArgs args;
+
+	if (mode == "setup")
+	{
+		if (!args.Parse(argc, argv, 2))
+		{
+			usage(argv[0]);
+			return 1;
+		}
+
+		return loadgen_setup(args);
+	}
+	else if (mode == "bots")
+	{
+		if (!args.Parse(argc, argv, 2))
+		{
+			usage(argv[0]);
+			return 1;
+		}
+
+		return loadgen_bots(args);
+	}
+	else if (mode == "replay")
+	{
+		if (argc < 3 || !args.Parse(argc, argv, 3))
+		{
+			usage(argv[0]);
+			return 1;
+		}
+
+		return loadgen_replay(argv[2], args);
+	}
+
+	usage(argv[0]);
+	return 1;
+}
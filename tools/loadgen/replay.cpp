@@ -0,0 +1,316 @@
+/* tools/loadgen/replay.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "loadgen.hpp"
+
+#include "connection.hpp"
+
+#include "fwd/world.hpp"
+
+#include "packet.hpp"
+#include "packetrecord.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+#include <poll.h>
+
+namespace
+{
+
+struct Replay_Connection
+{
+	LoadgenConnection connection;
+	std::deque<PacketRecord> events;
+	bool started = false;
+	double held_since = -1.0;
+	double accept_sent = -1.0;
+
+	// Character IDs are handed out as characters are loaded, so they can differ from the recorded session
+	std::vector<unsigned int> live_characters;
+	std::map<unsigned int, unsigned int> character_ids;
+
+	void Received(const std::string &packet);
+	std::string MapCharacter(const std::string &payload, std::size_t offset);
+};
+
+// Connections still waiting for an Init reply after this long are abandoned
+const double init_timeout = 10.0;
+
+void Replay_Connection::Received(const std::string &packet)
+{
+	PacketReader reader(packet);
+
+	if (reader.Family() != PACKET_LOGIN || reader.Action() != PACKET_REPLY || reader.GetShort() != LOGIN_OK)
+		return;
+
+	int count = reader.GetChar();
+	reader.GetByte();
+	reader.GetByte();
+
+	this->live_characters.clear();
+	this->character_ids.clear();
+
+	for (int i = 0; i < count && reader.Remaining() > 0; ++i)
+	{
+		reader.GetBreakString();
+		this->live_characters.push_back(reader.GetInt());
+		reader.GetBreakString(); // level, appearance, admin level and paperdoll
+	}
+}
+
+std::string Replay_Connection::MapCharacter(const std::string &payload, std::size_t offset)
+{
+	if (payload.length() < offset + 4 || this->live_characters.empty())
+		return payload;
+
+	PacketReader reader(std::string(2, '\0') + payload.substr(offset, 4));
+	unsigned int recorded = reader.GetInt();
+
+	auto it = this->character_ids.find(recorded);
+
+	if (it == this->character_ids.end())
+	{
+		// Recorded IDs are matched to live characters in the order they are first used
+		unsigned int live = this->live_characters[std::min(this->character_ids.size(), this->live_characters.size() - 1)];
+
+		if (std::find(UTIL_CRANGE(this->live_characters), recorded) != this->live_characters.end())
+			live = recorded;
+
+		it = this->character_ids.insert({recorded, live}).first;
+	}
+
+	PacketBuilder builder;
+	builder.AddInt(it->second);
+
+	std::string mapped = payload;
+	mapped.replace(offset, 4, builder.Get().substr(4));
+
+	return mapped;
+}
+
+}
+
+int loadgen_replay(const std::string &filename, const LoadgenArgs &args)
+{
+	std::string host = args.Get("host", "127.0.0.1");
+	int port = args.GetInt("port", 8078);
+	double speed = args.GetDouble("speed", 1.0);
+
+	if (speed <= 0.0)
+	{
+		std::fprintf(stderr, "Invalid speed\n");
+		return 1;
+	}
+
+	sockaddr_in address;
+
+	if (!loadgen_resolve(host, port, address))
+	{
+		std::fprintf(stderr, "Could not resolve %s\n", host.c_str());
+		return 1;
+	}
+
+	std::FILE *fh = std::fopen(filename.c_str(), "rb");
+
+	if (!fh)
+	{
+		std::fprintf(stderr, "Could not open %s\n", filename.c_str());
+		return 1;
+	}
+
+	if (!PacketRecorder::ReadHeader(fh))
+	{
+		std::fprintf(stderr, "%s is not a packet recording\n", filename.c_str());
+		std::fclose(fh);
+		return 1;
+	}
+
+	std::map<std::uint32_t, std::unique_ptr<Replay_Connection>> connections;
+	PacketRecord record;
+	double recorded_length = 0.0;
+	std::size_t recorded_packets = 0;
+
+	while (PacketRecorder::Read(fh, record))
+	{
+		std::unique_ptr<Replay_Connection> &connection = connections[record.connection];
+
+		if (!connection)
+			connection.reset(new Replay_Connection);
+
+		recorded_length = record.time;
+
+		if (record.event == PacketRecord::Packet)
+			++recorded_packets;
+
+		connection->events.push_back(std::move(record));
+		record = PacketRecord();
+	}
+
+	std::fclose(fh);
+
+	std::printf("Replaying %zu packets from %zu connections over %.1f seconds...\n", recorded_packets, connections.size(), recorded_length / speed);
+
+	loadgen_raise_fd_limit(connections.size());
+
+	std::size_t sent = 0;
+	std::size_t received = 0;
+	std::size_t dropped = 0;
+	std::size_t abandoned = 0;
+	double max_lag = 0.0;
+
+	std::vector<pollfd> fds;
+	std::vector<Replay_Connection *> fd_connections;
+	std::vector<std::string> packets;
+
+	double start = loadgen_clock();
+	double finished = -1.0;
+
+	for (;;)
+	{
+		double now = loadgen_clock();
+		double position = (now - start) * speed;
+		bool pending = false;
+
+		for (auto &entry : connections)
+		{
+			Replay_Connection &c = *entry.second;
+
+			while (!c.events.empty() && c.events.front().time <= position)
+			{
+				PacketRecord &event = c.events.front();
+
+				if (event.event == PacketRecord::Connect)
+				{
+					c.started = c.connection.Connect(address);
+				}
+				else if (event.event == PacketRecord::Disconnect)
+				{
+					c.connection.Close();
+				}
+				else if (!c.started || c.connection.GetState() == LoadgenConnection::Closed || event.data.length() < 2)
+				{
+					++dropped;
+				}
+				else
+				{
+					PacketAction action = PacketAction(static_cast<unsigned char>(event.data[0]));
+					PacketFamily family = PacketFamily(static_cast<unsigned char>(event.data[1]));
+
+					if (family == PACKET_F_INIT && action == PACKET_A_INIT)
+					{
+						PacketBuilder builder(family, action, event.data.length());
+						builder.AddString(event.data.substr(2));
+						c.connection.SendInit(builder);
+						++sent;
+					}
+					else if (!c.connection.Initialized())
+					{
+						// Everything after the Init packet depends on the server's reply to it
+						if (c.held_since < 0.0)
+							c.held_since = now;
+
+						if (now - c.held_since > init_timeout)
+						{
+							++abandoned;
+							dropped += c.events.size();
+							c.events.clear();
+							c.connection.Close();
+						}
+
+						break;
+					}
+					else if (family == PACKET_CONNECTION && action == PACKET_ACCEPT)
+					{
+						// Confirms values from the Init reply, which differ from the recorded session
+						c.connection.SendAccept();
+						c.accept_sent = now;
+						++sent;
+					}
+					else if (family != PACKET_CONNECTION && now - c.accept_sent < loadgen_accept_delay)
+					{
+						// Fast playback could otherwise send the next packet before the server handled Accept
+						break;
+					}
+					else if (family == PACKET_CONNECTION && action == PACKET_PING)
+					{
+						// Live pings are answered by the connection itself
+					}
+					else
+					{
+						std::string payload = event.data.substr(2);
+
+						if (family == PACKET_WELCOME && action == PACKET_REQUEST)
+							payload = c.MapCharacter(payload, 0);
+						else if (family == PACKET_WELCOME && action == PACKET_MSG)
+							payload = c.MapCharacter(payload, 3);
+
+						PacketBuilder builder = c.connection.Begin(family, action);
+						builder.AddString(payload);
+						c.connection.Send(builder);
+						++sent;
+					}
+				}
+
+				max_lag = std::max(max_lag, position - event.time);
+				c.events.pop_front();
+			}
+
+			if (!c.events.empty())
+				pending = true;
+		}
+
+		if (!pending)
+		{
+			// Give the server a moment to answer the last packets before hanging up
+			if (finished < 0.0)
+				finished = now;
+			else if (now - finished > 1.0)
+				break;
+		}
+
+		fds.clear();
+		fd_connections.clear();
+
+		for (auto &entry : connections)
+		{
+			Replay_Connection &c = *entry.second;
+
+			if (c.connection.GetState() == LoadgenConnection::Closed)
+				continue;
+
+			fds.push_back(pollfd{c.connection.FD(), c.connection.PollEvents(), 0});
+			fd_connections.push_back(&c);
+		}
+
+		poll(fds.data(), fds.size(), 1);
+
+		for (std::size_t i = 0; i < fds.size(); ++i)
+		{
+			if (fds[i].revents == 0)
+				continue;
+
+			packets.clear();
+			fd_connections[i]->connection.Poll(fds[i].revents, packets);
+			received += packets.size();
+
+			for (const std::string &packet : packets)
+				fd_connections[i]->Received(packet);
+		}
+	}
+
+	std::printf("Finished in %.1f seconds: %zu packets sent, %zu dropped, %zu received, %zu connections abandoned, %.1f ms maximum lag\n",
+		loadgen_clock() - start, sent, dropped, received, abandoned, max_lag / speed * 1000.0);
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+/* tools/loadgen/stats.cpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+double LatencyStats::Mean() const
+{
+	if (this->samples.empty())
+		return 0.0;
+
+	double total = 0.0;
+
+	for (double sample : this->samples)
+		total += sample;
+
+	return total / double(this->samples.size());
+}
+
+double LatencyStats::Max() const
+{
+	if (this->samples.empty())
+		return 0.0;
+
+	return *std::max_element(this->samples.begin(), this->samples.end());
+}
+
+double LatencyStats::Percentile(double p) const
+{
+	if (this->samples.empty())
+		return 0.0;
+
+	std::vector<double> sorted(this->samples);
+	std::size_t rank = std::size_t(std::ceil(p / 100.0 * double(sorted.size())));
+	rank = std::min(std::max<std::size_t>(rank, 1), sorted.size()) - 1;
+
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+	return sorted[rank];
+}
+
+void LatencyStats::Print(const char *name) const
+{
+	std::printf("%-8s %8zu %8i %9.2f %9.2f %9.2f %9.2f %9.2f\n", name, this->Count(), this->timeouts,
+		this->Mean(), this->Percentile(50), this->Percentile(90), this->Percentile(99), this->Max());
+}
+
+void LatencyStats::WriteJSON(std::FILE *fh, const char *name) const
+{
+	std::fprintf(fh, "\"%s\":{\"count\":%zu,\"timeouts\":%i,\"mean_ms\":%.3f,\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}",
+		name, this->Count(), this->timeouts, this->Mean(), this->Percentile(50), this->Percentile(90), this->Percentile(99), this->Max());
+}
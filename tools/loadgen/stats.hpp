@@ -0,0 +1,46 @@
+/* tools/loadgen/stats.hpp
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef LOADGEN_STATS_HPP_INCLUDED
+#define LOADGEN_STATS_HPP_INCLUDED
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Collects latency samples for one kind of request
+ */
+class LatencyStats
+{
+	private:
+		std::vector<double> samples;
+		int timeouts;
+
+	public:
+		LatencyStats() : timeouts(0) { }
+
+		/**
+		 * @param ms Milliseconds between the request and its reply
+		 */
+		void Add(double ms) { this->samples.push_back(ms); }
+		void Timeout() { ++this->timeouts; }
+
+		std::size_t Count() const { return this->samples.size(); }
+		int Timeouts() const { return this->timeouts; }
+
+		double Mean() const;
+		double Max() const;
+
+		/**
+		 * @param p Percentile between 0 and 100
+		 */
+		double Percentile(double p) const;
+
+		void Print(const char *name) const;
+		void WriteJSON(std::FILE *fh, const char *name) const;
+};
+
+#endif // LOADGEN_STATS_HPP_INCLUDED
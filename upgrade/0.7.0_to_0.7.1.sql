@@ -0,0 +1,18 @@
+ALTER TABLE `bans`
+    ADD COLUMN `ip_prefix` INTEGER DEFAULT NULL;
+
+ALTER TABLE `accounts`
+    MODIFY `password` VARCHAR(128) NOT NULL;
+
+CREATE TABLE IF NOT EXISTS `board_posts`
+(
+	`board`        INTEGER     NOT NULL,
+	`id`           INTEGER     NOT NULL,
+	`author`       VARCHAR(16) NOT NULL,
+	`author_admin` INTEGER     NOT NULL DEFAULT 0,
+	`subject`      TEXT        NOT NULL,
+	`body`         TEXT        NOT NULL,
+	`time`         INTEGER     NOT NULL,
+
+	PRIMARY KEY (`board`, `id`)
+);